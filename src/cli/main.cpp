@@ -0,0 +1,170 @@
+#include "reportwriter.h"
+#include "model/mediaanalyzer.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QThreadPool>
+#include <QThread>
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QDebug>
+#include <atomic>
+#include <cstdio>
+
+namespace {
+
+bool quietMode = false;
+
+void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    Q_UNUSED(context);
+    if (quietMode && (type == QtDebugMsg || type == QtInfoMsg)) {
+        return;
+    }
+    fprintf(stderr, "%s\n", qPrintable(message));
+}
+
+QStringList readFileList(const QString &listPath)
+{
+    QStringList paths;
+    QFile file;
+    if (listPath == "-") {
+        file.open(stdin, QIODevice::ReadOnly | QIODevice::Text);
+    } else {
+        file.setFileName(listPath);
+        file.open(QIODevice::ReadOnly | QIODevice::Text);
+    }
+
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        if (!line.isEmpty() && !line.startsWith('#')) {
+            paths.append(line);
+        }
+    }
+    return paths;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("legilimens-cli");
+    QCoreApplication::setApplicationVersion("0.1");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Analyse media files without a display and write their stream information "
+                                     "and packet tables as JSON Lines or CSV.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption formatOption({"f", "format"}, "Output format: jsonl (default) or csv.", "format", "jsonl");
+    QCommandLineOption outputOption({"o", "output-dir"}, "Write one report per input into <dir> instead of standard output.", "dir");
+    QCommandLineOption jobsOption({"j", "jobs"}, "Number of files analysed concurrently (default: number of cores).", "n");
+    QCommandLineOption listOption({"l", "list"}, "Read input paths from <file>, one per line ('-' for standard input).", "file");
+    QCommandLineOption tableOption("table", "CSV table written to standard output: packets (default) or streams.", "table", "packets");
+    QCommandLineOption streamsOnlyOption("streams-only", "Probe the streams only, without parsing packets.");
+    QCommandLineOption indexCacheOption("index-cache", "Load and save the persistent packet index in the user cache.");
+    QCommandLineOption readAheadOption("read-ahead", "Read-ahead block size in MiB (default: 8, 0 disables).", "mib", "8");
+    QCommandLineOption mmapOption("mmap", "Demux from a memory mapping of each file instead of read-ahead blocks.");
+    QCommandLineOption followOption("follow", "Follow files that are still being written until they stop growing for <seconds>.", "seconds");
+    QCommandLineOption quietOption({"q", "quiet"}, "Suppress diagnostic output.");
+    parser.addOptions({ formatOption, outputOption, jobsOption, listOption, tableOption,
+                        streamsOnlyOption, indexCacheOption, readAheadOption, mmapOption, followOption, quietOption });
+    parser.addPositionalArgument("files", "Media files to analyse; pipes and sockets are read as streams, '-' reads standard input.", "[files...]");
+    parser.process(app);
+
+    quietMode = parser.isSet(quietOption);
+    qInstallMessageHandler(messageHandler);
+
+    QStringList files = parser.positionalArguments();
+    if (parser.isSet(listOption)) {
+        files += readFileList(parser.value(listOption));
+    }
+    if (files.isEmpty()) {
+        fprintf(stderr, "No input files\n");
+        parser.showHelp(2);
+    }
+    if (files.count("-") > (parser.value(listOption) == "-" ? 0 : 1)) {
+        fprintf(stderr, "Standard input can only be read once\n");
+        return 2;
+    }
+
+    const QString format = parser.value(formatOption);
+    if (format != "jsonl" && format != "csv") {
+        fprintf(stderr, "Unknown format: %s\n", qPrintable(format));
+        return 2;
+    }
+    const QString table = parser.value(tableOption);
+    if (table != "packets" && table != "streams") {
+        fprintf(stderr, "Unknown table: %s\n", qPrintable(table));
+        return 2;
+    }
+
+    int jobs = QThread::idealThreadCount();
+    if (parser.isSet(jobsOption)) {
+        bool valid = false;
+        jobs = parser.value(jobsOption).toInt(&valid);
+        if (!valid || jobs < 1) {
+            fprintf(stderr, "Invalid job count: %s\n", qPrintable(parser.value(jobsOption)));
+            return 2;
+        }
+    }
+
+    bool validReadAhead = false;
+    const int readAheadMiB = parser.value(readAheadOption).toInt(&validReadAhead);
+    if (!validReadAhead || readAheadMiB < 0 || readAheadMiB > 1024) {
+        fprintf(stderr, "Invalid read-ahead size: %s\n", qPrintable(parser.value(readAheadOption)));
+        return 2;
+    }
+
+    int followIdleSeconds = 0;
+    if (parser.isSet(followOption)) {
+        bool valid = false;
+        followIdleSeconds = parser.value(followOption).toInt(&valid);
+        if (!valid || followIdleSeconds < 1) {
+            fprintf(stderr, "Invalid follow idle time: %s\n", qPrintable(parser.value(followOption)));
+            return 2;
+        }
+    }
+
+    const bool parsePackets = !parser.isSet(streamsOnlyOption);
+    ReportWriter writer(format == "csv" ? ReportWriter::Format::Csv : ReportWriter::Format::JsonLines,
+                        parser.value(outputOption),
+                        table == "streams" || !parsePackets ? ReportWriter::CsvTable::Streams
+                                                            : ReportWriter::CsvTable::Packets);
+    if (!writer.open()) {
+        fprintf(stderr, "Cannot open output\n");
+        return 2;
+    }
+
+    // Each file is analysed synchronously on a pool thread
+    AnalysisOptions options;
+    options.parsePackets = parsePackets;
+    options.useIndexCache = parser.isSet(indexCacheOption);
+    options.readAheadSize = readAheadMiB << 20;
+    options.memoryMappedInput = parser.isSet(mmapOption);
+    options.followIdleSeconds = followIdleSeconds;
+    std::atomic<int> failures(0);
+    QThreadPool pool;
+    pool.setMaxThreadCount(jobs);
+    for (const QString &file : files) {
+        pool.start([&writer, &failures, file, options]() {
+            const AnalysisResult report = MediaAnalyzer::analyze(file, options);
+            if (!report.ok) {
+                qWarning() << "Failed:" << file << report.errorMessage;
+            }
+            if (!writer.write(report) || !report.ok) {
+                failures.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    pool.waitForDone();
+
+    const int failed = failures.load();
+    if (!quietMode) {
+        fprintf(stderr, "Analysed %lld files, %d failed\n", static_cast<long long>(files.size()), failed);
+    }
+    return failed > 0 ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include "reportwriter.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QCryptographicHash>
+#include <cstdio>
+#include <functional>
+
+// FFmpeg headers
+extern "C" {
+#include <libavutil/avutil.h>
+}
+
+namespace {
+
+void appendTimestamp(QByteArray &out, qint64 value)
+{
+    if (value == AV_NOPTS_VALUE) {
+        out += "null";
+    } else {
+        out += QByteArray::number(value);
+    }
+}
+
+void appendCsvTimestamp(QByteArray &out, qint64 value)
+{
+    if (value != AV_NOPTS_VALUE) {
+        out += QByteArray::number(value);
+    }
+}
+
+QByteArray csvField(const QString &value)
+{
+    QByteArray field = value.toUtf8();
+    if (field.contains(',') || field.contains('"') || field.contains('\n')) {
+        field.replace("\"", "\"\"");
+        field = '"' + field + '"';
+    }
+    return field;
+}
+
+QByteArray jsonLine(const QJsonObject &object)
+{
+    return QJsonDocument(object).toJson(QJsonDocument::Compact) + '\n';
+}
+
+// Packet rows are formatted into chunks of this size and written out as each one fills
+constexpr int kChunkBytes = 1 << 20;
+
+template <typename AppendRow>
+bool writeRows(QIODevice &out, qint64 count, AppendRow appendRow)
+{
+    QByteArray chunk;
+    chunk.reserve(kChunkBytes + 4096);
+    for (qint64 i = 0; i < count; ++i) {
+        appendRow(chunk, i);
+        if (chunk.size() >= kChunkBytes) {
+            if (out.write(chunk) != chunk.size()) {
+                return false;
+            }
+            chunk.resize(0);
+        }
+    }
+    return chunk.isEmpty() || out.write(chunk) == chunk.size();
+}
+
+bool writeBlock(QIODevice &out, const QByteArray &block)
+{
+    return out.write(block) == block.size();
+}
+
+bool writeFile(const QString &path, const std::function<bool(QIODevice &)> &writeContents)
+{
+    QSaveFile output(path);
+    return output.open(QIODevice::WriteOnly) && writeContents(output) && output.commit();
+}
+
+} // namespace
+
+ReportWriter::ReportWriter(Format format, const QString &outputDirectory, CsvTable csvTable)
+    : format(format)
+    , outputDirectory(outputDirectory)
+    , csvTable(csvTable)
+    , headerWritten(false)
+{
+}
+
+ReportWriter::~ReportWriter()
+{
+    if (standardOutput.isOpen()) {
+        standardOutput.flush();
+    }
+}
+
+bool ReportWriter::open()
+{
+    if (!outputDirectory.isEmpty()) {
+        return QDir().mkpath(outputDirectory);
+    }
+    return standardOutput.open(stdout, QIODevice::WriteOnly);
+}
+
+QString ReportWriter::outputBaseName(const QString &filePath) const
+{
+    if (filePath == "-") {
+        return QDir(outputDirectory).filePath("stdin");
+    }
+
+    // Inputs with the same name in different directories must not overwrite each other
+    const QString absolutePath = QFileInfo(filePath).absoluteFilePath();
+    const QByteArray hash = QCryptographicHash::hash(absolutePath.toUtf8(), QCryptographicHash::Sha1).toHex().left(8);
+    return QDir(outputDirectory).filePath(QFileInfo(filePath).fileName() + "-" + QString::fromLatin1(hash));
+}
+
+bool ReportWriter::write(const AnalysisResult &report)
+{
+    if (outputDirectory.isEmpty()) {
+        // Records are formatted straight into the output under the lock, keeping each
+        // file's records together without holding the whole report in memory
+        QMutexLocker locker(&mutex);
+        bool written = true;
+        if (format == Format::JsonLines) {
+            written = writeJsonLines(standardOutput, report);
+        } else {
+            if (!headerWritten) {
+                written = writeBlock(standardOutput, csvTable == CsvTable::Streams ? streamsCsvHeader(true)
+                                                                                   : packetsCsvHeader(true));
+                headerWritten = true;
+            }
+            written = written && (csvTable == CsvTable::Streams ? writeBlock(standardOutput, streamsCsv(report, true))
+                                                                : writePacketsCsv(standardOutput, report, true));
+        }
+        standardOutput.flush();
+        return written;
+    }
+
+    // Per-file output needs no locking
+    const QString baseName = outputBaseName(report.filePath);
+    if (format == Format::JsonLines) {
+        return writeFile(baseName + ".jsonl", [&report](QIODevice &out) {
+            return writeJsonLines(out, report);
+        });
+    }
+
+    bool written = writeFile(baseName + ".streams.csv", [&report](QIODevice &out) {
+        return writeBlock(out, streamsCsvHeader(false) + streamsCsv(report, false));
+    });
+    if (report.packets) {
+        written = writeFile(baseName + ".packets.csv", [&report](QIODevice &out) {
+            return writeBlock(out, packetsCsvHeader(false)) && writePacketsCsv(out, report, false);
+        }) && written;
+    }
+    return written;
+}
+
+bool ReportWriter::writeJsonLines(QIODevice &device, const AnalysisResult &report)
+{
+    QByteArray out;
+
+    QJsonObject file;
+    file["type"] = "file";
+    file["path"] = report.filePath;
+    file["status"] = report.ok ? "ok" : "error";
+    if (!report.errorMessage.isEmpty()) {
+        file["error"] = report.errorMessage;
+    }
+    file["total_streams"] = report.totalStreams;
+    file["packets"] = report.packets ? static_cast<double>(report.packets->size()) : 0.0;
+    file["elapsed_ms"] = static_cast<double>(report.elapsedMs);
+    out += jsonLine(file);
+
+    for (const VideoStreamInfo &info : report.videoStreams) {
+        QJsonObject stream;
+        stream["type"] = "stream";
+        stream["index"] = info.streamIndex;
+        stream["kind"] = "video";
+        stream["codec"] = info.codecId;
+        stream["codec_tag"] = static_cast<double>(info.codecTag);
+        stream["format"] = info.format;
+        stream["bit_rate"] = static_cast<double>(info.bitRate);
+        stream["profile"] = info.profile;
+        stream["level"] = info.level;
+        stream["width"] = info.width;
+        stream["height"] = info.height;
+        stream["sample_aspect_ratio"] = info.sampleAspectRatio;
+        stream["field_order"] = info.fieldOrder;
+        stream["color_range"] = info.colorRange;
+        stream["color_primaries"] = info.colorPrimaries;
+        stream["color_trc"] = info.colorTrc;
+        stream["color_space"] = info.colorSpace;
+        stream["chroma_location"] = info.chromaLocation;
+        stream["video_delay"] = info.videoDelay;
+        out += jsonLine(stream);
+    }
+
+    for (const AudioStreamInfo &info : report.audioStreams) {
+        QJsonObject stream;
+        stream["type"] = "stream";
+        stream["index"] = info.streamIndex;
+        stream["kind"] = "audio";
+        stream["codec"] = info.codecId;
+        stream["codec_tag"] = static_cast<double>(info.codecTag);
+        stream["format"] = info.format;
+        stream["bit_rate"] = static_cast<double>(info.bitRate);
+        stream["profile"] = info.profile;
+        stream["sample_rate"] = info.sampleRate;
+        stream["channels"] = info.channels;
+        stream["channel_layout"] = info.channelLayout;
+        stream["bits_per_sample"] = info.bitsPerSample;
+        out += jsonLine(stream);
+    }
+
+    if (!writeBlock(device, out)) {
+        return false;
+    }
+    if (!report.packets) {
+        return true;
+    }
+
+    // Packet records are formatted directly; they dominate the output
+    const PacketTable &table = *report.packets;
+    return writeRows(device, table.size(), [&table](QByteArray &out, qint64 i) {
+        const quint8 flags = table.flags(i);
+        out += "{\"type\":\"packet\",\"index\":";
+        out += QByteArray::number(i);
+        out += ",\"stream\":";
+        out += QByteArray::number(table.streamIndex(i));
+        out += ",\"stream_type\":\"";
+        out += streamTypeName(table.streamType(i)).toLatin1();
+        out += "\",\"pts\":";
+        appendTimestamp(out, table.pts(i));
+        out += ",\"dts\":";
+        appendTimestamp(out, table.dts(i));
+        out += ",\"duration\":";
+        out += QByteArray::number(table.duration(i));
+        out += ",\"pos\":";
+        out += QByteArray::number(table.pos(i));
+        out += ",\"size\":";
+        out += QByteArray::number(table.packetSize(i));
+        out += ",\"key\":";
+        out += (flags & PacketTable::KeyFrameFlag) ? "true" : "false";
+        out += ",\"corrupt\":";
+        out += (flags & PacketTable::CorruptFlag) ? "true" : "false";
+        out += "}\n";
+    });
+}
+
+QByteArray ReportWriter::streamsCsvHeader(bool withPath)
+{
+    return QByteArray(withPath ? "path," : "")
+           + "status,index,kind,codec,profile,level,width,height,sample_rate,channels,bit_rate\n";
+}
+
+QByteArray ReportWriter::streamsCsv(const AnalysisResult &report, bool withPath)
+{
+    QByteArray out;
+    const QByteArray prefix = (withPath ? csvField(report.filePath) + "," : QByteArray())
+                              + (report.ok ? "ok" : "error");
+
+    for (const VideoStreamInfo &info : report.videoStreams) {
+        out += prefix + "," + QByteArray::number(info.streamIndex) + ",video,"
+               + csvField(info.codecId) + "," + csvField(info.profile) + "," + csvField(info.level) + ","
+               + QByteArray::number(info.width) + "," + QByteArray::number(info.height) + ",,,"
+               + QByteArray::number(info.bitRate) + "\n";
+    }
+    for (const AudioStreamInfo &info : report.audioStreams) {
+        out += prefix + "," + QByteArray::number(info.streamIndex) + ",audio,"
+               + csvField(info.codecId) + "," + csvField(info.profile) + ",,,,"
+               + QByteArray::number(info.sampleRate) + "," + QByteArray::number(info.channels) + ","
+               + QByteArray::number(info.bitRate) + "\n";
+    }
+
+    // A file without streams still gets a row, so failures show up in the table
+    if (report.videoStreams.isEmpty() && report.audioStreams.isEmpty()) {
+        out += prefix + ",,,,,,,,,,\n";
+    }
+    return out;
+}
+
+QByteArray ReportWriter::packetsCsvHeader(bool withPath)
+{
+    return QByteArray(withPath ? "path," : "") + "index,stream,stream_type,pts,dts,duration,pos,size,key,corrupt\n";
+}
+
+bool ReportWriter::writePacketsCsv(QIODevice &device, const AnalysisResult &report, bool withPath)
+{
+    if (!report.packets) {
+        return true;
+    }
+
+    const QByteArray prefix = withPath ? csvField(report.filePath) + "," : QByteArray();
+    const PacketTable &table = *report.packets;
+    return writeRows(device, table.size(), [&table, &prefix](QByteArray &out, qint64 i) {
+        const quint8 flags = table.flags(i);
+        out += prefix;
+        out += QByteArray::number(i);
+        out += ',';
+        out += QByteArray::number(table.streamIndex(i));
+        out += ',';
+        out += streamTypeName(table.streamType(i)).toLatin1();
+        out += ',';
+        appendCsvTimestamp(out, table.pts(i));
+        out += ',';
+        appendCsvTimestamp(out, table.dts(i));
+        out += ',';
+        out += QByteArray::number(table.duration(i));
+        out += ',';
+        out += QByteArray::number(table.pos(i));
+        out += ',';
+        out += QByteArray::number(table.packetSize(i));
+        out += (flags & PacketTable::KeyFrameFlag) ? ",1" : ",0";
+        out += (flags & PacketTable::CorruptFlag) ? ",1\n" : ",0\n";
+    });
+}
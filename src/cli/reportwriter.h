@@ -0,0 +1,71 @@
+#ifndef REPORTWRITER_H
+#define REPORTWRITER_H
+
+#include <QString>
+#include <QList>
+#include <QMutex>
+#include <QFile>
+#include "model/mediaanalyzer.h"
+
+/**
+ * @brief The ReportWriter class writes analysis results as JSON Lines or CSV
+ *
+ * Reports can be written from any thread; each file's records are written as one block.
+ * Packet records are formatted in chunks straight into the output, so a report never
+ * holds more than one chunk of text however many packets its file has.
+ * Without an output directory everything goes to standard output: JSON Lines carry a
+ * "file" record followed by its "stream" and "packet" records, CSV carries a single
+ * table with the file path in the first column. With an output directory each input
+ * gets its own files (name.jsonl, or name.streams.csv and name.packets.csv).
+ */
+class ReportWriter
+{
+public:
+    enum class Format {
+        JsonLines,
+        Csv
+    };
+
+    enum class CsvTable {
+        Streams,
+        Packets
+    };
+
+    /**
+     * @brief Create a writer
+     * @param format The output format
+     * @param outputDirectory Directory for per-file output, or empty for standard output
+     * @param csvTable The table written to standard output in CSV format
+     */
+    ReportWriter(Format format, const QString &outputDirectory, CsvTable csvTable = CsvTable::Packets);
+    ~ReportWriter();
+
+    /**
+     * @brief Open the output
+     * @return bool False if standard output or the output directory is not writable
+     */
+    bool open();
+
+    /**
+     * @brief Write the records of one file
+     * @return bool True if the records were written
+     */
+    bool write(const AnalysisResult &report);
+
+private:
+    Format format;
+    QString outputDirectory;
+    CsvTable csvTable;
+    QMutex mutex;
+    QFile standardOutput;
+    bool headerWritten;
+
+    QString outputBaseName(const QString &filePath) const;
+    static bool writeJsonLines(QIODevice &device, const AnalysisResult &report);
+    static QByteArray streamsCsv(const AnalysisResult &report, bool withPath);
+    static bool writePacketsCsv(QIODevice &device, const AnalysisResult &report, bool withPath);
+    static QByteArray streamsCsvHeader(bool withPath);
+    static QByteArray packetsCsvHeader(bool withPath);
+};
+
+#endif // REPORTWRITER_H
\ No newline at end of file
@@ -0,0 +1,6 @@
+#include "logging.h"
+
+Q_LOGGING_CATEGORY(lcParser, "legilimens.parser")
+Q_LOGGING_CATEGORY(lcIndex, "legilimens.index")
+Q_LOGGING_CATEGORY(lcIo, "legilimens.io")
+Q_LOGGING_CATEGORY(lcSlices, "legilimens.slices")
@@ -0,0 +1,35 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QLoggingCategory>
+
+/**
+ * @brief Logging categories and levels
+ *
+ * Diagnostics go through Qt logging categories, which can be switched at run time with
+ * QT_LOGGING_RULES (for example "legilimens.parser.debug=false"). qCDebug and friends
+ * evaluate their arguments only when the category is enabled, so disabled messages cost
+ * one flag test and no formatting.
+ *
+ * Per-packet and per-batch messages use LG_TRACE instead. Trace messages are compiled
+ * only when LEGILIMENS_TRACE_LOGGING is set, which the build does for Debug
+ * configurations; elsewhere the statement and its operands compile to nothing.
+ */
+
+Q_DECLARE_LOGGING_CATEGORY(lcParser)    ///< Opening, probing and parsing files
+Q_DECLARE_LOGGING_CATEGORY(lcIndex)     ///< Packet index cache and container indexers
+Q_DECLARE_LOGGING_CATEGORY(lcIo)        ///< Input readers: read-ahead, mapping, growing files, streams
+Q_DECLARE_LOGGING_CATEGORY(lcSlices)    ///< Slice pipeline, model and view
+
+#ifndef LEGILIMENS_TRACE_LOGGING
+#define LEGILIMENS_TRACE_LOGGING 0
+#endif
+
+#if LEGILIMENS_TRACE_LOGGING
+#define LG_TRACE(category) qCDebug(category)
+#else
+// The dead loop still type-checks the operands, but they are never evaluated
+#define LG_TRACE(category) while (false) qCDebug(category)
+#endif
+
+#endif // LOGGING_H
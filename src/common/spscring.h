@@ -0,0 +1,217 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QThread>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+/**
+ * @brief The SpscRing class is a bounded lock-free single-producer/single-consumer queue
+ *
+ * One thread pushes and one thread pops. While the ring is neither empty nor full both
+ * sides only touch their own index and an acquire load of the other's, so the fast path
+ * takes no lock. A producer facing a full ring, or a consumer facing an empty one, yields
+ * for a short while and then parks on a wait condition; the other side only takes the
+ * mutex to wake it when a waiter is flagged. Closing the ring releases both sides:
+ * pushes fail, pops drain what is left.
+ */
+template <typename T>
+class SpscRing
+{
+public:
+    /**
+     * @brief Create a ring
+     * @param capacity Minimum number of elements; rounded up to a power of two
+     */
+    explicit SpscRing(size_t capacity)
+        : mask(roundUp(capacity) - 1)
+        , buffer(new T[mask + 1])
+        , head(0)
+        , tail(0)
+        , closed(false)
+        , consumerWaiting(false)
+        , producerWaiting(false)
+        , cachedHead(0)
+        , cachedTail(0)
+    {
+    }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    /**
+     * @brief Push an element, blocking while the ring is full (producer only)
+     * @return bool False if the ring was closed
+     */
+    bool push(const T &value)
+    {
+        const size_t position = tail.load(std::memory_order_relaxed);
+        if (position - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead > mask && !waitForSpace(position)) {
+                return false;
+            }
+        }
+        if (closed.load(std::memory_order_relaxed)) {
+            return false;
+        }
+
+        buffer[position & mask] = value;
+        tail.store(position + 1, std::memory_order_release);
+        wake(consumerWaiting, notEmpty);
+        return true;
+    }
+
+    /**
+     * @brief Pop up to maxCount elements, blocking while the ring is empty (consumer only)
+     * @return size_t Number of elements popped; zero once the ring is closed and drained
+     */
+    size_t pop(T *out, size_t maxCount)
+    {
+        const size_t position = head.load(std::memory_order_relaxed);
+        if (cachedTail == position) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (cachedTail == position && !waitForData(position)) {
+                return 0;
+            }
+        }
+
+        size_t count = cachedTail - position;
+        if (count > maxCount) {
+            count = maxCount;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = buffer[(position + i) & mask];
+        }
+        head.store(position + count, std::memory_order_release);
+        wake(producerWaiting, notFull);
+        return count;
+    }
+
+    /**
+     * @brief Check whether the ring currently holds no elements (consumer only)
+     */
+    bool isEmpty() const
+    {
+        return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Close the ring and wake both sides; callable from any thread
+     */
+    void close()
+    {
+        QMutexLocker locker(&waitMutex);
+        closed.store(true, std::memory_order_seq_cst);
+        notEmpty.wakeAll();
+        notFull.wakeAll();
+    }
+
+    /**
+     * @brief Reopen a closed ring; only while neither side is using it
+     */
+    void reopen()
+    {
+        closed.store(false, std::memory_order_relaxed);
+    }
+
+    bool isClosed() const
+    {
+        return closed.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const
+    {
+        return mask + 1;
+    }
+
+private:
+    static size_t roundUp(size_t value)
+    {
+        size_t size = 2;
+        while (size < value) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    // The waiter flags its intent, then re-checks the index under the mutex; the other side
+    // publishes its index, then checks the flag. The fences order both pairs, so a wakeup
+    // cannot fall between the waiter's check and its wait.
+    bool waitForSpace(size_t position)
+    {
+        // The consumer usually frees a slot within microseconds; parking costs a syscall
+        for (int spin = 0; spin < SpinCount; ++spin) {
+            QThread::yieldCurrentThread();
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead <= mask) {
+                return !closed.load(std::memory_order_relaxed);
+            }
+        }
+        
+        QMutexLocker locker(&waitMutex);
+        producerWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (position - (cachedHead = head.load(std::memory_order_acquire)) > mask
+               && !closed.load(std::memory_order_relaxed)) {
+            notFull.wait(&waitMutex);
+        }
+        producerWaiting.store(false, std::memory_order_relaxed);
+        return !closed.load(std::memory_order_relaxed);
+    }
+
+    bool waitForData(size_t position)
+    {
+        for (int spin = 0; spin < SpinCount; ++spin) {
+            QThread::yieldCurrentThread();
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (cachedTail != position) {
+                return true;
+            }
+        }
+        
+        QMutexLocker locker(&waitMutex);
+        consumerWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while ((cachedTail = tail.load(std::memory_order_acquire)) == position
+               && !closed.load(std::memory_order_relaxed)) {
+            notEmpty.wait(&waitMutex);
+        }
+        consumerWaiting.store(false, std::memory_order_relaxed);
+        return cachedTail != position;
+    }
+
+    void wake(std::atomic<bool> &waiting, QWaitCondition &condition)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed)) {
+            QMutexLocker locker(&waitMutex);
+            condition.wakeOne();
+        }
+    }
+
+    static const int SpinCount = 64;        ///< Yields before a waiting side parks
+
+    const size_t mask;
+    const std::unique_ptr<T[]> buffer;
+
+    // Producer and consumer indices live on separate cache lines
+    alignas(64) std::atomic<size_t> head;   ///< Next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail;   ///< Next slot to push, written by the producer
+    alignas(64) std::atomic<bool> closed;
+    std::atomic<bool> consumerWaiting;
+    std::atomic<bool> producerWaiting;
+    QMutex waitMutex;
+    QWaitCondition notEmpty;
+    QWaitCondition notFull;
+
+    // Each side's last view of the other's index, so the fast path rarely touches its cache line
+    alignas(64) size_t cachedHead;          ///< Producer's copy of head
+    alignas(64) size_t cachedTail;          ///< Consumer's copy of tail
+};
+
+#endif // SPSCRING_H
@@ -18,12 +18,19 @@ Controller::Controller(MediaFileManager *model, QObject *parent)
 
     connect(model, &MediaFileManager::error, this, &Controller::error);
 
+    // Forward progress of the asynchronous open job
+    connect(model, &MediaFileManager::probingProgress, this, &Controller::probingProgress, Qt::QueuedConnection);
+
     // Forward stream information updates using queued connection to prevent destruction issues
     connect(model, &MediaFileManager::streamsInfoUpdated, this, &Controller::streamInfoUpdated, Qt::QueuedConnection);
 
     // Forward parser thread signals
-    connect(model, &MediaFileManager::slicesParsed, this, &Controller::slicesParsed, Qt::QueuedConnection);
+    connect(model, &MediaFileManager::packetTableReset, this, &Controller::packetTableReset, Qt::QueuedConnection);
+    connect(model, &MediaFileManager::mappedFileChanged, this, &Controller::mappedFileChanged, Qt::QueuedConnection);
+    connect(model, &MediaFileManager::packetsParsed, this, &Controller::packetsParsed, Qt::QueuedConnection);
     connect(model, &MediaFileManager::parsingProgress, this, &Controller::parsingProgress, Qt::QueuedConnection);
+    connect(model, &MediaFileManager::parsingMetrics, this, &Controller::parsingMetrics, Qt::QueuedConnection);
+    connect(model, &MediaFileManager::quickScanFinished, this, &Controller::quickScanFinished, Qt::QueuedConnection);
     connect(model, &MediaFileManager::parsingFinished, this, &Controller::parsingFinished, Qt::QueuedConnection);
 }
 
@@ -96,6 +103,20 @@ bool Controller::isParsing() const
     return model ? model->isParsing() : false;
 }
 
+void Controller::prioritizePosition(qint64 position)
+{
+    if (model) {
+        model->prioritizePosition(position);
+    }
+}
+
+void Controller::prioritizeTime(double seconds)
+{
+    if (model) {
+        model->prioritizeTime(seconds);
+    }
+}
+
 void Controller::setAutoParsingEnabled(bool enabled)
 {
     if (model) {
@@ -106,4 +127,28 @@ void Controller::setAutoParsingEnabled(bool enabled)
 bool Controller::isAutoParsingEnabled() const
 {
     return model ? model->isAutoParsingEnabled() : false;
+}
+
+void Controller::setFollowModeEnabled(bool enabled)
+{
+    if (model) {
+        model->setFollowModeEnabled(enabled);
+    }
+}
+
+bool Controller::isFollowModeEnabled() const
+{
+    return model ? model->isFollowModeEnabled() : false;
+}
+
+void Controller::setQuickScanEnabled(bool enabled)
+{
+    if (model) {
+        model->setQuickScanEnabled(enabled);
+    }
+}
+
+bool Controller::isQuickScanEnabled() const
+{
+    return model ? model->isQuickScanEnabled() : false;
 } 
\ No newline at end of file
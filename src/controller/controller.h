@@ -29,19 +29,36 @@ public:
     void stopParsing();
     bool isParsing() const;
     
+    // Parse the region at a byte offset, or around a time, before the rest of the file
+    void prioritizePosition(qint64 position);
+    void prioritizeTime(double seconds);
+    
     // Auto-parsing control
     void setAutoParsingEnabled(bool enabled);
     bool isAutoParsingEnabled() const;
     
+    // Follow files that are still being written (takes effect on the next open)
+    void setFollowModeEnabled(bool enabled);
+    bool isFollowModeEnabled() const;
+    
+    // Sample large files for estimates alongside the full parse (takes effect on the next open)
+    void setQuickScanEnabled(bool enabled);
+    bool isQuickScanEnabled() const;
+    
     // Stream information access
     MediaFileManager* getMediaFileManager() const { return model; }
 
 signals:
     void updateWindowTitle(const QString &title);
     void error(const QString &message);
+    void probingProgress(qint64 bytesProbed);
     void streamInfoUpdated(const QList<VideoStreamInfo> &videoStreams, const QList<AudioStreamInfo> &audioStreams);
-    void slicesParsed(const QList<SliceInfo> &slices);
+    void packetTableReset(QSharedPointer<const PacketTable> table);
+    void mappedFileChanged(QSharedPointer<const MappedFile> mapping);
+    void packetsParsed(const PacketBatch &batch);
     void parsingProgress(int percentage);
+    void parsingMetrics(const ParseMetrics &metrics);
+    void quickScanFinished(const QuickScanResult &result);
     void parsingFinished();
     void clearAllWidgets();
 
@@ -0,0 +1,140 @@
+#ifndef BITREADER_H
+#define BITREADER_H
+
+#include <QtGlobal>
+#include <QtAlgorithms>
+#include <QtEndian>
+
+/**
+ * @brief The BitReader class reads the fixed and Exp-Golomb coded fields of an RBSP
+ *
+ * Bits are served from a 64-bit cache holding the next bits MSB first, refilled eight
+ * bytes at a time while enough input is left. ue(v) counts the leading zero bits of the
+ * cache in one instruction and takes the whole code in one shift, so a typical slice
+ * header field costs a few instructions. Reads past the end return zero bits and set
+ * the overrun flag; callers check it once after a structure has been read.
+ *
+ * The input must already have its emulation prevention bytes removed.
+ */
+class BitReader
+{
+public:
+    BitReader(const uchar *data, int size)
+        : data(data)
+        , size(size)
+        , bytePos(0)
+        , cache(0)
+        , cacheBits(0)
+        , overrun(false)
+    {
+        refill();
+    }
+
+    /**
+     * @brief Read an unsigned field of up to 32 bits, u(n)
+     */
+    quint32 readBits(int bits)
+    {
+        if (bits <= 0) {
+            return 0;
+        }
+        if (cacheBits < bits) {
+            refill();
+            if (cacheBits < bits) {
+                overrun = true;
+                cache = 0;
+                cacheBits = 64;
+            }
+        }
+        const quint32 value = static_cast<quint32>(cache >> (64 - bits));
+        cache <<= bits;
+        cacheBits -= bits;
+        return value;
+    }
+
+    bool readFlag() { return readBits(1) != 0; }
+
+    void skipBits(int bits)
+    {
+        while (bits > 32) {
+            readBits(32);
+            bits -= 32;
+        }
+        readBits(bits);
+    }
+
+    /**
+     * @brief Read an unsigned Exp-Golomb code, ue(v)
+     *
+     * Codes longer than 32 bits (values above 2^32 - 2) are invalid and set the overrun flag.
+     */
+    quint32 readUe()
+    {
+        if (cacheBits < 32) {
+            refill();
+        }
+        const int zeros = cache ? static_cast<int>(qCountLeadingZeroBits(cache)) : 64;
+        const int length = 2 * zeros + 1;
+        if (length <= cacheBits) {
+            const quint32 value = static_cast<quint32>((cache >> (64 - length)) - 1);
+            cache <<= length;
+            cacheBits -= length;
+            return value;
+        }
+        if (zeros > 31) {
+            overrun = true;
+            return 0;
+        }
+
+        // Near the end of the input or of the cache: the prefix, then the suffix
+        readBits(zeros);
+        return static_cast<quint32>((quint64(readBits(zeros + 1))) - 1);
+    }
+
+    /**
+     * @brief Read a signed Exp-Golomb code, se(v)
+     */
+    qint32 readSe()
+    {
+        const quint32 code = readUe();
+        const qint32 magnitude = static_cast<qint32>((code >> 1) + (code & 1));
+        return (code & 1) ? magnitude : -magnitude;
+    }
+
+    /**
+     * @brief Check whether any read ran past the end of the input or met an invalid code
+     */
+    bool isOverrun() const { return overrun; }
+
+    /**
+     * @brief Get the number of bits not read yet
+     */
+    qint64 bitsLeft() const { return qint64(size - bytePos) * 8 + cacheBits; }
+
+private:
+    const uchar *data;
+    int size;
+    int bytePos;          ///< Next byte to move into the cache
+    quint64 cache;        ///< Unread bits, MSB first; bits below cacheBits are zero or the next input bits
+    int cacheBits;
+    bool overrun;
+
+    void refill()
+    {
+        if (bytePos + 8 <= size) {
+            // Whole bytes that fit below the cached bits; the partial byte is loaded again later
+            const quint64 next = qFromBigEndian<quint64>(data + bytePos);
+            cache |= next >> cacheBits;
+            const int bytes = (64 - cacheBits) >> 3;
+            bytePos += bytes;
+            cacheBits += bytes * 8;
+            return;
+        }
+        while (cacheBits <= 56 && bytePos < size) {
+            cache |= quint64(data[bytePos++]) << (56 - cacheBits);
+            cacheBits += 8;
+        }
+    }
+};
+
+#endif // BITREADER_H
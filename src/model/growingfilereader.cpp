@@ -0,0 +1,197 @@
+#include "growingfilereader.h"
+#include "common/logging.h"
+#include <QThread>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#if defined(Q_OS_LINUX)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// FFmpeg headers
+extern "C" {
+#include <libavformat/avio.h>
+#include <libavutil/mem.h>
+#include <libavutil/error.h>
+}
+
+GrowingFileReader::GrowingFileReader(const QString &filePath, const std::atomic<bool> *stopFlag)
+    : filePath(filePath)
+    , stopFlag(stopFlag)
+    , readPosition(0)
+    , knownSize(0)
+    , idleTimeoutMs(0)
+    , notifyHandle(-1)
+{
+}
+
+GrowingFileReader::~GrowingFileReader()
+{
+#if defined(Q_OS_LINUX)
+    if (notifyHandle >= 0) {
+        ::close(notifyHandle);
+    }
+#endif
+}
+
+bool GrowingFileReader::open()
+{
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        qCDebug(lcIo) << "Could not open growing file" << filePath << file.errorString();
+        return false;
+    }
+    knownSize = file.size();
+
+#if defined(Q_OS_LINUX)
+    // Writes wake the reader at once; without a watch it polls the size instead
+    notifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (notifyHandle >= 0
+        && inotify_add_watch(notifyHandle, QFile::encodeName(filePath).constData(),
+                             IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF) < 0) {
+        ::close(notifyHandle);
+        notifyHandle = -1;
+    }
+#endif
+    if (notifyHandle < 0) {
+        qCDebug(lcIo) << "Watching" << filePath << "for growth by polling every" << PollIntervalMs << "ms";
+    }
+    return true;
+}
+
+int GrowingFileReader::read(uchar *data, int maxSize)
+{
+    for (;;) {
+        if (isStopped()) {
+            return -1;
+        }
+
+        const qint64 count = file.read(reinterpret_cast<char *>(data), maxSize);
+        if (count > 0) {
+            readPosition += count;
+            knownSize = qMax(knownSize, readPosition);
+            return static_cast<int>(count);
+        }
+        if (count < 0) {
+            return -1;
+        }
+        if (!waitForGrowth()) {
+            return isStopped() ? -1 : 0;
+        }
+    }
+}
+
+bool GrowingFileReader::seek(qint64 position)
+{
+    if (position > knownSize) {
+        knownSize = file.size();
+    }
+    if (position < 0 || position > knownSize || !file.seek(position)) {
+        return false;
+    }
+    readPosition = position;
+    return true;
+}
+
+bool GrowingFileReader::waitForGrowth()
+{
+    if (waitCallback) {
+        waitCallback();
+    }
+
+    QElapsedTimer idle;
+    idle.start();
+    for (;;) {
+        if (isStopped()) {
+            return false;
+        }
+
+        // A file that shrinks was truncated or replaced; its old bytes are gone
+        const qint64 size = file.size();
+        if (size > readPosition) {
+            knownSize = size;
+            return true;
+        }
+        if (size < readPosition) {
+            qCDebug(lcIo) << "Growing file shrank from" << readPosition << "to" << size << "bytes, ending the stream";
+            return false;
+        }
+        if (idleTimeoutMs > 0 && idle.elapsed() >= idleTimeoutMs) {
+            return false;
+        }
+        waitForEvent(PollIntervalMs);
+    }
+}
+
+void GrowingFileReader::waitForEvent(int milliseconds)
+{
+#if defined(Q_OS_LINUX)
+    if (notifyHandle >= 0) {
+        pollfd descriptor = { notifyHandle, POLLIN, 0 };
+        if (::poll(&descriptor, 1, milliseconds) > 0) {
+            char events[4096];
+            while (::read(notifyHandle, events, sizeof(events)) > 0) {
+            }
+        }
+        return;
+    }
+#endif
+    QThread::msleep(milliseconds);
+}
+
+AVIOContext *GrowingFileReader::createIOContext()
+{
+    unsigned char *buffer = static_cast<unsigned char *>(av_malloc(IoBufferSize));
+    if (!buffer) {
+        return nullptr;
+    }
+    AVIOContext *context = avio_alloc_context(buffer, IoBufferSize, 0, this,
+                                              &GrowingFileReader::readPacket, nullptr,
+                                              &GrowingFileReader::seekPacket);
+    if (!context) {
+        av_free(buffer);
+    }
+    return context;
+}
+
+void GrowingFileReader::freeIOContext(AVIOContext **context)
+{
+    if (context && *context) {
+        av_freep(&(*context)->buffer);
+        avio_context_free(context);
+    }
+}
+
+int GrowingFileReader::readPacket(void *opaque, uint8_t *buffer, int size)
+{
+    GrowingFileReader *self = static_cast<GrowingFileReader *>(opaque);
+    const int count = self->read(buffer, size);
+    if (count > 0) {
+        return count;
+    }
+    if (count == 0) {
+        return AVERROR_EOF;
+    }
+    return self->isStopped() ? AVERROR_EXIT : AVERROR(EIO);
+}
+
+int64_t GrowingFileReader::seekPacket(void *opaque, int64_t offset, int whence)
+{
+    GrowingFileReader *self = static_cast<GrowingFileReader *>(opaque);
+
+    // The size is not final, so demuxers must not plan reads around it, such as
+    // looking for the last timestamps near the end
+    if (whence & AVSEEK_SIZE) {
+        return -1;
+    }
+
+    qint64 target;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET: target = offset; break;
+        case SEEK_CUR: target = self->position() + offset; break;
+        default: return AVERROR(EINVAL);
+    }
+    return self->seek(target) ? target : AVERROR(EINVAL);
+}
@@ -0,0 +1,105 @@
+#ifndef GROWINGFILEREADER_H
+#define GROWINGFILEREADER_H
+
+#include <QString>
+#include <QFile>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+// Forward declarations
+struct AVIOContext;
+
+/**
+ * @brief The GrowingFileReader class feeds the demuxer from a file that is still being written
+ *
+ * A read at the current end of the file does not report the end of the stream: it waits
+ * for the file to grow and then returns the new bytes, so the demuxer simply carries on
+ * with the data appended by a recorder. Growth is signalled by inotify where available
+ * and found by polling the file size elsewhere. The stream ends when the stop flag is
+ * set, when the file shrinks, or after an optional idle timeout without growth.
+ *
+ * The reader is consumed through a custom AVIOContext from createIOContext(); all
+ * read() and seek() calls must come from one thread.
+ */
+class GrowingFileReader
+{
+public:
+    static constexpr int IoBufferSize = 256 << 10;   ///< Size of the AVIOContext buffer
+    static constexpr int PollIntervalMs = 250;       ///< Growth and stop flag check interval while waiting
+
+    /**
+     * @brief Create a reader for a growing file
+     * @param filePath The file to read
+     * @param stopFlag Polled while waiting for growth; reads fail once it becomes true
+     */
+    GrowingFileReader(const QString &filePath, const std::atomic<bool> *stopFlag);
+    ~GrowingFileReader();
+
+    GrowingFileReader(const GrowingFileReader &) = delete;
+    GrowingFileReader &operator=(const GrowingFileReader &) = delete;
+
+    /**
+     * @brief Open the file and start watching it for growth
+     * @return bool False if the file cannot be opened
+     */
+    bool open();
+
+    /**
+     * @brief End the stream after this long without growth; 0 follows the file until stopped
+     */
+    void setIdleTimeout(int milliseconds) { idleTimeoutMs = milliseconds; }
+
+    /**
+     * @brief Set a function called each time the reader is about to wait for growth
+     *
+     * The parser uses it to publish the rows it holds back for batching, so a slow live
+     * stream still reaches the views promptly.
+     */
+    void setWaitCallback(const std::function<void()> &callback) { waitCallback = callback; }
+
+    /**
+     * @brief Copy bytes at the current position, waiting for the file to grow at its end
+     * @return int The number of bytes copied, 0 at the end of the stream, or -1 on error or stop
+     */
+    int read(uchar *data, int maxSize);
+
+    /**
+     * @brief Move the current position within the bytes written so far
+     * @return bool False if the position is outside them
+     */
+    bool seek(qint64 position);
+
+    qint64 position() const { return readPosition; }
+    qint64 size() const { return knownSize; }
+    bool isStopped() const { return stopFlag && stopFlag->load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Create an AVIOContext that reads through this reader
+     * @return AVIOContext* The context, or nullptr on allocation failure; free it with freeIOContext()
+     */
+    AVIOContext *createIOContext();
+
+    /**
+     * @brief Free a context made by createIOContext() and its buffer
+     */
+    static void freeIOContext(AVIOContext **context);
+
+private:
+    QString filePath;
+    const std::atomic<bool> *stopFlag;
+    QFile file;
+    qint64 readPosition;
+    qint64 knownSize;
+    int idleTimeoutMs;
+    std::function<void()> waitCallback;
+    int notifyHandle;          ///< inotify descriptor, or -1 when growth is found by polling
+
+    bool waitForGrowth();
+    void waitForEvent(int milliseconds);
+
+    static int readPacket(void *opaque, uint8_t *buffer, int size);
+    static int64_t seekPacket(void *opaque, int64_t offset, int whence);
+};
+
+#endif // GROWINGFILEREADER_H
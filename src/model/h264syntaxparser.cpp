@@ -0,0 +1,477 @@
+#include "h264syntaxparser.h"
+#include "bitreader.h"
+
+namespace {
+
+enum SliceType {
+    SliceP = 0,
+    SliceB = 1,
+    SliceI = 2,
+    SliceSP = 3,
+    SliceSI = 4
+};
+
+// Iteration bound for the syntax loops that end on a marker value, against corrupt input
+constexpr int kMaxLoopEntries = 64;
+
+bool hasChromaFormat(int profileIdc)
+{
+    switch (profileIdc) {
+        case 100: case 110: case 122: case 244: case 44: case 83: case 86:
+        case 118: case 128: case 138: case 139: case 134: case 135:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void skipScalingList(BitReader &reader, int size)
+{
+    int lastScale = 8;
+    int nextScale = 8;
+    for (int j = 0; j < size; ++j) {
+        if (nextScale != 0) {
+            nextScale = (lastScale + reader.readSe() + 256) % 256;
+        }
+        lastScale = nextScale == 0 ? lastScale : nextScale;
+    }
+}
+
+void skipRefPicListModification(BitReader &reader)
+{
+    if (!reader.readFlag()) {
+        return;
+    }
+    for (int i = 0; i < kMaxLoopEntries && !reader.isOverrun(); ++i) {
+        const quint32 idc = reader.readUe();
+        if (idc == 3) {
+            return;
+        }
+        reader.readUe();   // abs_diff_pic_num_minus1 or long_term_pic_num
+    }
+}
+
+void skipPredWeights(BitReader &reader, int references, int chromaArrayType)
+{
+    for (int i = 0; i < references; ++i) {
+        if (reader.readFlag()) {
+            reader.readSe();
+            reader.readSe();
+        }
+        if (chromaArrayType != 0 && reader.readFlag()) {
+            for (int j = 0; j < 4; ++j) {
+                reader.readSe();
+            }
+        }
+    }
+}
+
+} // namespace
+
+H264SyntaxParser::H264SyntaxParser()
+    : prevPocMsb(0)
+    , prevPocLsb(0)
+    , prevFrameNumOffset(0)
+    , prevFrameNum(0)
+    , lastFrameNum(-1)
+    , lastPpsId(-1)
+    , lastFieldPic(-1)
+    , lastPoc(0)
+{
+}
+
+H264SyntaxParser::~H264SyntaxParser()
+{
+}
+
+void H264SyntaxParser::parseConfig(const uchar *data, int size)
+{
+    if (!data || size < 7 || data[0] != 1) {
+        if (data && size > 0) {
+            parseAnnexB(data, size);
+        }
+        return;
+    }
+
+    // AVCDecoderConfigurationRecord: SPS count and units, then PPS count and units
+    NalSliceHeader header;
+    int pos = 5;
+    for (int list = 0; list < 2 && pos < size; ++list) {
+        const int count = list == 0 ? (data[pos] & 0x1F) : data[pos];
+        ++pos;
+        for (int i = 0; i < count && pos + 2 <= size; ++i) {
+            const int length = (data[pos] << 8) | data[pos + 1];
+            pos += 2;
+            if (pos + length > size) {
+                return;
+            }
+            parseUnit(data + pos, length, header);
+            pos += length;
+        }
+    }
+}
+
+bool H264SyntaxParser::parseUnit(const uchar *data, int size, NalSliceHeader &header)
+{
+    if (size < 2 || (data[0] & 0x80)) {
+        return false;
+    }
+
+    const int nalRefIdc = (data[0] >> 5) & 0x03;
+    const int nalType = data[0] & 0x1F;
+    switch (nalType) {
+        case 1: case 2: case 5: {
+            // Most headers fit in a few dozen bytes; long ones are read again in full
+            const int length = unescape(data + 1, size - 1, rbsp, ShortHeaderBytes);
+            BitReader reader(rbsp, length);
+            if (parseSlice(reader, nalType, nalRefIdc, header)) {
+                return true;
+            }
+            if (!reader.isOverrun() || length < ShortHeaderBytes) {
+                return false;
+            }
+            BitReader fullReader(rbsp, unescape(data + 1, size - 1, rbsp, MaxHeaderBytes));
+            return parseSlice(fullReader, nalType, nalRefIdc, header);
+        }
+        case 7: {
+            BitReader reader(rbsp, unescape(data + 1, size - 1, rbsp, MaxParameterSetBytes));
+            parseSps(reader);
+            return false;
+        }
+        case 8: {
+            BitReader reader(rbsp, unescape(data + 1, size - 1, rbsp, MaxParameterSetBytes));
+            parsePps(reader);
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+void H264SyntaxParser::parseSps(BitReader &reader)
+{
+    Sps sps;
+    const int profileIdc = static_cast<int>(reader.readBits(8));
+    reader.skipBits(16);   // constraint flags, level_idc
+    const quint32 id = reader.readUe();
+
+    if (hasChromaFormat(profileIdc)) {
+        const int chromaFormatIdc = static_cast<int>(reader.readUe());
+        if (chromaFormatIdc == 3) {
+            sps.separateColourPlane = reader.readFlag();
+        }
+        sps.chromaArrayType = sps.separateColourPlane ? 0 : chromaFormatIdc;
+        reader.readUe();      // bit_depth_luma_minus8
+        reader.readUe();      // bit_depth_chroma_minus8
+        reader.readFlag();    // qpprime_y_zero_transform_bypass_flag
+        if (reader.readFlag()) {
+            const int lists = chromaFormatIdc != 3 ? 8 : 12;
+            for (int i = 0; i < lists; ++i) {
+                if (reader.readFlag()) {
+                    skipScalingList(reader, i < 6 ? 16 : 64);
+                }
+            }
+        }
+    }
+
+    sps.log2MaxFrameNum = static_cast<int>(reader.readUe()) + 4;
+    sps.pocType = static_cast<int>(reader.readUe());
+    if (sps.pocType == 0) {
+        sps.log2MaxPocLsb = static_cast<int>(reader.readUe()) + 4;
+    } else if (sps.pocType == 1) {
+        sps.deltaPicOrderAlwaysZero = reader.readFlag();
+        sps.offsetForNonRefPic = reader.readSe();
+        sps.offsetForTopToBottomField = reader.readSe();
+        const quint32 cycle = reader.readUe();
+        if (cycle > 255) {
+            return;
+        }
+        sps.offsetForRefFrame.resize(static_cast<int>(cycle));
+        for (int &offset : sps.offsetForRefFrame) {
+            offset = reader.readSe();
+            sps.expectedDeltaPerCycle += offset;
+        }
+    }
+    reader.readUe();          // max_num_ref_frames
+    reader.readFlag();        // gaps_in_frame_num_value_allowed_flag
+    reader.readUe();          // pic_width_in_mbs_minus1
+    reader.readUe();          // pic_height_in_map_units_minus1
+    sps.frameMbsOnly = reader.readFlag();
+
+    if (reader.isOverrun() || id >= MaxSpsCount || sps.pocType > 2
+        || sps.log2MaxFrameNum > 16 || sps.log2MaxPocLsb > 16) {
+        return;
+    }
+    sps.valid = true;
+    spsTable[id] = sps;
+}
+
+void H264SyntaxParser::parsePps(BitReader &reader)
+{
+    Pps pps;
+    const quint32 id = reader.readUe();
+    const quint32 spsId = reader.readUe();
+    pps.entropyCodingMode = reader.readFlag();
+    pps.bottomFieldPicOrderPresent = reader.readFlag();
+
+    const quint32 sliceGroups = reader.readUe() + 1;
+    if (sliceGroups > 8) {
+        return;
+    }
+    if (sliceGroups > 1) {
+        const quint32 mapType = reader.readUe();
+        if (mapType == 0) {
+            for (quint32 i = 0; i < sliceGroups; ++i) {
+                reader.readUe();      // run_length_minus1
+            }
+        } else if (mapType == 2) {
+            for (quint32 i = 0; i + 1 < sliceGroups; ++i) {
+                reader.readUe();      // top_left
+                reader.readUe();      // bottom_right
+            }
+        } else if (mapType >= 3 && mapType <= 5) {
+            reader.readFlag();        // slice_group_change_direction_flag
+            reader.readUe();          // slice_group_change_rate_minus1
+        } else if (mapType == 6) {
+            const quint32 units = reader.readUe() + 1;
+            int bits = 0;
+            while ((1u << bits) < sliceGroups) {
+                ++bits;
+            }
+            if (units > (1u << 20)) {
+                return;
+            }
+            reader.skipBits(static_cast<int>(units) * bits);
+        }
+    }
+
+    pps.refIdxL0Default = static_cast<int>(reader.readUe()) + 1;
+    pps.refIdxL1Default = static_cast<int>(reader.readUe()) + 1;
+    pps.weightedPred = reader.readFlag();
+    pps.weightedBipredIdc = static_cast<int>(reader.readBits(2));
+    pps.picInitQp = 26 + reader.readSe();
+    reader.readSe();          // pic_init_qs_minus26
+    reader.readSe();          // chroma_qp_index_offset
+    reader.readFlag();        // deblocking_filter_control_present_flag
+    reader.readFlag();        // constrained_intra_pred_flag
+    pps.redundantPicCntPresent = reader.readFlag();
+
+    if (reader.isOverrun() || id >= MaxPpsCount || spsId >= MaxSpsCount
+        || pps.refIdxL0Default > 32 || pps.refIdxL1Default > 32) {
+        return;
+    }
+    pps.spsId = static_cast<int>(spsId);
+    pps.valid = true;
+    ppsTable[id] = pps;
+}
+
+bool H264SyntaxParser::parseSlice(BitReader &reader, int nalType, int nalRefIdc, NalSliceHeader &header)
+{
+    const quint32 firstMb = reader.readUe();
+    const quint32 rawType = reader.readUe();
+    const quint32 ppsId = reader.readUe();
+    if (rawType > 9 || ppsId >= MaxPpsCount || !ppsTable[ppsId].valid) {
+        return false;
+    }
+    const Pps &pps = ppsTable[ppsId];
+    const Sps &sps = spsTable[pps.spsId];
+    if (!sps.valid) {
+        return false;
+    }
+
+    const int sliceType = static_cast<int>(rawType % 5);
+    const bool intra = sliceType == SliceI || sliceType == SliceSI;
+    PictureFields picture = {};
+    picture.idr = nalType == 5;
+    picture.nalRefIdc = nalRefIdc;
+
+    if (sps.separateColourPlane) {
+        reader.skipBits(2);   // colour_plane_id
+    }
+    picture.frameNum = static_cast<int>(reader.readBits(sps.log2MaxFrameNum));
+    if (!sps.frameMbsOnly) {
+        picture.fieldPic = reader.readFlag();
+        if (picture.fieldPic) {
+            picture.bottomField = reader.readFlag();
+        }
+    }
+    if (picture.idr) {
+        reader.readUe();      // idr_pic_id
+    }
+    if (sps.pocType == 0) {
+        picture.pocLsb = static_cast<int>(reader.readBits(sps.log2MaxPocLsb));
+        if (pps.bottomFieldPicOrderPresent && !picture.fieldPic) {
+            picture.deltaPocBottom = reader.readSe();
+        }
+    } else if (sps.pocType == 1 && !sps.deltaPicOrderAlwaysZero) {
+        picture.deltaPoc[0] = reader.readSe();
+        if (pps.bottomFieldPicOrderPresent && !picture.fieldPic) {
+            picture.deltaPoc[1] = reader.readSe();
+        }
+    }
+    if (pps.redundantPicCntPresent) {
+        reader.readUe();      // redundant_pic_cnt
+    }
+    if (sliceType == SliceB) {
+        reader.readFlag();    // direct_spatial_mv_pred_flag
+    }
+
+    int refIdxL0 = intra ? 0 : pps.refIdxL0Default;
+    int refIdxL1 = sliceType == SliceB ? pps.refIdxL1Default : 0;
+    if (!intra && reader.readFlag()) {
+        refIdxL0 = static_cast<int>(reader.readUe()) + 1;
+        if (sliceType == SliceB) {
+            refIdxL1 = static_cast<int>(reader.readUe()) + 1;
+        }
+    }
+    if (refIdxL0 > 32 || refIdxL1 > 32) {
+        return false;
+    }
+
+    if (!intra) {
+        skipRefPicListModification(reader);
+        if (sliceType == SliceB) {
+            skipRefPicListModification(reader);
+        }
+    }
+
+    if ((pps.weightedPred && (sliceType == SliceP || sliceType == SliceSP))
+        || (pps.weightedBipredIdc == 1 && sliceType == SliceB)) {
+        reader.readUe();      // luma_log2_weight_denom
+        if (sps.chromaArrayType != 0) {
+            reader.readUe();  // chroma_log2_weight_denom
+        }
+        skipPredWeights(reader, refIdxL0, sps.chromaArrayType);
+        if (sliceType == SliceB) {
+            skipPredWeights(reader, refIdxL1, sps.chromaArrayType);
+        }
+    }
+
+    if (nalRefIdc != 0) {
+        if (picture.idr) {
+            reader.skipBits(2);   // no_output_of_prior_pics_flag, long_term_reference_flag
+        } else if (reader.readFlag()) {
+            for (int i = 0; i < kMaxLoopEntries && !reader.isOverrun(); ++i) {
+                const quint32 operation = reader.readUe();
+                if (operation == 0) {
+                    break;
+                }
+                if (operation == 1 || operation == 3) {
+                    reader.readUe();      // difference_of_pic_nums_minus1
+                }
+                if (operation == 2) {
+                    reader.readUe();      // long_term_pic_num
+                }
+                if (operation == 3 || operation == 6) {
+                    reader.readUe();      // long_term_frame_idx
+                }
+                if (operation == 4) {
+                    reader.readUe();      // max_long_term_frame_idx_plus1
+                }
+                picture.mmco5 |= operation == 5;
+            }
+        }
+    }
+
+    if (pps.entropyCodingMode && !intra) {
+        reader.readUe();      // cabac_init_idc
+    }
+    const int qpDelta = reader.readSe();
+    if (reader.isOverrun()) {
+        return false;
+    }
+
+    // Later slices of a picture repeat its frame number, parameter set and field
+    const int fieldPic = picture.fieldPic ? (picture.bottomField ? 2 : 1) : 0;
+    const bool samePicture = firstMb != 0 && picture.frameNum == lastFrameNum
+                             && static_cast<int>(ppsId) == lastPpsId && fieldPic == lastFieldPic;
+    if (!samePicture) {
+        lastPoc = pictureOrderCount(sps, picture);
+        lastFrameNum = picture.frameNum;
+        lastPpsId = static_cast<int>(ppsId);
+        lastFieldPic = fieldPic;
+    }
+
+    header.firstMb = static_cast<qint32>(firstMb);
+    header.frameNum = picture.frameNum;
+    header.poc = lastPoc;
+    header.sliceType = static_cast<qint8>(sliceType);
+    header.qpDelta = static_cast<qint8>(qBound(-128, qpDelta, 127));
+    header.qp = static_cast<qint8>(qBound(-128, pps.picInitQp + qpDelta, 127));
+    header.refIdxL0 = static_cast<quint8>(refIdxL0);
+    header.refIdxL1 = static_cast<quint8>(refIdxL1);
+    header.ppsId = static_cast<quint8>(ppsId);
+    header.fieldPic = static_cast<quint8>(fieldPic);
+    return true;
+}
+
+qint32 H264SyntaxParser::pictureOrderCount(const Sps &sps, const PictureFields &picture)
+{
+    qint64 top = 0;
+    qint64 bottom = 0;
+
+    if (sps.pocType == 0) {
+        if (picture.idr) {
+            prevPocMsb = 0;
+            prevPocLsb = 0;
+        }
+        const qint64 maxLsb = qint64(1) << sps.log2MaxPocLsb;
+        qint64 msb = prevPocMsb;
+        if (picture.pocLsb < prevPocLsb && prevPocLsb - picture.pocLsb >= maxLsb / 2) {
+            msb += maxLsb;
+        } else if (picture.pocLsb > prevPocLsb && picture.pocLsb - prevPocLsb > maxLsb / 2) {
+            msb -= maxLsb;
+        }
+        top = msb + picture.pocLsb;
+        bottom = picture.fieldPic ? top : top + picture.deltaPocBottom;
+
+        // Reference pictures set the base of the next; one with operation 5 restarts it
+        if (picture.nalRefIdc != 0) {
+            if (picture.mmco5) {
+                prevPocMsb = 0;
+                prevPocLsb = picture.bottomField ? 0 : top - qMin(top, bottom);
+            } else {
+                prevPocMsb = msb;
+                prevPocLsb = picture.pocLsb;
+            }
+        }
+    } else {
+        const qint64 maxFrameNum = qint64(1) << sps.log2MaxFrameNum;
+        qint64 frameNumOffset = 0;
+        if (!picture.idr) {
+            frameNumOffset = prevFrameNum > picture.frameNum ? prevFrameNumOffset + maxFrameNum : prevFrameNumOffset;
+        }
+
+        if (sps.pocType == 1) {
+            const int cycle = sps.offsetForRefFrame.size();
+            qint64 absFrameNum = cycle != 0 ? frameNumOffset + picture.frameNum : 0;
+            if (picture.nalRefIdc == 0 && absFrameNum > 0) {
+                --absFrameNum;
+            }
+            qint64 expected = 0;
+            if (absFrameNum > 0) {
+                expected = ((absFrameNum - 1) / cycle) * sps.expectedDeltaPerCycle;
+                const int frameInCycle = static_cast<int>((absFrameNum - 1) % cycle);
+                for (int i = 0; i <= frameInCycle; ++i) {
+                    expected += sps.offsetForRefFrame.at(i);
+                }
+            }
+            if (picture.nalRefIdc == 0) {
+                expected += sps.offsetForNonRefPic;
+            }
+            top = expected + picture.deltaPoc[0];
+            bottom = picture.fieldPic ? expected + sps.offsetForTopToBottomField + picture.deltaPoc[0]
+                                      : top + sps.offsetForTopToBottomField + picture.deltaPoc[1];
+        } else {
+            const qint64 order = 2 * (frameNumOffset + picture.frameNum);
+            top = bottom = picture.idr ? 0 : (picture.nalRefIdc == 0 ? order - 1 : order);
+        }
+
+        // Operation 5 makes the picture count as frame 0 of a new sequence
+        prevFrameNumOffset = picture.mmco5 ? 0 : frameNumOffset;
+        prevFrameNum = picture.mmco5 ? 0 : picture.frameNum;
+    }
+
+    const qint64 poc = !picture.fieldPic ? qMin(top, bottom) : (picture.bottomField ? bottom : top);
+    return static_cast<qint32>(poc);
+}
@@ -0,0 +1,102 @@
+#ifndef H264SYNTAXPARSER_H
+#define H264SYNTAXPARSER_H
+
+#include "nalsyntaxparser.h"
+#include <QVector>
+
+class BitReader;
+
+/**
+ * @brief The H264SyntaxParser class reads H.264 sequence and picture parameter sets and slice headers
+ *
+ * Slice headers are read up to slice_qp_delta, through the reference list modifications,
+ * prediction weight tables and reference marking before it. The picture order count is
+ * derived as in clause 8.2.1 for all three pic_order_cnt_type modes, from the pictures
+ * seen before in decoding order; it is relative until the first IDR picture the parser
+ * sees. Slices after the first of a picture share its order count.
+ */
+class H264SyntaxParser : public NalSyntaxParser
+{
+public:
+    H264SyntaxParser();
+    ~H264SyntaxParser() override;
+
+    void parseConfig(const uchar *data, int size) override;
+    bool parseUnit(const uchar *data, int size, NalSliceHeader &header) override;
+
+private:
+    static constexpr int MaxSpsCount = 32;
+    static constexpr int MaxPpsCount = 256;
+
+    /**
+     * @brief Sequence parameter set fields that slice headers depend on
+     */
+    struct Sps {
+        bool valid = false;
+        int chromaArrayType = 1;
+        int log2MaxFrameNum = 4;
+        int pocType = 0;
+        int log2MaxPocLsb = 4;
+        bool deltaPicOrderAlwaysZero = false;
+        int offsetForNonRefPic = 0;
+        int offsetForTopToBottomField = 0;
+        QVector<int> offsetForRefFrame;       ///< One per frame of the order count cycle
+        qint64 expectedDeltaPerCycle = 0;
+        bool frameMbsOnly = true;
+        bool separateColourPlane = false;
+    };
+
+    /**
+     * @brief Picture parameter set fields that slice headers depend on
+     */
+    struct Pps {
+        bool valid = false;
+        int spsId = 0;
+        bool entropyCodingMode = false;
+        bool bottomFieldPicOrderPresent = false;
+        int refIdxL0Default = 1;
+        int refIdxL1Default = 1;
+        bool weightedPred = false;
+        int weightedBipredIdc = 0;
+        int picInitQp = 26;
+        bool redundantPicCntPresent = false;
+    };
+
+    /**
+     * @brief Slice header fields the picture order count is derived from
+     */
+    struct PictureFields {
+        bool idr;
+        int nalRefIdc;
+        int frameNum;
+        bool fieldPic;
+        bool bottomField;
+        int pocLsb;
+        int deltaPocBottom;
+        int deltaPoc[2];
+        bool mmco5;                           ///< memory_management_control_operation 5 is present
+    };
+
+    Sps spsTable[MaxSpsCount];
+    Pps ppsTable[MaxPpsCount];
+    uchar rbsp[MaxParameterSetBytes];
+
+    // Order count state left by the previous pictures in decoding order
+    qint64 prevPocMsb;
+    qint64 prevPocLsb;
+    qint64 prevFrameNumOffset;
+    int prevFrameNum;
+
+    // The last picture, whose order count later slices of the same picture share
+    int lastFrameNum;
+    int lastPpsId;
+    int lastFieldPic;
+    qint32 lastPoc;
+
+    void parseSps(BitReader &reader);
+    void parsePps(BitReader &reader);
+    bool parseSlice(BitReader &reader, int nalType, int nalRefIdc, NalSliceHeader &header);
+    qint32 pictureOrderCount(const Sps &sps, const PictureFields &picture);
+};
+
+#endif // H264SYNTAXPARSER_H
@@ -0,0 +1,738 @@
+#include "hevcsyntaxparser.h"
+#include "bitreader.h"
+
+namespace {
+
+enum NalType {
+    NalRadlN = 6,
+    NalRaslR = 9,
+    NalRsvVclN14 = 14,
+    NalBlaWLp = 16,
+    NalBlaNLp = 18,
+    NalIdrWRadl = 19,
+    NalIdrNLp = 20,
+    NalCra = 21,
+    NalVps = 32,
+    NalSps = 33,
+    NalPps = 34,
+    NalEos = 36,
+    NalEob = 37
+};
+
+enum SliceType {
+    SliceB = 0,
+    SliceP = 1,
+    SliceI = 2
+};
+
+// slice_type in the H.264 numbering NalSliceHeader uses
+constexpr qint8 kSliceTypes[] = { 1, 0, 2 };
+
+int ceilLog2(int value)
+{
+    return value > 1 ? 32 - static_cast<int>(qCountLeadingZeroBits(quint32(value - 1))) : 0;
+}
+
+void readProfileTierLevel(BitReader &reader, int maxSubLayersMinus1, HevcSyntaxParser::ProfileTierLevel &ptl)
+{
+    reader.skipBits(2);       // general_profile_space
+    ptl.highTier = reader.readFlag();
+    ptl.profileIdc = static_cast<int>(reader.readBits(5));
+    const quint32 compatibility = reader.readBits(32);
+    reader.skipBits(48);      // progressive, interlaced, non-packed, frame-only and constraint flags
+    ptl.levelIdc = static_cast<int>(reader.readBits(8));
+
+    // Some encoders leave general_profile_idc 0 and only set the compatibility flags
+    if (ptl.profileIdc == 0 && (compatibility & 0x7FFFFFFF)) {
+        ptl.profileIdc = static_cast<int>(qCountLeadingZeroBits(compatibility & 0x7FFFFFFF));
+    }
+
+    bool profilePresent[8];
+    bool levelPresent[8];
+    for (int i = 0; i < maxSubLayersMinus1; ++i) {
+        profilePresent[i] = reader.readFlag();
+        levelPresent[i] = reader.readFlag();
+    }
+    if (maxSubLayersMinus1 > 0) {
+        reader.skipBits(2 * (8 - maxSubLayersMinus1));   // reserved_zero_2bits
+    }
+    for (int i = 0; i < maxSubLayersMinus1; ++i) {
+        reader.skipBits((profilePresent[i] ? 88 : 0) + (levelPresent[i] ? 8 : 0));
+    }
+}
+
+void skipScalingListData(BitReader &reader)
+{
+    for (int sizeId = 0; sizeId < 4; ++sizeId) {
+        for (int matrixId = 0; matrixId < 6; matrixId += sizeId == 3 ? 3 : 1) {
+            if (!reader.readFlag()) {
+                reader.readUe();      // scaling_list_pred_matrix_id_delta
+                continue;
+            }
+            if (sizeId > 1) {
+                reader.readSe();      // scaling_list_dc_coef_minus8
+            }
+            const int coefficients = qMin(64, 1 << (4 + (sizeId << 1)));
+            for (int i = 0; i < coefficients; ++i) {
+                reader.readSe();      // scaling_list_delta_coef
+            }
+        }
+    }
+}
+
+void skipPredWeights(BitReader &reader, int references, int chromaArrayType)
+{
+    quint32 lumaFlags = 0;
+    quint32 chromaFlags = 0;
+    for (int i = 0; i < references; ++i) {
+        lumaFlags |= quint32(reader.readFlag()) << i;
+    }
+    if (chromaArrayType != 0) {
+        for (int i = 0; i < references; ++i) {
+            chromaFlags |= quint32(reader.readFlag()) << i;
+        }
+    }
+    for (int i = 0; i < references; ++i) {
+        if (lumaFlags & (1u << i)) {
+            reader.readSe();          // delta_luma_weight
+            reader.readSe();          // luma_offset
+        }
+        if (chromaFlags & (1u << i)) {
+            for (int j = 0; j < 4; ++j) {
+                reader.readSe();      // delta_chroma_weight, delta_chroma_offset
+            }
+        }
+    }
+}
+
+} // namespace
+
+int HevcSyntaxParser::ShortTermRps::usedCount() const
+{
+    int count = 0;
+    for (int i = 0; i < numDeltaPocs(); ++i) {
+        count += used[i];
+    }
+    return count;
+}
+
+HevcSyntaxParser::HevcSyntaxParser()
+    : activeSpsId(-1)
+    , lastVpsId(-1)
+    , prevTid0PocLsb(0)
+    , prevTid0PocMsb(0)
+    , sequenceStart(true)
+    , lastIndependentValid(false)
+    , lastPoc(0)
+{
+}
+
+HevcSyntaxParser::~HevcSyntaxParser()
+{
+}
+
+void HevcSyntaxParser::parseConfig(const uchar *data, int size)
+{
+    if (!data || size < 23 || (!data[0] && !data[1] && data[2] <= 1)) {
+        if (data && size > 0) {
+            parseAnnexB(data, size);
+        }
+        return;
+    }
+
+    // HEVCDecoderConfigurationRecord: arrays of units, each with its type and count
+    NalSliceHeader header;
+    const int arrays = data[22];
+    int pos = 23;
+    for (int array = 0; array < arrays && pos + 3 <= size; ++array) {
+        const int count = (data[pos + 1] << 8) | data[pos + 2];
+        pos += 3;
+        for (int i = 0; i < count && pos + 2 <= size; ++i) {
+            const int length = (data[pos] << 8) | data[pos + 1];
+            pos += 2;
+            if (pos + length > size) {
+                return;
+            }
+            parseUnit(data + pos, length, header);
+            pos += length;
+        }
+    }
+}
+
+bool HevcSyntaxParser::parseUnit(const uchar *data, int size, NalSliceHeader &header)
+{
+    if (size < 3 || (data[0] & 0x80)) {
+        return false;
+    }
+
+    const int nalType = (data[0] >> 1) & 0x3F;
+    const int layerId = ((data[0] & 0x01) << 5) | (data[1] >> 3);
+    const int temporalId = (data[1] & 0x07) - 1;
+    if (layerId != 0 || temporalId < 0) {
+        return false;
+    }
+
+    if (nalType <= NalRaslR || (nalType >= NalBlaWLp && nalType <= NalCra)) {
+        // Most headers fit in a few dozen bytes; long ones are read again in full
+        const int length = unescape(data + 2, size - 2, rbsp, ShortHeaderBytes);
+        BitReader reader(rbsp, length);
+        if (parseSliceSegment(reader, nalType, temporalId, header)) {
+            return true;
+        }
+        if (!reader.isOverrun() || length < ShortHeaderBytes) {
+            return false;
+        }
+        BitReader fullReader(rbsp, unescape(data + 2, size - 2, rbsp, MaxHeaderBytes));
+        return parseSliceSegment(fullReader, nalType, temporalId, header);
+    }
+
+    switch (nalType) {
+        case NalVps: {
+            BitReader reader(rbsp, unescape(data + 2, size - 2, rbsp, MaxParameterSetBytes));
+            parseVps(reader);
+            return false;
+        }
+        case NalSps: {
+            BitReader reader(rbsp, unescape(data + 2, size - 2, rbsp, MaxParameterSetBytes));
+            parseSps(reader);
+            return false;
+        }
+        case NalPps: {
+            BitReader reader(rbsp, unescape(data + 2, size - 2, rbsp, MaxParameterSetBytes));
+            parsePps(reader);
+            return false;
+        }
+        case NalEos:
+        case NalEob:
+            sequenceStart = true;
+            return false;
+        default:
+            return false;
+    }
+}
+
+HevcSyntaxParser::ProfileTierLevel HevcSyntaxParser::profileTierLevel() const
+{
+    if (activeSpsId >= 0 && spsTable[activeSpsId].valid) {
+        return spsTable[activeSpsId].profileTierLevel;
+    }
+    return lastVpsId >= 0 ? vpsTable[lastVpsId] : ProfileTierLevel();
+}
+
+void HevcSyntaxParser::parseVps(BitReader &reader)
+{
+    const int id = static_cast<int>(reader.readBits(4));
+    reader.skipBits(8);       // vps_base_layer_internal_flag, vps_base_layer_available_flag, vps_max_layers_minus1
+    const int maxSubLayersMinus1 = static_cast<int>(reader.readBits(3));
+    reader.skipBits(17);      // vps_temporal_id_nesting_flag, vps_reserved_0xffff_16bits
+    if (maxSubLayersMinus1 > 6) {
+        return;
+    }
+    ProfileTierLevel ptl;
+    readProfileTierLevel(reader, maxSubLayersMinus1, ptl);
+    if (reader.isOverrun()) {
+        return;
+    }
+    vpsTable[id] = ptl;
+    lastVpsId = id;
+}
+
+void HevcSyntaxParser::parseSps(BitReader &reader)
+{
+    Sps sps;
+    reader.skipBits(4);       // sps_video_parameter_set_id
+    const int maxSubLayersMinus1 = static_cast<int>(reader.readBits(3));
+    reader.skipBits(1);       // sps_temporal_id_nesting_flag
+    if (maxSubLayersMinus1 > 6) {
+        return;
+    }
+    readProfileTierLevel(reader, maxSubLayersMinus1, sps.profileTierLevel);
+    const quint32 id = reader.readUe();
+
+    const quint32 chromaFormatIdc = reader.readUe();
+    if (chromaFormatIdc == 3) {
+        sps.separateColourPlane = reader.readFlag();
+    }
+    sps.chromaArrayType = sps.separateColourPlane ? 0 : static_cast<int>(chromaFormatIdc);
+    const quint32 width = reader.readUe();
+    const quint32 height = reader.readUe();
+    if (reader.readFlag()) {
+        for (int i = 0; i < 4; ++i) {
+            reader.readUe();  // conf_win offsets
+        }
+    }
+    reader.readUe();          // bit_depth_luma_minus8
+    reader.readUe();          // bit_depth_chroma_minus8
+    sps.log2MaxPocLsb = static_cast<int>(reader.readUe()) + 4;
+    const bool orderingInfoPresent = reader.readFlag();
+    for (int i = orderingInfoPresent ? 0 : maxSubLayersMinus1; i <= maxSubLayersMinus1; ++i) {
+        reader.readUe();      // sps_max_dec_pic_buffering_minus1
+        reader.readUe();      // sps_max_num_reorder_pics
+        reader.readUe();      // sps_max_latency_increase_plus1
+    }
+
+    const quint32 log2MinCbSize = reader.readUe() + 3;
+    const quint32 log2CtbSize = log2MinCbSize + reader.readUe();
+    reader.readUe();          // log2_min_luma_transform_block_size_minus2
+    reader.readUe();          // log2_diff_max_min_luma_transform_block_size
+    reader.readUe();          // max_transform_hierarchy_depth_inter
+    reader.readUe();          // max_transform_hierarchy_depth_intra
+    if (reader.readFlag() && reader.readFlag()) {
+        skipScalingListData(reader);   // scaling_list_enabled_flag, sps_scaling_list_data_present_flag
+    }
+    reader.readFlag();        // amp_enabled_flag
+    sps.sampleAdaptiveOffset = reader.readFlag();
+    if (reader.readFlag()) {
+        reader.skipBits(8);   // pcm_sample_bit_depth_luma_minus1, pcm_sample_bit_depth_chroma_minus1
+        reader.readUe();      // log2_min_pcm_luma_coding_block_size_minus3
+        reader.readUe();      // log2_diff_max_min_pcm_luma_coding_block_size
+        reader.readFlag();    // pcm_loop_filter_disabled_flag
+    }
+
+    const quint32 shortTermRpsCount = reader.readUe();
+    if (shortTermRpsCount > MaxShortTermRpsCount || chromaFormatIdc > 3
+        || log2CtbSize < 4 || log2CtbSize > 6 || width == 0 || height == 0 || width > 65536 || height > 65536) {
+        return;
+    }
+    sps.shortTermRps.reserve(static_cast<int>(shortTermRpsCount));
+    for (quint32 i = 0; i < shortTermRpsCount; ++i) {
+        ShortTermRps rps;
+        if (!parseShortTermRps(reader, sps.shortTermRps, false, rps)) {
+            return;
+        }
+        sps.shortTermRps.append(rps);
+    }
+
+    sps.longTermRefPicsPresent = reader.readFlag();
+    if (sps.longTermRefPicsPresent) {
+        const quint32 count = reader.readUe();
+        if (count > MaxLongTermRefPicsSps) {
+            return;
+        }
+        sps.numLongTermRefPicsSps = static_cast<int>(count);
+        for (int i = 0; i < sps.numLongTermRefPicsSps; ++i) {
+            reader.skipBits(sps.log2MaxPocLsb);   // lt_ref_pic_poc_lsb_sps
+            sps.usedByCurrPicLtSps[i] = reader.readFlag();
+        }
+    }
+    sps.temporalMvp = reader.readFlag();
+
+    if (reader.isOverrun() || id >= MaxSpsCount || sps.log2MaxPocLsb > 16) {
+        return;
+    }
+    const int ctbSize = 1 << log2CtbSize;
+    sps.picSizeInCtbs = static_cast<int>(((width + ctbSize - 1) >> log2CtbSize) * ((height + ctbSize - 1) >> log2CtbSize));
+    sps.valid = true;
+    spsTable[id] = sps;
+    activeSpsId = static_cast<int>(id);
+}
+
+void HevcSyntaxParser::parsePps(BitReader &reader)
+{
+    Pps pps;
+    const quint32 id = reader.readUe();
+    const quint32 spsId = reader.readUe();
+    pps.dependentSliceSegments = reader.readFlag();
+    pps.outputFlagPresent = reader.readFlag();
+    pps.numExtraSliceHeaderBits = static_cast<int>(reader.readBits(3));
+    reader.readFlag();        // sign_data_hiding_enabled_flag
+    pps.cabacInitPresent = reader.readFlag();
+    pps.refIdxL0Default = static_cast<int>(reader.readUe()) + 1;
+    pps.refIdxL1Default = static_cast<int>(reader.readUe()) + 1;
+    pps.initQp = 26 + reader.readSe();
+    reader.readFlag();        // constrained_intra_pred_flag
+    const bool transformSkip = reader.readFlag();
+    if (reader.readFlag()) {
+        reader.readUe();      // diff_cu_qp_delta_depth
+    }
+    reader.readSe();          // pps_cb_qp_offset
+    reader.readSe();          // pps_cr_qp_offset
+    pps.sliceChromaQpOffsetsPresent = reader.readFlag();
+    pps.weightedPred = reader.readFlag();
+    pps.weightedBipred = reader.readFlag();
+    reader.readFlag();        // transquant_bypass_enabled_flag
+    pps.tiles = reader.readFlag();
+    pps.entropyCodingSync = reader.readFlag();
+
+    if (pps.tiles) {
+        const quint32 columns = reader.readUe() + 1;
+        const quint32 rows = reader.readUe() + 1;
+        if (columns > 64 || rows > 64) {
+            return;
+        }
+        pps.tileColumns = static_cast<int>(columns);
+        pps.tileRows = static_cast<int>(rows);
+        if (!reader.readFlag()) {
+            for (int i = 0; i < pps.tileColumns - 1; ++i) {
+                reader.readUe();      // column_width_minus1
+            }
+            for (int i = 0; i < pps.tileRows - 1; ++i) {
+                reader.readUe();      // row_height_minus1
+            }
+        }
+        reader.readFlag();    // loop_filter_across_tiles_enabled_flag
+    }
+    pps.loopFilterAcrossSlices = reader.readFlag();
+    if (reader.readFlag()) {
+        pps.deblockingOverrideEnabled = reader.readFlag();
+        pps.deblockingDisabled = reader.readFlag();
+        if (!pps.deblockingDisabled) {
+            reader.readSe();  // pps_beta_offset_div2
+            reader.readSe();  // pps_tc_offset_div2
+        }
+    }
+    if (reader.readFlag()) {
+        skipScalingListData(reader);
+    }
+    pps.listsModificationPresent = reader.readFlag();
+    reader.readUe();          // log2_parallel_merge_level_minus2
+    reader.readFlag();        // slice_segment_header_extension_present_flag
+
+    if (reader.readFlag()) {
+        const bool rangeExtension = reader.readFlag();
+        reader.skipBits(2);   // pps_multilayer_extension_flag, pps_3d_extension_flag
+        if (reader.readFlag()) {
+            return;           // The screen content coding extension adds slice header fields
+        }
+        reader.skipBits(4);   // pps_extension_4bits
+        if (rangeExtension) {
+            if (transformSkip) {
+                reader.readUe();      // log2_max_transform_skip_block_size_minus2
+            }
+            reader.readFlag();        // cross_component_prediction_enabled_flag
+            pps.chromaQpOffsetListEnabled = reader.readFlag();
+        }
+    }
+
+    if (reader.isOverrun() || id >= MaxPpsCount || spsId >= MaxSpsCount
+        || pps.refIdxL0Default > 15 || pps.refIdxL1Default > 15) {
+        return;
+    }
+    pps.spsId = static_cast<int>(spsId);
+    pps.valid = true;
+    ppsTable[id] = pps;
+}
+
+bool HevcSyntaxParser::parseShortTermRps(BitReader &reader, const QVector<ShortTermRps> &sets, bool sliceHeader,
+                                         ShortTermRps &rps)
+{
+    const int index = sets.size();
+    if (index != 0 && reader.readFlag()) {
+        // Predicted from an earlier set: each of its pictures, shifted by deltaRps, is kept or
+        // dropped, and the current picture of the reference set may join as well (7-61, 7-62)
+        const int deltaIdx = sliceHeader ? static_cast<int>(reader.readUe()) + 1 : 1;
+        const bool sign = reader.readFlag();
+        const int deltaRps = (sign ? -1 : 1) * (static_cast<int>(reader.readUe()) + 1);
+        if (deltaIdx > index || reader.isOverrun()) {
+            return false;
+        }
+        const ShortTermRps &ref = sets.at(index - deltaIdx);
+        bool usedFlag[MaxRpsPictures + 1];
+        bool useDelta[MaxRpsPictures + 1];
+        for (int j = 0; j <= ref.numDeltaPocs(); ++j) {
+            usedFlag[j] = reader.readFlag();
+            useDelta[j] = usedFlag[j] || reader.readFlag();
+        }
+
+        int count = 0;
+        for (int j = ref.numPositive - 1; j >= 0; --j) {
+            const int deltaPoc = ref.deltaPoc[ref.numNegative + j] + deltaRps;
+            if (deltaPoc < 0 && useDelta[ref.numNegative + j] && count < MaxRpsPictures) {
+                rps.deltaPoc[count] = deltaPoc;
+                rps.used[count++] = usedFlag[ref.numNegative + j];
+            }
+        }
+        if (deltaRps < 0 && useDelta[ref.numDeltaPocs()] && count < MaxRpsPictures) {
+            rps.deltaPoc[count] = deltaRps;
+            rps.used[count++] = usedFlag[ref.numDeltaPocs()];
+        }
+        for (int j = 0; j < ref.numNegative; ++j) {
+            const int deltaPoc = ref.deltaPoc[j] + deltaRps;
+            if (deltaPoc < 0 && useDelta[j] && count < MaxRpsPictures) {
+                rps.deltaPoc[count] = deltaPoc;
+                rps.used[count++] = usedFlag[j];
+            }
+        }
+        rps.numNegative = count;
+
+        for (int j = ref.numNegative - 1; j >= 0; --j) {
+            const int deltaPoc = ref.deltaPoc[j] + deltaRps;
+            if (deltaPoc > 0 && useDelta[j] && count < MaxRpsPictures) {
+                rps.deltaPoc[count] = deltaPoc;
+                rps.used[count++] = usedFlag[j];
+            }
+        }
+        if (deltaRps > 0 && useDelta[ref.numDeltaPocs()] && count < MaxRpsPictures) {
+            rps.deltaPoc[count] = deltaRps;
+            rps.used[count++] = usedFlag[ref.numDeltaPocs()];
+        }
+        for (int j = 0; j < ref.numPositive; ++j) {
+            const int deltaPoc = ref.deltaPoc[ref.numNegative + j] + deltaRps;
+            if (deltaPoc > 0 && useDelta[ref.numNegative + j] && count < MaxRpsPictures) {
+                rps.deltaPoc[count] = deltaPoc;
+                rps.used[count++] = usedFlag[ref.numNegative + j];
+            }
+        }
+        rps.numPositive = count - rps.numNegative;
+        return !reader.isOverrun();
+    }
+
+    const quint32 negative = reader.readUe();
+    const quint32 positive = reader.readUe();
+    if (negative > MaxRpsPictures || positive > MaxRpsPictures - negative) {
+        return false;
+    }
+    rps.numNegative = static_cast<int>(negative);
+    rps.numPositive = static_cast<int>(positive);
+    int deltaPoc = 0;
+    for (int i = 0; i < rps.numNegative; ++i) {
+        deltaPoc -= static_cast<int>(reader.readUe()) + 1;
+        rps.deltaPoc[i] = deltaPoc;
+        rps.used[i] = reader.readFlag();
+    }
+    deltaPoc = 0;
+    for (int i = rps.numNegative; i < rps.numDeltaPocs(); ++i) {
+        deltaPoc += static_cast<int>(reader.readUe()) + 1;
+        rps.deltaPoc[i] = deltaPoc;
+        rps.used[i] = reader.readFlag();
+    }
+    return !reader.isOverrun();
+}
+
+bool HevcSyntaxParser::parseSliceSegment(BitReader &reader, int nalType, int temporalId, NalSliceHeader &header)
+{
+    const bool firstInPicture = reader.readFlag();
+    const bool irap = nalType >= NalBlaWLp;
+    if (irap) {
+        reader.readFlag();    // no_output_of_prior_pics_flag
+    }
+    const quint32 ppsId = reader.readUe();
+    if (ppsId >= MaxPpsCount || !ppsTable[ppsId].valid) {
+        return false;
+    }
+    const Pps &pps = ppsTable[ppsId];
+    const Sps &sps = spsTable[pps.spsId];
+    if (!sps.valid) {
+        return false;
+    }
+    activeSpsId = pps.spsId;
+
+    bool dependent = false;
+    quint32 address = 0;
+    if (!firstInPicture) {
+        if (pps.dependentSliceSegments) {
+            dependent = reader.readFlag();
+        }
+        address = reader.readBits(ceilLog2(sps.picSizeInCtbs));
+        if (address >= quint32(sps.picSizeInCtbs)) {
+            return false;
+        }
+    }
+
+    NalSliceHeader segment;
+    if (dependent) {
+        if (!lastIndependentValid) {
+            return false;
+        }
+        segment = lastIndependent;
+    } else {
+        reader.skipBits(pps.numExtraSliceHeaderBits);   // slice_reserved_flag
+        const quint32 sliceType = reader.readUe();
+        if (sliceType > SliceI) {
+            return false;
+        }
+        if (pps.outputFlagPresent) {
+            reader.readFlag();    // pic_output_flag
+        }
+        if (sps.separateColourPlane) {
+            reader.skipBits(2);   // colour_plane_id
+        }
+
+        const bool idr = nalType == NalIdrWRadl || nalType == NalIdrNLp;
+        int pocLsb = 0;
+        ShortTermRps rps;
+        int longTermRefs = 0;
+        int longTermUsed = 0;
+        bool temporalMvp = false;
+        if (!idr) {
+            pocLsb = static_cast<int>(reader.readBits(sps.log2MaxPocLsb));
+            if (!reader.readFlag()) {
+                if (!parseShortTermRps(reader, sps.shortTermRps, true, rps)) {
+                    return false;
+                }
+            } else {
+                const int sets = sps.shortTermRps.size();
+                const int index = static_cast<int>(reader.readBits(ceilLog2(sets)));
+                if (index >= sets) {
+                    return false;
+                }
+                rps = sps.shortTermRps.at(index);
+            }
+
+            if (sps.longTermRefPicsPresent) {
+                const quint32 fromSps = sps.numLongTermRefPicsSps > 0 ? reader.readUe() : 0;
+                const quint32 pictures = reader.readUe();
+                if (fromSps > quint32(sps.numLongTermRefPicsSps) || pictures > MaxRpsPictures - fromSps) {
+                    return false;
+                }
+                longTermRefs = static_cast<int>(fromSps + pictures);
+                for (int i = 0; i < longTermRefs; ++i) {
+                    if (i < static_cast<int>(fromSps)) {
+                        const int index = static_cast<int>(reader.readBits(ceilLog2(sps.numLongTermRefPicsSps)));
+                        if (index >= sps.numLongTermRefPicsSps) {
+                            return false;
+                        }
+                        longTermUsed += sps.usedByCurrPicLtSps[index];
+                    } else {
+                        reader.skipBits(sps.log2MaxPocLsb);   // poc_lsb_lt
+                        longTermUsed += reader.readFlag();
+                    }
+                    if (reader.readFlag()) {
+                        reader.readUe();      // delta_poc_msb_cycle_lt
+                    }
+                }
+            }
+            if (sps.temporalMvp) {
+                temporalMvp = reader.readFlag();
+            }
+        }
+
+        bool saoLuma = false;
+        bool saoChroma = false;
+        if (sps.sampleAdaptiveOffset) {
+            saoLuma = reader.readFlag();
+            if (sps.chromaArrayType != 0) {
+                saoChroma = reader.readFlag();
+            }
+        }
+
+        int refIdxL0 = 0;
+        int refIdxL1 = 0;
+        if (sliceType != SliceI) {
+            refIdxL0 = pps.refIdxL0Default;
+            refIdxL1 = sliceType == SliceB ? pps.refIdxL1Default : 0;
+            if (reader.readFlag()) {
+                refIdxL0 = static_cast<int>(reader.readUe()) + 1;
+                if (sliceType == SliceB) {
+                    refIdxL1 = static_cast<int>(reader.readUe()) + 1;
+                }
+            }
+            if (refIdxL0 > 15 || refIdxL1 > 15) {
+                return false;
+            }
+
+            const int picTotalCurr = rps.usedCount() + longTermUsed;
+            if (pps.listsModificationPresent && picTotalCurr > 1) {
+                const int bits = ceilLog2(picTotalCurr);
+                if (reader.readFlag()) {
+                    reader.skipBits(refIdxL0 * bits);   // list_entry_l0
+                }
+                if (sliceType == SliceB && reader.readFlag()) {
+                    reader.skipBits(refIdxL1 * bits);   // list_entry_l1
+                }
+            }
+            if (sliceType == SliceB) {
+                reader.readFlag();    // mvd_l1_zero_flag
+            }
+            if (pps.cabacInitPresent) {
+                reader.readFlag();    // cabac_init_flag
+            }
+            if (temporalMvp) {
+                const bool fromL0 = sliceType == SliceB ? reader.readFlag() : true;
+                if ((fromL0 && refIdxL0 > 1) || (!fromL0 && refIdxL1 > 1)) {
+                    reader.readUe();  // collocated_ref_idx
+                }
+            }
+            if ((pps.weightedPred && sliceType == SliceP) || (pps.weightedBipred && sliceType == SliceB)) {
+                reader.readUe();      // luma_log2_weight_denom
+                if (sps.chromaArrayType != 0) {
+                    reader.readSe();  // delta_chroma_log2_weight_denom
+                }
+                skipPredWeights(reader, refIdxL0, sps.chromaArrayType);
+                if (sliceType == SliceB) {
+                    skipPredWeights(reader, refIdxL1, sps.chromaArrayType);
+                }
+            }
+            reader.readUe();          // five_minus_max_num_merge_cand
+        }
+
+        const int qpDelta = reader.readSe();
+        if (pps.sliceChromaQpOffsetsPresent) {
+            reader.readSe();          // slice_cb_qp_offset
+            reader.readSe();          // slice_cr_qp_offset
+        }
+        if (pps.chromaQpOffsetListEnabled) {
+            reader.readFlag();        // cu_chroma_qp_offset_enabled_flag
+        }
+        bool deblockingDisabled = pps.deblockingDisabled;
+        if (pps.deblockingOverrideEnabled && reader.readFlag()) {
+            deblockingDisabled = reader.readFlag();
+            if (!deblockingDisabled) {
+                reader.readSe();      // slice_beta_offset_div2
+                reader.readSe();      // slice_tc_offset_div2
+            }
+        }
+        if (pps.loopFilterAcrossSlices && (saoLuma || saoChroma || !deblockingDisabled)) {
+            reader.readFlag();        // slice_loop_filter_across_slices_enabled_flag
+        }
+        if (reader.isOverrun()) {
+            return false;
+        }
+
+        // The order count is derived once per picture, at its first segment (8.3.1)
+        if (firstInPicture) {
+            const int maxLsb = 1 << sps.log2MaxPocLsb;
+            int pocMsb = 0;
+            if (!(irap && (nalType <= NalBlaNLp || idr || sequenceStart))) {
+                pocMsb = prevTid0PocMsb;
+                if (pocLsb < prevTid0PocLsb && prevTid0PocLsb - pocLsb >= maxLsb / 2) {
+                    pocMsb += maxLsb;
+                } else if (pocLsb > prevTid0PocLsb && pocLsb - prevTid0PocLsb > maxLsb / 2) {
+                    pocMsb -= maxLsb;
+                }
+            }
+            const bool leading = nalType >= NalRadlN && nalType <= NalRaslR;
+            const bool subLayerNonReference = nalType <= NalRsvVclN14 && nalType % 2 == 0;
+            if (temporalId == 0 && !leading && !subLayerNonReference) {
+                prevTid0PocLsb = pocLsb;
+                prevTid0PocMsb = pocMsb;
+            }
+            lastPoc = pocMsb + pocLsb;
+            sequenceStart = false;
+        }
+
+        segment.poc = lastPoc;
+        segment.sliceType = kSliceTypes[sliceType];
+        segment.qpDelta = static_cast<qint8>(qBound(-128, qpDelta, 127));
+        segment.qp = static_cast<qint8>(qBound(-128, pps.initQp + qpDelta, 127));
+        segment.refIdxL0 = static_cast<quint8>(refIdxL0);
+        segment.refIdxL1 = static_cast<quint8>(refIdxL1);
+        segment.ppsId = static_cast<quint8>(ppsId);
+        segment.tileColumns = static_cast<quint8>(pps.tileColumns);
+        segment.tileRows = static_cast<quint8>(pps.tileRows);
+        segment.wavefront = pps.entropyCodingSync;
+        segment.rpsNegative = static_cast<quint8>(rps.numNegative);
+        segment.rpsPositive = static_cast<quint8>(rps.numPositive);
+        segment.rpsUsed = static_cast<quint8>(rps.usedCount());
+        segment.longTermRefs = static_cast<quint8>(longTermRefs);
+        lastIndependent = segment;
+        lastIndependentValid = true;
+    }
+
+    quint32 entryPoints = 0;
+    if (pps.tiles || pps.entropyCodingSync) {
+        entryPoints = reader.readUe();
+        if (entryPoints >= quint32(sps.picSizeInCtbs)) {
+            return false;
+        }
+    }
+    if (reader.isOverrun()) {
+        return false;
+    }
+
+    segment.firstMb = static_cast<qint32>(address);
+    segment.dependent = dependent;
+    segment.entryPoints = static_cast<quint16>(qMin<quint32>(entryPoints, 0xFFFF));
+    header = segment;
+    return true;
+}
@@ -0,0 +1,154 @@
+#ifndef HEVCSYNTAXPARSER_H
+#define HEVCSYNTAXPARSER_H
+
+#include "nalsyntaxparser.h"
+#include <QVector>
+
+class BitReader;
+
+/**
+ * @brief The HevcSyntaxParser class reads HEVC parameter sets and slice segment headers
+ *
+ * Slice segment headers are read up to num_entry_point_offsets, through the short-term
+ * and long-term reference picture sets, reference list modifications, prediction weight
+ * tables and loop filter controls before it; the entry point offsets themselves are not
+ * read. Short-term reference picture sets are derived in full, including sets predicted
+ * from earlier ones, as later sets and slices refer to them. The picture order count
+ * follows clause 8.3.1 and is relative until the first IRAP picture the parser sees.
+ * Dependent slice segments take the fields of the independent segment before them.
+ *
+ * Of video parameter sets only the general profile, tier and level are read; nothing
+ * in them bears on the slice headers of a single layer. Units of layers above the base
+ * layer and the screen content coding extensions are not supported.
+ */
+class HevcSyntaxParser : public NalSyntaxParser
+{
+public:
+    /**
+     * @brief General profile, tier and level of a profile_tier_level() structure
+     */
+    struct ProfileTierLevel {
+        int profileIdc = 0;         ///< general_profile_idc, or the first compatible profile when it is 0
+        bool highTier = false;      ///< general_tier_flag
+        int levelIdc = 0;           ///< general_level_idc, 30 times the level number
+
+        bool isValid() const { return profileIdc > 0 || levelIdc > 0; }
+    };
+
+    HevcSyntaxParser();
+    ~HevcSyntaxParser() override;
+
+    void parseConfig(const uchar *data, int size) override;
+    bool parseUnit(const uchar *data, int size, NalSliceHeader &header) override;
+
+    /**
+     * @brief Get the profile, tier and level of the stream
+     * @return ProfileTierLevel Those of the SPS of the last slice, or else of the last SPS
+     *         or VPS read; not valid if no parameter set was read
+     */
+    ProfileTierLevel profileTierLevel() const;
+
+private:
+    static constexpr int MaxVpsCount = 16;
+    static constexpr int MaxSpsCount = 16;
+    static constexpr int MaxPpsCount = 64;
+    static constexpr int MaxShortTermRpsCount = 64;
+    static constexpr int MaxLongTermRefPicsSps = 32;
+    static constexpr int MaxRpsPictures = 16;
+
+    /**
+     * @brief A short-term reference picture set, as derived in clause 7.4.8
+     */
+    struct ShortTermRps {
+        int numNegative = 0;
+        int numPositive = 0;
+        int deltaPoc[MaxRpsPictures];         ///< DeltaPocS0 entries, then DeltaPocS1 entries
+        bool used[MaxRpsPictures];            ///< UsedByCurrPicS0 and UsedByCurrPicS1 in the same order
+
+        int numDeltaPocs() const { return numNegative + numPositive; }
+        int usedCount() const;
+    };
+
+    /**
+     * @brief Sequence parameter set fields that slice headers depend on
+     */
+    struct Sps {
+        bool valid = false;
+        ProfileTierLevel profileTierLevel;
+        bool separateColourPlane = false;
+        int chromaArrayType = 1;
+        int log2MaxPocLsb = 4;
+        int picSizeInCtbs = 1;
+        bool sampleAdaptiveOffset = false;
+        QVector<ShortTermRps> shortTermRps;
+        bool longTermRefPicsPresent = false;
+        int numLongTermRefPicsSps = 0;
+        bool usedByCurrPicLtSps[MaxLongTermRefPicsSps];
+        bool temporalMvp = false;
+    };
+
+    /**
+     * @brief Picture parameter set fields that slice headers depend on
+     */
+    struct Pps {
+        bool valid = false;
+        int spsId = 0;
+        bool dependentSliceSegments = false;
+        bool outputFlagPresent = false;
+        int numExtraSliceHeaderBits = 0;
+        bool cabacInitPresent = false;
+        int refIdxL0Default = 1;
+        int refIdxL1Default = 1;
+        int initQp = 26;
+        bool sliceChromaQpOffsetsPresent = false;
+        bool weightedPred = false;
+        bool weightedBipred = false;
+        bool tiles = false;
+        bool entropyCodingSync = false;
+        int tileColumns = 1;
+        int tileRows = 1;
+        bool loopFilterAcrossSlices = false;
+        bool deblockingOverrideEnabled = false;
+        bool deblockingDisabled = false;
+        bool listsModificationPresent = false;
+        bool chromaQpOffsetListEnabled = false;
+    };
+
+    ProfileTierLevel vpsTable[MaxVpsCount];
+    Sps spsTable[MaxSpsCount];
+    Pps ppsTable[MaxPpsCount];
+    uchar rbsp[MaxParameterSetBytes];
+
+    // Parameter sets profileTierLevel() reports: the SPS of the last slice or the last one read,
+    // and the last VPS read; -1 if none
+    int activeSpsId;
+    int lastVpsId;
+
+    // Order count of the previous picture with TemporalId 0 that is not a RASL, RADL or
+    // sub-layer non-reference picture
+    int prevTid0PocLsb;
+    int prevTid0PocMsb;
+
+    // The next CRA picture starts a coded video sequence: at the start and after an end of sequence
+    bool sequenceStart;
+
+    // The last independent slice segment, whose fields dependent segments share, and its picture's order count
+    NalSliceHeader lastIndependent;
+    bool lastIndependentValid;
+    qint32 lastPoc;
+
+    void parseVps(BitReader &reader);
+    void parseSps(BitReader &reader);
+    void parsePps(BitReader &reader);
+    bool parseSliceSegment(BitReader &reader, int nalType, int temporalId, NalSliceHeader &header);
+
+    /**
+     * @brief Read st_ref_pic_set() with index sets.size()
+     * @param sets The sets of the SPS read so far, or all of them for a set in a slice header
+     * @param sliceHeader Whether the set is coded in a slice header
+     * @return bool False if the set is invalid
+     */
+    static bool parseShortTermRps(BitReader &reader, const QVector<ShortTermRps> &sets, bool sliceHeader, ShortTermRps &rps);
+};
+
+#endif // HEVCSYNTAXPARSER_H
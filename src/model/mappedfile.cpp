@@ -0,0 +1,127 @@
+#include "mappedfile.h"
+#include "common/logging.h"
+#include <QDebug>
+#include <cstring>
+
+// FFmpeg headers
+extern "C" {
+#include <libavformat/avio.h>
+#include <libavutil/mem.h>
+#include <libavutil/error.h>
+}
+
+namespace {
+
+// Read position of one AVIOContext; several contexts may read the same mapping
+struct MappedCursor {
+    const MappedFile *file;
+    qint64 position;
+};
+
+constexpr int kIoBufferSize = 64 << 10;
+
+} // namespace
+
+MappedFile::MappedFile()
+    : mapping(nullptr)
+    , length(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    if (mapping) {
+        file.unmap(mapping);
+    }
+}
+
+QSharedPointer<const MappedFile> MappedFile::open(const QString &filePath)
+{
+    QSharedPointer<MappedFile> mapped(new MappedFile);
+    mapped->path = filePath;
+    mapped->file.setFileName(filePath);
+    if (!mapped->file.open(QIODevice::ReadOnly)) {
+        return QSharedPointer<const MappedFile>();
+    }
+
+    // Empty files cannot be mapped, and 32-bit builds cannot map large ones
+    mapped->length = mapped->file.size();
+    mapped->mapping = mapped->length > 0 ? mapped->file.map(0, mapped->length) : nullptr;
+    if (!mapped->mapping) {
+        qCDebug(lcIo) << "Could not map" << filePath << mapped->file.errorString();
+        return QSharedPointer<const MappedFile>();
+    }
+
+    qCDebug(lcIo) << "Mapped" << mapped->length << "bytes of" << filePath;
+    return mapped;
+}
+
+QByteArray MappedFile::bytes(qint64 offset, qint64 count) const
+{
+    if (offset < 0 || offset >= length || count <= 0) {
+        return QByteArray();
+    }
+    count = qMin(count, length - offset);
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(mapping + offset), static_cast<qsizetype>(count));
+}
+
+AVIOContext *MappedFile::createIOContext() const
+{
+    unsigned char *buffer = static_cast<unsigned char *>(av_malloc(kIoBufferSize));
+    if (!buffer) {
+        return nullptr;
+    }
+    MappedCursor *cursor = new MappedCursor{ this, 0 };
+    AVIOContext *context = avio_alloc_context(buffer, kIoBufferSize, 0, cursor,
+                                              &MappedFile::readPacket, nullptr,
+                                              &MappedFile::seekPacket);
+    if (!context) {
+        av_free(buffer);
+        delete cursor;
+    }
+    return context;
+}
+
+void MappedFile::freeIOContext(AVIOContext **context)
+{
+    if (context && *context) {
+        delete static_cast<MappedCursor *>((*context)->opaque);
+        av_freep(&(*context)->buffer);
+        avio_context_free(context);
+    }
+}
+
+int MappedFile::readPacket(void *opaque, uint8_t *buffer, int size)
+{
+    MappedCursor *cursor = static_cast<MappedCursor *>(opaque);
+    const qint64 available = cursor->file->length - cursor->position;
+    if (available <= 0) {
+        return AVERROR_EOF;
+    }
+    const int count = static_cast<int>(qMin<qint64>(size, available));
+    memcpy(buffer, cursor->file->mapping + cursor->position, count);
+    cursor->position += count;
+    return count;
+}
+
+int64_t MappedFile::seekPacket(void *opaque, int64_t offset, int whence)
+{
+    MappedCursor *cursor = static_cast<MappedCursor *>(opaque);
+    const qint64 size = cursor->file->length;
+    if (whence & AVSEEK_SIZE) {
+        return size;
+    }
+
+    qint64 target;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET: target = offset; break;
+        case SEEK_CUR: target = cursor->position + offset; break;
+        case SEEK_END: target = size + offset; break;
+        default: return AVERROR(EINVAL);
+    }
+    if (target < 0 || target > size) {
+        return AVERROR(EINVAL);
+    }
+    cursor->position = target;
+    return target;
+}
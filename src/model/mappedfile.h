@@ -0,0 +1,74 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <QString>
+#include <QFile>
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QMetaType>
+
+// Forward declarations
+struct AVIOContext;
+
+/**
+ * @brief The MappedFile class is a read-only memory mapping of a whole media file
+ *
+ * One mapping serves the demuxer, through a custom AVIOContext, and the byte-level views,
+ * which read packet payloads straight from it. Pages the demuxer touched stay in the page
+ * cache, so inspecting a packet later costs no read. The mapping is shared through
+ * QSharedPointer and stays valid for as long as any holder keeps a reference, even after
+ * the file is closed in the application.
+ */
+class MappedFile
+{
+public:
+    /**
+     * @brief Map a file
+     * @param filePath The file to map
+     * @return QSharedPointer<const MappedFile> The mapping, or null if the file cannot be mapped
+     */
+    static QSharedPointer<const MappedFile> open(const QString &filePath);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    QString filePath() const { return path; }
+    const uchar *data() const { return mapping; }
+    qint64 size() const { return length; }
+
+    /**
+     * @brief Get a byte range without copying it
+     *
+     * The returned array refers to the mapping, so it must not outlive this object.
+     * The range is clipped to the file.
+     */
+    QByteArray bytes(qint64 offset, qint64 count) const;
+
+    /**
+     * @brief Create an AVIOContext that reads from the mapping
+     * @return AVIOContext* The context, or nullptr on allocation failure; free it with freeIOContext()
+     */
+    AVIOContext *createIOContext() const;
+
+    /**
+     * @brief Free a context made by createIOContext() and its buffer
+     */
+    static void freeIOContext(AVIOContext **context);
+
+private:
+    MappedFile();
+
+    QString path;
+    QFile file;
+    uchar *mapping;
+    qint64 length;
+
+    static int readPacket(void *opaque, uint8_t *buffer, int size);
+    static int64_t seekPacket(void *opaque, int64_t offset, int whence);
+};
+
+Q_DECLARE_METATYPE(QSharedPointer<const MappedFile>)
+
+#endif // MAPPEDFILE_H
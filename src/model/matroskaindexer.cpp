@@ -0,0 +1,622 @@
+#include "matroskaindexer.h"
+#include "common/logging.h"
+#include <QFile>
+#include <QByteArray>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+
+// FFmpeg headers
+extern "C" {
+#include <libavutil/avutil.h>
+}
+
+namespace {
+
+// Element IDs, with their length marker bits as they appear in the file
+enum EbmlId : quint32 {
+    EbmlHeaderId = 0x1A45DFA3,
+    SegmentId = 0x18538067,
+    SeekHeadId = 0x114D9B74,
+    SeekId = 0x4DBB,
+    SeekIdId = 0x53AB,
+    SeekPositionId = 0x53AC,
+    InfoId = 0x1549A966,
+    TimecodeScaleId = 0x2AD7B1,
+    TracksId = 0x1654AE6B,
+    TrackEntryId = 0xAE,
+    TrackNumberId = 0xD7,
+    DefaultDurationId = 0x23E383,
+    CuesId = 0x1C53BB6B,
+    CuePointId = 0xBB,
+    CueTrackPositionsId = 0xB7,
+    CueClusterPositionId = 0xF1,
+    ClusterId = 0x1F43B675,
+    TimecodeId = 0xE7,
+    SimpleBlockId = 0xA3,
+    BlockGroupId = 0xA0,
+    BlockId = 0xA1,
+    BlockDurationId = 0x9B,
+    ReferenceBlockId = 0xFB,
+    TagsId = 0x1254C367,
+    ChaptersId = 0x1043A770,
+    AttachmentsId = 0x1941A469
+};
+
+constexpr qint64 kHeaderWindowBytes = 16 * 1024;   // Read at each window miss
+constexpr qint64 kMaxReadBytes = 1 << 20;          // Longest single request (cluster scans)
+constexpr qint64 kMaxLaceHeaderBytes = 64 * 1024;
+
+bool isTopLevelId(quint32 id)
+{
+    return id == ClusterId || id == CuesId || id == SeekHeadId || id == InfoId || id == TracksId
+           || id == TagsId || id == ChaptersId || id == AttachmentsId;
+}
+
+} // namespace
+
+/**
+ * Windowed reader over the file; element headers and lace headers are served from
+ * a small window, so a run of small blocks costs one read per window while a block
+ * larger than the window is skipped with a seek and its payload never read.
+ */
+class EbmlReader
+{
+public:
+    explicit EbmlReader(const QString &filePath) : file(filePath), windowStart(0), fileSize(0) {}
+
+    bool open()
+    {
+        if (!file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        fileSize = file.size();
+        return true;
+    }
+
+    qint64 size() const { return fileSize; }
+
+    // Make [pos, pos + length) available, returning a pointer to it
+    const uchar *data(qint64 pos, qint64 length)
+    {
+        if (pos < 0 || length > kMaxReadBytes || pos + length > fileSize) {
+            return nullptr;
+        }
+        if (pos < windowStart || pos + length > windowStart + window.size()) {
+            if (!file.seek(pos)) {
+                return nullptr;
+            }
+            window = file.read(qMax(length, kHeaderWindowBytes));
+            windowStart = pos;
+            if (window.size() < length) {
+                return nullptr;
+            }
+        }
+        return reinterpret_cast<const uchar*>(window.constData()) + (pos - windowStart);
+    }
+
+    // Read a variable-length integer; keepMarker keeps the length marker (element IDs)
+    bool readVint(qint64 &pos, int maxLength, bool keepMarker, quint64 &value, bool *allOnes = nullptr)
+    {
+        const uchar *p = data(pos, 1);
+        if (!p || p[0] == 0) {
+            return false;
+        }
+        const int length = 1 + __builtin_clz(static_cast<unsigned int>(p[0])) - 24;
+        if (length > maxLength || !(p = data(pos, length))) {
+            return false;
+        }
+
+        value = keepMarker ? p[0] : (p[0] & (0xFF >> length));
+        bool ones = ((p[0] | (0xFF << (8 - length))) & 0xFF) == 0xFF;
+        for (int i = 1; i < length; ++i) {
+            value = (value << 8) | p[i];
+            ones = ones && p[i] == 0xFF;
+        }
+        if (allOnes) {
+            *allOnes = ones;
+        }
+        pos += length;
+        return true;
+    }
+
+    // Read an element header; size is -1 for an unknown size
+    bool readElement(qint64 &pos, quint32 &id, qint64 &size)
+    {
+        quint64 rawId;
+        quint64 rawSize;
+        bool unknown;
+        if (!readVint(pos, 4, true, rawId) || !readVint(pos, 8, false, rawSize, &unknown)) {
+            return false;
+        }
+        id = static_cast<quint32>(rawId);
+        size = unknown ? -1 : static_cast<qint64>(rawSize);
+        return size == -1 || pos + size <= fileSize;
+    }
+
+    bool readUInt(qint64 pos, qint64 size, quint64 &value)
+    {
+        const uchar *p = (size >= 1 && size <= 8) ? data(pos, size) : nullptr;
+        if (!p) {
+            return false;
+        }
+        value = 0;
+        for (qint64 i = 0; i < size; ++i) {
+            value = (value << 8) | p[i];
+        }
+        return true;
+    }
+
+private:
+    QFile file;
+    QByteArray window;
+    qint64 windowStart;
+    qint64 fileSize;
+};
+
+MatroskaIndexer::MatroskaIndexer(const QString &filePath, const QHash<int, StreamMapping> &trackStreams,
+                                 const std::atomic<bool> *stopFlag)
+    : filePath(filePath)
+    , trackStreams(trackStreams)
+    , stopFlag(stopFlag)
+    , reader(new EbmlReader(filePath))
+    , segmentStart(0)
+    , segmentEnd(0)
+    , firstCluster(-1)
+    , cuesPosition(-1)
+    , timecodeScale(1000000)
+{
+}
+
+MatroskaIndexer::~MatroskaIndexer()
+{
+}
+
+bool MatroskaIndexer::load()
+{
+    if (!reader->open()) {
+        return false;
+    }
+
+    // EBML header, then the Segment
+    qint64 pos = 0;
+    quint32 id;
+    qint64 size;
+    if (!reader->readElement(pos, id, size) || id != EbmlHeaderId || size < 0) {
+        return false;
+    }
+    pos += size;
+    if (!reader->readElement(pos, id, size) || id != SegmentId) {
+        return false;
+    }
+    segmentStart = pos;
+    segmentEnd = size < 0 ? reader->size() : pos + size;
+
+    // Top-level elements up to the first Cluster
+    while (pos < segmentEnd) {
+        const qint64 elementPos = pos;
+        if (!reader->readElement(pos, id, size)) {
+            break;
+        }
+        if (id == ClusterId) {
+            firstCluster = elementPos;
+            break;
+        }
+        if (size < 0) {
+            break;
+        }
+
+        switch (id) {
+            case InfoId: parseInfo(pos, pos + size); break;
+            case TracksId: parseTracks(pos, pos + size); break;
+            case SeekHeadId: parseSeekHead(pos, pos + size); break;
+            case CuesId: cuesPosition = elementPos; break;
+            default: break;
+        }
+        pos += size;
+    }
+
+    // Cues usually follow the clusters and are found through the SeekHead
+    if (cuesPosition >= 0) {
+        qint64 cuesPos = cuesPosition;
+        if (reader->readElement(cuesPos, id, size) && id == CuesId && size >= 0) {
+            parseCues(cuesPos, cuesPos + size);
+        }
+    }
+
+    if (firstCluster < 0 || tracks.isEmpty()) {
+        qCDebug(lcIndex) << "No clusters or mapped tracks in" << filePath;
+        return false;
+    }
+
+    qCDebug(lcIndex) << QString("Matroska segment: timecode scale %1 ns, %2 tracks, %3 cued clusters")
+                .arg(timecodeScale).arg(tracks.size()).arg(cueClusters.size());
+    return true;
+}
+
+void MatroskaIndexer::parseInfo(qint64 pos, qint64 end)
+{
+    quint32 id;
+    qint64 size;
+    while (pos < end && reader->readElement(pos, id, size) && size >= 0) {
+        quint64 value;
+        if (id == TimecodeScaleId && reader->readUInt(pos, size, value) && value > 0) {
+            timecodeScale = value;
+        }
+        pos += size;
+    }
+}
+
+void MatroskaIndexer::parseTracks(qint64 pos, qint64 end)
+{
+    quint32 id;
+    qint64 size;
+    while (pos < end && reader->readElement(pos, id, size) && size >= 0) {
+        if (id == TrackEntryId) {
+            quint64 number = 0;
+            quint64 defaultDuration = 0;
+            qint64 child = pos;
+            quint32 childId;
+            qint64 childSize;
+            while (child < pos + size && reader->readElement(child, childId, childSize) && childSize >= 0) {
+                if (childId == TrackNumberId) {
+                    reader->readUInt(child, childSize, number);
+                } else if (childId == DefaultDurationId) {
+                    reader->readUInt(child, childSize, defaultDuration);
+                }
+                child += childSize;
+            }
+
+            // The Matroska demuxer stores each track number in AVStream::id
+            auto mapping = trackStreams.constFind(static_cast<int>(number));
+            if (number > 0 && mapping != trackStreams.constEnd()) {
+                tracks.insert(number, { *mapping, static_cast<qint64>(defaultDuration) });
+            }
+        }
+        pos += size;
+    }
+}
+
+void MatroskaIndexer::parseSeekHead(qint64 pos, qint64 end)
+{
+    quint32 id;
+    qint64 size;
+    while (pos < end && reader->readElement(pos, id, size) && size >= 0) {
+        if (id == SeekId) {
+            quint64 target = 0;
+            quint64 position = 0;
+            bool hasPosition = false;
+            qint64 child = pos;
+            quint32 childId;
+            qint64 childSize;
+            while (child < pos + size && reader->readElement(child, childId, childSize) && childSize >= 0) {
+                if (childId == SeekIdId) {
+                    reader->readUInt(child, childSize, target);
+                } else if (childId == SeekPositionId) {
+                    hasPosition = reader->readUInt(child, childSize, position);
+                }
+                child += childSize;
+            }
+            if (target == CuesId && hasPosition) {
+                cuesPosition = segmentStart + static_cast<qint64>(position);
+            }
+        }
+        pos += size;
+    }
+}
+
+void MatroskaIndexer::parseCues(qint64 pos, qint64 end)
+{
+    quint32 id;
+    qint64 size;
+    while (pos < end && reader->readElement(pos, id, size) && size >= 0) {
+        if (id == CuePointId) {
+            qint64 child = pos;
+            quint32 childId;
+            qint64 childSize;
+            while (child < pos + size && reader->readElement(child, childId, childSize) && childSize >= 0) {
+                if (childId == CueTrackPositionsId) {
+                    qint64 leaf = child;
+                    quint32 leafId;
+                    qint64 leafSize;
+                    while (leaf < child + childSize && reader->readElement(leaf, leafId, leafSize) && leafSize >= 0) {
+                        quint64 position;
+                        if (leafId == CueClusterPositionId && reader->readUInt(leaf, leafSize, position)) {
+                            cueClusters.append(segmentStart + static_cast<qint64>(position));
+                        }
+                        leaf += leafSize;
+                    }
+                }
+                child += childSize;
+            }
+        }
+        pos += size;
+    }
+
+    std::sort(cueClusters.begin(), cueClusters.end());
+    cueClusters.erase(std::unique(cueClusters.begin(), cueClusters.end()), cueClusters.end());
+}
+
+bool MatroskaIndexer::appendTo(PacketTable &table, const BatchCallback &onBatch)
+{
+    qint64 batchStart = table.size();
+    qint64 pos = firstCluster;
+    bool tableFull = false;
+
+    // Frames of H.264 and HEVC tracks are read and split into NAL units as they are appended
+    for (const TrackInfo &track : tracks) {
+        nalPayloads.addStream(track.stream.streamIndex, track.stream.nalCodec, track.stream.codecConfig);
+    }
+    nalPayloads.openFile(filePath);
+
+    while (pos < segmentEnd && !tableFull) {
+        if (isStopped()) {
+            return false;
+        }
+
+        const qint64 elementPos = pos;
+        quint32 id;
+        qint64 size;
+        if (!reader->readElement(pos, id, size) || (size < 0 && id != ClusterId)) {
+            pos = resync(elementPos);
+            continue;
+        }
+
+        if (id == ClusterId) {
+            const qint64 end = size < 0 ? segmentEnd : pos + size;
+            pos = parseCluster(pos, end, table, tableFull);
+        } else if (isTopLevelId(id) || id == 0xEC /* Void */ || id == 0xBF /* CRC-32 */) {
+            pos += size;
+        } else {
+            pos = resync(elementPos);
+            continue;
+        }
+
+        if (onBatch && table.size() - batchStart >= PacketTable::ChunkSize) {
+            onBatch(batchStart, static_cast<int>(table.size() - batchStart), pos);
+            batchStart = table.size();
+        }
+    }
+
+    if (onBatch && table.size() > batchStart) {
+        onBatch(batchStart, static_cast<int>(table.size() - batchStart), pos);
+    }
+    if (tableFull) {
+        qCDebug(lcIndex) << "Packet table is full";
+    }
+    return !tableFull;
+}
+
+qint64 MatroskaIndexer::parseCluster(qint64 pos, qint64 end, PacketTable &table, bool &tableFull)
+{
+    qint64 clusterTimecode = 0;
+    quint32 id;
+    qint64 size;
+
+    while (pos < end) {
+        const qint64 elementPos = pos;
+        if (!reader->readElement(pos, id, size)) {
+            return resync(elementPos);
+        }
+        // An unknown-size cluster ends where the next top-level element begins
+        if (isTopLevelId(id)) {
+            return elementPos;
+        }
+        if (size < 0 || pos + size > end) {
+            return resync(elementPos);
+        }
+
+        if (id == TimecodeId) {
+            quint64 value;
+            if (reader->readUInt(pos, size, value)) {
+                clusterTimecode = static_cast<qint64>(value);
+            }
+        } else if (id == SimpleBlockId) {
+            if (!appendBlock(pos, size, clusterTimecode, true, -1, false, table)) {
+                tableFull = true;
+                return end;
+            }
+        } else if (id == BlockGroupId) {
+            qint64 blockPos = -1;
+            qint64 blockSize = 0;
+            quint64 duration = 0;
+            bool hasDuration = false;
+            bool referenced = false;
+            qint64 child = pos;
+            quint32 childId;
+            qint64 childSize;
+            while (child < pos + size && reader->readElement(child, childId, childSize) && childSize >= 0) {
+                if (childId == BlockId) {
+                    blockPos = child;
+                    blockSize = childSize;
+                } else if (childId == BlockDurationId) {
+                    hasDuration = reader->readUInt(child, childSize, duration);
+                } else if (childId == ReferenceBlockId) {
+                    referenced = true;
+                }
+                child += childSize;
+            }
+            if (blockPos >= 0
+                && !appendBlock(blockPos, blockSize, clusterTimecode, false,
+                                hasDuration ? static_cast<qint64>(duration) : -1, referenced, table)) {
+                tableFull = true;
+                return end;
+            }
+        }
+        pos += size;
+    }
+    return end;
+}
+
+bool MatroskaIndexer::appendBlock(qint64 pos, qint64 size, qint64 clusterTimecode, bool simpleBlock,
+                                  qint64 blockDuration, bool referenced, PacketTable &table)
+{
+    // Track number, relative timecode and flags
+    qint64 p = pos;
+    quint64 trackNumber;
+    if (!reader->readVint(p, 8, false, trackNumber)) {
+        return true;
+    }
+    auto track = tracks.constFind(trackNumber);
+    if (track == tracks.constEnd()) {
+        return true;
+    }
+    const uchar *header = reader->data(p, 3);
+    if (!header || p + 3 > pos + size) {
+        return true;
+    }
+    const qint64 timecode = clusterTimecode + qFromBigEndian<qint16>(header);
+    const uchar blockFlags = header[2];
+    p += 3;
+
+    // Frame sizes from the lace header
+    QVector<qint64> frameSizes;
+    qint64 framePos = p;
+    const int lacing = (blockFlags >> 1) & 0x3;
+    if (lacing == 0) {
+        frameSizes.append(pos + size - p);
+    } else {
+        const qint64 available = pos + size - p;
+        qint64 headerBytes = qMin(available, kHeaderWindowBytes);
+        const uchar *lace = reader->data(p, headerBytes);
+        if (!lace || headerBytes < 1) {
+            return true;
+        }
+        const int frames = lace[0] + 1;
+        qint64 offset = 1;
+        qint64 laced = 0;
+        if (lacing == 1) {
+            // Xiph lacing: each size is a run of 255s plus a final byte; a header that runs
+            // past the first window is read again at its full length
+            for (;;) {
+                frameSizes.clear();
+                offset = 1;
+                laced = 0;
+                bool truncated = false;
+                for (int i = 0; i < frames - 1 && !truncated; ++i) {
+                    qint64 frameSize = 0;
+                    while (offset < headerBytes && lace[offset] == 0xFF) {
+                        frameSize += 0xFF;
+                        ++offset;
+                    }
+                    truncated = offset >= headerBytes;
+                    if (!truncated) {
+                        frameSize += lace[offset++];
+                        frameSizes.append(frameSize);
+                        laced += frameSize;
+                    }
+                }
+                const qint64 limit = qMin(available, kMaxLaceHeaderBytes);
+                if (!truncated || headerBytes >= limit) {
+                    break;
+                }
+                headerBytes = limit;
+                if (!(lace = reader->data(p, headerBytes))) {
+                    return true;
+                }
+            }
+        } else if (lacing == 3) {
+            // EBML lacing: the first size, then signed differences
+            qint64 vintPos = p + offset;
+            quint64 first;
+            if (reader->readVint(vintPos, 8, false, first)) {
+                qint64 frameSize = static_cast<qint64>(first);
+                frameSizes.append(frameSize);
+                laced += frameSize;
+                for (int i = 1; i < frames - 1; ++i) {
+                    const qint64 before = vintPos;
+                    quint64 raw;
+                    if (!reader->readVint(vintPos, 8, false, raw)) {
+                        break;
+                    }
+                    const int length = static_cast<int>(vintPos - before);
+                    frameSize += static_cast<qint64>(raw) - ((1LL << (7 * length - 1)) - 1);
+                    frameSizes.append(frameSize);
+                    laced += frameSize;
+                }
+            }
+            offset = vintPos - p;
+        }
+
+        const qint64 payload = pos + size - p - offset;
+        framePos = p + offset;
+        if (lacing == 2) {
+            for (int i = 0; i < frames; ++i) {
+                frameSizes.append(payload / frames);
+            }
+        } else if (frameSizes.size() == frames - 1 && laced <= payload) {
+            frameSizes.append(payload - laced);
+        } else {
+            qCDebug(lcIndex) << "Damaged lace header at" << pos;
+            frameSizes.clear();
+            frameSizes.append(payload);
+        }
+    }
+
+    // Durations in timecode ticks
+    const int frames = frameSizes.size();
+    const qint64 defaultTicks = track->defaultDuration > 0
+                                ? static_cast<qint64>(track->defaultDuration / static_cast<qint64>(timecodeScale))
+                                : 0;
+    const qint64 frameTicks = blockDuration >= 0 ? blockDuration / frames : defaultTicks;
+
+    const bool key = simpleBlock ? (blockFlags & 0x80) != 0 : !referenced;
+    quint8 flags = static_cast<quint8>((static_cast<quint8>(track->stream.streamType) << PacketTable::StreamTypeShift)
+                                       & PacketTable::StreamTypeMask);
+    if (key) {
+        flags |= PacketTable::KeyFrameFlag;
+    }
+    if (simpleBlock && (blockFlags & 0x01)) {
+        flags |= PacketTable::DiscardFlag;
+    }
+
+    for (int i = 0; i < frames; ++i) {
+        // Later laced frames only have a timestamp when the frame duration is known
+        const qint64 pts = i == 0 ? timecode : (defaultTicks > 0 ? timecode + i * defaultTicks : AV_NOPTS_VALUE);
+        const qint64 row = table.appendRow(pts, AV_NOPTS_VALUE, pos, static_cast<qint32>(frameTicks),
+                                           static_cast<qint32>(frameSizes[i]),
+                                           static_cast<quint16>(track->stream.streamIndex), flags);
+        if (row < 0) {
+            return false;
+        }
+        nalPayloads.indexSample(table.nalUnits(), row, track->stream.streamIndex, framePos,
+                                static_cast<qint32>(frameSizes[i]));
+        framePos += frameSizes[i];
+    }
+    return true;
+}
+
+qint64 MatroskaIndexer::resync(qint64 from)
+{
+    // Prefer the next cued cluster
+    auto cue = std::upper_bound(cueClusters.begin(), cueClusters.end(), from);
+    if (cue != cueClusters.end()) {
+        qCDebug(lcIndex) << "Damaged data at" << from << "- resuming at cued cluster" << *cue;
+        return *cue;
+    }
+
+    // Otherwise scan for the next Cluster ID
+    for (qint64 pos = from + 1; pos + 4 <= segmentEnd; ) {
+        const qint64 length = qMin(kMaxReadBytes, segmentEnd - pos);
+        const uchar *data = reader->data(pos, length);
+        if (!data) {
+            break;
+        }
+        for (qint64 i = 0; i + 4 <= length; ++i) {
+            if (data[i] == 0x1F && data[i + 1] == 0x43 && data[i + 2] == 0xB6 && data[i + 3] == 0x75) {
+                qint64 check = pos + i;
+                quint32 id;
+                qint64 size;
+                if (reader->readElement(check, id, size)) {
+                    qCDebug(lcIndex) << "Damaged data at" << from << "- resuming at cluster" << pos + i;
+                    return pos + i;
+                }
+                data = reader->data(pos, length);
+            }
+        }
+        pos += length - 3;
+    }
+
+    qCDebug(lcIndex) << "Damaged data at" << from << "- no further clusters";
+    return segmentEnd;
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#ifndef MATROSKAINDEXER_H
+#define MATROSKAINDEXER_H
+
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "packettable.h"
+#include "nalpayloadindexer.h"
+
+class EbmlReader;
+
+/**
+ * @brief The MatroskaIndexer class builds the packet table of a Matroska/WebM file from its block headers
+ *
+ * The indexer walks the EBML element tree itself: it reads the segment Info and Tracks,
+ * then every Cluster and its SimpleBlock and BlockGroup headers, including the lace
+ * headers of laced blocks, and seeks over the frame payloads. Frames of H.264 and HEVC
+ * tracks are the exception: they are read and split into NAL units. Cues are read when the
+ * file has them and used to resynchronize after damaged data; without Cues the indexer
+ * scans forward for the next Cluster ID. Timestamps are in the segment timecode scale,
+ * the time base FFmpeg gives Matroska streams.
+ */
+class MatroskaIndexer
+{
+public:
+    /**
+     * @brief Callback run after each batch of appended rows
+     * @param firstIndex The first packet table row of the batch
+     * @param count The number of rows in the batch
+     * @param bytePos File position reached so far
+     */
+    using BatchCallback = std::function<void(qint64 firstIndex, int count, qint64 bytePos)>;
+
+    /**
+     * @brief Create an indexer for a file
+     * @param filePath The file to index
+     * @param trackStreams The stream each track number maps to
+     * @param stopFlag Polled while indexing; indexing ends early when it becomes true
+     */
+    MatroskaIndexer(const QString &filePath, const QHash<int, StreamMapping> &trackStreams,
+                    const std::atomic<bool> *stopFlag);
+    ~MatroskaIndexer();
+
+    /**
+     * @brief Read the segment header elements (Info, Tracks, SeekHead and Cues)
+     * @return bool False if the file is not a Matroska file with clusters
+     */
+    bool load();
+
+    /**
+     * @brief Get the end of the segment, for progress reporting
+     */
+    qint64 segmentEndPosition() const { return segmentEnd; }
+
+    /**
+     * @brief Append the frames of all clusters to the table in file order
+     * @param table The table to append to (the caller must be its only writer)
+     * @param onBatch Called after each batch of rows
+     * @return bool True if every cluster was indexed
+     */
+    bool appendTo(PacketTable &table, const BatchCallback &onBatch);
+
+private:
+    struct TrackInfo {
+        StreamMapping stream;
+        qint64 defaultDuration;    ///< Frame duration in nanoseconds, 0 if unknown
+    };
+
+    QString filePath;
+    QHash<int, StreamMapping> trackStreams;
+    const std::atomic<bool> *stopFlag;
+    std::unique_ptr<EbmlReader> reader;
+
+    qint64 segmentStart;           ///< Position of the Segment data; SeekHead and Cues positions are relative to it
+    qint64 segmentEnd;
+    qint64 firstCluster;
+    qint64 cuesPosition;
+    quint64 timecodeScale;         ///< Nanoseconds per timecode tick
+    QHash<quint64, TrackInfo> tracks;
+    QVector<qint64> cueClusters;   ///< Sorted absolute Cluster positions from the Cues
+    NalPayloadIndexer nalPayloads;
+
+    bool isStopped() const { return stopFlag && stopFlag->load(std::memory_order_relaxed); }
+    void parseInfo(qint64 pos, qint64 end);
+    void parseTracks(qint64 pos, qint64 end);
+    void parseSeekHead(qint64 pos, qint64 end);
+    void parseCues(qint64 pos, qint64 end);
+    qint64 parseCluster(qint64 pos, qint64 end, PacketTable &table, bool &tableFull);
+    bool appendBlock(qint64 pos, qint64 size, qint64 clusterTimecode, bool simpleBlock,
+                     qint64 blockDuration, bool referenced, PacketTable &table);
+    qint64 resync(qint64 from);
+};
+
+#endif // MATROSKAINDEXER_H
\ No newline at end of file
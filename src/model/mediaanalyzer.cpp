@@ -0,0 +1,55 @@
+#include "mediaanalyzer.h"
+#include "mediaparserthread.h"
+#include "streaminputreader.h"
+#include <QElapsedTimer>
+
+AnalysisResult MediaAnalyzer::analyze(const QString &filePath, const AnalysisOptions &options)
+{
+    AnalysisResult result;
+    result.filePath = filePath;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // The parser object is only driven through direct calls, so no event loop is needed
+    QSharedPointer<PacketTable> table(new PacketTable);
+    MediaParserThread parser;
+    parser.setFilePath(filePath);
+    parser.setParsePackets(options.parsePackets);
+    parser.setUseIndexCache(options.useIndexCache);
+    parser.setReadAheadSize(options.readAheadSize);
+    if (options.memoryMappedInput && !StreamInputReader::isStreamInput(filePath)) {
+        parser.setMappedFile(MappedFile::open(filePath));
+    }
+    if (options.followIdleSeconds > 0) {
+        parser.setFollowMode(true, options.followIdleSeconds * 1000);
+    }
+    parser.setPacketTable(table);
+
+    bool probed = false;
+    bool finished = false;
+    QObject::connect(&parser, &MediaParserThread::streamsProbed,
+                     [&](const QList<VideoStreamInfo> &videoStreams, const QList<AudioStreamInfo> &audioStreams, int totalStreams) {
+        result.videoStreams = videoStreams;
+        result.audioStreams = audioStreams;
+        result.totalStreams = totalStreams;
+        probed = true;
+    });
+    QObject::connect(&parser, &MediaParserThread::parsingFinished, [&]() {
+        finished = true;
+    });
+    QObject::connect(&parser, &MediaParserThread::error, [&](const QString &message) {
+        if (result.errorMessage.isEmpty()) {
+            result.errorMessage = message;
+        }
+    });
+
+    parser.startParsing();
+
+    result.ok = result.errorMessage.isEmpty() && probed && (!options.parsePackets || finished);
+    if (options.parsePackets) {
+        result.packets = table;
+    }
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
\ No newline at end of file
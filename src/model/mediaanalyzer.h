@@ -0,0 +1,55 @@
+#ifndef MEDIAANALYZER_H
+#define MEDIAANALYZER_H
+
+#include <QString>
+#include <QList>
+#include <QSharedPointer>
+#include "packettable.h"
+#include "readaheadreader.h"
+#include "mediafilemanager.h"
+
+/**
+ * @brief Options of a synchronous analysis
+ */
+struct AnalysisOptions {
+    bool parsePackets = true;     ///< Parse the packet table, not just the streams
+    bool useIndexCache = true;    ///< Load and save the persistent packet index
+    int readAheadSize = ReadAheadReader::DefaultBlockSize;  ///< Read-ahead block size in bytes, 0 to use the FFmpeg file protocol
+    bool memoryMappedInput = false;  ///< Demux from a memory mapping of the file instead of read-ahead blocks
+    int followIdleSeconds = 0;    ///< Follow a growing file until it has not grown for this long, 0 to read it as it is
+};
+
+/**
+ * @brief Result of analysing one file
+ */
+struct AnalysisResult {
+    QString filePath;
+    bool ok = false;
+    QString errorMessage;
+    QList<VideoStreamInfo> videoStreams;
+    QList<AudioStreamInfo> audioStreams;
+    int totalStreams = 0;
+    QSharedPointer<const PacketTable> packets;   ///< Null when only the streams were probed
+    qint64 elapsedMs = 0;
+};
+
+/**
+ * @brief The MediaAnalyzer class is the synchronous analysis entry point of the core library
+ *
+ * analyze() runs the same open, probe and parse job as MediaFileManager, including the
+ * packet index and the container fast paths, but on the calling thread and without an
+ * event loop. It is safe to run several analyses concurrently on different threads.
+ */
+class MediaAnalyzer
+{
+public:
+    /**
+     * @brief Analyse a file on the calling thread
+     * @param filePath The file to analyse
+     * @param options The analysis options
+     * @return AnalysisResult The streams and packets of the file
+     */
+    static AnalysisResult analyze(const QString &filePath, const AnalysisOptions &options = AnalysisOptions());
+};
+
+#endif // MEDIAANALYZER_H
\ No newline at end of file
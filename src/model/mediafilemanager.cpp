@@ -1,7 +1,12 @@
 #include "mediafilemanager.h"
+#include "hevcsyntaxparser.h"
 #include "mediaparserthread.h"
+#include "sliceprocessor.h"
+#include "streaminputreader.h"
+#include "common/logging.h"
 #include <QFileInfo>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QThread>
 
 // FFmpeg headers
@@ -16,22 +21,40 @@ extern "C" {
 MediaFileManager::MediaFileManager(QObject *parent)
     : QObject(parent)
     , fileSize(0)
-    , formatContext(nullptr)
-    , videoStream(nullptr)
-    , audioStream(nullptr)
-    , packet(nullptr)
-    , frame(nullptr)
+    , fileProbed(false)
+    , totalStreamCount(0)
     , parserThread(nullptr)
     , workerThread(nullptr)
+    , sliceProcessor(nullptr)
+    , processorThread(nullptr)
+    , jobGeneration(0)
+    , memoryMappedInputEnabled(true)
+    , followModeEnabled(false)
+    , quickScanEnabled(true)
     , autoParsingEnabled(true)  // Enable auto-parsing by default
 {
     // Register meta types for signal-slot system
+    qRegisterMetaType<ParseMetrics>("ParseMetrics");
+    qRegisterMetaType<QuickScanResult>("QuickScanResult");
     qRegisterMetaType<VideoStreamInfo>("VideoStreamInfo");
     qRegisterMetaType<AudioStreamInfo>("AudioStreamInfo");
-    qRegisterMetaType<SliceInfo>("SliceInfo");
     qRegisterMetaType<QList<VideoStreamInfo>>("QList<VideoStreamInfo>");
     qRegisterMetaType<QList<AudioStreamInfo>>("QList<AudioStreamInfo>");
-    qRegisterMetaType<QList<SliceInfo>>("QList<SliceInfo>");
+    qRegisterMetaType<QSharedPointer<const PacketTable>>("QSharedPointer<const PacketTable>");
+    qRegisterMetaType<PacketBatch>("PacketBatch");
+    qRegisterMetaType<QSharedPointer<const MappedFile>>("QSharedPointer<const MappedFile>");
+    
+    // The slice processor lives as long as the manager and serves every parse job
+    processorThread = new QThread(this);
+    sliceProcessor = new SliceProcessor();
+    sliceProcessor->moveToThread(processorThread);
+    connect(processorThread, &QThread::started, sliceProcessor, &SliceProcessor::process);
+    connect(sliceProcessor, &SliceProcessor::slicesBatchProcessed,
+            this, &MediaFileManager::onSlicesBatchProcessed, Qt::QueuedConnection);
+    connect(sliceProcessor, &SliceProcessor::processingFinished,
+            this, &MediaFileManager::onProcessingFinished, Qt::QueuedConnection);
+    sliceProcessor->start();
+    processorThread->start();
 }
 
 MediaFileManager::~MediaFileManager()
@@ -42,164 +65,92 @@ MediaFileManager::~MediaFileManager()
     // Disconnect all signals to prevent issues during destruction
     disconnect();
     closeFile();
+    
+    // No parser publishes any more, so the processor can drain and exit
+    sliceProcessor->stop();
+    processorThread->quit();
+    processorThread->wait();
+    delete sliceProcessor;
 }
 
 bool MediaFileManager::openFile(const QString &filePath)
 {
+    // Standard input, pipes and sockets are opened like files but have no size
     QFileInfo fileInfo(filePath);
-    if (!fileInfo.exists()) {
+    const bool streamInput = StreamInputReader::isStreamInput(filePath);
+    if (!streamInput && !fileInfo.exists()) {
         emit error("File does not exist: " + filePath);
         return false;
     }
 
+    // Opening another file cancels the open or parse job in flight
+    closeFile();
+
     currentFilePath = filePath;
-    fileSize = fileInfo.size();
+    fileSize = streamInput ? -1 : fileInfo.size();
     
     // Add logging information
-    qDebug() << "File opened successfully:";
-    qDebug() << "  Name:" << fileInfo.fileName();
-    qDebug() << "  Size:" << fileSize << "bytes";
+    qCDebug(lcParser) << "Opening" << (streamInput ? "stream:" : "file:");
+    qCDebug(lcParser) << "  Name:" << fileInfo.fileName();
+    qCDebug(lcParser) << "  Size:" << fileSize << "bytes";
     
-    // Open the file with FFmpeg
-    if (!openFFmpegFile(filePath)) {
-        emit error("Failed to open file with FFmpeg");
-        return false;
+    // Map the file once for the demuxer and the byte-level views; read-ahead is the fallback.
+    // A stream can be read only once, by the demuxer, so the byte-level views stay empty.
+    if (memoryMappedInputEnabled && !streamInput) {
+        mappedFile = MappedFile::open(filePath);
+        emit mappedFileChanged(mappedFile);
     }
     
-    emit fileOpened(filePath);
+    // Open and probe on the worker thread; parse packets in the same pass if enabled
+    startJob(autoParsingEnabled);
     return true;
 }
 
 void MediaFileManager::closeFile()
 {
     if (!currentFilePath.isEmpty()) {
-        // Stop parsing if in progress
+        // Stop opening or parsing if in progress
         stopParsing();
         
-        closeFFmpegFile();
+        clearStreamInfo();
+        packetTable.reset();
+        if (mappedFile) {
+            mappedFile.reset();
+            emit mappedFileChanged(mappedFile);
+        }
         currentFilePath.clear();
         fileSize = 0;
+        fileProbed = false;
         emit fileClosed();
     }
 }
 
-bool MediaFileManager::openFFmpegFile(const QString &filePath)
+bool MediaFileManager::isOpening() const
 {
-    // Clean up any existing resources
-    cleanupFFmpegResources();
-
-    // Open input file
-    int ret = avformat_open_input(&formatContext, filePath.toUtf8().constData(), nullptr, nullptr);
-    if (ret < 0) {
-        char errbuf[AV_ERROR_MAX_STRING_SIZE];
-        av_strerror(ret, errbuf, AV_ERROR_MAX_STRING_SIZE);
-        emit error(QString("Could not open input file: %1").arg(errbuf));
-        return false;
-    }
-
-    // Read stream information
-    ret = avformat_find_stream_info(formatContext, nullptr);
-    if (ret < 0) {
-        char errbuf[AV_ERROR_MAX_STRING_SIZE];
-        av_strerror(ret, errbuf, AV_ERROR_MAX_STRING_SIZE);
-        emit error(QString("Could not find stream information: %1").arg(errbuf));
-        return false;
-    }
-
-    // Find video and audio streams
-    if (!findStreams()) {
-        emit error("Could not find video or audio streams");
-        return false;
-    }
-
-    // Allocate packet and frame
-    packet = av_packet_alloc();
-    frame = av_frame_alloc();
-    if (!packet || !frame) {
-        emit error("Could not allocate packet or frame");
-        return false;
-    }
-
-    qDebug() << "FFmpeg file opened successfully:";
-    qDebug() << "  Format:" << formatContext->iformat->name;
-    qDebug() << "  Duration:" << formatContext->duration / AV_TIME_BASE << "seconds";
-    qDebug() << "  Number of streams:" << formatContext->nb_streams;
-
-    // Extract all stream information
-    extractAllStreamInfo();
-
-    // Automatically start parsing after stream extraction is complete (if enabled)
-    if (autoParsingEnabled) {
-        startParsing();
-    }
-
-    return true;
+    return !currentFilePath.isEmpty() && !fileProbed && isParsing();
 }
 
-void MediaFileManager::closeFFmpegFile()
+bool MediaFileManager::isVideoStream(const AVFormatContext *context, int streamIndex)
 {
-    cleanupFFmpegResources();
-}
-
-bool MediaFileManager::findStreams()
-{
-    videoStream = nullptr;
-    audioStream = nullptr;
-
-    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
-        AVStream *stream = formatContext->streams[i];
-        if (!videoStream && isVideoStream(i)) {
-            videoStream = stream;
-            qDebug() << "Found video stream:" << i;
-        }
-        if (!audioStream && isAudioStream(i)) {
-            audioStream = stream;
-            qDebug() << "Found audio stream:" << i;
-        }
-    }
-
-    return (videoStream != nullptr || audioStream != nullptr);
-}
-
-bool MediaFileManager::isVideoStream(int streamIndex) const
-{
-    if (!formatContext || streamIndex < 0 || streamIndex >= (int)formatContext->nb_streams) {
+    if (!context || streamIndex < 0 || streamIndex >= (int)context->nb_streams) {
         return false;
     }
-    return formatContext->streams[streamIndex]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO;
+    return context->streams[streamIndex]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO;
 }
 
-bool MediaFileManager::isAudioStream(int streamIndex) const
+bool MediaFileManager::isAudioStream(const AVFormatContext *context, int streamIndex)
 {
-    if (!formatContext || streamIndex < 0 || streamIndex >= (int)formatContext->nb_streams) {
+    if (!context || streamIndex < 0 || streamIndex >= (int)context->nb_streams) {
         return false;
     }
-    return formatContext->streams[streamIndex]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO;
+    return context->streams[streamIndex]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO;
 }
 
-void MediaFileManager::cleanupFFmpegResources()
+void MediaFileManager::clearStreamInfo()
 {
-    // Stop parsing first
-    stopParsing();
-    
-    if (formatContext) {
-        avformat_close_input(&formatContext);
-        formatContext = nullptr;
-    }
-    if (packet) {
-        av_packet_free(&packet);
-        packet = nullptr;
-    }
-    if (frame) {
-        av_frame_free(&frame);
-        frame = nullptr;
-    }
-    videoStream = nullptr;
-    audioStream = nullptr;
-    
-    // Clear stream information lists
     videoStreamInfoList.clear();
     audioStreamInfoList.clear();
+    totalStreamCount = 0;
 }
 
 QString MediaFileManager::getCurrentFilePath() const
@@ -212,34 +163,71 @@ qint64 MediaFileManager::getFileSize() const
     return fileSize;
 }
 
-void MediaFileManager::extractAllStreamInfo()
+void MediaFileManager::extractAllStreamInfo(const AVFormatContext *context,
+                                            QList<VideoStreamInfo> &videoStreams,
+                                            QList<AudioStreamInfo> &audioStreams)
 {
-    videoStreamInfoList.clear();
-    audioStreamInfoList.clear();
+    videoStreams.clear();
+    audioStreams.clear();
 
-    for (unsigned int i = 0; i < formatContext->nb_streams; i++) {
-        if (isVideoStream(i)) {
-            VideoStreamInfo info = extractVideoStreamInfo(i);
-            videoStreamInfoList.append(info);
-        } else if (isAudioStream(i)) {
-            AudioStreamInfo info = extractAudioStreamInfo(i);
-            audioStreamInfoList.append(info);
+    for (unsigned int i = 0; i < context->nb_streams; i++) {
+        if (isVideoStream(context, i)) {
+            videoStreams.append(extractVideoStreamInfo(context, i));
+        } else if (isAudioStream(context, i)) {
+            audioStreams.append(extractAudioStreamInfo(context, i));
         }
     }
+}
+
+void MediaFileManager::onStreamsProbed(const QList<VideoStreamInfo> &videoStreams, const QList<AudioStreamInfo> &audioStreams, int totalStreams)
+{
+    // Ignore results of a job that was cancelled after it queued them
+    if (sender() != parserThread) {
+        return;
+    }
+
+    videoStreamInfoList = videoStreams;
+    audioStreamInfoList = audioStreams;
+    totalStreamCount = totalStreams;
+
+    const bool firstProbe = !fileProbed;
+    fileProbed = true;
 
     emit streamsInfoUpdated(videoStreamInfoList, audioStreamInfoList);
-    qDebug() << "Extracted" << videoStreamInfoList.size() << "video streams and" << audioStreamInfoList.size() << "audio streams";
+    qCDebug(lcParser) << "Extracted" << videoStreamInfoList.size() << "video streams and" << audioStreamInfoList.size() << "audio streams";
+
+    if (firstProbe) {
+        emit fileOpened(currentFilePath);
+    }
 }
 
-VideoStreamInfo MediaFileManager::extractVideoStreamInfo(int streamIndex) const
+void MediaFileManager::onSlicesBatchProcessed(quint32 generation, qint64 firstIndex, int count)
+{
+    // Ranges of a cancelled or closed job refer to a table nobody shows any more
+    if (generation != jobGeneration || !packetTable) {
+        return;
+    }
+    emit packetsParsed(PacketBatch(packetTable, firstIndex, count));
+}
+
+void MediaFileManager::onProcessingFinished(quint32 generation)
+{
+    // The parse is reported finished once its last rows have reached the views
+    if (generation != jobGeneration || !packetTable) {
+        return;
+    }
+    emit parsingFinished();
+}
+
+VideoStreamInfo MediaFileManager::extractVideoStreamInfo(const AVFormatContext *context, int streamIndex)
 {
     VideoStreamInfo info;
 
-    if (!formatContext || streamIndex < 0 || streamIndex >= (int)formatContext->nb_streams) {
+    if (!context || streamIndex < 0 || streamIndex >= (int)context->nb_streams) {
         return info;
     }
 
-    AVStream *stream = formatContext->streams[streamIndex];
+    AVStream *stream = context->streams[streamIndex];
     AVCodecParameters *codecpar = stream->codecpar;
 
     info.streamIndex = streamIndex;
@@ -261,18 +249,30 @@ VideoStreamInfo MediaFileManager::extractVideoStreamInfo(int streamIndex) const
     info.chromaLocation = getChromaLocationName(codecpar->chroma_location);
     info.videoDelay = stream->codecpar->video_delay;
 
+    // HEVC parameter sets in the extradata also give the tier, which codecpar leaves out
+    if (codecpar->codec_id == AV_CODEC_ID_HEVC && codecpar->extradata && codecpar->extradata_size > 0) {
+        HevcSyntaxParser parser;
+        parser.parseConfig(codecpar->extradata, codecpar->extradata_size);
+        const HevcSyntaxParser::ProfileTierLevel ptl = parser.profileTierLevel();
+        if (ptl.isValid()) {
+            info.profile = getProfileName(codecpar->codec_id, ptl.profileIdc);
+            info.level = QString("%1, %2 tier").arg(getLevelName(codecpar->codec_id, ptl.levelIdc),
+                                                    QString(ptl.highTier ? "High" : "Main"));
+        }
+    }
+
     return info;
 }
 
-AudioStreamInfo MediaFileManager::extractAudioStreamInfo(int streamIndex) const
+AudioStreamInfo MediaFileManager::extractAudioStreamInfo(const AVFormatContext *context, int streamIndex)
 {
     AudioStreamInfo info;
 
-    if (!formatContext || streamIndex < 0 || streamIndex >= (int)formatContext->nb_streams) {
+    if (!context || streamIndex < 0 || streamIndex >= (int)context->nb_streams) {
         return info;
     }
 
-    AVStream *stream = formatContext->streams[streamIndex];
+    AVStream *stream = context->streams[streamIndex];
     AVCodecParameters *codecpar = stream->codecpar;
 
     info.streamIndex = streamIndex;
@@ -316,10 +316,10 @@ int MediaFileManager::getAudioStreamCount() const
 
 int MediaFileManager::getTotalStreamCount() const
 {
-    return formatContext ? formatContext->nb_streams : 0;
+    return totalStreamCount;
 }
 
-QString MediaFileManager::getCodecName(int codecId) const
+QString MediaFileManager::getCodecName(int codecId)
 {
     const AVCodec *codec = avcodec_find_decoder(static_cast<AVCodecID>(codecId));
     if (codec && codec->name) {
@@ -328,13 +328,13 @@ QString MediaFileManager::getCodecName(int codecId) const
     return QString("unknown");
 }
 
-QString MediaFileManager::getPixelFormatName(int pixFmt) const
+QString MediaFileManager::getPixelFormatName(int pixFmt)
 {
     const char *name = av_get_pix_fmt_name(static_cast<AVPixelFormat>(pixFmt));
     return name ? QString(name) : QString("unknown");
 }
 
-QString MediaFileManager::getColorRangeName(int colorRange) const
+QString MediaFileManager::getColorRangeName(int colorRange)
 {
     switch (colorRange) {
         case AVCOL_RANGE_MPEG: return "tv";
@@ -343,31 +343,31 @@ QString MediaFileManager::getColorRangeName(int colorRange) const
     }
 }
 
-QString MediaFileManager::getColorPrimariesName(int colorPrimaries) const
+QString MediaFileManager::getColorPrimariesName(int colorPrimaries)
 {
     const char *name = av_color_primaries_name(static_cast<AVColorPrimaries>(colorPrimaries));
     return name ? QString(name) : QString("unknown");
 }
 
-QString MediaFileManager::getColorTrcName(int colorTrc) const
+QString MediaFileManager::getColorTrcName(int colorTrc)
 {
     const char *name = av_color_transfer_name(static_cast<AVColorTransferCharacteristic>(colorTrc));
     return name ? QString(name) : QString("unknown");
 }
 
-QString MediaFileManager::getColorSpaceName(int colorSpace) const
+QString MediaFileManager::getColorSpaceName(int colorSpace)
 {
     const char *name = av_color_space_name(static_cast<AVColorSpace>(colorSpace));
     return name ? QString(name) : QString("unknown");
 }
 
-QString MediaFileManager::getChromaLocationName(int chromaLocation) const
+QString MediaFileManager::getChromaLocationName(int chromaLocation)
 {
     const char *name = av_chroma_location_name(static_cast<AVChromaLocation>(chromaLocation));
     return name ? QString(name) : QString("unknown");
 }
 
-QString MediaFileManager::getFieldOrderName(int fieldOrder) const
+QString MediaFileManager::getFieldOrderName(int fieldOrder)
 {
     switch (fieldOrder) {
         case AV_FIELD_PROGRESSIVE: return "progressive";
@@ -379,21 +379,25 @@ QString MediaFileManager::getFieldOrderName(int fieldOrder) const
     }
 }
 
-QString MediaFileManager::getProfileName(int codecId, int profile) const
+QString MediaFileManager::getProfileName(int codecId, int profile)
 {
     const char *name = avcodec_profile_name(static_cast<AVCodecID>(codecId), profile);
     return name ? QString(name) : QString("unknown");
 }
 
-QString MediaFileManager::getLevelName(int codecId, int level) const
+QString MediaFileManager::getLevelName(int codecId, int level)
 {
     if (level == AV_LEVEL_UNKNOWN) {
         return QString("unknown");
     }
+    // HEVC levels are coded as 30 times the level number
+    if (codecId == AV_CODEC_ID_HEVC && level > 0) {
+        return QString("%1.%2").arg(level / 30).arg(level % 30 / 3);
+    }
     return QString::number(level);
 }
 
-QString MediaFileManager::formatAspectRatio(int num, int den) const
+QString MediaFileManager::formatAspectRatio(int num, int den)
 {
     if (den == 0) {
         return QString("unknown");
@@ -408,40 +412,67 @@ void MediaFileManager::startParsing()
         return;
     }
     
-    // Stop any existing parsing
+    startJob(true);
+}
+
+void MediaFileManager::startJob(bool parsePackets)
+{
+    // Stop any existing job
     stopParsing();
     
+    // Every parse fills a fresh table; readers of the previous one keep their reference
+    packetTable = QSharedPointer<PacketTable>::create();
+    emit packetTableReset(packetTable);
+    
     // Create worker thread
     workerThread = new QThread(this);
     
-    // Create parser thread object
+    // Create parser thread object; it opens and probes the file once and parses
+    // packets from the same demuxer context
     parserThread = new MediaParserThread();
     parserThread->setFilePath(currentFilePath);
+    parserThread->setPacketTable(packetTable);
+    parserThread->setParsePackets(parsePackets);
+    parserThread->setSliceProcessor(sliceProcessor, ++jobGeneration);
+    parserThread->setMappedFile(mappedFile);
+    parserThread->setFollowMode(followModeEnabled);
+    parserThread->setQuickScanSamples(quickScanEnabled ? QuickScanSamples : 0);
     
     // Move parser to worker thread
     parserThread->moveToThread(workerThread);
     
     // Connect signals
     connect(workerThread, &QThread::started, parserThread, &MediaParserThread::startParsing);
-    connect(parserThread, &MediaParserThread::slicesParsed, this, &MediaFileManager::slicesParsed, Qt::QueuedConnection);
+    connect(parserThread, &MediaParserThread::probingProgress, this, &MediaFileManager::probingProgress, Qt::QueuedConnection);
+    connect(parserThread, &MediaParserThread::streamsProbed, this, &MediaFileManager::onStreamsProbed, Qt::QueuedConnection);
     connect(parserThread, &MediaParserThread::parsingProgress, this, &MediaFileManager::parsingProgress, Qt::QueuedConnection);
-    connect(parserThread, &MediaParserThread::parsingFinished, this, &MediaFileManager::parsingFinished, Qt::QueuedConnection);
+    connect(parserThread, &MediaParserThread::parsingMetrics, this, &MediaFileManager::parsingMetrics, Qt::QueuedConnection);
+    connect(parserThread, &MediaParserThread::quickScanFinished, this, &MediaFileManager::quickScanFinished, Qt::QueuedConnection);
     connect(parserThread, &MediaParserThread::error, this, &MediaFileManager::error, Qt::QueuedConnection);
     
     // Connect cleanup signals
-    connect(parserThread, &MediaParserThread::parsingFinished, workerThread, &QThread::quit);
-    connect(parserThread, &MediaParserThread::error, workerThread, &QThread::quit);
+    connect(parserThread, &MediaParserThread::jobFinished, workerThread, &QThread::quit);
     connect(workerThread, &QThread::finished, parserThread, &QObject::deleteLater);
     connect(workerThread, &QThread::finished, workerThread, &QObject::deleteLater);
     
-    // Clear pointers when objects are deleted
-    connect(parserThread, &QObject::destroyed, this, [this]() { parserThread = nullptr; });
-    connect(workerThread, &QObject::destroyed, this, [this]() { workerThread = nullptr; });
+    // Clear pointers when objects are deleted, unless a newer job replaced them already
+    MediaParserThread *parser = parserThread;
+    QThread *worker = workerThread;
+    connect(parserThread, &QObject::destroyed, this, [this, parser]() {
+        if (parserThread == parser) {
+            parserThread = nullptr;
+        }
+    });
+    connect(workerThread, &QObject::destroyed, this, [this, worker]() {
+        if (workerThread == worker) {
+            workerThread = nullptr;
+        }
+    });
     
     // Start the worker thread
     workerThread->start();
     
-    qDebug() << "Started parsing thread for file:" << currentFilePath;
+    qCDebug(lcParser) << "Started" << (parsePackets ? "parsing" : "probing") << "thread for file:" << currentFilePath;
 }
 
 void MediaFileManager::stopParsing()
@@ -450,14 +481,15 @@ void MediaFileManager::stopParsing()
         parserThread->requestStop();
     }
     
+    // Every blocking step of a job polls the stop flag, so the job ends within one read
+    // and leaves a checkpoint for the next open to resume from
     if (workerThread && workerThread->isRunning()) {
-        qDebug() << "Stopping parsing thread...";
+        qCDebug(lcParser) << "Stopping parsing thread...";
+        QElapsedTimer stopTimer;
+        stopTimer.start();
         workerThread->quit();
-        if (!workerThread->wait(5000)) { // Wait up to 5 seconds
-            qDebug() << "Force terminating parsing thread...";
-            workerThread->terminate();
-            workerThread->wait();
-        }
+        workerThread->wait();
+        qCDebug(lcParser) << "Parsing thread stopped in" << stopTimer.elapsed() << "ms";
     }
     
     // Objects will be deleted automatically through deleteLater connections
@@ -470,13 +502,62 @@ bool MediaFileManager::isParsing() const
     return workerThread && workerThread->isRunning();
 }
 
+void MediaFileManager::prioritizePosition(qint64 position)
+{
+    if (parserThread) {
+        parserThread->requestPriorityPosition(position);
+        qCDebug(lcParser) << "Priority parse requested at byte" << position;
+    }
+}
+
+void MediaFileManager::prioritizeTime(double seconds)
+{
+    if (parserThread) {
+        parserThread->requestPriorityTime(seconds);
+        qCDebug(lcParser) << "Priority parse requested at" << seconds << "seconds";
+    }
+}
+
 void MediaFileManager::setAutoParsingEnabled(bool enabled)
 {
     autoParsingEnabled = enabled;
-    qDebug() << "Auto-parsing" << (enabled ? "enabled" : "disabled");
+    qCDebug(lcParser) << "Auto-parsing" << (enabled ? "enabled" : "disabled");
 }
 
 bool MediaFileManager::isAutoParsingEnabled() const
 {
     return autoParsingEnabled;
+}
+
+void MediaFileManager::setMemoryMappedInputEnabled(bool enabled)
+{
+    memoryMappedInputEnabled = enabled;
+    qCDebug(lcParser) << "Memory-mapped input" << (enabled ? "enabled" : "disabled");
+}
+
+bool MediaFileManager::isMemoryMappedInputEnabled() const
+{
+    return memoryMappedInputEnabled;
+}
+
+void MediaFileManager::setFollowModeEnabled(bool enabled)
+{
+    followModeEnabled = enabled;
+    qCDebug(lcParser) << "Follow mode" << (enabled ? "enabled" : "disabled");
+}
+
+bool MediaFileManager::isFollowModeEnabled() const
+{
+    return followModeEnabled;
+}
+
+void MediaFileManager::setQuickScanEnabled(bool enabled)
+{
+    quickScanEnabled = enabled;
+    qCDebug(lcParser) << "Quick scan" << (enabled ? "enabled" : "disabled");
+}
+
+bool MediaFileManager::isQuickScanEnabled() const
+{
+    return quickScanEnabled;
 } 
\ No newline at end of file
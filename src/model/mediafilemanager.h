@@ -5,30 +5,17 @@
 #include <QString>
 #include <QFileInfo>
 #include <QList>
+#include <QVector>
+#include <QSharedPointer>
+#include "packettable.h"
+#include "mappedfile.h"
 
 // Forward declarations for FFmpeg structures
 struct AVFormatContext;
-struct AVStream;
-struct AVPacket;
-struct AVFrame;
 
 // Forward declaration for parser thread
 class MediaParserThread;
-
-// Slice information structure
-struct SliceInfo {
-    int streamIndex;
-    int64_t pts;          // Presentation timestamp
-    int64_t dts;          // Decode timestamp
-    int64_t duration;     // Duration
-    int64_t pos;          // Position in file
-    int size;             // Size in bytes
-    bool isKeyFrame;      // Is this a key frame
-    QString streamType;   // "video" or "audio"
-    
-    // Constructor
-    SliceInfo() : streamIndex(-1), pts(0), dts(0), duration(0), pos(0), size(0), isKeyFrame(false) {}
-};
+class SliceProcessor;
 
 // Video stream information structure
 struct VideoStreamInfo {
@@ -73,13 +60,59 @@ struct AudioStreamInfo {
     AudioStreamInfo() : streamIndex(-1), codecTag(0), bitRate(0), sampleRate(0), channels(0), bitsPerSample(0) {}
 };
 
+// Live metrics of a packet parse, measured in bytes of the input file
+struct ParseMetrics {
+    qint64 bytesDone;          // Bytes of the file parsed so far
+    qint64 totalBytes;         // Size of the input, or -1 if unknown
+    qint64 packets;            // Packets in the table
+    qint64 elapsedMs;          // Time since the parse started
+    double bytesPerSecond;
+    double packetsPerSecond;
+    qint64 etaMs;              // Estimated time to completion, or -1 if unknown
+
+    // Constructor
+    ParseMetrics() : bytesDone(0), totalBytes(-1), packets(0), elapsedMs(0), bytesPerSecond(0), packetsPerSecond(0), etaMs(-1) {}
+};
+
+// Bit rate and key frame spacing of one stream, estimated by a quick scan
+struct QuickScanStreamEstimate {
+    int streamIndex;
+    double bitRate;            // Bits per second over the sampled packets
+    double keyFrameInterval;   // Average packets from one key frame to the next, or 0 if unknown
+    double keyFrameSeconds;    // Average time from one key frame to the next, or 0 if unknown
+
+    // Constructor
+    QuickScanStreamEstimate() : streamIndex(-1), bitRate(0), keyFrameInterval(0), keyFrameSeconds(0) {}
+};
+
+// Overall bit rate around one sampled byte offset
+struct QuickScanPoint {
+    qint64 position;           // Byte offset the sample was read from
+    double seconds;            // Presentation time of the sample
+    double bitRate;            // Bits per second of all streams in the sample
+};
+
+// Estimates from demuxing short windows spread over the input, published early in the full parse
+struct QuickScanResult {
+    QSharedPointer<const PacketTable> packets;   // Sampled packets; estimates until the full parse replaces them
+    QVector<QuickScanPoint> bitRateProfile;      // One point per sample, in file order
+    QList<QuickScanStreamEstimate> streams;
+    double averageBitRate;     // Bits per second over all samples
+    int samples;               // Samples read; fewer than requested if the time budget ran out
+    qint64 bytesRead;
+    qint64 elapsedMs;
+
+    // Constructor
+    QuickScanResult() : averageBitRate(0), samples(0), bytesRead(0), elapsedMs(0) {}
+};
+
 // Register types with Qt's meta-object system
+Q_DECLARE_METATYPE(ParseMetrics)
+Q_DECLARE_METATYPE(QuickScanResult)
 Q_DECLARE_METATYPE(VideoStreamInfo)
 Q_DECLARE_METATYPE(AudioStreamInfo)
-Q_DECLARE_METATYPE(SliceInfo)
 Q_DECLARE_METATYPE(QList<VideoStreamInfo>)
 Q_DECLARE_METATYPE(QList<AudioStreamInfo>)
-Q_DECLARE_METATYPE(QList<SliceInfo>)
 
 class MediaFileManager : public QObject
 {
@@ -90,26 +123,34 @@ public:
     virtual ~MediaFileManager();
 
     // File operations
+    // openFile() only validates the path and starts the open job; the file is opened,
+    // probed and (with auto-parsing) parsed on the worker thread. fileOpened and
+    // streamsInfoUpdated are emitted once probing finishes.
     bool openFile(const QString &filePath);
     void closeFile();
     QString getCurrentFilePath() const;
-    qint64 getFileSize() const;
-
-    // FFmpeg operations
-    bool openFFmpegFile(const QString &filePath);
-    void closeFFmpegFile();
-    bool findStreams();
-    bool isVideoStream(int streamIndex) const;
-    bool isAudioStream(int streamIndex) const;
-    AVStream* getVideoStream() const { return videoStream; }
-    AVStream* getAudioStream() const { return audioStream; }
-    AVFormatContext* getFormatContext() const { return formatContext; }
+    qint64 getFileSize() const;          // -1 for standard input, pipes and sockets
+    bool isOpening() const;
+
+    // Stream classification of a probed context
+    static bool isVideoStream(const AVFormatContext *context, int streamIndex);
+    static bool isAudioStream(const AVFormatContext *context, int streamIndex);
+
+    // Shared packet table of the current parse
+    QSharedPointer<const PacketTable> getPacketTable() const { return packetTable; }
+
+    // Memory mapping of the open file, shared by the parser and the byte-level views
+    QSharedPointer<const MappedFile> getMappedFile() const { return mappedFile; }
 
     // Stream information extraction
     QList<VideoStreamInfo> getVideoStreamInfoList() const;
     QList<AudioStreamInfo> getAudioStreamInfoList() const;
-    VideoStreamInfo extractVideoStreamInfo(int streamIndex) const;
-    AudioStreamInfo extractAudioStreamInfo(int streamIndex) const;
+    // Safe to call from the thread that owns the context
+    static void extractAllStreamInfo(const AVFormatContext *context,
+                                     QList<VideoStreamInfo> &videoStreams,
+                                     QList<AudioStreamInfo> &audioStreams);
+    static VideoStreamInfo extractVideoStreamInfo(const AVFormatContext *context, int streamIndex);
+    static AudioStreamInfo extractAudioStreamInfo(const AVFormatContext *context, int streamIndex);
 
     // Stream count getters
     int getVideoStreamCount() const;
@@ -121,55 +162,96 @@ public:
     void stopParsing();
     bool isParsing() const;
     
+    // Parse the region at a byte offset, or around a time in seconds, before the rest of
+    // the file; ignored when no parse is running
+    void prioritizePosition(qint64 position);
+    void prioritizeTime(double seconds);
+    
     // Auto-parsing control
     void setAutoParsingEnabled(bool enabled);
     bool isAutoParsingEnabled() const;
+    
+    // Memory-mapped input control (takes effect when the next file is opened)
+    void setMemoryMappedInputEnabled(bool enabled);
+    bool isMemoryMappedInputEnabled() const;
+    
+    // Follow mode: keep parsing bytes appended to the file while it is being written
+    // (takes effect when the next file is opened)
+    void setFollowModeEnabled(bool enabled);
+    bool isFollowModeEnabled() const;
+    
+    // Quick scan control: sample large files for estimates alongside the full parse
+    // (takes effect when the next file is opened)
+    void setQuickScanEnabled(bool enabled);
+    bool isQuickScanEnabled() const;
 
 signals:
     void fileOpened(const QString &filePath);
     void fileClosed();
     void error(const QString &message);
+    void probingProgress(qint64 bytesProbed);
     void streamsInfoUpdated(const QList<VideoStreamInfo> &videoStreams, const QList<AudioStreamInfo> &audioStreams);
-    void slicesParsed(const QList<SliceInfo> &slices);
+    void packetTableReset(QSharedPointer<const PacketTable> table);
+    void mappedFileChanged(QSharedPointer<const MappedFile> mapping);
+    void packetsParsed(const PacketBatch &batch);
     void parsingProgress(int percentage);
+    void parsingMetrics(const ParseMetrics &metrics);
+    void quickScanFinished(const QuickScanResult &result);
     void parsingFinished();
 
+private slots:
+    void onStreamsProbed(const QList<VideoStreamInfo> &videoStreams, const QList<AudioStreamInfo> &audioStreams, int totalStreams);
+    void onSlicesBatchProcessed(quint32 generation, qint64 firstIndex, int count);
+    void onProcessingFinished(quint32 generation);
+
 private:
     QString currentFilePath;
     qint64 fileSize;
-
-    // FFmpeg context pointers
-    AVFormatContext *formatContext;
-    AVStream *videoStream;
-    AVStream *audioStream;
-    AVPacket *packet;
-    AVFrame *frame;
+    bool fileProbed;
 
     // Stream information lists
     QList<VideoStreamInfo> videoStreamInfoList;
     QList<AudioStreamInfo> audioStreamInfoList;
+    int totalStreamCount;
+
+    // Packet table filled by the parser thread
+    QSharedPointer<PacketTable> packetTable;
 
     // Parser thread
     MediaParserThread *parserThread;
     QThread *workerThread;
 
+    // Receives row ranges from the parser through a lock-free ring, on its own thread
+    SliceProcessor *sliceProcessor;
+    QThread *processorThread;
+    quint32 jobGeneration;
+
+    // Mapping of the open file, or null when mapping is disabled or failed
+    QSharedPointer<const MappedFile> mappedFile;
+    bool memoryMappedInputEnabled;
+    bool followModeEnabled;
+    
+    // Windows sampled by the quick scan, spread evenly over the file
+    static constexpr int QuickScanSamples = 32;
+    bool quickScanEnabled;
+
     // Auto-parsing flag
     bool autoParsingEnabled;
 
     // Helper methods
-    void cleanupFFmpegResources();
-    void extractAllStreamInfo();
-    QString getCodecName(int codecId) const;
-    QString getPixelFormatName(int pixFmt) const;
-    QString getColorRangeName(int colorRange) const;
-    QString getColorPrimariesName(int colorPrimaries) const;
-    QString getColorTrcName(int colorTrc) const;
-    QString getColorSpaceName(int colorSpace) const;
-    QString getChromaLocationName(int chromaLocation) const;
-    QString getFieldOrderName(int fieldOrder) const;
-    QString getProfileName(int codecId, int profile) const;
-    QString getLevelName(int codecId, int level) const;
-    QString formatAspectRatio(int num, int den) const;
+    void startJob(bool parsePackets);
+    void clearStreamInfo();
+    static QString getCodecName(int codecId);
+    static QString getPixelFormatName(int pixFmt);
+    static QString getColorRangeName(int colorRange);
+    static QString getColorPrimariesName(int colorPrimaries);
+    static QString getColorTrcName(int colorTrc);
+    static QString getColorSpaceName(int colorSpace);
+    static QString getChromaLocationName(int chromaLocation);
+    static QString getFieldOrderName(int fieldOrder);
+    static QString getProfileName(int codecId, int profile);
+    static QString getLevelName(int codecId, int level);
+    static QString formatAspectRatio(int num, int den);
 };
 
-#endif // MEDIAFILEMANAGER_H 
\ No newline at end of file
+#endif // MEDIAFILEMANAGER_H
\ No newline at end of file
@@ -1,8 +1,26 @@
 #include "mediaparserthread.h"
 #include "mediafilemanager.h"
+#include "packetindexcache.h"
+#include "tsshardparser.h"
+#include "movsampleindexer.h"
+#include "matroskaindexer.h"
+#include "sliceprocessor.h"
+#include "readaheadreader.h"
+#include "growingfilereader.h"
+#include "streaminputreader.h"
+#include "nalpayloadindexer.h"
+#include "common/logging.h"
 #include <QMutexLocker>
 #include <QDebug>
 #include <QThread>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+#include <QVector>
+#include <algorithm>
+#include <limits>
+#include <cstring>
 
 // FFmpeg headers
 extern "C" {
@@ -14,8 +32,35 @@ extern "C" {
 MediaParserThread::MediaParserThread(QObject *parent)
     : QObject(parent)
     , stopRequested(false)
+    , parsePackets(true)
+    , useIndexCache(true)
+    , quickScanSamples(0)
+    , probing(false)
+    , lastProbeReport(0)
+    , sliceProcessor(nullptr)
+    , generation(0)
     , parseContext(nullptr)
     , parsePacket(nullptr)
+    , metricsTotalBytes(-1)
+    , metricsBytesDone(0)
+    , lastMetricsReport(0)
+    , lastProgress(-1)
+    , metricsStartBytes(0)
+    , metricsStartPackets(0)
+    , indexWriter(nullptr)
+    , checkpointsEnabled(false)
+    , checkpointIntervalMs(CheckpointIntervalMs)
+    , openRegionStart(-1)
+    , openRegionEnd(-1)
+    , readAheadSize(ReadAheadReader::DefaultBlockSize)
+    , readAhead(nullptr)
+    , ioContext(nullptr)
+    , followMode(false)
+    , followIdleTimeoutMs(0)
+    , growingReader(nullptr)
+    , streamReader(nullptr)
+    , quickScanThread(nullptr)
+    , quickScanStop(false)
 {
     parsePacket = av_packet_alloc();
 }
@@ -31,196 +76,1222 @@ void MediaParserThread::setFilePath(const QString &filePath)
     this->filePath = filePath;
 }
 
-void MediaParserThread::requestStop()
+void MediaParserThread::setParsePackets(bool enabled)
 {
     QMutexLocker locker(&mutex);
-    stopRequested = true;
+    parsePackets = enabled;
 }
 
-bool MediaParserThread::isStopped() const
+void MediaParserThread::setUseIndexCache(bool enabled)
+{
+    QMutexLocker locker(&mutex);
+    useIndexCache = enabled;
+}
+
+void MediaParserThread::setReadAheadSize(int bytes)
+{
+    QMutexLocker locker(&mutex);
+    readAheadSize = bytes;
+}
+
+void MediaParserThread::setMappedFile(const QSharedPointer<const MappedFile> &mapping)
+{
+    QMutexLocker locker(&mutex);
+    mappedFile = mapping;
+}
+
+void MediaParserThread::setFollowMode(bool enabled, int idleTimeoutMs)
+{
+    QMutexLocker locker(&mutex);
+    followMode = enabled;
+    followIdleTimeoutMs = qMax(0, idleTimeoutMs);
+}
+
+void MediaParserThread::setQuickScanSamples(int samples)
+{
+    QMutexLocker locker(&mutex);
+    quickScanSamples = qMax(0, samples);
+}
+
+void MediaParserThread::setPacketTable(const QSharedPointer<PacketTable> &table)
+{
+    QMutexLocker locker(&mutex);
+    packetTable = table;
+}
+
+void MediaParserThread::setSliceProcessor(SliceProcessor *processor, quint32 generation)
 {
     QMutexLocker locker(&mutex);
-    return stopRequested;
+    sliceProcessor = processor;
+    this->generation = generation;
+}
+
+void MediaParserThread::requestStop()
+{
+    // Also polled by FFmpeg through the interrupt callback, so blocking
+    // open, probe and read calls return promptly
+    stopRequested.store(true, std::memory_order_relaxed);
+}
+
+void MediaParserThread::requestPriorityPosition(qint64 position)
+{
+    schedule.requestPosition(position);
+}
+
+void MediaParserThread::requestPriorityTime(double seconds)
+{
+    schedule.requestTime(seconds);
+}
+
+bool MediaParserThread::isStopped() const
+{
+    return stopRequested.load(std::memory_order_relaxed);
+}
+
+int MediaParserThread::interruptCallback(void *opaque)
+{
+    MediaParserThread *self = static_cast<MediaParserThread*>(opaque);
+    
+    // Report probing progress as the bytes consumed so far, at most once per MiB
+    if (self->probing && self->parseContext && self->parseContext->pb) {
+        const qint64 bytes = avio_tell(self->parseContext->pb);
+        if (bytes - self->lastProbeReport >= (1 << 20)) {
+            self->lastProbeReport = bytes;
+            emit self->probingProgress(bytes);
+        }
+    }
+    
+    return self->isStopped() ? 1 : 0;
 }
 
 void MediaParserThread::startParsing()
 {
+    runJob();
+    emit jobFinished();
+}
+
+void MediaParserThread::publishPackets(qint64 firstIndex, int count)
+{
+    // Only the parser thread reads these once the job runs
+    if (sliceProcessor) {
+        sliceProcessor->publish({ generation, firstIndex, count });
+    } else {
+        emit packetsParsed(firstIndex, count);
+    }
+}
+
+void MediaParserThread::publishFinished()
+{
+    // The processor reports the end once every range published before it is delivered
+    if (sliceProcessor) {
+        sliceProcessor->finish(generation);
+    }
+    emit parsingFinished();
+}
+
+void MediaParserThread::beginMetrics(qint64 totalBytes)
+{
+    metricsTimer.start();
+    metricsTotalBytes = totalBytes > 0 ? totalBytes : -1;
+    metricsBytesDone = 0;
+    lastMetricsReport = 0;
+    lastProgress = -1;
+    metricsStartBytes = 0;
+    metricsStartPackets = 0;
+}
+
+void MediaParserThread::reportProgress(qint64 bytesDone, bool force)
+{
+    metricsBytesDone = bytesDone;
+    
+    // Progress is the share of the input consumed, which every container and timestamp layout agrees on
+    if (metricsTotalBytes > 0) {
+        const int progress = static_cast<int>(qBound<qint64>(0, bytesDone * 100 / metricsTotalBytes, 100));
+        if (progress != lastProgress) {
+            emit parsingProgress(progress);
+            lastProgress = progress;
+        }
+    }
+    
+    // Throughput is published four times a second
+    const qint64 elapsed = metricsTimer.elapsed();
+    if (!force && elapsed - lastMetricsReport < 250) {
+        return;
+    }
+    lastMetricsReport = elapsed;
+    
+    QSharedPointer<PacketTable> table;
+    {
+        QMutexLocker locker(&mutex);
+        table = packetTable;
+    }
+    
+    ParseMetrics metrics;
+    metrics.bytesDone = bytesDone;
+    metrics.totalBytes = metricsTotalBytes;
+    metrics.packets = table ? table->size() : 0;
+    metrics.elapsedMs = elapsed;
+    if (elapsed > 0) {
+        metrics.bytesPerSecond = qMax<qint64>(0, bytesDone - metricsStartBytes) * 1000.0 / elapsed;
+        metrics.packetsPerSecond = qMax<qint64>(0, metrics.packets - metricsStartPackets) * 1000.0 / elapsed;
+    }
+    if (metricsTotalBytes > 0 && metrics.bytesPerSecond > 0) {
+        metrics.etaMs = static_cast<qint64>(qMax<qint64>(0, metricsTotalBytes - bytesDone) * 1000.0 / metrics.bytesPerSecond);
+    }
+    emit parsingMetrics(metrics);
+}
+
+void MediaParserThread::finishMetrics(bool reachedEnd)
+{
+    reportProgress(reachedEnd && metricsTotalBytes > 0 ? metricsTotalBytes : metricsBytesDone, true);
+    if (lastProgress != 100) {
+        emit parsingProgress(100);
+        lastProgress = 100;
+    }
+}
+
+void MediaParserThread::runJob()
+{
+    qCDebug(lcParser) << "Starting media file parsing in thread:" << QThread::currentThread();
+    
+    QSharedPointer<PacketTable> table;
+    QString currentFilePath;
+    bool indexCache;
+    bool follow;
     {
         QMutexLocker locker(&mutex);
-        stopRequested = false;
+        table = packetTable;
+        currentFilePath = filePath;
+        follow = followMode;
+        indexCache = useIndexCache;
     }
     
-    qDebug() << "Starting media file parsing in thread:" << QThread::currentThread();
+    // Streams and growing files can only go through the demuxer, and have no stable
+    // identity to key an index by
+    const bool demuxOnly = follow || StreamInputReader::isStreamInput(currentFilePath);
+    if (demuxOnly) {
+        indexCache = false;
+    }
+    if (!table) {
+        emit error("No packet table set for parsing");
+        return;
+    }
+    
+    // A valid index from an earlier run replaces probing and demuxing
+    if (indexCache && loadFromIndex(table)) {
+        return;
+    }
     
     if (!openFile()) {
-        emit error("Failed to open file for parsing");
+        if (!isStopped()) {
+            emit error("Failed to open file for parsing");
+        }
+        return;
+    }
+    
+    // Publish the stream information as soon as probing is done
+    QList<VideoStreamInfo> videoStreams;
+    QList<AudioStreamInfo> audioStreams;
+    MediaFileManager::extractAllStreamInfo(parseContext, videoStreams, audioStreams);
+    const int totalStreams = static_cast<int>(parseContext->nb_streams);
+    emit streamsProbed(videoStreams, audioStreams, totalStreams);
+    
+    // Large inputs are sampled on a second demuxer alongside the parse, so estimates are
+    // available within about a second without holding the parse back
+    startQuickScan();
+    
+    bool parse;
+    {
+        QMutexLocker locker(&mutex);
+        parse = parsePackets;
+    }
+    if (!parse) {
+        qCDebug(lcParser) << "Probing finished, packet parsing disabled";
+        finishQuickScan(false);
+        closeFile();
         return;
     }
     
-    QList<SliceInfo> slices;
     int64_t totalDuration = parseContext->duration;
-    int64_t currentTime = 0;
-    int lastProgress = -1;
+    qCDebug(lcParser) << "Starting packet parsing. Total duration:" << totalDuration;
+    
+    // MP4/MOV files are indexed from their sample tables, Matroska from its block headers,
+    // transport streams on all cores, and everything else goes through the demuxer.
+    // Streams and followed files have no final size, so they report none here.
+    bool reachedEnd = false;
+    beginMetrics(parseContext->pb ? avio_size(parseContext->pb) : -1);
+    schedule.setInput(metricsTotalBytes,
+                      totalDuration > 0 ? static_cast<double>(totalDuration) / AV_TIME_BASE : 0.0,
+                      parseContext->bit_rate);
+    
+    // A partial index left by a stopped parse seeds the table and the schedule; the index is
+    // then kept up to date, as checkpoints where the parse can resume and complete at the end
+    if (indexCache) {
+        checkpointsEnabled = canResume();
+        qint64 storedChunks = 0;
+        qint64 storedNalChunks = 0;
+        if (checkpointsEnabled) {
+            restoreCheckpoint(table, storedChunks, storedNalChunks);
+        }
+        indexWriter = new PacketIndexWriter(currentFilePath);
+        if (!indexWriter->open(videoStreams, audioStreams, totalStreams, storedChunks, storedNalChunks)) {
+            delete indexWriter;
+            indexWriter = nullptr;
+        }
+        checkpointTimer.start();
+    }
+    
+    if (demuxOnly) {
+        reachedEnd = parseSequentially(table);
+    } else if (!parseSampleTables(table, reachedEnd) && !parseMatroskaBlocks(table, reachedEnd)) {
+        reachedEnd = canParseShards() ? parseShards(table) : parseSequentially(table);
+    }
+    
+    // Estimates are of no use once the parse is done
+    finishQuickScan(true);
+    
+    // Log parsing summary
+    qCDebug(lcParser) << "=== PARSING SUMMARY ===";
+    qCDebug(lcParser) << QString("Total slices processed: %1").arg(table->size());
+    qCDebug(lcParser) << QString("File duration: %1 seconds").arg(totalDuration / AV_TIME_BASE);
+    qCDebug(lcParser) << QString("Number of streams: %1").arg(parseContext->nb_streams);
+    qCDebug(lcParser) << QString("Packet table memory: %1 bytes").arg(table->memoryUsage());
+    qCDebug(lcParser) << QString("NAL units indexed: %1 (%2 start code search)")
+                .arg(table->nalUnits().size()).arg(NalScanner::kernelName());
+    
+    // Count slices by stream type
+    int videoSlices = 0, audioSlices = 0, otherSlices = 0;
+    for (int i = 0; i < parseContext->nb_streams; i++) {
+        StreamType streamType = getStreamType(i);
+        if (streamType == StreamType::Video) videoSlices++;
+        else if (streamType == StreamType::Audio) audioSlices++;
+        else otherSlices++;
+    }
+    qCDebug(lcParser) << QString("Streams breakdown - Video: %1, Audio: %2, Other: %3")
+                .arg(videoSlices).arg(audioSlices).arg(otherSlices);
+    qCDebug(lcParser) << "=======================";
+    
+    closeFile();
+    
+    if (!isStopped()) {
+        finishMetrics(reachedEnd);
+        publishFinished();
+        qCDebug(lcParser) << "Media file parsing completed successfully";
+    }
+    
+    // Complete the index, or leave a checkpoint for the next run to resume from
+    if (indexWriter) {
+        if (reachedEnd && !isStopped()) {
+            indexWriter->write(*table, nullptr);
+        } else {
+            writeCheckpoint(*table, true);
+        }
+        delete indexWriter;
+        indexWriter = nullptr;
+    }
+}
+
+bool MediaParserThread::parseSequentially(const QSharedPointer<PacketTable> &table)
+{
+    qint64 batchStart = table->size();
     int sliceCount = 0;
     
-    qDebug() << "Starting packet parsing. Total duration:" << totalDuration;
+    // The file is read as regions, each owning the packets that start inside it; without
+    // priority requests one region spans the whole file. A request cuts the current region
+    // after the packets kept so far and the demuxer seeks to the requested byte, reading
+    // until it meets a covered range and then seeking back to the first gap. Reading runs
+    // SeamLookahead bytes past a region's end, so packets it started that are interleaved
+    // with later data still complete.
+    const bool reorder = canReorderRegions();
+    qint64 regionStart = 0;
+    qint64 regionEnd = reorder ? schedule.totalBytes() : std::numeric_limits<qint64>::max();
+    qint64 lastKept = -1;       // Highest packet position kept in the region
+    qint64 jumpTarget = -1;     // Requested region to read once the current one is closed
+    qint64 keepFrom = 0;        // Packets before this were kept by an earlier region or run
+    qint64 seamEnd = -1;        // Packets before this may be in the table already
+    QSet<QPair<qint64, int>> seamRows;
+    bool complete = false;
+    NalPayloadIndexer nalPayloads;
+    for (unsigned int i = 0; i < parseContext->nb_streams; i++) {
+        const AVCodecParameters *codecpar = parseContext->streams[i]->codecpar;
+        nalPayloads.addStream(static_cast<int>(i), getNalCodec(i),
+                              QByteArray::fromRawData(reinterpret_cast<const char *>(codecpar->extradata),
+                                                      codecpar->extradata_size));
+    }
+    
+    // While a followed file waits for more bytes, the rows held back for batching are
+    // published and progress reported, so appended packets show up without delay
+    if (growingReader) {
+        growingReader->setWaitCallback([this, &table, &batchStart]() {
+            const qint64 pending = table->size() - batchStart;
+            if (pending > 0) {
+                publishPackets(batchStart, static_cast<int>(pending));
+                batchStart = table->size();
+            }
+            reportProgress(growingReader->position());
+        });
+    }
+    
+    // A restored checkpoint re-reads the end of the region that was open, so packets still
+    // in flight when it was taken complete; rows already in the table are skipped there
+    if (reorder && (openRegionStart >= 0 || schedule.coveredBytes() > 0)) {
+        if (openRegionStart >= 0) {
+            regionStart = openRegionStart;
+            keepFrom = qMax(openRegionStart, openRegionEnd - SeamLookahead);
+            seamEnd = openRegionEnd;
+            lastKept = openRegionEnd - 1;
+            const qint64 rows = table->size();
+            for (qint64 i = 0; i < rows; ++i) {
+                const qint64 rowPos = table->pos(i);
+                if (rowPos >= keepFrom && rowPos < seamEnd) {
+                    seamRows.insert({ rowPos, table->streamIndex(i) });
+                }
+            }
+        } else {
+            regionStart = keepFrom = schedule.firstGap(0);
+            if (regionStart < 0) {
+                return true;
+            }
+            lastKept = regionStart - 1;
+        }
+        regionEnd = schedule.nextCoveredStart(regionStart);
+        if (!seekToByte(keepFrom)) {
+            return false;
+        }
+        qCDebug(lcParser) << "Resuming parse at byte" << keepFrom << "of" << schedule.totalBytes();
+    }
     
     // Parse packets from the file
-    while (av_read_frame(parseContext, parsePacket) >= 0) {
+    for (;;) {
+        const int readResult = av_read_frame(parseContext, parsePacket);
+        const qint64 pos = readResult >= 0 ? parsePacket->pos : -1;
+        
+        // Close the region at its end or at the end of the file and move to the next one
+        const bool regionEmpty = jumpTarget >= 0 && lastKept < regionStart;
+        if (readResult < 0 || (reorder && (pos >= regionEnd + SeamLookahead || regionEmpty))) {
+            if (readResult >= 0) {
+                av_packet_unref(parsePacket);
+            }
+            if (!reorder || (readResult < 0 && readResult != AVERROR_EOF)) {
+                complete = readResult == AVERROR_EOF;
+                break;
+            }
+            
+            schedule.markCovered(regionStart, regionEnd);
+            const qint64 next = jumpTarget >= 0 ? jumpTarget : schedule.firstGap(regionEnd);
+            jumpTarget = -1;
+            if (next < 0) {
+                complete = true;
+                break;
+            }
+            if (isStopped() || !seekToByte(next)) {
+                break;
+            }
+            regionStart = keepFrom = next;
+            regionEnd = schedule.nextCoveredStart(next);
+            lastKept = next - 1;
+            seamEnd = -1;
+            seamRows.clear();
+            qCDebug(lcParser) << "Parsing region from byte" << regionStart << "to" << regionEnd;
+            continue;
+        }
+        
         // Check if stop was requested
         if (isStopped()) {
-            qDebug() << "Parsing stopped by request";
+            qCDebug(lcParser) << "Parsing stopped by request";
             break;
         }
         
-        // Create slice info from packet
+        if (reorder) {
+            // Requests already parsed, or close ahead of the demuxer, need no seek
+            qint64 target;
+            if (schedule.hasRequest() && schedule.takeRequest(target)) {
+                target = schedule.coveredEnd(target);
+                const bool parsed = target >= schedule.totalBytes() || (target >= regionStart && target <= lastKept);
+                const bool nearby = jumpTarget < 0 && target > lastKept && target < regionEnd
+                                    && target - lastKept <= PriorityReachBytes;
+                if (!parsed && !nearby) {
+                    regionEnd = qMin(regionEnd, qMax(regionStart, lastKept + 1));
+                    jumpTarget = target;
+                    qCDebug(lcParser) << "Priority request for byte" << target << "- closing region at" << regionEnd;
+                }
+            }
+            
+            // Packets outside the region belong to one read before or after it
+            if (pos >= 0 && (pos < keepFrom || pos >= regionEnd
+                             || (pos < seamEnd && seamRows.contains({ pos, parsePacket->stream_index })))) {
+                av_packet_unref(parsePacket);
+                continue;
+            }
+            lastKept = qMax(lastKept, pos);
+        }
+        
+        // Create slice info from packet and store it in the shared table
         SliceInfo slice = createSliceInfo(parsePacket, parsePacket->stream_index);
-        slices.append(slice);
+        const qint64 row = table->append(slice);
+        if (row < 0) {
+            av_packet_unref(parsePacket);
+            emit error("Packet table is full");
+            break;
+        }
         sliceCount++;
         
-        // Log detailed information for first 10 slices, then every 50th slice
+        // Split H.264 and HEVC packets into NAL units linked to the new row
+        if (nalPayloads.hasStream(parsePacket->stream_index)) {
+            nalPayloads.indexPayload(table->nalUnits(), row, parsePacket->stream_index, parsePacket->data, parsePacket->size);
+        }
+        
+        // Trace the first 10 slices, then every 50th; compiled out unless trace logging is on
         if (sliceCount <= 10 || sliceCount % 50 == 0) {
-            QString logMsg = QString("Slice #%1: Stream %2 (%3), PTS: %4, DTS: %5, Duration: %6, Size: %7 bytes, KeyFrame: %8, Pos: %9")
-                        .arg(sliceCount)
-                        .arg(slice.streamIndex)
-                        .arg(slice.streamType)
-                        .arg(slice.pts)
-                        .arg(slice.dts)
-                        .arg(slice.duration)
-                        .arg(slice.size)
-                        .arg(slice.isKeyFrame ? "Yes" : "No")
-                        .arg(slice.pos);
-            
-            if (sliceCount <= 10) {
-                qDebug() << "[FIRST_SLICES]" << logMsg;
-            } else {
-                qDebug() << "[PROGRESS]" << logMsg;
-            }
+            LG_TRACE(lcParser) << (sliceCount <= 10 ? "[FIRST_SLICES]" : "[PROGRESS]")
+                               << QString("Slice #%1: Stream %2 (%3), PTS: %4, DTS: %5, Duration: %6, Size: %7 bytes, KeyFrame: %8, Pos: %9")
+                                  .arg(sliceCount)
+                                  .arg(slice.streamIndex)
+                                  .arg(streamTypeName(slice.streamType))
+                                  .arg(slice.pts)
+                                  .arg(slice.dts)
+                                  .arg(slice.duration)
+                                  .arg(slice.size)
+                                  .arg(slice.isKeyFrame ? "Yes" : "No")
+                                  .arg(slice.pos);
         }
         
-        // Update progress
-        if (totalDuration > 0) {
-            currentTime = parsePacket->pts;
-            if (currentTime > 0) {
-                int progress = static_cast<int>((currentTime * 100) / totalDuration);
-                if (progress != lastProgress && progress >= 0 && progress <= 100) {
-                    emit parsingProgress(progress);
-                    lastProgress = progress;
-                }
-            }
+        // Update progress from the covered ranges and the demuxer's position in the region
+        if ((sliceCount & 63) == 0) {
+            const qint64 position = avio_tell(parseContext->pb);
+            reportProgress(reorder ? schedule.coveredBytes() + qBound<qint64>(0, position - regionStart, regionEnd - regionStart)
+                                   : position);
+            openRegionStart = regionStart;
+            openRegionEnd = qMax(regionStart, lastKept + 1);
+            writeCheckpoint(*table, false);
         }
         
-        // Emit slices in batches to avoid overwhelming the UI
-        if (slices.size() >= 100) {
-            qDebug() << QString("Emitting batch of %1 slices (total processed: %2)")
-                        .arg(slices.size())
+        // Announce new rows in batches to avoid overwhelming the UI
+        const qint64 pending = table->size() - batchStart;
+        if (pending >= 100) {
+            LG_TRACE(lcParser) << QString("Emitting batch of %1 slices (total processed: %2)")
+                        .arg(pending)
                         .arg(sliceCount);
-            emit slicesParsed(slices);
-            slices.clear();
+            publishPackets(batchStart, static_cast<int>(pending));
+            batchStart = table->size();
         }
         
         // Unref the packet
         av_packet_unref(parsePacket);
     }
     
-    // Emit any remaining slices
-    if (!slices.isEmpty()) {
-        qDebug() << QString("Emitting final batch of %1 slices").arg(slices.size());
-        emit slicesParsed(slices);
+    if (growingReader) {
+        growingReader->setWaitCallback(nullptr);
     }
     
-    // Log parsing summary
-    qDebug() << "=== PARSING SUMMARY ===";
-    qDebug() << QString("Total slices processed: %1").arg(sliceCount);
-    qDebug() << QString("File duration: %1 seconds").arg(totalDuration / AV_TIME_BASE);
-    qDebug() << QString("Number of streams: %1").arg(parseContext->nb_streams);
+    // Announce any remaining rows
+    const qint64 remaining = table->size() - batchStart;
+    if (remaining > 0) {
+        LG_TRACE(lcParser) << QString("Emitting final batch of %1 slices").arg(remaining);
+        publishPackets(batchStart, static_cast<int>(remaining));
+    }
     
-    // Count slices by stream type
-    int videoSlices = 0, audioSlices = 0, otherSlices = 0;
-    for (int i = 0; i < parseContext->nb_streams; i++) {
-        QString streamType = getStreamType(i);
-        if (streamType == "video") videoSlices++;
-        else if (streamType == "audio") audioSlices++;
-        else otherSlices++;
+    // The last checkpoint resumes in the region that was being read
+    openRegionStart = complete ? -1 : regionStart;
+    openRegionEnd = qMax(regionStart, lastKept + 1);
+    
+    // Only a parse that covered the whole file is worth persisting
+    return complete;
+}
+
+void MediaParserThread::startQuickScan()
+{
+    int samples;
+    bool follow;
+    QString currentFilePath;
+    QSharedPointer<const MappedFile> mapping;
+    {
+        QMutexLocker locker(&mutex);
+        samples = quickScanSamples;
+        follow = followMode;
+        currentFilePath = filePath;
+        mapping = mappedFile;
+    }
+    const qint64 totalBytes = parseContext->pb ? avio_size(parseContext->pb) : -1;
+    if (samples <= 0 || follow || totalBytes < QuickScanMinBytes || !canSeekBytes()
+        || StreamInputReader::isStreamInput(currentFilePath)) {
+        return;
     }
-    qDebug() << QString("Streams breakdown - Video: %1, Audio: %2, Other: %3")
-                .arg(videoSlices).arg(audioSlices).arg(otherSlices);
-    qDebug() << "=======================";
     
-    closeFile();
+    // The scan opens its own demuxer on the same file, so it needs nothing the parse changes
+    QuickScanInput input;
+    input.filePath = currentFilePath;
+    input.format = parseContext->iformat;
+    input.mapping = mapping && mapping->filePath() == currentFilePath ? mapping : QSharedPointer<const MappedFile>();
+    input.totalBytes = totalBytes;
+    input.samples = samples;
+    input.startTime = parseContext->start_time != AV_NOPTS_VALUE
+                      ? static_cast<double>(parseContext->start_time) / AV_TIME_BASE : 0.0;
+    input.streams = streamsById();
+    input.keyedById = input.streams.size() == static_cast<int>(parseContext->nb_streams);
+    if (!input.keyedById) {
+        input.streams.clear();
+        for (unsigned int i = 0; i < parseContext->nb_streams; i++) {
+            input.streams.insert(static_cast<int>(i), { static_cast<int>(i), getStreamType(i) });
+        }
+    }
+    
+    quickScanStop.store(false, std::memory_order_relaxed);
+    quickScanThread = QThread::create([this, input]() { runQuickScan(input); });
+    quickScanThread->start();
+}
+
+void MediaParserThread::finishQuickScan(bool cancel)
+{
+    if (!quickScanThread) {
+        return;
+    }
+    if (cancel) {
+        quickScanStop.store(true, std::memory_order_relaxed);
+    }
+    quickScanThread->wait();
+    delete quickScanThread;
+    quickScanThread = nullptr;
+}
+
+int MediaParserThread::quickScanInterruptCallback(void *opaque)
+{
+    const MediaParserThread *self = static_cast<const MediaParserThread*>(opaque);
+    return self->isStopped() || self->quickScanStop.load(std::memory_order_relaxed) ? 1 : 0;
+}
+
+void MediaParserThread::runQuickScan(const QuickScanInput &input)
+{
+    QElapsedTimer timer;
+    timer.start();
+    auto cancelled = [this]() {
+        return isStopped() || quickScanStop.load(std::memory_order_relaxed);
+    };
+    
+    // A mapped file is shared with the parse; otherwise the scan reads through FFmpeg
+    AVFormatContext *context = avformat_alloc_context();
+    AVIOContext *scanIo = nullptr;
+    AVPacket *packet = av_packet_alloc();
+    if (!context || !packet) {
+        avformat_free_context(context);
+        av_packet_free(&packet);
+        return;
+    }
+    context->interrupt_callback.callback = &MediaParserThread::quickScanInterruptCallback;
+    context->interrupt_callback.opaque = this;
+    if (input.mapping) {
+        scanIo = input.mapping->createIOContext();
+        context->pb = scanIo;
+    }
+    if (avformat_open_input(&context, input.filePath.toUtf8().constData(), input.format, nullptr) < 0) {
+        qCDebug(lcParser) << "Quick scan could not open" << input.filePath;
+        MappedFile::freeIOContext(&scanIo);
+        av_packet_free(&packet);
+        return;
+    }
+    
+    const qint64 totalBytes = input.totalBytes;
+    const int samples = input.samples;
+    QSharedPointer<PacketTable> sampled(new PacketTable);
+    QuickScanResult result;
+    
+    // Bytes and time spans summed over the samples, and the key frame intervals seen whole
+    struct StreamTotals {
+        qint64 bytes = 0;
+        double seconds = 0;
+        qint64 keyFramePackets = 0;
+        double keyFrameSeconds = 0;
+        int keyFrameIntervals = 0;
+    };
+    struct WindowState {
+        qint64 bytes = 0;
+        bool hasTime = false;
+        double firstTime = 0;
+        double endTime = 0;
+        int packetsSinceKey = 0;   // Packets from the last key frame on, 0 before the first one
+        double lastKeyTime = 0;
+        bool lastKeyHasTime = false;
+        int keyFrames = 0;
+    };
+    QHash<int, StreamTotals> totals;
+    QHash<int, StreamType> streamTypes;
+    for (const StreamMapping &mapping : input.streams) {
+        streamTypes.insert(mapping.streamIndex, mapping.streamType);
+    }
+    qint64 sampledBytes = 0;
+    double sampledSeconds = 0;
+    const double startTime = input.startTime;
+    
+    // Samples are visited coarse to fine (0, 1/2, 1/4, 3/4, ...), so a scan cut short by the
+    // time budget still spans the whole input
+    QVector<int> order;
+    QVector<bool> queued(samples, false);
+    int step = 1;
+    while (step < samples) {
+        step *= 2;
+    }
+    for (; step >= 1; step /= 2) {
+        for (int i = 0; i < samples; i += step) {
+            if (!queued[i]) {
+                queued[i] = true;
+                order.append(i);
+            }
+        }
+    }
+    
+    for (int sample : order) {
+        if (cancelled() || timer.elapsed() >= QuickScanBudgetMs) {
+            break;
+        }
+        const qint64 offset = totalBytes * sample / samples;
+        if (av_seek_frame(context, -1, offset, AVSEEK_FLAG_BYTE) < 0) {
+            continue;
+        }
+        
+        // A window ends after its byte budget once every video stream in it has shown a
+        // whole key frame interval, or at its reach for long intervals
+        QHash<int, WindowState> window;
+        qint64 lastPosition = offset;
+        while (av_read_frame(context, packet) >= 0) {
+            // Packets are attributed to the parse's streams, matched by container id
+            const AVStream *stream = context->streams[packet->stream_index];
+            auto mapping = input.streams.constFind(input.keyedById ? stream->id : packet->stream_index);
+            if (mapping == input.streams.constEnd()) {
+                av_packet_unref(packet);
+                continue;
+            }
+            const int streamIndex = mapping->streamIndex;
+            const AVRational timeBase = stream->time_base;
+            const int64_t timestamp = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+            WindowState &state = window[streamIndex];
+            state.bytes += packet->size;
+            
+            const bool hasTime = timestamp != AV_NOPTS_VALUE;
+            const double time = hasTime ? timestamp * av_q2d(timeBase) : 0.0;
+            if (hasTime) {
+                if (!state.hasTime) {
+                    state.hasTime = true;
+                    state.firstTime = time;
+                }
+                state.endTime = qMax(state.endTime, time + packet->duration * av_q2d(timeBase));
+            }
+            if (packet->flags & AV_PKT_FLAG_KEY) {
+                // An interval counts only when both of its key frames have a timestamp
+                if (state.packetsSinceKey > 0 && hasTime && state.lastKeyHasTime) {
+                    StreamTotals &streamTotals = totals[streamIndex];
+                    streamTotals.keyFramePackets += state.packetsSinceKey;
+                    streamTotals.keyFrameSeconds += time - state.lastKeyTime;
+                    streamTotals.keyFrameIntervals++;
+                }
+                state.packetsSinceKey = 1;
+                state.lastKeyTime = time;
+                state.lastKeyHasTime = hasTime;
+                state.keyFrames++;
+            } else if (state.packetsSinceKey > 0) {
+                state.packetsSinceKey++;
+            }
+            
+            // The parse context belongs to the parser thread, so the row is filled here
+            SliceInfo slice;
+            slice.streamIndex = streamIndex;
+            slice.pts = packet->pts;
+            slice.dts = packet->dts;
+            slice.duration = packet->duration;
+            slice.pos = packet->pos;
+            slice.size = packet->size;
+            slice.isKeyFrame = (packet->flags & AV_PKT_FLAG_KEY) != 0;
+            slice.streamType = mapping->streamType;
+            sampled->append(slice);
+            lastPosition = packet->pos >= 0 ? packet->pos : avio_tell(context->pb);
+            av_packet_unref(packet);
+            
+            if (lastPosition - offset >= QuickScanMaxWindowBytes || cancelled()) {
+                break;
+            }
+            if (lastPosition - offset >= QuickScanWindowBytes) {
+                bool intervalOpen = false;
+                for (auto it = window.cbegin(); it != window.cend(); ++it) {
+                    intervalOpen |= streamTypes.value(it.key()) == StreamType::Video && it.value().keyFrames < 2;
+                }
+                if (!intervalOpen) {
+                    break;
+                }
+            }
+        }
+        
+        // The sample's bit rate spreads all of its bytes over its longest stream span
+        qint64 windowBytes = 0;
+        double windowSeconds = 0;
+        double windowTime = -1;
+        for (auto it = window.cbegin(); it != window.cend(); ++it) {
+            const WindowState &state = it.value();
+            windowBytes += state.bytes;
+            if (!state.hasTime || state.endTime <= state.firstTime) {
+                continue;
+            }
+            StreamTotals &streamTotals = totals[it.key()];
+            streamTotals.bytes += state.bytes;
+            streamTotals.seconds += state.endTime - state.firstTime;
+            windowSeconds = qMax(windowSeconds, state.endTime - state.firstTime);
+            windowTime = windowTime < 0 ? state.firstTime : qMin(windowTime, state.firstTime);
+        }
+        result.samples++;
+        result.bytesRead += lastPosition - offset;
+        if (windowSeconds > 0) {
+            sampledBytes += windowBytes;
+            sampledSeconds += windowSeconds;
+            result.bitRateProfile.append({ offset, qMax(0.0, windowTime - startTime), windowBytes * 8 / windowSeconds });
+        }
+    }
+    
+    std::sort(result.bitRateProfile.begin(), result.bitRateProfile.end(),
+              [](const QuickScanPoint &a, const QuickScanPoint &b) { return a.position < b.position; });
+    for (int i = 0; i < input.streams.size(); ++i) {
+        auto it = totals.constFind(i);
+        if (it == totals.cend()) {
+            continue;
+        }
+        QuickScanStreamEstimate estimate;
+        estimate.streamIndex = i;
+        estimate.bitRate = it->seconds > 0 ? it->bytes * 8 / it->seconds : 0;
+        if (it->keyFrameIntervals > 0) {
+            estimate.keyFrameInterval = static_cast<double>(it->keyFramePackets) / it->keyFrameIntervals;
+            estimate.keyFrameSeconds = it->keyFrameSeconds / it->keyFrameIntervals;
+        }
+        result.streams.append(estimate);
+    }
+    result.averageBitRate = sampledSeconds > 0 ? sampledBytes * 8 / sampledSeconds : 0;
+    result.packets = sampled;
+    result.elapsedMs = timer.elapsed();
+    
+    avformat_close_input(&context);
+    MappedFile::freeIOContext(&scanIo);
+    av_packet_free(&packet);
+    
+    qCDebug(lcParser) << "Quick scan read" << result.samples << "of" << samples << "samples," << result.bytesRead
+                      << "bytes and" << sampled->size() << "packets in" << result.elapsedMs << "ms; average bit rate"
+                      << qRound64(result.averageBitRate) << "bps";
+    if (!cancelled()) {
+        emit quickScanFinished(result);
+    }
+}
+
+bool MediaParserThread::canSeekBytes() const
+{
+    return parseContext->pb && parseContext->iformat
+           && (parseContext->pb->seekable & AVIO_SEEKABLE_NORMAL)
+           && !(parseContext->iformat->flags & AVFMT_NO_BYTE_SEEK);
+}
+
+bool MediaParserThread::canReorderRegions() const
+{
+    // Regions are reached with byte seeks, which need a seekable input of known size
+    return schedule.totalBytes() > 0 && canSeekBytes();
+}
+
+bool MediaParserThread::seekToByte(qint64 position)
+{
+    if (av_seek_frame(parseContext, -1, position, AVSEEK_FLAG_BYTE) < 0) {
+        qCDebug(lcParser) << "Byte seek to" << position << "failed";
+        emit error(QString("Seeking to byte %1 failed").arg(position));
+        return false;
+    }
+    return true;
+}
+
+bool MediaParserThread::parseSampleTables(const QSharedPointer<PacketTable> &table, bool &complete)
+{
+    if (!parseContext || !parseContext->iformat || strncmp(parseContext->iformat->name, "mov,", 4) != 0) {
+        return false;
+    }
+    
+    QString currentFilePath;
+    {
+        QMutexLocker locker(&mutex);
+        currentFilePath = filePath;
+    }
+    
+    // The MOV demuxer stores each track ID in AVStream::id
+    MovSampleIndexer indexer(currentFilePath, streamsById(), &stopRequested);
+    if (!indexer.load()) {
+        qCDebug(lcParser) << "Sample tables unusable, demuxing the file instead";
+        return false;
+    }
+    
+    // Tracks are merged by position, so the last sample's end is how far into the file the index got
+    PacketTable *rows = table.data();
+    complete = indexer.appendTo(*table, [this, rows](qint64 firstIndex, int count) {
+        publishPackets(firstIndex, count);
+        const qint64 last = firstIndex + count - 1;
+        reportProgress(rows->pos(last) + rows->packetSize(last));
+    });
+    if (!complete && !isStopped()) {
+        emit error("MP4 sample tables ended before their last sample");
+    }
+    return true;
+}
+
+bool MediaParserThread::parseMatroskaBlocks(const QSharedPointer<PacketTable> &table, bool &complete)
+{
+    if (!parseContext || !parseContext->iformat || strncmp(parseContext->iformat->name, "matroska", 8) != 0) {
+        return false;
+    }
+    
+    QString currentFilePath;
+    {
+        QMutexLocker locker(&mutex);
+        currentFilePath = filePath;
+    }
+    
+    // The Matroska demuxer stores each track number in AVStream::id
+    MatroskaIndexer indexer(currentFilePath, streamsById(), &stopRequested);
+    if (!indexer.load()) {
+        qCDebug(lcParser) << "Matroska structure unusable, demuxing the file instead";
+        return false;
+    }
+    
+    // Clusters are read in file order; the segment may end before the file does
+    if (indexer.segmentEndPosition() > 0) {
+        metricsTotalBytes = indexer.segmentEndPosition();
+    }
+    complete = indexer.appendTo(*table, [this](qint64 firstIndex, int count, qint64 bytePos) {
+        publishPackets(firstIndex, count);
+        reportProgress(bytePos);
+    }) && !isStopped();
+    return true;
+}
+
+bool MediaParserThread::canParseShards() const
+{
+    if (!parseContext || !parseContext->iformat || strcmp(parseContext->iformat->name, "mpegts") != 0) {
+        return false;
+    }
+    
+    QString currentFilePath;
+    {
+        QMutexLocker locker(&mutex);
+        currentFilePath = filePath;
+    }
+    return TsShardParser::canShard(currentFilePath);
+}
+
+bool MediaParserThread::parseShards(const QSharedPointer<PacketTable> &table)
+{
+    QString currentFilePath;
+    {
+        QMutexLocker locker(&mutex);
+        currentFilePath = filePath;
+    }
+    
+    // The transport stream demuxer stores each stream's PID in AVStream::id; priority
+    // requests pick the shard parsed next
+    TsShardParser parser(currentFilePath, streamsById(), &stopRequested);
+    PacketTable *rows = table.data();
+    const bool complete = parser.run(*table, [this, rows](qint64 firstIndex, int count, qint64 bytesDone) {
+        if (count > 0) {
+            publishPackets(firstIndex, count);
+        }
+        reportProgress(bytesDone);
+        writeCheckpoint(*rows, false);
+    }, &schedule);
+    
+    if (!complete && !isStopped()) {
+        emit error("Parallel transport stream parsing failed");
+    }
+    return complete;
+}
+
+QHash<int, StreamMapping> MediaParserThread::streamsById() const
+{
+    QHash<int, StreamMapping> streams;
+    for (unsigned int i = 0; i < parseContext->nb_streams; i++) {
+        const AVCodecParameters *codecpar = parseContext->streams[i]->codecpar;
+        StreamMapping mapping = { static_cast<int>(i), getStreamType(i), getNalCodec(i) };
+        if (mapping.nalCodec != NalCodec::Unknown && codecpar->extradata) {
+            mapping.codecConfig = QByteArray(reinterpret_cast<const char *>(codecpar->extradata), codecpar->extradata_size);
+        }
+        streams.insert(parseContext->streams[i]->id, mapping);
+    }
+    return streams;
+}
+
+bool MediaParserThread::loadFromIndex(const QSharedPointer<PacketTable> &table)
+{
+    QString currentFilePath;
+    bool parse;
+    {
+        QMutexLocker locker(&mutex);
+        currentFilePath = filePath;
+        parse = parsePackets;
+    }
+    
+    PacketIndexCache cache(currentFilePath);
+    if (!cache.load()) {
+        return false;
+    }
+    if (parse && (!table->isEmpty() || !cache.attachPackets(*table))) {
+        qCDebug(lcParser) << "Could not attach packet index, parsing the file instead";
+        return false;
+    }
+    
+    QList<VideoStreamInfo> videoStreams;
+    QList<AudioStreamInfo> audioStreams;
+    int totalStreams = 0;
+    cache.streamInfo(videoStreams, audioStreams, totalStreams);
+    emit streamsProbed(videoStreams, audioStreams, totalStreams);
+    
+    if (!parse) {
+        return true;
+    }
+    
+    // Announce the whole table in int-sized ranges
+    const qint64 total = table->size();
+    for (qint64 first = 0; first < total && !isStopped(); ) {
+        const int count = static_cast<int>(qMin<qint64>(total - first, std::numeric_limits<int>::max()));
+        publishPackets(first, count);
+        first += count;
+    }
     
     if (!isStopped()) {
         emit parsingProgress(100);
-        emit parsingFinished();
-        qDebug() << "Media file parsing completed successfully";
+        publishFinished();
+        qCDebug(lcParser) << "Loaded" << total << "packets from index" << cache.indexFilePath();
+    }
+    return true;
+}
+
+bool MediaParserThread::canResume() const
+{
+    // MP4 and Matroska indexing is fast enough to redo; a resumed demuxer or shard parse
+    // needs byte positions to restart from
+    if (!parseContext || !parseContext->iformat
+        || strncmp(parseContext->iformat->name, "mov,", 4) == 0
+        || strncmp(parseContext->iformat->name, "matroska", 8) == 0) {
+        return false;
+    }
+    return canParseShards() || canReorderRegions();
+}
+
+bool MediaParserThread::restoreCheckpoint(const QSharedPointer<PacketTable> &table, qint64 &storedChunks,
+                                          qint64 &storedNalChunks)
+{
+    QString currentFilePath;
+    {
+        QMutexLocker locker(&mutex);
+        currentFilePath = filePath;
+    }
+    
+    PacketIndexCache cache(currentFilePath);
+    if (!cache.load(true) || cache.isComplete()) {
+        return false;
+    }
+    if (!table->isEmpty() || !cache.attachPackets(*table)) {
+        qCDebug(lcParser) << "Could not attach partial packet index, parsing from the start";
+        return false;
+    }
+    
+    const ParseCheckpoint checkpoint = cache.checkpoint();
+    for (const auto &span : checkpoint.coveredSpans) {
+        schedule.markCovered(span.first, span.second);
+    }
+    openRegionStart = checkpoint.openStart;
+    openRegionEnd = checkpoint.openEnd;
+    storedChunks = cache.storedChunkCount();
+    storedNalChunks = cache.storedNalChunkCount();
+    
+    // Shards have no open region; one left by the demuxer counts as covered
+    if (openRegionStart >= 0 && canParseShards()) {
+        schedule.markCovered(openRegionStart, openRegionEnd);
+        openRegionStart = openRegionEnd = -1;
+    }
+    
+    // Show the restored rows at once; rates count only what this run parses
+    const qint64 total = table->size();
+    for (qint64 first = 0; first < total && !isStopped(); ) {
+        const int count = static_cast<int>(qMin<qint64>(total - first, std::numeric_limits<int>::max()));
+        publishPackets(first, count);
+        first += count;
     }
+    const qint64 restoredBytes = schedule.coveredBytes() + qMax<qint64>(0, openRegionEnd - openRegionStart);
+    metricsStartBytes = restoredBytes;
+    metricsStartPackets = total;
+    reportProgress(restoredBytes, true);
+    
+    qCDebug(lcParser) << "Resuming from checkpoint with" << total << "packets and"
+                      << restoredBytes << "bytes covered";
+    return true;
+}
+
+void MediaParserThread::writeCheckpoint(const PacketTable &table, bool force)
+{
+    if (!indexWriter || !checkpointsEnabled) {
+        return;
+    }
+    if (!force && checkpointTimer.elapsed() < checkpointIntervalMs) {
+        return;
+    }
+    
+    ParseCheckpoint checkpoint;
+    checkpoint.coveredSpans = schedule.coveredSpans();
+    checkpoint.openStart = openRegionStart;
+    checkpoint.openEnd = openRegionEnd;
+    
+    // Checkpoints take a small share of the parse, however large the table grows
+    QElapsedTimer writeTimer;
+    writeTimer.start();
+    indexWriter->write(table, &checkpoint);
+    checkpointIntervalMs = qMax<qint64>(CheckpointIntervalMs, writeTimer.elapsed() * 20);
+    checkpointTimer.start();
+    LG_TRACE(lcParser) << "Checkpoint with" << table.size() << "packets took" << writeTimer.elapsed() << "ms";
 }
 
 bool MediaParserThread::openFile()
 {
     QString currentFilePath;
+    int readAheadBytes;
+    QSharedPointer<const MappedFile> mapping;
+    bool follow;
+    int idleTimeoutMs;
     {
         QMutexLocker locker(&mutex);
         currentFilePath = filePath;
+        readAheadBytes = readAheadSize;
+        mapping = mappedFile;
+        follow = followMode;
+        idleTimeoutMs = followIdleTimeoutMs;
     }
     
     if (currentFilePath.isEmpty()) {
         return false;
     }
     
-    // Open input file
+    // Allocate the context up front so the interrupt callback covers opening and probing
+    parseContext = avformat_alloc_context();
+    if (!parseContext) {
+        emit error("Could not allocate format context");
+        return false;
+    }
+    parseContext->interrupt_callback.callback = &MediaParserThread::interruptCallback;
+    parseContext->interrupt_callback.opaque = this;
+    
+    // Streams are read as they arrive, and a followed file through a reader that waits at its
+    // end for the file to grow. A mapped file is read straight from memory; other regular
+    // files are read in large blocks on a read-ahead thread instead of FFmpeg's small reads
+    if (StreamInputReader::isStreamInput(currentFilePath)) {
+        streamReader = new StreamInputReader(currentFilePath, &stopRequested);
+        if (streamReader->open()) {
+            ioContext = streamReader->createIOContext();
+        }
+        if (!ioContext) {
+            closeFile();
+            emit error("Could not open stream input: " + currentFilePath);
+            return false;
+        }
+        parseContext->pb = ioContext;
+        qCDebug(lcParser) << "Reading" << currentFilePath << "as a stream";
+    } else if (follow && QFileInfo(currentFilePath).isFile()) {
+        growingReader = new GrowingFileReader(currentFilePath, &stopRequested);
+        growingReader->setIdleTimeout(idleTimeoutMs);
+        if (growingReader->open()) {
+            ioContext = growingReader->createIOContext();
+        }
+        if (ioContext) {
+            parseContext->pb = ioContext;
+            qCDebug(lcParser) << "Following" << currentFilePath << "as it grows";
+        } else {
+            qCDebug(lcParser) << "Cannot follow the file, reading it as it is now";
+            delete growingReader;
+            growingReader = nullptr;
+        }
+    }
+    if (!ioContext && mapping && mapping->filePath() == currentFilePath) {
+        ioContext = mapping->createIOContext();
+        if (ioContext) {
+            parseContext->pb = ioContext;
+        }
+    }
+    if (!ioContext && readAheadBytes > 0 && QFileInfo(currentFilePath).isFile()) {
+        readAhead = new ReadAheadReader(currentFilePath, readAheadBytes, &stopRequested);
+        if (readAhead->open()) {
+            ioContext = readAhead->createIOContext();
+        }
+        if (ioContext) {
+            parseContext->pb = ioContext;
+        } else {
+            qCDebug(lcParser) << "Read-ahead unavailable, using the FFmpeg file protocol";
+            delete readAhead;
+            readAhead = nullptr;
+        }
+    }
+    
+    // Open input file (frees the context on failure)
+    probing = true;
+    lastProbeReport = 0;
     int ret = avformat_open_input(&parseContext, currentFilePath.toUtf8().constData(), nullptr, nullptr);
     if (ret < 0) {
-        char errbuf[AV_ERROR_MAX_STRING_SIZE];
-        av_strerror(ret, errbuf, AV_ERROR_MAX_STRING_SIZE);
-        emit error(QString("Could not open input file for parsing: %1").arg(errbuf));
+        probing = false;
+        parseContext = nullptr;
+        closeFile();
+        if (!isStopped()) {
+            char errbuf[AV_ERROR_MAX_STRING_SIZE];
+            av_strerror(ret, errbuf, AV_ERROR_MAX_STRING_SIZE);
+            emit error(QString("Could not open input file for parsing: %1").arg(errbuf));
+        }
         return false;
     }
     
     // Read stream information
     ret = avformat_find_stream_info(parseContext, nullptr);
+    probing = false;
     if (ret < 0) {
-        char errbuf[AV_ERROR_MAX_STRING_SIZE];
-        av_strerror(ret, errbuf, AV_ERROR_MAX_STRING_SIZE);
-        emit error(QString("Could not find stream information for parsing: %1").arg(errbuf));
+        if (!isStopped()) {
+            char errbuf[AV_ERROR_MAX_STRING_SIZE];
+            av_strerror(ret, errbuf, AV_ERROR_MAX_STRING_SIZE);
+            emit error(QString("Could not find stream information for parsing: %1").arg(errbuf));
+        }
+        closeFile();
         return false;
     }
     
-    qDebug() << "Parser opened file successfully:" << currentFilePath;
+    qCDebug(lcParser) << "Parser opened file successfully:" << currentFilePath;
+    logFormatContext();
     
+    return true;
+}
+
+void MediaParserThread::logFormatContext() const
+{
     // Log file context information
-    qDebug() << "=== FILE CONTEXT INFO ===";
-    qDebug() << QString("Format: %1").arg(parseContext->iformat->name);
-    qDebug() << QString("Duration: %1 seconds").arg(parseContext->duration / AV_TIME_BASE);
-    qDebug() << QString("Bit rate: %1 bps").arg(parseContext->bit_rate);
-    qDebug() << QString("Number of streams: %1").arg(parseContext->nb_streams);
+    qCDebug(lcParser) << "=== FILE CONTEXT INFO ===";
+    qCDebug(lcParser) << QString("Format: %1").arg(parseContext->iformat->name);
+    qCDebug(lcParser) << QString("Duration: %1 seconds").arg(parseContext->duration / AV_TIME_BASE);
+    qCDebug(lcParser) << QString("Bit rate: %1 bps").arg(parseContext->bit_rate);
+    qCDebug(lcParser) << QString("Number of streams: %1").arg(parseContext->nb_streams);
     
     // Log information about each stream
     for (unsigned int i = 0; i < parseContext->nb_streams; i++) {
         AVStream *stream = parseContext->streams[i];
         AVCodecParameters *codecpar = stream->codecpar;
-        QString streamType = getStreamType(i);
+        StreamType streamType = getStreamType(i);
         
-        qDebug() << QString("Stream %1: Type=%2, Codec=%3, Bitrate=%4")
+        qCDebug(lcParser) << QString("Stream %1: Type=%2, Codec=%3, Bitrate=%4")
                     .arg(i)
-                    .arg(streamType)
+                    .arg(streamTypeName(streamType))
                     .arg(avcodec_get_name(codecpar->codec_id))
                     .arg(codecpar->bit_rate);
         
-        if (streamType == "video") {
-            qDebug() << QString("  Video: %1x%2, FPS: %3")
+        if (streamType == StreamType::Video) {
+            qCDebug(lcParser) << QString("  Video: %1x%2, FPS: %3")
                         .arg(codecpar->width)
                         .arg(codecpar->height)
                         .arg(av_q2d(stream->avg_frame_rate));
-        } else if (streamType == "audio") {
-            qDebug() << QString("  Audio: %1 Hz, %2 channels")
+        } else if (streamType == StreamType::Audio) {
+            qCDebug(lcParser) << QString("  Audio: %1 Hz, %2 channels")
                         .arg(codecpar->sample_rate)
                         .arg(codecpar->ch_layout.nb_channels);
         }
     }
-    qDebug() << "========================";
-    
-    return true;
+    qCDebug(lcParser) << "========================";
 }
 
 void MediaParserThread::closeFile()
@@ -229,6 +1300,24 @@ void MediaParserThread::closeFile()
         avformat_close_input(&parseContext);
         parseContext = nullptr;
     }
+    
+    // FFmpeg does not free custom I/O contexts
+    if (streamReader) {
+        StreamInputReader::freeIOContext(&ioContext);
+    } else if (growingReader) {
+        GrowingFileReader::freeIOContext(&ioContext);
+    } else if (readAhead) {
+        ReadAheadReader::freeIOContext(&ioContext);
+    } else {
+        MappedFile::freeIOContext(&ioContext);
+    }
+    ioContext = nullptr;
+    delete readAhead;
+    readAhead = nullptr;
+    delete growingReader;
+    growingReader = nullptr;
+    delete streamReader;
+    streamReader = nullptr;
 }
 
 SliceInfo MediaParserThread::createSliceInfo(AVPacket *packet, int streamIndex) const
@@ -247,25 +1336,41 @@ SliceInfo MediaParserThread::createSliceInfo(AVPacket *packet, int streamIndex)
     return slice;
 }
 
-QString MediaParserThread::getStreamType(int streamIndex) const
+StreamType MediaParserThread::getStreamType(int streamIndex) const
 {
     if (!parseContext || streamIndex < 0 || streamIndex >= (int)parseContext->nb_streams) {
-        return "unknown";
+        return StreamType::Unknown;
     }
     
     AVCodecParameters *codecpar = parseContext->streams[streamIndex]->codecpar;
     switch (codecpar->codec_type) {
-        case AVMEDIA_TYPE_VIDEO: return "video";
-        case AVMEDIA_TYPE_AUDIO: return "audio";
-        case AVMEDIA_TYPE_SUBTITLE: return "subtitle";
-        case AVMEDIA_TYPE_DATA: return "data";
-        default: return "unknown";
+        case AVMEDIA_TYPE_VIDEO: return StreamType::Video;
+        case AVMEDIA_TYPE_AUDIO: return StreamType::Audio;
+        case AVMEDIA_TYPE_SUBTITLE: return StreamType::Subtitle;
+        case AVMEDIA_TYPE_DATA: return StreamType::Data;
+        default: return StreamType::Unknown;
+    }
+}
+
+NalCodec MediaParserThread::getNalCodec(int streamIndex) const
+{
+    if (!parseContext || streamIndex < 0 || streamIndex >= (int)parseContext->nb_streams) {
+        return NalCodec::Unknown;
+    }
+    
+    switch (parseContext->streams[streamIndex]->codecpar->codec_id) {
+        case AV_CODEC_ID_H264: return NalCodec::H264;
+        case AV_CODEC_ID_HEVC: return NalCodec::Hevc;
+        default: return NalCodec::Unknown;
     }
 }
 
 void MediaParserThread::cleanupResources()
 {
+    finishQuickScan(true);
     closeFile();
+    delete indexWriter;
+    indexWriter = nullptr;
     if (parsePacket) {
         av_packet_free(&parsePacket);
         parsePacket = nullptr;
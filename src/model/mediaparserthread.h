@@ -5,11 +5,28 @@
 #include <QMutex>
 #include <QList>
 #include <QString>
+#include <QSharedPointer>
+#include <QHash>
+#include <QVector>
+#include <QElapsedTimer>
+#include <atomic>
+#include <memory>
+#include "packettable.h"
+#include "mappedfile.h"
+#include "parseschedule.h"
+#include "mediafilemanager.h"
 
 // Forward declarations
 struct AVFormatContext;
 struct AVPacket;
-struct SliceInfo;
+struct AVIOContext;
+struct AVInputFormat;
+class SliceProcessor;
+class ReadAheadReader;
+class GrowingFileReader;
+class StreamInputReader;
+class PacketIndexWriter;
+class QThread;
 
 class MediaParserThread : public QObject
 {
@@ -22,33 +39,165 @@ public:
     // Set the file to parse
     void setFilePath(const QString &filePath);
     
+    // Whether to parse packets after probing, or stop once the streams are known
+    void setParsePackets(bool enabled);
+    
+    // Whether to load and save the persistent packet index (on by default)
+    void setUseIndexCache(bool enabled);
+    
+    // Size of the read-ahead blocks for regular files; 0 reads through FFmpeg's file protocol
+    void setReadAheadSize(int bytes);
+    
+    // Read through a memory mapping of the file instead of read-ahead blocks
+    void setMappedFile(const QSharedPointer<const MappedFile> &mapping);
+    
+    // Keep reading a file that is still being written, parsing appended bytes as they arrive;
+    // the parse ends when stopped or after idleTimeoutMs without growth (0 waits until stopped)
+    void setFollowMode(bool enabled, int idleTimeoutMs = 0);
+    
+    // Sample this many windows of large inputs alongside the full parse, on a second demuxer,
+    // for quick estimates; 0 disables the quick scan
+    void setQuickScanSamples(int samples);
+    
+    // Set the table parsed packets are appended to
+    void setPacketTable(const QSharedPointer<PacketTable> &table);
+    
+    // Publish appended row ranges through the processor's ring instead of packetsParsed;
+    // the processor's processingFinished then follows the last range of the job
+    void setSliceProcessor(SliceProcessor *processor, quint32 generation);
+    
+    // Parse the region at a byte offset, or around a time in seconds, before the rest of the file;
+    // callable from any thread while the job runs
+    void requestPriorityPosition(qint64 position);
+    void requestPriorityTime(double seconds);
+    
     // Control parsing
     void requestStop();
     bool isStopped() const;
 
 public slots:
+    // Open and probe the file, then parse its packets from the same demuxer context
     void startParsing();
 
 signals:
-    void slicesParsed(const QList<SliceInfo> &slices);
+    void probingProgress(qint64 bytesProbed);
+    void streamsProbed(const QList<VideoStreamInfo> &videoStreams, const QList<AudioStreamInfo> &audioStreams, int totalStreams);
+    void packetsParsed(qint64 firstIndex, int count);
     void parsingProgress(int percentage);
+    void parsingMetrics(const ParseMetrics &metrics);
+    void quickScanFinished(const QuickScanResult &result);
     void parsingFinished();
     void error(const QString &message);
+    
+    // Emitted when the job ends for any reason (finished, failed or stopped)
+    void jobFinished();
 
 private:
+    static constexpr qint64 SeamLookahead = 4 << 20;         ///< Bytes read past a region's end to complete its packets
+    static constexpr qint64 PriorityReachBytes = 32 << 20;   ///< Requests this close ahead are reached by reading on
+    static constexpr qint64 CheckpointIntervalMs = 10000;    ///< Shortest time between checkpoints
+    static constexpr qint64 QuickScanMinBytes = qint64(1) << 30;   ///< Smaller inputs parse fully about as fast
+    static constexpr qint64 QuickScanWindowBytes = 1 << 20;       ///< Bytes read at each sample
+    static constexpr qint64 QuickScanMaxWindowBytes = 8 << 20;    ///< Reach of a sample still waiting for a second key frame
+    static constexpr qint64 QuickScanBudgetMs = 1000;             ///< Time after which no further sample is started
+    
+    // What the quick scan needs from the probed input, copied before its thread starts
+    struct QuickScanInput {
+        QString filePath;
+        const AVInputFormat *format = nullptr;
+        QSharedPointer<const MappedFile> mapping;
+        qint64 totalBytes = 0;
+        int samples = 0;
+        double startTime = 0;
+        QHash<int, StreamMapping> streams;   ///< Parse streams by container id, or by index
+        bool keyedById = true;
+    };
+    
     QString filePath;
     mutable QMutex mutex;
-    bool stopRequested;
+    std::atomic<bool> stopRequested;
+    bool parsePackets;
+    bool useIndexCache;
+    int quickScanSamples;
+    bool probing;
+    qint64 lastProbeReport;
+    QSharedPointer<PacketTable> packetTable;
+    SliceProcessor *sliceProcessor;
+    quint32 generation;
     
     // FFmpeg context for parsing
     AVFormatContext *parseContext;
     AVPacket *parsePacket;
     
+    // Progress and throughput of the running parse, measured in input bytes
+    QElapsedTimer metricsTimer;
+    qint64 metricsTotalBytes;
+    qint64 metricsBytesDone;
+    qint64 lastMetricsReport;
+    int lastProgress;
+    qint64 metricsStartBytes;      // Bytes covered by a restored checkpoint, left out of the rates
+    qint64 metricsStartPackets;    // Rows restored from a checkpoint, likewise
+    
+    // Priority requests from the views and the byte ranges already parsed
+    ParseSchedule schedule;
+    
+    // Partial index kept up to date while parsing, so a stopped parse resumes where it ended
+    PacketIndexWriter *indexWriter;
+    bool checkpointsEnabled;
+    QElapsedTimer checkpointTimer;
+    qint64 checkpointIntervalMs;
+    qint64 openRegionStart;        // Region the demuxer is reading, as recorded in checkpoints
+    qint64 openRegionEnd;
+    
+    // Custom I/O feeding the demuxer from a memory mapping or read-ahead blocks
+    int readAheadSize;
+    QSharedPointer<const MappedFile> mappedFile;
+    ReadAheadReader *readAhead;
+    AVIOContext *ioContext;
+    
+    // Follow mode: the demuxer reads through a reader that waits for the file to grow
+    bool followMode;
+    int followIdleTimeoutMs;
+    GrowingFileReader *growingReader;
+    
+    // Standard input, pipes and sockets are read once, without seeking or a known size
+    StreamInputReader *streamReader;
+    
+    // Quick scan running alongside the parse, on its own thread and demuxer context
+    QThread *quickScanThread;
+    std::atomic<bool> quickScanStop;
+    
     // Helper methods
+    void runJob();
+    void publishPackets(qint64 firstIndex, int count);
+    void publishFinished();
+    void beginMetrics(qint64 totalBytes);
+    void reportProgress(qint64 bytesDone, bool force = false);
+    void finishMetrics(bool reachedEnd);
+    bool loadFromIndex(const QSharedPointer<PacketTable> &table);
+    bool canResume() const;
+    bool restoreCheckpoint(const QSharedPointer<PacketTable> &table, qint64 &storedChunks, qint64 &storedNalChunks);
+    void writeCheckpoint(const PacketTable &table, bool force);
+    bool parseSequentially(const QSharedPointer<PacketTable> &table);
+    void startQuickScan();
+    void finishQuickScan(bool cancel);
+    void runQuickScan(const QuickScanInput &input);
+    static int quickScanInterruptCallback(void *opaque);
+    bool canSeekBytes() const;
+    bool canReorderRegions() const;
+    bool seekToByte(qint64 position);
+    QHash<int, StreamMapping> streamsById() const;
+    bool parseSampleTables(const QSharedPointer<PacketTable> &table, bool &complete);
+    bool parseMatroskaBlocks(const QSharedPointer<PacketTable> &table, bool &complete);
+    bool canParseShards() const;
+    bool parseShards(const QSharedPointer<PacketTable> &table);
+    static int interruptCallback(void *opaque);
     bool openFile();
     void closeFile();
+    void logFormatContext() const;
     SliceInfo createSliceInfo(AVPacket *packet, int streamIndex) const;
-    QString getStreamType(int streamIndex) const;
+    StreamType getStreamType(int streamIndex) const;
+    NalCodec getNalCodec(int streamIndex) const;
     void cleanupResources();
 };
 
@@ -0,0 +1,450 @@
+#include "movsampleindexer.h"
+#include "common/logging.h"
+#include <QFile>
+#include <QtEndian>
+#include <QDebug>
+
+namespace {
+
+constexpr quint32 fourcc(const char (&name)[5])
+{
+    return (quint32(uchar(name[0])) << 24) | (quint32(uchar(name[1])) << 16)
+           | (quint32(uchar(name[2])) << 8) | quint32(uchar(name[3]));
+}
+
+constexpr qint64 kMaxMoovBytes = 1LL << 30;   // Sanity bound on the in-memory moov box
+constexpr qint64 kMoovReadBytes = 4 << 20;     // Read size between stop checks
+constexpr int kBatchRows = PacketTable::ChunkSize;
+
+quint32 read32(const uchar *p) { return qFromBigEndian<quint32>(p); }
+quint64 read64(const uchar *p) { return qFromBigEndian<quint64>(p); }
+
+/**
+ * Iterate over the boxes in [data, data + size). Returns false at the end or on a
+ * malformed box header.
+ */
+bool nextBox(const uchar *&data, const uchar *end, quint32 &type, const uchar *&payload, qint64 &payloadSize)
+{
+    if (end - data < 8) {
+        return false;
+    }
+
+    qint64 boxSize = read32(data);
+    type = read32(data + 4);
+    int headerSize = 8;
+    if (boxSize == 1) {
+        if (end - data < 16) {
+            return false;
+        }
+        boxSize = static_cast<qint64>(read64(data + 8));
+        headerSize = 16;
+    } else if (boxSize == 0) {
+        boxSize = end - data;
+    }
+    if (boxSize < headerSize || boxSize > end - data) {
+        return false;
+    }
+
+    payload = data + headerSize;
+    payloadSize = boxSize - headerSize;
+    data += boxSize;
+    return true;
+}
+
+} // namespace
+
+// Sample tables of one track plus the cursor walking them
+struct MovSampleIndexer::Track {
+    int trackId = 0;
+    StreamMapping stream = { -1, StreamType::Unknown };
+
+    // Table pointers into the moov payload, entries in big-endian order
+    const uchar *stts = nullptr;  quint32 sttsCount = 0;
+    const uchar *ctts = nullptr;  quint32 cttsCount = 0;
+    const uchar *stss = nullptr;  quint32 stssCount = 0;
+    const uchar *stsc = nullptr;  quint32 stscCount = 0;
+    const uchar *chunkOffsets = nullptr;  quint32 chunkCount = 0;  bool offsets64 = false;
+    const uchar *sizes = nullptr;  int sizeBits = 32;  quint32 uniformSize = 0;
+    quint32 sampleCount = 0;
+
+    // Cursor
+    quint32 sample = 0;
+    qint64 chunk = -1;
+    quint32 samplesLeftInChunk = 0;
+    quint32 stscIndex = 0;
+    qint64 offset = 0;
+    quint32 sttsIndex = 0;  quint32 sttsLeft = 0;  qint64 dts = 0;  qint32 delta = 0;
+    quint32 cttsIndex = 0;  quint32 cttsLeft = 0;
+    quint32 stssIndex = 0;
+
+    // Next sample, filled by advance()
+    bool pending = false;
+    qint64 pendingPts = 0;
+    qint64 pendingDts = 0;
+    qint64 pendingPos = 0;
+    qint32 pendingDuration = 0;
+    qint32 pendingSize = 0;
+    bool pendingKey = false;
+
+    quint32 sampleSize(quint32 index) const
+    {
+        if (!sizes) {
+            return uniformSize;
+        }
+        switch (sizeBits) {
+            case 4: return (index & 1) ? (sizes[index / 2] & 0x0F) : (sizes[index / 2] >> 4);
+            case 8: return sizes[index];
+            case 16: return qFromBigEndian<quint16>(sizes + index * 2);
+            default: return read32(sizes + index * 4);
+        }
+    }
+
+    qint64 chunkOffset(qint64 index) const
+    {
+        return offsets64 ? static_cast<qint64>(read64(chunkOffsets + index * 8))
+                         : static_cast<qint64>(read32(chunkOffsets + index * 4));
+    }
+
+    void advance()
+    {
+        pending = false;
+        if (sample >= sampleCount) {
+            return;
+        }
+
+        // Move to the chunk holding the sample
+        while (samplesLeftInChunk == 0) {
+            if (++chunk >= chunkCount) {
+                return;
+            }
+            while (stscIndex + 1 < stscCount && chunk + 1 >= read32(stsc + (stscIndex + 1) * 12)) {
+                ++stscIndex;
+            }
+            samplesLeftInChunk = read32(stsc + stscIndex * 12 + 4);
+            offset = chunkOffset(chunk);
+        }
+
+        // Decode time and duration
+        while (sttsLeft == 0 && sttsIndex < sttsCount) {
+            sttsLeft = read32(stts + sttsIndex * 8);
+            delta = static_cast<qint32>(read32(stts + sttsIndex * 8 + 4));
+            ++sttsIndex;
+        }
+
+        // Composition offset
+        qint32 compositionOffset = 0;
+        if (ctts) {
+            while (cttsLeft == 0 && cttsIndex < cttsCount) {
+                cttsLeft = read32(ctts + cttsIndex * 8);
+                ++cttsIndex;
+            }
+            if (cttsLeft > 0) {
+                compositionOffset = static_cast<qint32>(read32(ctts + (cttsIndex - 1) * 8 + 4));
+                --cttsLeft;
+            }
+        }
+
+        // Sync samples are numbered from 1; without stss every sample is a sync sample
+        bool key = true;
+        if (stss) {
+            while (stssIndex < stssCount && read32(stss + stssIndex * 4) < sample + 1) {
+                ++stssIndex;
+            }
+            key = stssIndex < stssCount && read32(stss + stssIndex * 4) == sample + 1;
+        }
+
+        const quint32 size = sampleSize(sample);
+        pending = true;
+        pendingPos = offset;
+        pendingSize = static_cast<qint32>(size);
+        pendingDts = dts;
+        pendingPts = dts + compositionOffset;
+        pendingDuration = delta;
+        pendingKey = key;
+
+        offset += size;
+        --samplesLeftInChunk;
+        if (sttsLeft > 0) {
+            --sttsLeft;
+        }
+        dts += delta;
+        ++sample;
+    }
+};
+
+MovSampleIndexer::MovSampleIndexer(const QString &filePath, const QHash<int, StreamMapping> &trackStreams,
+                                   const std::atomic<bool> *stopFlag)
+    : filePath(filePath)
+    , trackStreams(trackStreams)
+    , stopFlag(stopFlag)
+    , totalSamples(0)
+{
+}
+
+MovSampleIndexer::~MovSampleIndexer()
+{
+}
+
+bool MovSampleIndexer::readMoov()
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // Walk the top-level boxes, seeking over mdat, until moov is found
+    const qint64 fileSize = file.size();
+    qint64 pos = 0;
+    while (pos + 8 <= fileSize) {
+        uchar header[16];
+        if (!file.seek(pos) || file.read(reinterpret_cast<char*>(header), 16) < 8) {
+            return false;
+        }
+
+        qint64 boxSize = read32(header);
+        const quint32 type = read32(header + 4);
+        int headerSize = 8;
+        if (boxSize == 1) {
+            boxSize = static_cast<qint64>(read64(header + 8));
+            headerSize = 16;
+        } else if (boxSize == 0) {
+            boxSize = fileSize - pos;
+        }
+        if (boxSize < headerSize || pos + boxSize > fileSize) {
+            return false;
+        }
+
+        if (type == fourcc("moov")) {
+            const qint64 moovSize = boxSize - headerSize;
+            if (moovSize > kMaxMoovBytes || !file.seek(pos + headerSize)) {
+                return false;
+            }
+
+            // A large moov box is read in pieces, so a stop request ends the read promptly
+            moov.resize(static_cast<int>(moovSize));
+            for (qint64 done = 0; done < moovSize; ) {
+                if (isStopped()) {
+                    moov.clear();
+                    return false;
+                }
+                const qint64 read = file.read(moov.data() + done, qMin(kMoovReadBytes, moovSize - done));
+                if (read <= 0) {
+                    moov.clear();
+                    return false;
+                }
+                done += read;
+            }
+            return true;
+        }
+        pos += boxSize;
+    }
+    return false;
+}
+
+bool MovSampleIndexer::load()
+{
+    if (!readMoov()) {
+        qCDebug(lcIndex) << "No readable moov box in" << filePath;
+        return false;
+    }
+
+    const uchar *data = reinterpret_cast<const uchar*>(moov.constData());
+    const uchar *end = data + moov.size();
+    quint32 type;
+    const uchar *payload;
+    qint64 payloadSize;
+    while (nextBox(data, end, type, payload, payloadSize)) {
+        if (type == fourcc("mvex")) {
+            qCDebug(lcIndex) << "Fragmented MP4, sample tables are incomplete";
+            return false;
+        }
+        if (type == fourcc("cmov")) {
+            qCDebug(lcIndex) << "Compressed moov box is not supported";
+            return false;
+        }
+        if (type == fourcc("trak") && !parseTrack(payload, payloadSize)) {
+            return false;
+        }
+    }
+
+    totalSamples = 0;
+    for (Track &track : tracks) {
+        totalSamples += track.sampleCount;
+        track.advance();
+    }
+    qCDebug(lcIndex) << "Read sample tables of" << tracks.size() << "tracks with" << totalSamples << "samples";
+    return !tracks.empty();
+}
+
+bool MovSampleIndexer::parseTrack(const uchar *data, qint64 size)
+{
+    Track track;
+    bool hasSizes = false;
+
+    // Descend through trak/mdia/minf/stbl, collecting the tables
+    std::vector<std::pair<const uchar*, const uchar*>> containers = { { data, data + size } };
+    while (!containers.empty()) {
+        const uchar *p = containers.back().first;
+        const uchar *end = containers.back().second;
+        containers.pop_back();
+
+        quint32 type;
+        const uchar *payload;
+        qint64 length;
+        while (nextBox(p, end, type, payload, length)) {
+            if (type == fourcc("mdia") || type == fourcc("minf") || type == fourcc("stbl")) {
+                containers.push_back({ payload, payload + length });
+                continue;
+            }
+
+            // Everything below is a full box: version and flags, then an entry count
+            if (length < 8) {
+                continue;
+            }
+            const quint32 count = read32(payload + 4);
+            const qint64 available = length - 8;
+            if (type == fourcc("tkhd")) {
+                const int version = payload[0];
+                const qint64 idOffset = version == 1 ? 20 : 12;
+                if (length >= idOffset + 4) {
+                    track.trackId = static_cast<int>(read32(payload + idOffset));
+                }
+            } else if (type == fourcc("stts") && available >= qint64(count) * 8) {
+                track.stts = payload + 8;
+                track.sttsCount = count;
+            } else if (type == fourcc("ctts") && available >= qint64(count) * 8) {
+                track.ctts = payload + 8;
+                track.cttsCount = count;
+            } else if (type == fourcc("stss") && available >= qint64(count) * 4) {
+                track.stss = payload + 8;
+                track.stssCount = count;
+            } else if (type == fourcc("stsc") && available >= qint64(count) * 12) {
+                track.stsc = payload + 8;
+                track.stscCount = count;
+            } else if (type == fourcc("stco") && available >= qint64(count) * 4) {
+                track.chunkOffsets = payload + 8;
+                track.chunkCount = count;
+                track.offsets64 = false;
+            } else if (type == fourcc("co64") && available >= qint64(count) * 8) {
+                track.chunkOffsets = payload + 8;
+                track.chunkCount = count;
+                track.offsets64 = true;
+            } else if (type == fourcc("stsz") && length >= 12) {
+                track.uniformSize = read32(payload + 4);
+                track.sampleCount = read32(payload + 8);
+                track.sizes = nullptr;
+                track.sizeBits = 32;
+                if (track.uniformSize == 0) {
+                    if (length - 12 < qint64(track.sampleCount) * 4) {
+                        return false;
+                    }
+                    track.sizes = payload + 12;
+                }
+                hasSizes = true;
+            } else if (type == fourcc("stz2") && length >= 12) {
+                track.sizeBits = payload[7];
+                track.sampleCount = read32(payload + 8);
+                if ((track.sizeBits != 4 && track.sizeBits != 8 && track.sizeBits != 16)
+                    || length - 12 < (qint64(track.sampleCount) * track.sizeBits + 7) / 8) {
+                    return false;
+                }
+                track.sizes = payload + 12;
+                hasSizes = true;
+            }
+        }
+    }
+
+    // Tracks FFmpeg does not expose as streams (hint tracks, chapters) are skipped
+    auto mapping = trackStreams.constFind(track.trackId);
+    if (mapping == trackStreams.constEnd()) {
+        qCDebug(lcIndex) << "Skipping track" << track.trackId << "without a stream";
+        return true;
+    }
+    if (!hasSizes || !track.chunkOffsets || !track.stsc || track.stscCount == 0 || !track.stts) {
+        if (track.sampleCount == 0) {
+            return true;
+        }
+        qCDebug(lcIndex) << "Track" << track.trackId << "has incomplete sample tables";
+        return false;
+    }
+
+    // The chunks must hold every sample, or the walk would stop short of the table's end
+    qint64 chunkSamples = 0;
+    for (quint32 i = 0; i < track.stscCount && chunkSamples < track.sampleCount; ++i) {
+        const qint64 firstChunk = read32(track.stsc + i * 12);
+        const qint64 nextChunk = i + 1 < track.stscCount ? read32(track.stsc + (i + 1) * 12)
+                                                         : qint64(track.chunkCount) + 1;
+        if (firstChunk < 1 || firstChunk > track.chunkCount || nextChunk < firstChunk) {
+            break;
+        }
+        chunkSamples += (qMin<qint64>(nextChunk, qint64(track.chunkCount) + 1) - firstChunk)
+                        * read32(track.stsc + i * 12 + 4);
+    }
+    if (chunkSamples < track.sampleCount) {
+        qCDebug(lcIndex) << "Track" << track.trackId << "chunks hold" << chunkSamples << "of" << track.sampleCount << "samples";
+        return false;
+    }
+
+    track.stream = *mapping;
+    tracks.push_back(track);
+    return true;
+}
+
+bool MovSampleIndexer::appendTo(PacketTable &table, const BatchCallback &onBatch)
+{
+    const quint8 keyFlag = PacketTable::KeyFrameFlag;
+    qint64 batchStart = table.size();
+    qint64 appended = 0;
+
+    // Samples of H.264 and HEVC tracks are read and split into NAL units as they are appended
+    for (const Track &track : tracks) {
+        nalPayloads.addStream(track.stream.streamIndex, track.stream.nalCodec, track.stream.codecConfig);
+    }
+    nalPayloads.openFile(filePath);
+
+    while (true) {
+        // Take the pending sample with the lowest file position
+        Track *next = nullptr;
+        for (Track &track : tracks) {
+            if (track.pending && (!next || track.pendingPos < next->pendingPos)) {
+                next = &track;
+            }
+        }
+        if (!next) {
+            break;
+        }
+
+        const quint8 flags = static_cast<quint8>(((static_cast<quint8>(next->stream.streamType) << PacketTable::StreamTypeShift)
+                                                   & PacketTable::StreamTypeMask)
+                                                  | (next->pendingKey ? keyFlag : 0));
+        const qint64 row = table.appendRow(next->pendingPts, next->pendingDts, next->pendingPos, next->pendingDuration,
+                                           next->pendingSize, static_cast<quint16>(next->stream.streamIndex), flags);
+        if (row < 0) {
+            qCDebug(lcIndex) << "Packet table is full";
+            return false;
+        }
+        nalPayloads.indexSample(table.nalUnits(), row, next->stream.streamIndex, next->pendingPos, next->pendingSize);
+        next->advance();
+
+        if (++appended % kBatchRows == 0) {
+            if (onBatch) {
+                onBatch(batchStart, static_cast<int>(table.size() - batchStart));
+            }
+            batchStart = table.size();
+            if (isStopped()) {
+                return false;
+            }
+        }
+    }
+
+    if (onBatch && table.size() > batchStart) {
+        onBatch(batchStart, static_cast<int>(table.size() - batchStart));
+    }
+
+    // A short walk leaves the table partial; it must not be taken for a complete index
+    if (appended != totalSamples) {
+        qCDebug(lcIndex) << "Sample tables ended early:" << appended << "of" << totalSamples << "samples";
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
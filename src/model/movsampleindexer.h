@@ -0,0 +1,81 @@
+#ifndef MOVSAMPLEINDEXER_H
+#define MOVSAMPLEINDEXER_H
+
+#include <QString>
+#include <QHash>
+#include <QByteArray>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "packettable.h"
+#include "nalpayloadindexer.h"
+
+/**
+ * @brief The MovSampleIndexer class builds the packet table of an MP4/MOV file from its sample tables
+ *
+ * ISO-BMFF files list every sample in the moov/trak/stbl boxes: sizes in stsz/stz2,
+ * chunk offsets in stco/co64, the sample to chunk map in stsc, decode times in stts,
+ * composition offsets in ctts and sync samples in stss. The indexer reads the moov box,
+ * seeking over mdat, and walks those tables; the only payloads read are the samples of
+ * H.264 and HEVC tracks, which are split into NAL units. Samples
+ * of all tracks are merged by file position. Timestamps are the raw sample table
+ * values in the track timescale; edit lists are not applied. Fragmented files keep
+ * their samples in moof boxes and are left to the demuxer.
+ */
+class MovSampleIndexer
+{
+public:
+    /**
+     * @brief Callback run after each batch of appended rows
+     * @param firstIndex The first packet table row of the batch
+     * @param count The number of rows in the batch
+     */
+    using BatchCallback = std::function<void(qint64 firstIndex, int count)>;
+
+    /**
+     * @brief Create an indexer for a file
+     * @param filePath The file to index
+     * @param trackStreams The stream each track ID maps to
+     * @param stopFlag Polled while reading the moov box and appending; indexing ends early when it becomes true
+     */
+    MovSampleIndexer(const QString &filePath, const QHash<int, StreamMapping> &trackStreams,
+                     const std::atomic<bool> *stopFlag);
+    ~MovSampleIndexer();
+
+    /**
+     * @brief Read the moov box and its sample tables
+     * @return bool False if the file has no usable sample tables (fragmented, compressed or damaged)
+     */
+    bool load();
+
+    /**
+     * @brief Get the number of samples found by load()
+     */
+    qint64 sampleCount() const { return totalSamples; }
+
+    /**
+     * @brief Append all samples to the table in file order
+     * @param table The table to append to (the caller must be its only writer)
+     * @param onBatch Called after each batch of rows
+     * @return bool True if every sample was appended
+     */
+    bool appendTo(PacketTable &table, const BatchCallback &onBatch);
+
+private:
+    struct Track;
+
+    QString filePath;
+    QHash<int, StreamMapping> trackStreams;
+    const std::atomic<bool> *stopFlag;
+
+    QByteArray moov;               ///< The moov payload; the tracks point into it
+    std::vector<Track> tracks;
+    qint64 totalSamples;
+    NalPayloadIndexer nalPayloads;
+
+    bool isStopped() const { return stopFlag && stopFlag->load(std::memory_order_relaxed); }
+    bool readMoov();
+    bool parseTrack(const uchar *data, qint64 size);
+};
+
+#endif // MOVSAMPLEINDEXER_H
\ No newline at end of file
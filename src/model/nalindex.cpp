@@ -0,0 +1,100 @@
+#include "nalindex.h"
+
+NalIndex::NalIndex()
+    : chunks(new std::atomic<Chunk*>[MaxChunks])
+    , count(0)
+    , adoptedChunks(0)
+{
+    for (int i = 0; i < MaxChunks; ++i) {
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+NalIndex::~NalIndex()
+{
+    const qint64 used = (count.load(std::memory_order_relaxed) + ChunkSize - 1) >> ChunkShift;
+    for (qint64 i = adoptedChunks; i < used; ++i) {
+        delete chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+qint64 NalIndex::append(qint64 packetRow, NalCodec codec, const NalUnit &unit, const NalSliceHeader *header)
+{
+    const qint64 index = count.load(std::memory_order_relaxed);
+    const qint64 chunkIndex = index >> ChunkShift;
+    if (chunkIndex >= MaxChunks) {
+        return -1;
+    }
+
+    Chunk *chunk = chunks[chunkIndex].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new Chunk;
+        chunks[chunkIndex].store(chunk, std::memory_order_release);
+    }
+
+    const int offset = offsetOf(index);
+    chunk->packetRow[offset] = packetRow;
+    chunk->offset[offset] = unit.offset;
+    chunk->size[offset] = unit.size;
+    chunk->emulationBytes[offset] = unit.emulationBytes;
+    chunk->type[offset] = unit.type;
+    chunk->codec[offset] = static_cast<quint8>(codec);
+    chunk->sliceHeader[offset] = header ? *header : NalSliceHeader();
+
+    // Publish the row to readers
+    count.store(index + 1, std::memory_order_release);
+    return index;
+}
+
+bool NalIndex::adoptChunks(const QVector<const Chunk*> &chunkData, std::shared_ptr<void> storage)
+{
+    const int chunkCount = chunkData.size();
+    if (count.load(std::memory_order_relaxed) != 0 || chunkCount > MaxChunks) {
+        return false;
+    }
+
+    // Appends start in the chunk after the adopted ones, which are full
+    for (int i = 0; i < chunkCount; ++i) {
+        chunks[i].store(const_cast<Chunk*>(chunkData[i]), std::memory_order_relaxed);
+    }
+    adoptedChunks = chunkCount;
+    externalStorage = std::move(storage);
+    count.store(static_cast<qint64>(chunkCount) << ChunkShift, std::memory_order_release);
+    return true;
+}
+
+int NalIndex::unitsOf(qint64 row, qint64 &first) const
+{
+    // Lower bound of the packet row, then the run of units that share it
+    const qint64 end = size();
+    qint64 low = 0;
+    qint64 high = end;
+    while (low < high) {
+        const qint64 middle = low + (high - low) / 2;
+        if (packetRow(middle) < row) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    first = low;
+
+    qint64 last = low;
+    while (last < end && packetRow(last) == row) {
+        ++last;
+    }
+    return static_cast<int>(last - low);
+}
+
+NalUnit NalIndex::at(qint64 index) const
+{
+    const Chunk *chunk = chunkFor(index);
+    const int offset = offsetOf(index);
+    return { chunk->offset[offset], chunk->size[offset], chunk->type[offset], chunk->emulationBytes[offset] };
+}
+
+qint64 NalIndex::memoryUsage() const
+{
+    const qint64 owned = ((size() + ChunkSize - 1) >> ChunkShift) - adoptedChunks;
+    return owned * static_cast<qint64>(sizeof(Chunk)) + MaxChunks * static_cast<qint64>(sizeof(std::atomic<Chunk*>));
+}
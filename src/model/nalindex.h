@@ -0,0 +1,144 @@
+#ifndef NALINDEX_H
+#define NALINDEX_H
+
+#include "nalscanner.h"
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+/**
+ * @brief Fields of a parsed slice header, kept with its NAL unit
+ */
+struct NalSliceHeader {
+    qint32 firstMb = 0;         ///< first_mb_in_slice, or slice_segment_address in CTBs for HEVC
+    qint32 frameNum = 0;        ///< frame_num, 0 for HEVC
+    qint32 poc = 0;             ///< Picture order count of the slice's picture
+    qint8 sliceType = -1;       ///< H.264 slice_type modulo 5 (0 P, 1 B, 2 I, 3 SP, 4 SI), or -1 if not parsed
+    qint8 qpDelta = 0;          ///< slice_qp_delta
+    qint8 qp = 0;               ///< Luma QP of the slice, below 0 for high bit depths
+    quint8 refIdxL0 = 0;        ///< Active references in list 0, 0 for intra slices
+    quint8 refIdxL1 = 0;        ///< Active references in list 1, 0 unless a B slice
+    quint8 ppsId = 0;           ///< Picture parameter set the slice refers to
+    quint8 fieldPic = 0;        ///< 0 for frames, 1 for top fields, 2 for bottom fields
+
+    // HEVC only
+    quint16 entryPoints = 0;    ///< num_entry_point_offsets
+    quint8 tileColumns = 1;
+    quint8 tileRows = 1;
+    quint8 wavefront = 0;       ///< 1 if entropy_coding_sync_enabled_flag is set
+    quint8 dependent = 0;       ///< 1 for dependent slice segments
+    quint8 rpsNegative = 0;     ///< Short-term reference pictures before the current one
+    quint8 rpsPositive = 0;     ///< Short-term reference pictures after the current one
+    quint8 rpsUsed = 0;         ///< Short-term reference pictures the current one may refer to
+    quint8 longTermRefs = 0;    ///< Long-term reference pictures in the slice header
+
+    bool isValid() const { return sliceType >= 0; }
+};
+
+/**
+ * @brief The NalIndex class stores the NAL units of the video packets in a packet table
+ *
+ * Each row is one unit, linked to its packet by the packet's table row; the units of a
+ * packet are consecutive and packets appear in table row order, so the units of any
+ * packet are found by binary search. Storage follows PacketTable: fixed-size columnar
+ * chunks that never move, appended by a single writer while readers access rows below
+ * size(). Slice units also keep their parsed header, in a column read only for display.
+ * A row costs 52 bytes.
+ */
+class NalIndex
+{
+public:
+    static constexpr int ChunkShift = 16;
+    static constexpr int ChunkSize = 1 << ChunkShift;   ///< Units per chunk
+    static constexpr int MaxChunks = 1 << 16;           ///< Up to 4G units per index
+
+    /**
+     * @brief One chunk of rows, one array per column
+     */
+    struct Chunk {
+        qint64 packetRow[ChunkSize];
+        qint32 offset[ChunkSize];
+        qint32 size[ChunkSize];
+        quint16 emulationBytes[ChunkSize];
+        quint8 type[ChunkSize];
+        quint8 codec[ChunkSize];
+        NalSliceHeader sliceHeader[ChunkSize];
+    };
+
+    NalIndex();
+    ~NalIndex();
+
+    NalIndex(const NalIndex &) = delete;
+    NalIndex &operator=(const NalIndex &) = delete;
+
+    /**
+     * @brief Append one unit (writer thread only)
+     * @param packetRow Row of the packet in its table; must not be below the last appended row
+     * @param header The unit's parsed slice header, or nullptr if it is not a parsed slice
+     * @return qint64 The row index of the unit, or -1 if the index is full
+     */
+    qint64 append(qint64 packetRow, NalCodec codec, const NalUnit &unit, const NalSliceHeader *header = nullptr);
+
+    /**
+     * @brief Adopt read-only chunks that live in external storage, such as a memory-mapped index
+     *
+     * Only valid on an empty index, before any reader sees it; see PacketTable::adoptChunks().
+     * @param chunkData The full chunks, in row order
+     * @param storage Owner of the chunk memory
+     * @return bool True if the chunks were adopted
+     */
+    bool adoptChunks(const QVector<const Chunk*> &chunkData, std::shared_ptr<void> storage);
+
+    /**
+     * @brief Get a chunk for bulk column access; rows past size() are undefined
+     */
+    const Chunk *chunk(int chunkIndex) const { return chunks[chunkIndex].load(std::memory_order_acquire); }
+
+    /**
+     * @brief Get the number of rows visible to readers
+     */
+    qint64 size() const { return count.load(std::memory_order_acquire); }
+    bool isEmpty() const { return size() == 0; }
+
+    /**
+     * @brief Find the units of a packet
+     * @param row Row of the packet in its table
+     * @param first Receives the row of its first unit
+     * @return int The number of units, 0 if the packet was not split
+     */
+    int unitsOf(qint64 row, qint64 &first) const;
+
+    /**
+     * @brief Get a row as a NalUnit value
+     * @param index The row index, must be below size()
+     */
+    NalUnit at(qint64 index) const;
+
+    // Column accessors, index must be below size()
+    qint64 packetRow(qint64 index) const { return chunkFor(index)->packetRow[offsetOf(index)]; }
+    qint32 offset(qint64 index) const { return chunkFor(index)->offset[offsetOf(index)]; }
+    qint32 unitSize(qint64 index) const { return chunkFor(index)->size[offsetOf(index)]; }
+    quint16 emulationBytes(qint64 index) const { return chunkFor(index)->emulationBytes[offsetOf(index)]; }
+    quint8 type(qint64 index) const { return chunkFor(index)->type[offsetOf(index)]; }
+    NalCodec codec(qint64 index) const { return static_cast<NalCodec>(chunkFor(index)->codec[offsetOf(index)]); }
+    const NalSliceHeader &sliceHeader(qint64 index) const { return chunkFor(index)->sliceHeader[offsetOf(index)]; }
+
+    /**
+     * @brief Get the approximate memory used by the index in bytes
+     */
+    qint64 memoryUsage() const;
+
+private:
+    std::unique_ptr<std::atomic<Chunk*>[]> chunks;  ///< Chunk directory, filled on demand
+    std::atomic<qint64> count;                      ///< Rows published to readers
+    int adoptedChunks;                              ///< Leading chunks owned by externalStorage
+    std::shared_ptr<void> externalStorage;          ///< Keeps adopted chunks alive
+
+    const Chunk *chunkFor(qint64 index) const
+    {
+        return chunks[index >> ChunkShift].load(std::memory_order_acquire);
+    }
+    static int offsetOf(qint64 index) { return static_cast<int>(index & (ChunkSize - 1)); }
+};
+
+#endif // NALINDEX_H
@@ -0,0 +1,93 @@
+#include "nalpayloadindexer.h"
+#include "nalsyntaxparser.h"
+#include "common/logging.h"
+
+NalPayloadIndexer::NalPayloadIndexer()
+{
+}
+
+NalPayloadIndexer::~NalPayloadIndexer()
+{
+}
+
+void NalPayloadIndexer::addStream(int streamIndex, NalCodec codec, const QByteArray &codecConfig)
+{
+    if (streamIndex < 0 || codec == NalCodec::Unknown) {
+        return;
+    }
+    if (streamIndex >= streams.size()) {
+        streams.resize(streamIndex + 1);
+    }
+
+    const uchar *config = reinterpret_cast<const uchar *>(codecConfig.constData());
+    Stream &stream = streams[streamIndex];
+    stream.codec = codec;
+    stream.lengthSize = lengthSizeOf(codec, config, codecConfig.size());
+
+    // Parameter sets carried in the extradata apply from the first packet on
+    stream.syntax = NalSyntaxParser::create(codec);
+    if (stream.syntax && !codecConfig.isEmpty()) {
+        stream.syntax->parseConfig(config, codecConfig.size());
+    }
+}
+
+int NalPayloadIndexer::lengthSizeOf(NalCodec codec, const uchar *config, int size)
+{
+    // avcC and hvcC configuration records mean samples carry length fields, not start codes
+    if (codec == NalCodec::H264 && size >= 7 && config[0] == 1) {
+        return (config[4] & 0x03) + 1;
+    }
+    if (codec == NalCodec::Hevc && size >= 23 && (config[0] || config[1] || config[2] > 1)) {
+        return (config[21] & 0x03) + 1;
+    }
+    return 0;
+}
+
+void NalPayloadIndexer::indexPayload(NalIndex &index, qint64 row, int streamIndex, const uchar *data, int size)
+{
+    if (!hasStream(streamIndex) || !data) {
+        return;
+    }
+    const Stream &stream = streams[streamIndex];
+
+    units.clear();
+    scanner.setCodec(stream.codec);
+    if (stream.lengthSize > 0) {
+        scanner.scanLengthPrefixed(data, size, stream.lengthSize, units);
+    } else {
+        scanner.begin();
+        scanner.feed(data, size, units);
+        scanner.finish(units);
+    }
+
+    NalSliceHeader header;
+    for (const NalUnit &unit : units) {
+        const bool parsed = stream.syntax && stream.syntax->parseUnit(data + unit.offset, unit.size, header);
+        if (index.append(row, stream.codec, unit, parsed ? &header : nullptr) < 0) {
+            break;
+        }
+    }
+}
+
+bool NalPayloadIndexer::openFile(const QString &filePath)
+{
+    file.close();
+    file.setFileName(filePath);
+    return file.open(QIODevice::ReadOnly);
+}
+
+bool NalPayloadIndexer::indexSample(NalIndex &index, qint64 row, int streamIndex, qint64 position, qint32 size)
+{
+    if (!hasStream(streamIndex)) {
+        return true;
+    }
+
+    // Samples are read in file order, so the reads stay sequential
+    payload.resize(qMax(size, 0));
+    if (!file.isOpen() || !file.seek(position) || file.read(payload.data(), payload.size()) != payload.size()) {
+        qCDebug(lcIndex) << "Could not read the sample at" << position << "to split it into NAL units";
+        return false;
+    }
+    indexPayload(index, row, streamIndex, reinterpret_cast<const uchar *>(payload.constData()), payload.size());
+    return true;
+}
@@ -0,0 +1,88 @@
+#ifndef NALPAYLOADINDEXER_H
+#define NALPAYLOADINDEXER_H
+
+#include <QString>
+#include <QFile>
+#include <QByteArray>
+#include <QVector>
+#include <memory>
+#include "nalindex.h"
+
+class NalSyntaxParser;
+
+/**
+ * @brief The NalPayloadIndexer class splits the packets of H.264 and HEVC streams into NAL units
+ *
+ * Each stream is set up from its codec extradata: an avcC or hvcC configuration record
+ * means its packets are MP4 style samples with unit length fields, and its parameter
+ * sets are read up front; anything else is taken as Annex B data split at start codes.
+ * The units of each packet are appended to a NalIndex with their parsed slice headers.
+ * Payloads come from the caller, such as a demuxed packet, or are read from the file by
+ * position, for indexers that walk container headers and seek over the payloads.
+ */
+class NalPayloadIndexer
+{
+public:
+    NalPayloadIndexer();
+    ~NalPayloadIndexer();
+
+    NalPayloadIndexer(const NalPayloadIndexer &) = delete;
+    NalPayloadIndexer &operator=(const NalPayloadIndexer &) = delete;
+
+    /**
+     * @brief Split the packets of a stream
+     * @param streamIndex The stream's index, as stored in the packet table
+     * @param codec The stream's codec; streams of other codecs are ignored
+     * @param codecConfig The stream's extradata, if any
+     */
+    void addStream(int streamIndex, NalCodec codec, const QByteArray &codecConfig);
+
+    /**
+     * @brief Check whether the packets of a stream are split
+     */
+    bool hasStream(int streamIndex) const
+    {
+        return streamIndex >= 0 && streamIndex < streams.size() && streams[streamIndex].codec != NalCodec::Unknown;
+    }
+
+    /**
+     * @brief Get the size of the unit length fields of a configuration record
+     * @return int 1 to 4 for avcC and hvcC records, 0 for Annex B extradata or none
+     */
+    static int lengthSizeOf(NalCodec codec, const uchar *config, int size);
+
+    /**
+     * @brief Split one packet payload and append its units
+     * @param index The index to append to (the caller must be its only writer)
+     * @param row The packet's table row
+     */
+    void indexPayload(NalIndex &index, qint64 row, int streamIndex, const uchar *data, int size);
+
+    /**
+     * @brief Set the file payloads are read from by indexSample()
+     * @return bool False if the file cannot be opened
+     */
+    bool openFile(const QString &filePath);
+
+    /**
+     * @brief Read one packet payload from the file, then split it and append its units
+     * @param position File position of the payload
+     * @return bool False if the payload cannot be read
+     */
+    bool indexSample(NalIndex &index, qint64 row, int streamIndex, qint64 position, qint32 size);
+
+private:
+    struct Stream {
+        NalCodec codec = NalCodec::Unknown;
+        int lengthSize = 0;        ///< Size of the unit length fields, 0 for start codes
+        std::shared_ptr<NalSyntaxParser> syntax;
+    };
+
+    QVector<Stream> streams;       ///< By stream index
+    NalScanner scanner;
+    QVector<NalUnit> units;
+    QFile file;
+    QByteArray payload;
+};
+
+#endif // NALPAYLOADINDEXER_H
@@ -0,0 +1,318 @@
+#include "nalscanner.h"
+#include <QtAlgorithms>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#include <immintrin.h>
+#define NALSCANNER_HAVE_AVX2
+#endif
+#endif
+
+namespace {
+
+using FindFunction = int (*)(const uchar *, int, int);
+
+// A triple starting at i can only match when data[i + 2] <= 3, data[i + 1] == 0 and
+// data[i] == 0; testing the last byte first lets most positions skip three bytes
+int findCandidateScalar(const uchar *data, int size, int from)
+{
+    int i = from;
+    while (i + 2 < size) {
+        if (data[i + 2] > 3) {
+            i += 3;
+        } else if (data[i + 1]) {
+            i += 2;
+        } else if (data[i]) {
+            i += 1;
+        } else {
+            return i;
+        }
+    }
+    return size;
+}
+
+#if defined(__SSE2__)
+// Bit k of the mask is set when the triple at i + k matches: bytes i + k and i + k + 1
+// are zero and byte i + k + 2 has no bits above the lowest two
+int findCandidateSse2(const uchar *data, int size, int from)
+{
+    const __m128i high = _mm_set1_epi8(static_cast<char>(0xFC));
+    const __m128i zero = _mm_setzero_si128();
+    int i = from;
+    while (i + 18 <= size) {
+        const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 1));
+        const __m128i third = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 2));
+        const __m128i any = _mm_or_si128(_mm_or_si128(first, second), _mm_and_si128(third, high));
+        const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(any, zero));
+        if (mask) {
+            return i + qCountTrailingZeroBits(static_cast<quint32>(mask));
+        }
+        i += 16;
+    }
+    return findCandidateScalar(data, size, i);
+}
+#endif
+
+#if defined(NALSCANNER_HAVE_AVX2)
+// Short pieces such as transport packet payloads scan faster in 16-byte steps
+constexpr int Avx2MinBytes = 256;
+
+__attribute__((target("avx2")))
+int findCandidateAvx2(const uchar *data, int size, int from)
+{
+    const __m256i high = _mm256_set1_epi8(static_cast<char>(0xFC));
+    const __m256i zero = _mm256_setzero_si256();
+    int i = from;
+    while (i + 34 <= size && size - i >= Avx2MinBytes) {
+        const __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        const __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 1));
+        const __m256i third = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 2));
+        const __m256i any = _mm256_or_si256(_mm256_or_si256(first, second), _mm256_and_si256(third, high));
+        const quint32 mask = static_cast<quint32>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(any, zero)));
+        if (mask) {
+            return i + qCountTrailingZeroBits(mask);
+        }
+        i += 32;
+    }
+
+    // The tail stays in VEX-encoded code; calling the SSE2 kernel with dirty upper
+    // registers costs more than the whole search on some CPUs
+    const __m128i highHalf = _mm256_castsi256_si128(high);
+    while (i + 18 <= size) {
+        const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 1));
+        const __m128i third = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 2));
+        const __m128i any = _mm_or_si128(_mm_or_si128(first, second), _mm_and_si128(third, highHalf));
+        const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128()));
+        if (mask) {
+            return i + qCountTrailingZeroBits(static_cast<quint32>(mask));
+        }
+        i += 16;
+    }
+    return findCandidateScalar(data, size, i);
+}
+#endif
+
+struct Kernel {
+    FindFunction find;
+    const char *name;
+};
+
+Kernel selectKernel()
+{
+#if defined(NALSCANNER_HAVE_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return { findCandidateAvx2, "avx2" };
+    }
+#endif
+#if defined(__SSE2__)
+    return { findCandidateSse2, "sse2" };
+#else
+    return { findCandidateScalar, "scalar" };
+#endif
+}
+
+const Kernel &kernel()
+{
+    static const Kernel selected = selectKernel();
+    return selected;
+}
+
+// Zero bytes directly before end, stopping at the start of the data
+int zerosBefore(const uchar *data, int end)
+{
+    int zeros = 0;
+    while (end - zeros > 0 && data[end - zeros - 1] == 0) {
+        ++zeros;
+    }
+    return zeros;
+}
+
+} // namespace
+
+NalScanner::NalScanner(NalCodec codec)
+    : nalCodec(codec)
+{
+    begin();
+}
+
+void NalScanner::begin()
+{
+    position = 0;
+    trailingZeros = 0;
+    unitStart = -1;
+    headerPending = false;
+    openType = 0;
+    openEmulationBytes = 0;
+}
+
+void NalScanner::feed(const uchar *data, int size, QVector<NalUnit> &units)
+{
+    if (size <= 0) {
+        return;
+    }
+
+    if (headerPending) {
+        openType = unitType(nalCodec, data[0]);
+        headerPending = false;
+    }
+
+    // Triples that start in the previous piece and end in this one
+    if (trailingZeros >= 2 && data[0] <= 3) {
+        startCode(position - 2, trailingZeros - 2, data, size, 0, units);
+    }
+    if (trailingZeros >= 1 && data[0] == 0 && size >= 2 && data[1] <= 3) {
+        startCode(position - 1, trailingZeros - 1, data, size, 1, units);
+    }
+
+    const FindFunction find = kernel().find;
+    int i = find(data, size, 0);
+    while (i < size) {
+        const int zeros = zerosBefore(data, i);
+        startCode(position + i, zeros == i ? zeros + trailingZeros : zeros, data, size, i + 2, units);
+        i = find(data, size, data[i + 2] == 0 ? i + 1 : i + 3);
+    }
+
+    const int zeros = zerosBefore(data, size);
+    trailingZeros = zeros == size ? trailingZeros + size : zeros;
+    position += size;
+}
+
+void NalScanner::startCode(int codeStart, int zerosBefore, const uchar *data, int size, int base,
+                           QVector<NalUnit> &units)
+{
+    // base is the index of the triple's last byte in this piece
+    const uchar last = data[base];
+    if (last == 3) {
+        if (unitStart >= 0) {
+            ++openEmulationBytes;
+        }
+        return;
+    }
+    if (last != 1) {
+        return;
+    }
+
+    // The zeros before the start code are its leading zero or trailing_zero_8bits,
+    // not part of the unit it ends
+    closeUnit(codeStart - zerosBefore, units);
+    unitStart = codeStart + 3;
+    openEmulationBytes = 0;
+    if (base + 1 < size) {
+        openType = unitType(nalCodec, data[base + 1]);
+        headerPending = false;
+    } else {
+        headerPending = true;
+    }
+}
+
+void NalScanner::closeUnit(int end, QVector<NalUnit> &units)
+{
+    if (unitStart >= 0 && !headerPending && end > unitStart) {
+        units.append({ unitStart, end - unitStart, openType,
+                       static_cast<quint16>(qMin(openEmulationBytes, 0xFFFF)) });
+    }
+    unitStart = -1;
+}
+
+void NalScanner::finish(QVector<NalUnit> &units)
+{
+    closeUnit(position - trailingZeros, units);
+    begin();
+}
+
+bool NalScanner::scanLengthPrefixed(const uchar *data, int size, int lengthSize, QVector<NalUnit> &units) const
+{
+    if (lengthSize < 1 || lengthSize > 4) {
+        return false;
+    }
+
+    int offset = 0;
+    while (offset + lengthSize <= size) {
+        quint32 length = 0;
+        for (int i = 0; i < lengthSize; ++i) {
+            length = (length << 8) | data[offset + i];
+        }
+        offset += lengthSize;
+        if (length > static_cast<quint32>(size - offset)) {
+            return false;
+        }
+        if (length > 0) {
+            const int unitSize = static_cast<int>(length);
+            const int emulationBytes = countEmulationBytes(data + offset, unitSize);
+            units.append({ offset, unitSize, unitType(nalCodec, data[offset]),
+                           static_cast<quint16>(qMin(emulationBytes, 0xFFFF)) });
+            offset += unitSize;
+        }
+    }
+    return offset == size;
+}
+
+int NalScanner::findCandidate(const uchar *data, int size, int from)
+{
+    return kernel().find(data, size, from);
+}
+
+int NalScanner::countEmulationBytes(const uchar *data, int size)
+{
+    const FindFunction find = kernel().find;
+    int count = 0;
+    int i = find(data, size, 0);
+    while (i < size) {
+        if (data[i + 2] == 3) {
+            ++count;
+        }
+        i = find(data, size, data[i + 2] == 0 ? i + 1 : i + 3);
+    }
+    return count;
+}
+
+const char *NalScanner::kernelName()
+{
+    return kernel().name;
+}
+
+quint8 NalScanner::unitType(NalCodec codec, uchar header)
+{
+    switch (codec) {
+        case NalCodec::H264: return header & 0x1F;
+        case NalCodec::Hevc: return (header >> 1) & 0x3F;
+        default: return 0;
+    }
+}
+
+QString NalScanner::typeName(NalCodec codec, quint8 type)
+{
+    if (codec == NalCodec::H264) {
+        static const char *const names[] = {
+            nullptr, "Non-IDR slice", "Slice data A", "Slice data B", "Slice data C", "IDR slice",
+            "SEI", "SPS", "PPS", "Access unit delimiter", "End of sequence", "End of stream",
+            "Filler data", "SPS extension", "Prefix NAL", "Subset SPS", "Depth parameter set",
+            nullptr, nullptr, "Auxiliary slice", "Slice extension", "Depth slice extension"
+        };
+        if (type < sizeof(names) / sizeof(names[0]) && names[type]) {
+            return names[type];
+        }
+        return QString(type == 0 || type >= 24 ? "Unspecified (%1)" : "Reserved (%1)").arg(type);
+    }
+
+    if (codec == NalCodec::Hevc) {
+        static const char *const names[] = {
+            "TRAIL_N", "TRAIL_R", "TSA_N", "TSA_R", "STSA_N", "STSA_R", "RADL_N", "RADL_R",
+            "RASL_N", "RASL_R", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+            "BLA_W_LP", "BLA_W_RADL", "BLA_N_LP", "IDR_W_RADL", "IDR_N_LP", "CRA", nullptr, nullptr,
+            nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+            "VPS", "SPS", "PPS", "Access unit delimiter", "End of sequence", "End of bitstream",
+            "Filler data", "Prefix SEI", "Suffix SEI"
+        };
+        if (type < sizeof(names) / sizeof(names[0]) && names[type]) {
+            return names[type];
+        }
+        return QString(type >= 48 ? "Unspecified (%1)" : "Reserved (%1)").arg(type);
+    }
+
+    return QString("Type %1").arg(type);
+}
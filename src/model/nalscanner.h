@@ -0,0 +1,111 @@
+#ifndef NALSCANNER_H
+#define NALSCANNER_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief Video codecs whose packets are split into NAL units
+ */
+enum class NalCodec : quint8 {
+    Unknown = 0,
+    H264,
+    Hevc
+};
+
+/**
+ * @brief One NAL unit of a packet
+ */
+struct NalUnit {
+    qint32 offset;            ///< Offset of the NAL header in the packet payload
+    qint32 size;              ///< Bytes from the header to the end of the unit, emulation prevention included
+    quint8 type;              ///< nal_unit_type
+    quint16 emulationBytes;   ///< Emulation prevention bytes in the unit, saturated at 65535
+};
+
+/**
+ * @brief The NalScanner class splits video packet payloads into NAL units
+ *
+ * Annex B payloads (transport streams, raw elementary streams) are split at start codes
+ * and may be fed in pieces, such as the payloads of consecutive transport packets; a
+ * start code split across two pieces is still found. Length-prefixed payloads (MP4 and
+ * Matroska samples) are split at their length fields instead.
+ *
+ * Both searches run on one kernel that finds the next 00 00 0x triple with x <= 3, which
+ * covers start codes (00 00 01) and emulation prevention (00 00 03). The kernel uses
+ * AVX2 or SSE2 when the CPU has them, chosen once at run time, and a scalar loop that
+ * skips three bytes at a time otherwise.
+ */
+class NalScanner
+{
+public:
+    explicit NalScanner(NalCodec codec = NalCodec::Unknown);
+
+    void setCodec(NalCodec codec) { nalCodec = codec; }
+    NalCodec codec() const { return nalCodec; }
+
+    /**
+     * @brief Start a new Annex B payload, dropping any unit left open
+     */
+    void begin();
+
+    /**
+     * @brief Scan the next piece of an Annex B payload
+     * @param units Receives the units that end in this piece
+     */
+    void feed(const uchar *data, int size, QVector<NalUnit> &units);
+
+    /**
+     * @brief End the payload, closing the last unit
+     * @param units Receives the last unit, without trailing zero bytes
+     */
+    void finish(QVector<NalUnit> &units);
+
+    /**
+     * @brief Split a payload whose units are each preceded by a big-endian length field
+     * @param lengthSize Size of the length fields, 1 to 4 bytes
+     * @return bool False if a length runs past the payload; the units before it are kept
+     */
+    bool scanLengthPrefixed(const uchar *data, int size, int lengthSize, QVector<NalUnit> &units) const;
+
+    /**
+     * @brief Find the next 00 00 0x triple with x <= 3
+     * @return int Offset of the triple at or after from, or size if none lies wholly inside
+     */
+    static int findCandidate(const uchar *data, int size, int from);
+
+    /**
+     * @brief Count the emulation prevention bytes (the 03 of 00 00 03) in a unit
+     */
+    static int countEmulationBytes(const uchar *data, int size);
+
+    /**
+     * @brief Name of the kernel findCandidate() runs on: "avx2", "sse2" or "scalar"
+     */
+    static const char *kernelName();
+
+    /**
+     * @brief Get nal_unit_type from the first header byte of a unit
+     */
+    static quint8 unitType(NalCodec codec, uchar header);
+
+    /**
+     * @brief Get the display name of a NAL unit type ("IDR slice", "SPS", ...)
+     */
+    static QString typeName(NalCodec codec, quint8 type);
+
+private:
+    NalCodec nalCodec;
+    int position;             ///< Bytes of the payload fed so far
+    int trailingZeros;        ///< Zero bytes at the end of the bytes fed so far
+    int unitStart;            ///< Offset of the open unit's header, or -1 before the first start code
+    bool headerPending;       ///< The open unit's header byte has not been fed yet
+    quint8 openType;
+    int openEmulationBytes;
+
+    void startCode(int codeStart, int zerosBefore, const uchar *data, int size, int base, QVector<NalUnit> &units);
+    void closeUnit(int end, QVector<NalUnit> &units);
+};
+
+#endif // NALSCANNER_H
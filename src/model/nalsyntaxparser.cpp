@@ -0,0 +1,57 @@
+#include "nalsyntaxparser.h"
+#include "h264syntaxparser.h"
+#include "hevcsyntaxparser.h"
+#include <cstring>
+
+NalSyntaxParser::~NalSyntaxParser()
+{
+}
+
+std::unique_ptr<NalSyntaxParser> NalSyntaxParser::create(NalCodec codec)
+{
+    switch (codec) {
+        case NalCodec::H264: return std::unique_ptr<NalSyntaxParser>(new H264SyntaxParser);
+        case NalCodec::Hevc: return std::unique_ptr<NalSyntaxParser>(new HevcSyntaxParser);
+        default: return nullptr;
+    }
+}
+
+int NalSyntaxParser::unescape(const uchar *data, int size, uchar *rbsp, int capacity)
+{
+    // Copy the runs between 00 00 03 sequences, dropping each 03. At most one byte in
+    // three is dropped, so the search stops well before the end of a large slice
+    size = qMin(size, capacity + capacity / 2 + 2);
+    int copied = 0;
+    int runStart = 0;
+    int i = NalScanner::findCandidate(data, size, 0);
+    while (i < size && copied < capacity) {
+        if (data[i + 2] != 3) {
+            i = NalScanner::findCandidate(data, size, data[i + 2] == 0 ? i + 1 : i + 3);
+            continue;
+        }
+        const int run = qMin(i + 2 - runStart, capacity - copied);
+        memcpy(rbsp + copied, data + runStart, run);
+        copied += run;
+        runStart = i + 3;
+        i = NalScanner::findCandidate(data, size, runStart);
+    }
+    const int run = qMin(size - runStart, capacity - copied);
+    if (run > 0) {
+        memcpy(rbsp + copied, data + runStart, run);
+        copied += run;
+    }
+    return copied;
+}
+
+void NalSyntaxParser::parseAnnexB(const uchar *data, int size)
+{
+    NalScanner scanner;
+    QVector<NalUnit> units;
+    scanner.feed(data, size, units);
+    scanner.finish(units);
+
+    NalSliceHeader header;
+    for (const NalUnit &unit : units) {
+        parseUnit(data + unit.offset, unit.size, header);
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef NALSYNTAXPARSER_H
+#define NALSYNTAXPARSER_H
+
+#include "nalindex.h"
+#include <QByteArray>
+#include <memory>
+
+/**
+ * @brief The NalSyntaxParser class reads parameter sets and slice headers from NAL units
+ *
+ * One parser follows one video stream in decoding order: parameter set units update the
+ * sets it holds, and slice units are parsed against them into a NalSliceHeader, without
+ * running a decoder. Only the first ShortHeaderBytes of a slice are read, or up to
+ * MaxHeaderBytes for headers with long weight tables, which covers every header field
+ * the parser reports. Slices whose parameter sets have not been seen are skipped, so a
+ * parser that starts mid-stream reports slices from the next sets on; codec
+ * configuration records supply the sets up front where the container has them.
+ */
+class NalSyntaxParser
+{
+public:
+    static constexpr int ShortHeaderBytes = 64;   ///< Bytes of a slice unit read for its header first
+    static constexpr int MaxHeaderBytes = 1024;   ///< Bytes read when the header is longer
+    static constexpr int MaxParameterSetBytes = 4096;   ///< Bytes read of a parameter set, scaling lists included
+
+    virtual ~NalSyntaxParser();
+
+    /**
+     * @brief Create a parser for a codec
+     * @return std::unique_ptr<NalSyntaxParser> The parser, or nullptr if the codec has none
+     */
+    static std::unique_ptr<NalSyntaxParser> create(NalCodec codec);
+
+    /**
+     * @brief Read the parameter sets of codec extradata
+     * @param config A configuration record (avcC, hvcC) or Annex B units
+     */
+    virtual void parseConfig(const uchar *data, int size) = 0;
+
+    /**
+     * @brief Parse one NAL unit, starting at its header
+     * @param header Receives the header if the unit is a slice
+     * @return bool True if the unit is a slice whose header was parsed
+     */
+    virtual bool parseUnit(const uchar *data, int size, NalSliceHeader &header) = 0;
+
+protected:
+    /**
+     * @brief Copy a unit's payload without its emulation prevention bytes
+     * @param capacity Bytes available at rbsp; the copy stops there
+     * @return int The number of bytes copied
+     */
+    static int unescape(const uchar *data, int size, uchar *rbsp, int capacity);
+
+    /**
+     * @brief Parse each unit of Annex B coded extradata
+     */
+    void parseAnnexB(const uchar *data, int size);
+};
+
+#endif // NALSYNTAXPARSER_H
@@ -0,0 +1,597 @@
+#include "packetindexcache.h"
+#include "common/logging.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QDataStream>
+#include <QByteArray>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+constexpr char kIndexMagic[8] = { 'L', 'G', 'P', 'K', 'I', 'D', 'X', '1' };
+constexpr quint32 kIndexVersion = 3;
+constexpr quint32 kByteOrderMark = 0x01020304;
+constexpr qint64 kChunkAlignment = 4096;
+constexpr qint64 kColumnAlignment = 8;
+constexpr quint32 kCompleteFlag = 0x1;
+
+// Bytes per row of the packed tail columns
+constexpr qint64 kPacketRowBytes = 3 * sizeof(qint64) + 2 * sizeof(qint32) + sizeof(quint16) + sizeof(quint8);
+constexpr qint64 kNalRowBytes = sizeof(qint64) + 2 * sizeof(qint32) + sizeof(quint16) + 2 * sizeof(quint8)
+                                + sizeof(NalSliceHeader);
+
+qint64 alignUp(qint64 value, qint64 alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+QDataStream &operator<<(QDataStream &out, const VideoStreamInfo &info)
+{
+    out << qint32(info.streamIndex) << info.codecType << info.codecId << quint32(info.codecTag)
+        << info.format << qint64(info.bitRate) << info.profile << info.level
+        << qint32(info.width) << qint32(info.height) << info.sampleAspectRatio << info.fieldOrder
+        << info.colorRange << info.colorPrimaries << info.colorTrc << info.colorSpace
+        << info.chromaLocation << qint32(info.videoDelay);
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, VideoStreamInfo &info)
+{
+    qint32 streamIndex, width, height, videoDelay;
+    quint32 codecTag;
+    qint64 bitRate;
+    in >> streamIndex >> info.codecType >> info.codecId >> codecTag
+       >> info.format >> bitRate >> info.profile >> info.level
+       >> width >> height >> info.sampleAspectRatio >> info.fieldOrder
+       >> info.colorRange >> info.colorPrimaries >> info.colorTrc >> info.colorSpace
+       >> info.chromaLocation >> videoDelay;
+    info.streamIndex = streamIndex;
+    info.codecTag = codecTag;
+    info.bitRate = bitRate;
+    info.width = width;
+    info.height = height;
+    info.videoDelay = videoDelay;
+    return in;
+}
+
+QDataStream &operator<<(QDataStream &out, const AudioStreamInfo &info)
+{
+    out << qint32(info.streamIndex) << info.codecType << info.codecId << quint32(info.codecTag)
+        << info.format << qint64(info.bitRate) << info.profile << qint32(info.sampleRate)
+        << qint32(info.channels) << info.channelLayout << qint32(info.bitsPerSample);
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, AudioStreamInfo &info)
+{
+    qint32 streamIndex, sampleRate, channels, bitsPerSample;
+    quint32 codecTag;
+    qint64 bitRate;
+    in >> streamIndex >> info.codecType >> info.codecId >> codecTag
+       >> info.format >> bitRate >> info.profile >> sampleRate
+       >> channels >> info.channelLayout >> bitsPerSample;
+    info.streamIndex = streamIndex;
+    info.codecTag = codecTag;
+    info.bitRate = bitRate;
+    info.sampleRate = sampleRate;
+    info.channels = channels;
+    info.bitsPerSample = bitsPerSample;
+    return in;
+}
+
+QByteArray encodeCheckpoint(const ParseCheckpoint &checkpoint)
+{
+    QByteArray state;
+    QDataStream out(&state, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << qint32(checkpoint.coveredSpans.size());
+    for (const auto &span : checkpoint.coveredSpans) {
+        out << qint64(span.first) << qint64(span.second);
+    }
+    out << qint64(checkpoint.openStart) << qint64(checkpoint.openEnd);
+    return state;
+}
+
+bool decodeCheckpoint(const QByteArray &state, ParseCheckpoint &checkpoint)
+{
+    QDataStream in(state);
+    in.setVersion(QDataStream::Qt_5_15);
+    qint32 spanCount = 0;
+    in >> spanCount;
+    checkpoint.coveredSpans.clear();
+    for (qint32 i = 0; i < spanCount && in.status() == QDataStream::Ok; ++i) {
+        qint64 start, end;
+        in >> start >> end;
+        checkpoint.coveredSpans.append({ start, end });
+    }
+    qint64 openStart = -1, openEnd = -1;
+    in >> openStart >> openEnd;
+    checkpoint.openStart = openStart;
+    checkpoint.openEnd = openEnd;
+    return in.status() == QDataStream::Ok;
+}
+
+} // namespace
+
+// On-disk header, stored in native byte order (checked through byteOrderMark)
+struct PacketIndexCache::Header {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrderMark;
+    quint32 chunkSize;        // PacketTable::ChunkSize
+    quint32 chunkBytes;       // sizeof(PacketTable::Chunk)
+    qint64 mediaSize;
+    qint64 mediaModified;     // msecs since epoch
+    qint64 packetCount;
+    qint64 metadataOffset;
+    qint64 metadataSize;
+    qint64 chunkOffset;       // page aligned, full chunks of both tables in their in-memory layout
+    qint64 fullChunkCount;
+    qint64 tailOffset;        // end of the chunks, then the remaining rows, one packed array per column
+    quint32 flags;
+    quint32 reserved;
+    qint64 stateOffset;       // ParseCheckpoint of a partial index, after the directory
+    qint64 stateSize;
+    quint32 nalChunkSize;     // NalIndex::ChunkSize
+    quint32 nalChunkBytes;    // sizeof(NalIndex::Chunk)
+    qint64 nalCount;
+    qint64 nalFullChunkCount;
+    qint64 nalTailOffset;     // remaining NAL rows, after the packet rows
+    qint64 directoryOffset;   // offset of each full chunk, packet chunks first, after the NAL rows
+};
+
+PacketIndexCache::PacketIndexCache(const QString &mediaFilePath)
+    : mediaPath(mediaFilePath)
+    , mediaSize(0)
+    , mediaModified(0)
+    , mapped(nullptr)
+    , mappedSize(0)
+    , cachedTotalStreams(0)
+    , cachedPacketCount(0)
+    , tailOffset(0)
+    , cachedNalCount(0)
+    , nalTailOffset(0)
+    , complete(false)
+{
+    QFileInfo info(mediaFilePath);
+    if (info.exists()) {
+        mediaSize = info.size();
+        mediaModified = info.lastModified().toMSecsSinceEpoch();
+        indexPath = indexPathFor(mediaFilePath, mediaSize, mediaModified);
+    }
+}
+
+PacketIndexCache::~PacketIndexCache()
+{
+}
+
+QString PacketIndexCache::cacheDirectory()
+{
+    QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (base.isEmpty()) {
+        base = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/legilimens";
+    }
+    return base + "/packet-index";
+}
+
+QString PacketIndexCache::indexPathFor(const QString &mediaFilePath, qint64 size, qint64 modified)
+{
+    const QString key = QString("%1|%2|%3").arg(QFileInfo(mediaFilePath).absoluteFilePath()).arg(size).arg(modified);
+    const QByteArray hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return cacheDirectory() + "/" + QString::fromLatin1(hash) + ".lgidx";
+}
+
+bool PacketIndexCache::load(bool allowPartial)
+{
+    if (indexPath.isEmpty() || !QFile::exists(indexPath)) {
+        return false;
+    }
+
+    std::shared_ptr<QFile> file = std::make_shared<QFile>(indexPath);
+    if (!file->open(QIODevice::ReadOnly) || file->size() < static_cast<qint64>(sizeof(Header))) {
+        return false;
+    }
+
+    const qint64 size = file->size();
+    const uchar *data = file->map(0, size);
+    if (!data) {
+        qCDebug(lcIndex) << "Could not map packet index:" << indexPath;
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+
+    const qint64 tailRows = header.packetCount - header.fullChunkCount * PacketTable::ChunkSize;
+    const qint64 nalTailRows = header.nalCount - header.nalFullChunkCount * NalIndex::ChunkSize;
+    const qint64 directoryBytes = (header.fullChunkCount + header.nalFullChunkCount) * static_cast<qint64>(sizeof(qint64));
+    const bool valid = std::memcmp(header.magic, kIndexMagic, sizeof(kIndexMagic)) == 0
+                       && header.version == kIndexVersion
+                       && header.byteOrderMark == kByteOrderMark
+                       && header.chunkSize == static_cast<quint32>(PacketTable::ChunkSize)
+                       && header.chunkBytes == static_cast<quint32>(sizeof(PacketTable::Chunk))
+                       && header.nalChunkSize == static_cast<quint32>(NalIndex::ChunkSize)
+                       && header.nalChunkBytes == static_cast<quint32>(sizeof(NalIndex::Chunk))
+                       && (allowPartial || (header.flags & kCompleteFlag))
+                       && header.mediaSize == mediaSize
+                       && header.mediaModified == mediaModified
+                       && header.fullChunkCount >= 0 && header.fullChunkCount <= PacketTable::MaxChunks
+                       && tailRows >= 0 && tailRows < PacketTable::ChunkSize
+                       && header.nalFullChunkCount >= 0 && header.nalFullChunkCount <= NalIndex::MaxChunks
+                       && nalTailRows >= 0 && nalTailRows < NalIndex::ChunkSize
+                       && header.metadataOffset >= static_cast<qint64>(sizeof(Header))
+                       && header.metadataSize >= 0 && header.metadataOffset + header.metadataSize <= size
+                       && header.chunkOffset >= 0 && header.chunkOffset % kChunkAlignment == 0
+                       && header.tailOffset >= header.chunkOffset && header.tailOffset + tailRows * kPacketRowBytes <= size
+                       && header.nalTailOffset >= 0 && header.nalTailOffset % kColumnAlignment == 0
+                       && header.nalTailOffset + nalTailRows * kNalRowBytes <= size
+                       && header.directoryOffset >= 0 && header.directoryOffset + directoryBytes <= size
+                       && header.stateOffset >= 0 && header.stateSize >= 0
+                       && header.stateOffset + header.stateSize <= size;
+    if (!valid) {
+        qCDebug(lcIndex) << "Ignoring stale or invalid packet index:" << indexPath;
+        return false;
+    }
+
+    // Every full chunk must lie whole between the chunk start and the tail
+    QVector<qint64> packetChunks(static_cast<int>(header.fullChunkCount));
+    QVector<qint64> nalChunks(static_cast<int>(header.nalFullChunkCount));
+    std::memcpy(packetChunks.data(), data + header.directoryOffset, packetChunks.size() * sizeof(qint64));
+    std::memcpy(nalChunks.data(), data + header.directoryOffset + packetChunks.size() * sizeof(qint64),
+                nalChunks.size() * sizeof(qint64));
+    auto chunksValid = [&header](const QVector<qint64> &offsets, qint64 chunkBytes) {
+        for (qint64 offset : offsets) {
+            if (offset < header.chunkOffset || offset % kChunkAlignment != 0 || offset + chunkBytes > header.tailOffset) {
+                return false;
+            }
+        }
+        return true;
+    };
+    if (!chunksValid(packetChunks, sizeof(PacketTable::Chunk)) || !chunksValid(nalChunks, sizeof(NalIndex::Chunk))) {
+        qCDebug(lcIndex) << "Ignoring packet index with a corrupt chunk directory:" << indexPath;
+        return false;
+    }
+
+    // Decode the stream information
+    QByteArray metadata = QByteArray::fromRawData(reinterpret_cast<const char*>(data + header.metadataOffset),
+                                                  static_cast<int>(header.metadataSize));
+    QDataStream in(metadata);
+    in.setVersion(QDataStream::Qt_5_15);
+    qint32 totalStreams, videoCount, audioCount;
+    in >> totalStreams >> videoCount;
+    cachedVideoStreams.clear();
+    for (qint32 i = 0; i < videoCount && in.status() == QDataStream::Ok; ++i) {
+        VideoStreamInfo info;
+        in >> info;
+        cachedVideoStreams.append(info);
+    }
+    in >> audioCount;
+    cachedAudioStreams.clear();
+    for (qint32 i = 0; i < audioCount && in.status() == QDataStream::Ok; ++i) {
+        AudioStreamInfo info;
+        in >> info;
+        cachedAudioStreams.append(info);
+    }
+    if (in.status() != QDataStream::Ok) {
+        qCDebug(lcIndex) << "Ignoring packet index with corrupt metadata:" << indexPath;
+        return false;
+    }
+
+    // A partial index carries the state its parse resumes from
+    ParseCheckpoint checkpoint;
+    if (!(header.flags & kCompleteFlag) && header.stateSize > 0) {
+        const QByteArray state = QByteArray::fromRawData(reinterpret_cast<const char*>(data + header.stateOffset),
+                                                         static_cast<int>(header.stateSize));
+        if (!decodeCheckpoint(state, checkpoint)) {
+            qCDebug(lcIndex) << "Ignoring packet index with corrupt parse state:" << indexPath;
+            return false;
+        }
+    }
+
+    cachedTotalStreams = totalStreams;
+    cachedPacketCount = header.packetCount;
+    packetChunkOffsets = packetChunks;
+    tailOffset = header.tailOffset;
+    cachedNalCount = header.nalCount;
+    nalChunkOffsets = nalChunks;
+    nalTailOffset = header.nalTailOffset;
+    complete = (header.flags & kCompleteFlag) != 0;
+    cachedCheckpoint = checkpoint;
+    indexFile = file;
+    mapped = data;
+    mappedSize = size;
+
+    qCDebug(lcIndex) << "Loaded" << (complete ? "packet index" : "partial packet index") << indexPath
+             << "with" << cachedPacketCount << "packets and" << cachedNalCount << "NAL units";
+    return true;
+}
+
+void PacketIndexCache::streamInfo(QList<VideoStreamInfo> &videoStreams, QList<AudioStreamInfo> &audioStreams, int &totalStreams) const
+{
+    videoStreams = cachedVideoStreams;
+    audioStreams = cachedAudioStreams;
+    totalStreams = cachedTotalStreams;
+}
+
+qint64 PacketIndexCache::packetCount() const
+{
+    return mapped ? cachedPacketCount : 0;
+}
+
+bool PacketIndexCache::attachPackets(PacketTable &table) const
+{
+    NalIndex &nals = table.nalUnits();
+    if (!mapped || !table.isEmpty() || !nals.isEmpty()) {
+        return false;
+    }
+
+    // Full chunks are used in place from the mapping
+    QVector<const PacketTable::Chunk*> chunks;
+    for (qint64 offset : packetChunkOffsets) {
+        chunks.append(reinterpret_cast<const PacketTable::Chunk*>(mapped + offset));
+    }
+    QVector<const NalIndex::Chunk*> nalChunks;
+    for (qint64 offset : nalChunkOffsets) {
+        nalChunks.append(reinterpret_cast<const NalIndex::Chunk*>(mapped + offset));
+    }
+    if (!table.adoptChunks(chunks, indexFile) || !nals.adoptChunks(nalChunks, indexFile)) {
+        return false;
+    }
+
+    // The partial last chunks are stored packed and copied into owned chunks
+    const qint64 tailRows = cachedPacketCount - table.size();
+    const uchar *column = mapped + tailOffset;
+    const qint64 *pts = reinterpret_cast<const qint64*>(column);
+    const qint64 *dts = pts + tailRows;
+    const qint64 *pos = dts + tailRows;
+    const qint32 *duration = reinterpret_cast<const qint32*>(pos + tailRows);
+    const qint32 *sizes = duration + tailRows;
+    const quint16 *streams = reinterpret_cast<const quint16*>(sizes + tailRows);
+    const quint8 *flags = reinterpret_cast<const quint8*>(streams + tailRows);
+    for (qint64 i = 0; i < tailRows; ++i) {
+        table.appendRow(pts[i], dts[i], pos[i], duration[i], sizes[i], streams[i], flags[i]);
+    }
+
+    const qint64 nalTailRows = cachedNalCount - nals.size();
+    const qint64 *packetRows = reinterpret_cast<const qint64*>(mapped + nalTailOffset);
+    const qint32 *offsets = reinterpret_cast<const qint32*>(packetRows + nalTailRows);
+    const qint32 *nalSizes = offsets + nalTailRows;
+    const quint16 *emulationBytes = reinterpret_cast<const quint16*>(nalSizes + nalTailRows);
+    const quint8 *types = reinterpret_cast<const quint8*>(emulationBytes + nalTailRows);
+    const quint8 *codecs = types + nalTailRows;
+    const NalSliceHeader *headers = reinterpret_cast<const NalSliceHeader*>(codecs + nalTailRows);
+    for (qint64 i = 0; i < nalTailRows; ++i) {
+        const NalUnit unit = { offsets[i], nalSizes[i], types[i], emulationBytes[i] };
+        nals.append(packetRows[i], static_cast<NalCodec>(codecs[i]), unit, &headers[i]);
+    }
+
+    return true;
+}
+
+bool PacketIndexCache::save(const QString &mediaFilePath,
+                            const QList<VideoStreamInfo> &videoStreams,
+                            const QList<AudioStreamInfo> &audioStreams,
+                            int totalStreams,
+                            const PacketTable &table)
+{
+    PacketIndexWriter writer(mediaFilePath);
+    return writer.open(videoStreams, audioStreams, totalStreams, 0, 0) && writer.write(table, nullptr);
+}
+
+PacketIndexWriter::PacketIndexWriter(const QString &mediaFilePath)
+    : mediaPath(mediaFilePath)
+    , mediaSize(0)
+    , mediaModified(0)
+    , chunkOffset(0)
+    , chunkEnd(0)
+{
+    QFileInfo info(mediaFilePath);
+    if (info.exists()) {
+        mediaSize = info.size();
+        mediaModified = info.lastModified().toMSecsSinceEpoch();
+        indexPath = PacketIndexCache::indexPathFor(mediaFilePath, mediaSize, mediaModified);
+    }
+}
+
+PacketIndexWriter::~PacketIndexWriter()
+{
+}
+
+bool PacketIndexWriter::open(const QList<VideoStreamInfo> &videoStreams,
+                             const QList<AudioStreamInfo> &audioStreams,
+                             int totalStreams,
+                             qint64 storedChunks,
+                             qint64 storedNalChunks)
+{
+    if (indexPath.isEmpty() || !QDir().mkpath(QFileInfo(indexPath).absolutePath())) {
+        qCDebug(lcIndex) << "Could not create packet index directory for" << indexPath;
+        return false;
+    }
+
+    // Serialize the stream information
+    metadata.clear();
+    {
+        QDataStream out(&metadata, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_15);
+        out << qint32(totalStreams) << qint32(videoStreams.size());
+        for (const VideoStreamInfo &info : videoStreams) {
+            out << info;
+        }
+        out << qint32(audioStreams.size());
+        for (const AudioStreamInfo &info : audioStreams) {
+            out << info;
+        }
+    }
+    chunkOffset = alignUp(sizeof(PacketIndexCache::Header) + metadata.size(), kChunkAlignment);
+
+    // A resumed index keeps its stored chunks, which the table may still map; the header
+    // is checked and the chunk directory read, so new chunks are appended after the old ones
+    file.setFileName(indexPath);
+    packetChunkOffsets.clear();
+    nalChunkOffsets.clear();
+    if (storedChunks > 0 || storedNalChunks > 0) {
+        PacketIndexCache::Header header;
+        if (file.open(QIODevice::ReadWrite)
+            && file.read(reinterpret_cast<char*>(&header), sizeof(header)) == static_cast<qint64>(sizeof(header))
+            && header.version == kIndexVersion
+            && header.chunkOffset == chunkOffset
+            && header.fullChunkCount == storedChunks
+            && header.nalFullChunkCount == storedNalChunks) {
+            packetChunkOffsets.resize(static_cast<int>(storedChunks));
+            nalChunkOffsets.resize(static_cast<int>(storedNalChunks));
+            const qint64 packetBytes = storedChunks * static_cast<qint64>(sizeof(qint64));
+            const qint64 nalBytes = storedNalChunks * static_cast<qint64>(sizeof(qint64));
+            if (file.seek(header.directoryOffset)
+                && file.read(reinterpret_cast<char*>(packetChunkOffsets.data()), packetBytes) == packetBytes
+                && file.read(reinterpret_cast<char*>(nalChunkOffsets.data()), nalBytes) == nalBytes) {
+                chunkEnd = header.tailOffset;
+                return true;
+            }
+            packetChunkOffsets.clear();
+            nalChunkOffsets.clear();
+        }
+        file.close();
+        qCDebug(lcIndex) << "Partial packet index changed on disk, starting it over:" << indexPath;
+    }
+
+    // A new index replaces the old file rather than truncating it under a live mapping
+    QFile::remove(indexPath);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qCDebug(lcIndex) << "Could not write packet index:" << indexPath;
+        return false;
+    }
+    const QByteArray padding(static_cast<int>(chunkOffset - sizeof(PacketIndexCache::Header) - metadata.size()), '\0');
+    if (!file.seek(sizeof(PacketIndexCache::Header))
+        || file.write(metadata) != metadata.size()
+        || file.write(padding) != padding.size()) {
+        discard();
+        return false;
+    }
+    chunkEnd = chunkOffset;
+    return true;
+}
+
+void PacketIndexWriter::discard()
+{
+    // A half-written index must not be picked up by a later load
+    qCDebug(lcIndex) << "Could not write packet index:" << indexPath << file.errorString();
+    file.close();
+    QFile::remove(indexPath);
+    packetChunkOffsets.clear();
+    nalChunkOffsets.clear();
+}
+
+bool PacketIndexWriter::write(const PacketTable &table, const ParseCheckpoint *checkpoint)
+{
+    if (!file.isOpen()) {
+        return false;
+    }
+
+    const qint64 packetCount = table.size();
+    const qint64 fullChunks = packetCount / PacketTable::ChunkSize;
+    const qint64 tailRows = packetCount - fullChunks * PacketTable::ChunkSize;
+    const NalIndex &nals = table.nalUnits();
+    const qint64 nalCount = nals.size();
+    const qint64 nalFullChunks = nalCount / NalIndex::ChunkSize;
+    const qint64 nalTailRows = nalCount - nalFullChunks * NalIndex::ChunkSize;
+    bool written = true;
+
+    // Chunks filled since the last write, appended after the stored ones in either table
+    if (fullChunks > packetChunkOffsets.size() || nalFullChunks > nalChunkOffsets.size()) {
+        written = file.seek(chunkEnd);
+    }
+    for (qint64 i = packetChunkOffsets.size(); i < fullChunks && written; ++i) {
+        written = file.write(reinterpret_cast<const char*>(table.chunk(static_cast<int>(i))), sizeof(PacketTable::Chunk))
+                  == static_cast<qint64>(sizeof(PacketTable::Chunk));
+        packetChunkOffsets.append(chunkEnd);
+        chunkEnd += sizeof(PacketTable::Chunk);
+    }
+    for (qint64 i = nalChunkOffsets.size(); i < nalFullChunks && written; ++i) {
+        written = file.write(reinterpret_cast<const char*>(nals.chunk(static_cast<int>(i))), sizeof(NalIndex::Chunk))
+                  == static_cast<qint64>(sizeof(NalIndex::Chunk));
+        nalChunkOffsets.append(chunkEnd);
+        chunkEnd += sizeof(NalIndex::Chunk);
+    }
+
+    // The partial last chunks, stored packed
+    const qint64 tailOffset = chunkEnd;
+    written = written && file.seek(tailOffset);
+    if (written && tailRows > 0) {
+        const PacketTable::Chunk *tail = table.chunk(static_cast<int>(fullChunks));
+        written = writeColumn(tail->pts, tailRows)
+                  && writeColumn(tail->dts, tailRows)
+                  && writeColumn(tail->pos, tailRows)
+                  && writeColumn(tail->duration, tailRows)
+                  && writeColumn(tail->size, tailRows)
+                  && writeColumn(tail->streamIndex, tailRows)
+                  && writeColumn(tail->flags, tailRows);
+    }
+    const qint64 nalTailOffset = alignUp(tailOffset + tailRows * kPacketRowBytes, kColumnAlignment);
+    written = written && file.seek(nalTailOffset);
+    if (written && nalTailRows > 0) {
+        const NalIndex::Chunk *tail = nals.chunk(static_cast<int>(nalFullChunks));
+        written = writeColumn(tail->packetRow, nalTailRows)
+                  && writeColumn(tail->offset, nalTailRows)
+                  && writeColumn(tail->size, nalTailRows)
+                  && writeColumn(tail->emulationBytes, nalTailRows)
+                  && writeColumn(tail->type, nalTailRows)
+                  && writeColumn(tail->codec, nalTailRows)
+                  && writeColumn(tail->sliceHeader, nalTailRows);
+    }
+
+    // The directory locates every full chunk, then the parse state follows
+    const qint64 directoryOffset = file.pos();
+    written = written && writeColumn(packetChunkOffsets.constData(), packetChunkOffsets.size())
+              && writeColumn(nalChunkOffsets.constData(), nalChunkOffsets.size());
+
+    const QByteArray state = checkpoint ? encodeCheckpoint(*checkpoint) : QByteArray();
+    const qint64 stateOffset = file.pos();
+    written = written && file.write(state) == state.size() && file.resize(stateOffset + state.size());
+    if (!written) {
+        discard();
+        return false;
+    }
+
+    // The header goes last, so a reader never sees rows that are not on disk yet
+    PacketIndexCache::Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+    header.version = kIndexVersion;
+    header.byteOrderMark = kByteOrderMark;
+    header.chunkSize = PacketTable::ChunkSize;
+    header.chunkBytes = sizeof(PacketTable::Chunk);
+    header.mediaSize = mediaSize;
+    header.mediaModified = mediaModified;
+    header.packetCount = packetCount;
+    header.metadataOffset = sizeof(header);
+    header.metadataSize = metadata.size();
+    header.chunkOffset = chunkOffset;
+    header.fullChunkCount = fullChunks;
+    header.tailOffset = tailOffset;
+    header.flags = checkpoint ? 0 : kCompleteFlag;
+    header.stateOffset = stateOffset;
+    header.stateSize = state.size();
+    header.nalChunkSize = NalIndex::ChunkSize;
+    header.nalChunkBytes = sizeof(NalIndex::Chunk);
+    header.nalCount = nalCount;
+    header.nalFullChunkCount = nalFullChunks;
+    header.nalTailOffset = nalTailOffset;
+    header.directoryOffset = directoryOffset;
+    if (!file.flush() || !file.seek(0)
+        || file.write(reinterpret_cast<const char*>(&header), sizeof(header)) != static_cast<qint64>(sizeof(header))
+        || !file.flush()) {
+        discard();
+        return false;
+    }
+
+    if (!checkpoint) {
+        qCDebug(lcIndex) << "Saved packet index" << indexPath << "with" << packetCount << "packets and"
+                         << nalCount << "NAL units";
+    }
+    return true;
+}
@@ -0,0 +1,213 @@
+#ifndef PACKETINDEXCACHE_H
+#define PACKETINDEXCACHE_H
+
+#include <QString>
+#include <QList>
+#include <QVector>
+#include <QPair>
+#include <QFile>
+#include <memory>
+#include "packettable.h"
+#include "mediafilemanager.h"
+
+/**
+ * @brief Parse state stored in a partial index, enough to resume the parse
+ */
+struct ParseCheckpoint {
+    QVector<QPair<qint64, qint64>> coveredSpans;  ///< Byte ranges whose packets are all in the index
+    qint64 openStart = -1;    ///< Start of the region being read at the checkpoint, or -1
+    qint64 openEnd = -1;      ///< End of the packets kept from that region
+};
+
+/**
+ * @brief The PacketIndexCache class persists a parsed packet table next to the user's cache
+ *
+ * The packet table, its NAL index and the stream information are written to a compact
+ * binary index in the per-user cache directory, keyed by the media file's path, size and
+ * modification time. Full chunks are stored in the exact in-memory layout of
+ * PacketTable::Chunk and NalIndex::Chunk, in the order they filled, with a directory
+ * giving the position of each; reopening maps the index and hands the chunks to the
+ * table without copying, so NAL units and slice headers come back with their packets.
+ * Only the partial last chunk of each is read into memory. While a parse runs the index is kept as a
+ * partial index with a ParseCheckpoint, which a later run resumes from; only a complete
+ * index replaces parsing. A stale or corrupt index is ignored and the file is demuxed again.
+ */
+class PacketIndexCache
+{
+public:
+    /**
+     * @brief Create a cache handle for a media file
+     * @param mediaFilePath The media file the index belongs to
+     */
+    explicit PacketIndexCache(const QString &mediaFilePath);
+    ~PacketIndexCache();
+
+    /**
+     * @brief Get the path of the index file for the media file
+     */
+    QString indexFilePath() const { return indexPath; }
+
+    /**
+     * @brief Map and validate the index
+     * @param allowPartial Also accept the partial index of an unfinished parse
+     * @return bool True if an index exists and matches the media file's size and mtime
+     */
+    bool load(bool allowPartial = false);
+
+    /**
+     * @brief Check whether a loaded index holds every packet of the file
+     */
+    bool isComplete() const { return complete; }
+
+    /**
+     * @brief Get the parse state stored in a loaded partial index
+     */
+    ParseCheckpoint checkpoint() const { return cachedCheckpoint; }
+
+    /**
+     * @brief Get the number of full packet chunks stored in a loaded index
+     */
+    qint64 storedChunkCount() const { return mapped ? packetChunkOffsets.size() : 0; }
+
+    /**
+     * @brief Get the number of full NAL index chunks stored in a loaded index
+     */
+    qint64 storedNalChunkCount() const { return mapped ? nalChunkOffsets.size() : 0; }
+
+    /**
+     * @brief Get the stream information stored in a loaded index
+     */
+    void streamInfo(QList<VideoStreamInfo> &videoStreams, QList<AudioStreamInfo> &audioStreams, int &totalStreams) const;
+
+    /**
+     * @brief Get the number of packets stored in a loaded index
+     */
+    qint64 packetCount() const;
+
+    /**
+     * @brief Fill an empty packet table and its NAL index from a loaded index
+     * @param table The table; full chunks are adopted from the mapping, the rest is copied
+     * @return bool True on success
+     */
+    bool attachPackets(PacketTable &table) const;
+
+    /**
+     * @brief Write the index for a media file
+     * @param mediaFilePath The media file the packets were parsed from
+     * @param videoStreams The video stream information
+     * @param audioStreams The audio stream information
+     * @param totalStreams The total number of streams
+     * @param table The parsed packets
+     * @return bool True if the index was written
+     */
+    static bool save(const QString &mediaFilePath,
+                     const QList<VideoStreamInfo> &videoStreams,
+                     const QList<AudioStreamInfo> &audioStreams,
+                     int totalStreams,
+                     const PacketTable &table);
+
+private:
+    friend class PacketIndexWriter;
+    struct Header;
+
+    QString mediaPath;
+    QString indexPath;
+    qint64 mediaSize;
+    qint64 mediaModified;
+
+    // Mapped index; shared with tables that adopt its chunks
+    std::shared_ptr<QFile> indexFile;
+    const uchar *mapped;
+    qint64 mappedSize;
+
+    // Decoded metadata of a loaded index
+    QList<VideoStreamInfo> cachedVideoStreams;
+    QList<AudioStreamInfo> cachedAudioStreams;
+    int cachedTotalStreams;
+    qint64 cachedPacketCount;
+    QVector<qint64> packetChunkOffsets;
+    qint64 tailOffset;
+    qint64 cachedNalCount;
+    QVector<qint64> nalChunkOffsets;
+    qint64 nalTailOffset;
+    bool complete;
+    ParseCheckpoint cachedCheckpoint;
+
+    static QString cacheDirectory();
+    static QString indexPathFor(const QString &mediaFilePath, qint64 size, qint64 modified);
+};
+
+/**
+ * @brief The PacketIndexWriter class keeps the index of a running parse up to date
+ *
+ * Rows below a table's size never change, so each write only appends the chunks of the
+ * table and its NAL index filled since the previous one, then rewrites the partial last
+ * chunks, the chunk directory, the parse state and finally the header. A checkpoint therefore costs the rows added since the last one,
+ * however large the table has grown. A write without a checkpoint marks the index
+ * complete. Writes come from the table's writer thread.
+ */
+class PacketIndexWriter
+{
+public:
+    /**
+     * @brief Create a writer for a media file's index
+     * @param mediaFilePath The media file being parsed
+     */
+    explicit PacketIndexWriter(const QString &mediaFilePath);
+    ~PacketIndexWriter();
+
+    PacketIndexWriter(const PacketIndexWriter &) = delete;
+    PacketIndexWriter &operator=(const PacketIndexWriter &) = delete;
+
+    /**
+     * @brief Start a new index, or continue the partial index a table was restored from
+     * @param storedChunks Full chunks of the table already in the index on disk, or 0 to start over
+     * @param storedNalChunks Full chunks of the table's NAL index already in the index on disk
+     * @return bool False if the index cannot be written
+     */
+    bool open(const QList<VideoStreamInfo> &videoStreams,
+              const QList<AudioStreamInfo> &audioStreams,
+              int totalStreams,
+              qint64 storedChunks,
+              qint64 storedNalChunks);
+
+    /**
+     * @brief Write the rows added since the last write
+     * @param table The table being parsed
+     * @param checkpoint The state to resume from, or nullptr once the table is complete
+     * @return bool True if the index was written
+     */
+    bool write(const PacketTable &table, const ParseCheckpoint *checkpoint);
+
+    QString indexFilePath() const { return indexPath; }
+
+private:
+    /**
+     * @brief Write the first rows of one column
+     * @return bool True if every byte was written
+     */
+    template <typename T>
+    bool writeColumn(const T *column, qint64 rows)
+    {
+        const qint64 bytes = rows * static_cast<qint64>(sizeof(T));
+        return bytes == 0 || file.write(reinterpret_cast<const char*>(column), bytes) == bytes;
+    }
+
+    /**
+     * @brief Close and remove an index whose write failed
+     */
+    void discard();
+
+    QString mediaPath;
+    QString indexPath;
+    qint64 mediaSize;
+    qint64 mediaModified;
+    QFile file;
+    QByteArray metadata;
+    qint64 chunkOffset;
+    qint64 chunkEnd;                       ///< End of the stored chunks, where the tails start
+    QVector<qint64> packetChunkOffsets;    ///< Position of each stored packet chunk
+    QVector<qint64> nalChunkOffsets;       ///< Position of each stored NAL index chunk
+};
+
+#endif // PACKETINDEXCACHE_H
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "packettable.h"
+#include <limits>
+
+QString streamTypeName(StreamType type)
+{
+    switch (type) {
+        case StreamType::Video: return "video";
+        case StreamType::Audio: return "audio";
+        case StreamType::Subtitle: return "subtitle";
+        case StreamType::Data: return "data";
+        default: return "unknown";
+    }
+}
+
+PacketTable::PacketTable()
+    : chunks(new std::atomic<Chunk*>[MaxChunks])
+    , count(0)
+    , adoptedChunks(0)
+{
+    for (int i = 0; i < MaxChunks; ++i) {
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+PacketTable::~PacketTable()
+{
+    const qint64 used = (count.load(std::memory_order_relaxed) + ChunkSize - 1) >> ChunkShift;
+    for (qint64 i = adoptedChunks; i < used; ++i) {
+        delete chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+qint64 PacketTable::append(const SliceInfo &slice)
+{
+    const qint32 duration = static_cast<qint32>(qBound<int64_t>(std::numeric_limits<qint32>::min(),
+                                                                slice.duration,
+                                                                std::numeric_limits<qint32>::max()));
+    const quint8 flags = static_cast<quint8>((slice.isKeyFrame ? KeyFrameFlag : 0)
+                                             | ((static_cast<quint8>(slice.streamType) << StreamTypeShift) & StreamTypeMask));
+    return appendRow(slice.pts, slice.dts, slice.pos, duration, slice.size,
+                     static_cast<quint16>(slice.streamIndex), flags);
+}
+
+qint64 PacketTable::appendRow(qint64 pts, qint64 dts, qint64 pos, qint32 duration, qint32 size,
+                              quint16 streamIndex, quint8 flags)
+{
+    const qint64 index = count.load(std::memory_order_relaxed);
+    const qint64 chunkIndex = index >> ChunkShift;
+    if (chunkIndex >= MaxChunks) {
+        return -1;
+    }
+
+    Chunk *chunk = chunks[chunkIndex].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new Chunk;
+        chunks[chunkIndex].store(chunk, std::memory_order_release);
+    }
+
+    const int offset = offsetOf(index);
+    chunk->pts[offset] = pts;
+    chunk->dts[offset] = dts;
+    chunk->pos[offset] = pos;
+    chunk->duration[offset] = duration;
+    chunk->size[offset] = size;
+    chunk->streamIndex[offset] = streamIndex;
+    chunk->flags[offset] = flags;
+
+    // Publish the row to readers
+    count.store(index + 1, std::memory_order_release);
+    return index;
+}
+
+bool PacketTable::adoptChunks(const QVector<const Chunk*> &chunkData, std::shared_ptr<void> storage)
+{
+    const int chunkCount = chunkData.size();
+    if (count.load(std::memory_order_relaxed) != 0 || chunkCount > MaxChunks) {
+        return false;
+    }
+
+    // Adopted chunks are full, so the writer never touches them: appends start in the next chunk
+    for (int i = 0; i < chunkCount; ++i) {
+        chunks[i].store(const_cast<Chunk*>(chunkData[i]), std::memory_order_relaxed);
+    }
+    adoptedChunks = chunkCount;
+    externalStorage = std::move(storage);
+    count.store(static_cast<qint64>(chunkCount) << ChunkShift, std::memory_order_release);
+    return true;
+}
+
+SliceInfo PacketTable::at(qint64 index) const
+{
+    const Chunk *chunk = chunkFor(index);
+    const int offset = offsetOf(index);
+
+    SliceInfo slice;
+    slice.streamIndex = chunk->streamIndex[offset];
+    slice.pts = chunk->pts[offset];
+    slice.dts = chunk->dts[offset];
+    slice.duration = chunk->duration[offset];
+    slice.pos = chunk->pos[offset];
+    slice.size = chunk->size[offset];
+    slice.isKeyFrame = (chunk->flags[offset] & KeyFrameFlag) != 0;
+    slice.streamType = static_cast<StreamType>((chunk->flags[offset] & StreamTypeMask) >> StreamTypeShift);
+    return slice;
+}
+
+qint64 PacketTable::memoryUsage() const
+{
+    const qint64 owned = chunkCount() - adoptedChunks;
+    return owned * static_cast<qint64>(sizeof(Chunk)) + MaxChunks * static_cast<qint64>(sizeof(std::atomic<Chunk*>))
+           + nalIndex.memoryUsage();
+}
\ No newline at end of file
@@ -0,0 +1,226 @@
+#ifndef PACKETTABLE_H
+#define PACKETTABLE_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QSharedPointer>
+#include <QMetaType>
+#include "nalindex.h"
+#include <atomic>
+#include <memory>
+
+/**
+ * @brief Stream type of a packet, stored in the packet flags byte
+ */
+enum class StreamType : quint8 {
+    Unknown = 0,
+    Video,
+    Audio,
+    Subtitle,
+    Data
+};
+
+/**
+ * @brief Get the display name of a stream type ("video", "audio", ...)
+ * @param type The stream type
+ * @return QString The stream type name
+ */
+QString streamTypeName(StreamType type);
+
+/**
+ * @brief Stream that a container-level stream id (TS PID, MP4 track ID, Matroska track number) maps to
+ */
+struct StreamMapping {
+    int streamIndex;
+    StreamType streamType;
+    NalCodec nalCodec = NalCodec::Unknown;   ///< Codec of video streams whose packets are split into NAL units
+    QByteArray codecConfig;                  ///< Extradata holding the stream's parameter sets, if any
+};
+
+// Slice information structure
+struct SliceInfo {
+    int streamIndex;
+    int64_t pts;          // Presentation timestamp
+    int64_t dts;          // Decode timestamp
+    int64_t duration;     // Duration
+    int64_t pos;          // Position in file
+    int size;             // Size in bytes
+    bool isKeyFrame;      // Is this a key frame
+    StreamType streamType;
+
+    // Constructor
+    SliceInfo() : streamIndex(-1), pts(0), dts(0), duration(0), pos(0), size(0), isKeyFrame(false), streamType(StreamType::Unknown) {}
+};
+
+/**
+ * @brief The PacketTable class is the shared, columnar store of all parsed packets
+ *
+ * Packets are kept in fixed-size chunks, one typed array per column, so a scan over
+ * a single column touches contiguous memory and a row costs 35 bytes. Chunks never
+ * move once allocated: a single writer (the parser) appends rows while any number of
+ * readers access rows below size(). The table is shared through QSharedPointer, so a
+ * reader holding an old table stays valid after a new file is opened.
+ *
+ * Video packets whose payload the parser reads are also split into NAL units, kept in
+ * the table's nalUnits() index under the same single-writer rules.
+ */
+class PacketTable
+{
+public:
+    static constexpr int ChunkShift = 16;
+    static constexpr int ChunkSize = 1 << ChunkShift;   ///< Packets per chunk
+    static constexpr int MaxChunks = 1 << 16;           ///< Up to 4G packets per table
+
+    /**
+     * @brief Bits of the per-packet flags column
+     *
+     * The stream type occupies bits 4-6 of the same byte.
+     */
+    enum PacketFlag : quint8 {
+        KeyFrameFlag = 0x01,
+        CorruptFlag = 0x02,
+        DiscardFlag = 0x04
+    };
+    static constexpr int StreamTypeShift = 4;
+    static constexpr quint8 StreamTypeMask = 0x70;
+
+    /**
+     * @brief One chunk of rows, one array per column
+     */
+    struct Chunk {
+        qint64 pts[ChunkSize];
+        qint64 dts[ChunkSize];
+        qint64 pos[ChunkSize];
+        qint32 duration[ChunkSize];
+        qint32 size[ChunkSize];
+        quint16 streamIndex[ChunkSize];
+        quint8 flags[ChunkSize];
+    };
+
+    PacketTable();
+    ~PacketTable();
+
+    PacketTable(const PacketTable &) = delete;
+    PacketTable &operator=(const PacketTable &) = delete;
+
+    /**
+     * @brief Append one packet (writer thread only)
+     * @param slice The packet to append
+     * @return qint64 The row index of the packet, or -1 if the table is full
+     */
+    qint64 append(const SliceInfo &slice);
+
+    /**
+     * @brief Append one packet from raw column values (writer thread only)
+     * @return qint64 The row index of the packet, or -1 if the table is full
+     */
+    qint64 appendRow(qint64 pts, qint64 dts, qint64 pos, qint32 duration, qint32 size,
+                     quint16 streamIndex, quint8 flags);
+
+    /**
+     * @brief Adopt read-only chunks that live in external storage, such as a memory-mapped index
+     *
+     * Only valid on an empty table, before any reader sees it. The chunks are never written
+     * or freed by the table; storage is kept alive for as long as the table exists.
+     * @param chunkData The full chunks, in row order
+     * @param storage Owner of the chunk memory
+     * @return bool True if the chunks were adopted
+     */
+    bool adoptChunks(const QVector<const Chunk*> &chunkData, std::shared_ptr<void> storage);
+
+    /**
+     * @brief Get the number of allocated chunks
+     */
+    int chunkCount() const { return static_cast<int>((size() + ChunkSize - 1) >> ChunkShift); }
+
+    /**
+     * @brief Get a chunk for bulk column access; rows past size() are undefined
+     */
+    const Chunk *chunk(int chunkIndex) const { return chunks[chunkIndex].load(std::memory_order_acquire); }
+
+    /**
+     * @brief Get the number of rows visible to readers
+     */
+    qint64 size() const { return count.load(std::memory_order_acquire); }
+    bool isEmpty() const { return size() == 0; }
+
+    /**
+     * @brief Get a row as a SliceInfo value
+     * @param index The row index, must be below size()
+     */
+    SliceInfo at(qint64 index) const;
+
+    // Column accessors, index must be below size()
+    qint64 pts(qint64 index) const { return chunkFor(index)->pts[offsetOf(index)]; }
+    qint64 dts(qint64 index) const { return chunkFor(index)->dts[offsetOf(index)]; }
+    qint64 pos(qint64 index) const { return chunkFor(index)->pos[offsetOf(index)]; }
+    qint32 duration(qint64 index) const { return chunkFor(index)->duration[offsetOf(index)]; }
+    qint32 packetSize(qint64 index) const { return chunkFor(index)->size[offsetOf(index)]; }
+    int streamIndex(qint64 index) const { return chunkFor(index)->streamIndex[offsetOf(index)]; }
+    quint8 flags(qint64 index) const { return chunkFor(index)->flags[offsetOf(index)]; }
+    bool isKeyFrame(qint64 index) const { return flags(index) & KeyFrameFlag; }
+    StreamType streamType(qint64 index) const
+    {
+        return static_cast<StreamType>((flags(index) & StreamTypeMask) >> StreamTypeShift);
+    }
+
+    /**
+     * @brief Get the NAL units of the table's video packets
+     *
+     * Written by the table's writer, after the packet rows they belong to.
+     */
+    NalIndex &nalUnits() { return nalIndex; }
+    const NalIndex &nalUnits() const { return nalIndex; }
+
+    /**
+     * @brief Get the approximate memory used by the table in bytes
+     */
+    qint64 memoryUsage() const;
+
+private:
+    std::unique_ptr<std::atomic<Chunk*>[]> chunks;  ///< Chunk directory, filled on demand
+    std::atomic<qint64> count;                      ///< Rows published to readers
+    int adoptedChunks;                              ///< Leading chunks owned by externalStorage
+    std::shared_ptr<void> externalStorage;          ///< Keeps adopted chunks alive
+    NalIndex nalIndex;
+
+    const Chunk *chunkFor(qint64 index) const
+    {
+        return chunks[index >> ChunkShift].load(std::memory_order_acquire);
+    }
+    static int offsetOf(qint64 index) { return static_cast<int>(index & (ChunkSize - 1)); }
+};
+
+/**
+ * @brief Handle to a published range of packet table rows
+ *
+ * Rows below PacketTable::size() are immutable, so a handle can be passed by value to
+ * any number of receivers and threads. Copying a handle costs one reference count
+ * update, however many packets it covers, and keeps the table and its chunks alive.
+ * Receivers compare table() with the table they display to drop stale ranges.
+ */
+class PacketBatch
+{
+public:
+    PacketBatch() : first(0), rows(0) {}
+    PacketBatch(const QSharedPointer<const PacketTable> &table, qint64 firstIndex, int count)
+        : packetTable(table), first(firstIndex), rows(count) {}
+
+    const QSharedPointer<const PacketTable> &table() const { return packetTable; }
+    qint64 firstIndex() const { return first; }
+    qint64 endIndex() const { return first + rows; }
+    int count() const { return rows; }
+    bool isNull() const { return !packetTable || rows <= 0; }
+
+private:
+    QSharedPointer<const PacketTable> packetTable;
+    qint64 first;
+    int rows;
+};
+
+Q_DECLARE_METATYPE(QSharedPointer<const PacketTable>)
+Q_DECLARE_METATYPE(PacketBatch)
+
+#endif // PACKETTABLE_H
\ No newline at end of file
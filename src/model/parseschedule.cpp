@@ -0,0 +1,143 @@
+#include "parseschedule.h"
+#include <QMutexLocker>
+#include <iterator>
+
+ParseSchedule::ParseSchedule()
+    : requestPending(false)
+    , requestIsTime(false)
+    , requestedPosition(0)
+    , requestedSeconds(0)
+    , inputSize(0)
+    , durationSeconds(0)
+    , bitRate(0)
+    , covered(0)
+{
+}
+
+void ParseSchedule::requestPosition(qint64 position)
+{
+    QMutexLocker locker(&mutex);
+    requestIsTime = false;
+    requestedPosition = position;
+    requestPending.store(true, std::memory_order_release);
+}
+
+void ParseSchedule::requestTime(double seconds)
+{
+    QMutexLocker locker(&mutex);
+    requestIsTime = true;
+    requestedSeconds = seconds;
+    requestPending.store(true, std::memory_order_release);
+}
+
+void ParseSchedule::setInput(qint64 totalBytes, double durationSeconds, qint64 bitRate)
+{
+    inputSize = qMax<qint64>(0, totalBytes);
+    this->durationSeconds = durationSeconds;
+    this->bitRate = bitRate;
+}
+
+bool ParseSchedule::takeRequest(qint64 &position)
+{
+    bool isTime;
+    qint64 bytes;
+    double seconds;
+    {
+        QMutexLocker locker(&mutex);
+        if (!requestPending.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        requestPending.store(false, std::memory_order_relaxed);
+        isTime = requestIsTime;
+        bytes = requestedPosition;
+        seconds = requestedSeconds;
+    }
+
+    if (inputSize <= 0) {
+        return false;
+    }
+
+    // Times are placed by assuming a constant bit rate; close is enough, the region
+    // is parsed from the nearest packet on
+    if (isTime) {
+        if (durationSeconds > 0) {
+            bytes = static_cast<qint64>(seconds / durationSeconds * inputSize);
+        } else if (bitRate > 0) {
+            bytes = static_cast<qint64>(seconds * bitRate / 8);
+        } else {
+            return false;
+        }
+    }
+    position = qBound<qint64>(0, bytes, inputSize - 1);
+    return true;
+}
+
+void ParseSchedule::markCovered(qint64 start, qint64 end)
+{
+    start = qMax<qint64>(0, start);
+    end = qMin(end, inputSize);
+    if (end <= start) {
+        return;
+    }
+
+    // Merge with a span that reaches start, then swallow every span starting up to end
+    auto it = spans.upperBound(start);
+    if (it != spans.begin()) {
+        auto previous = std::prev(it);
+        if (previous.value() >= start) {
+            start = previous.key();
+            end = qMax(end, previous.value());
+            covered -= previous.value() - previous.key();
+            spans.erase(previous);
+        }
+    }
+    it = spans.lowerBound(start);
+    while (it != spans.end() && it.key() <= end) {
+        end = qMax(end, it.value());
+        covered -= it.value() - it.key();
+        it = spans.erase(it);
+    }
+    spans.insert(start, end);
+    covered += end - start;
+}
+
+bool ParseSchedule::isCovered(qint64 position) const
+{
+    return coveredEnd(position) != position;
+}
+
+qint64 ParseSchedule::coveredEnd(qint64 position) const
+{
+    auto it = spans.upperBound(position);
+    if (it == spans.begin()) {
+        return position;
+    }
+    --it;
+    return position < it.value() ? it.value() : position;
+}
+
+qint64 ParseSchedule::nextCoveredStart(qint64 position) const
+{
+    auto it = spans.upperBound(position);
+    return it == spans.end() ? inputSize : it.key();
+}
+
+QVector<QPair<qint64, qint64>> ParseSchedule::coveredSpans() const
+{
+    QVector<QPair<qint64, qint64>> result;
+    result.reserve(spans.size());
+    for (auto it = spans.begin(); it != spans.end(); ++it) {
+        result.append({ it.key(), it.value() });
+    }
+    return result;
+}
+
+qint64 ParseSchedule::firstGap(qint64 from) const
+{
+    const qint64 after = coveredEnd(from);
+    if (after < inputSize) {
+        return after;
+    }
+    const qint64 wrapped = coveredEnd(0);
+    return wrapped < inputSize ? wrapped : -1;
+}
@@ -0,0 +1,83 @@
+#ifndef PARSESCHEDULE_H
+#define PARSESCHEDULE_H
+
+#include <QtGlobal>
+#include <QMap>
+#include <QVector>
+#include <QPair>
+#include <QMutex>
+#include <atomic>
+
+/**
+ * @brief The ParseSchedule class decides which part of the input the parser reads next
+ *
+ * The UI asks for a region it wants indexed first, as a byte offset or a presentation
+ * time, from any thread. The parser takes the request when it can move, reads that
+ * region, and falls back to the first byte range nobody has read yet once it runs
+ * into a range that is already covered. Covered ranges are kept as merged half-open
+ * byte spans; only the parser thread touches them.
+ */
+class ParseSchedule
+{
+public:
+    ParseSchedule();
+
+    ParseSchedule(const ParseSchedule &) = delete;
+    ParseSchedule &operator=(const ParseSchedule &) = delete;
+
+    /**
+     * @brief Ask for the region starting at a byte offset to be parsed next (any thread)
+     */
+    void requestPosition(qint64 position);
+
+    /**
+     * @brief Ask for the region around a presentation time to be parsed next (any thread)
+     * @param seconds Time from the start of the file
+     */
+    void requestTime(double seconds);
+
+    /**
+     * @brief Check cheaply whether a request is waiting
+     */
+    bool hasRequest() const { return requestPending.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Set the input size and the time to byte mapping used to resolve requests
+     * @param totalBytes Size of the input
+     * @param durationSeconds Duration of the input, or 0 if unknown
+     * @param bitRate Overall bit rate used when the duration is unknown, or 0
+     */
+    void setInput(qint64 totalBytes, double durationSeconds, qint64 bitRate);
+
+    /**
+     * @brief Take the pending request as a byte offset
+     * @return bool False if no request was pending or it could not be placed in the input
+     */
+    bool takeRequest(qint64 &position);
+
+    // Covered byte spans, parser thread only
+    void markCovered(qint64 start, qint64 end);
+    bool isCovered(qint64 position) const;
+    qint64 coveredEnd(qint64 position) const;         ///< End of the span holding position, or position
+    qint64 nextCoveredStart(qint64 position) const;   ///< Start of the first span after position, or the input size
+    qint64 firstGap(qint64 from) const;               ///< First uncovered byte at or after from, wrapping; -1 if none
+    qint64 coveredBytes() const { return covered; }
+    QVector<QPair<qint64, qint64>> coveredSpans() const;
+    qint64 totalBytes() const { return inputSize; }
+
+private:
+    QMutex mutex;
+    std::atomic<bool> requestPending;
+    bool requestIsTime;
+    qint64 requestedPosition;
+    double requestedSeconds;
+
+    qint64 inputSize;
+    double durationSeconds;
+    qint64 bitRate;
+
+    QMap<qint64, qint64> spans;    ///< Start to end of each covered span, disjoint and not touching
+    qint64 covered;
+};
+
+#endif // PARSESCHEDULE_H
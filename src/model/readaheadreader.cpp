@@ -0,0 +1,239 @@
+#include "readaheadreader.h"
+#include "common/logging.h"
+#include <QThread>
+#include <QDebug>
+#include <cstring>
+
+#if defined(Q_OS_UNIX) && !defined(Q_OS_DARWIN)
+#include <fcntl.h>
+#endif
+
+// FFmpeg headers
+extern "C" {
+#include <libavformat/avio.h>
+#include <libavutil/mem.h>
+#include <libavutil/error.h>
+}
+
+ReadAheadReader::ReadAheadReader(const QString &filePath, int blockSize, const std::atomic<bool> *stopFlag)
+    : filePath(filePath)
+    , blockSize(qMax(blockSize, MinBlockSize))
+    , stopFlag(stopFlag)
+    , fileSize(0)
+    , readPosition(0)
+    , fetchPosition(0)
+    , epoch(0)
+    , failed(false)
+    , quit(false)
+    , fetchThread(nullptr)
+{
+}
+
+ReadAheadReader::~ReadAheadReader()
+{
+    if (fetchThread) {
+        {
+            QMutexLocker locker(&mutex);
+            quit = true;
+            blockFree.wakeAll();
+        }
+        fetchThread->wait();
+        delete fetchThread;
+    }
+}
+
+bool ReadAheadReader::open()
+{
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        qCDebug(lcIo) << "Read-ahead could not open" << filePath << file.errorString();
+        return false;
+    }
+    fileSize = file.size();
+
+#if defined(Q_OS_UNIX) && !defined(Q_OS_DARWIN)
+    // Let the kernel use its large sequential read-ahead window as well
+    posix_fadvise(file.handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    for (Block &block : blocks) {
+        block.data.resize(blockSize);
+    }
+
+    fetchThread = QThread::create([this]() { fetchLoop(); });
+    fetchThread->start();
+    return true;
+}
+
+void ReadAheadReader::fetchLoop()
+{
+    QMutexLocker locker(&mutex);
+    while (!quit) {
+        const int free = findBlock(-1, BlockState::Empty);
+        if (free < 0 || fetchPosition >= fileSize || failed) {
+            blockFree.wait(&mutex);
+            continue;
+        }
+
+        Block &block = blocks[free];
+        const qint64 offset = fetchPosition;
+        const quint64 fillEpoch = epoch;
+        block.state = BlockState::Filling;
+        block.offset = offset;
+        fetchPosition += blockSize;
+
+        // Read without the lock, so the reader keeps consuming the other block
+        locker.unlock();
+        qint64 length = -1;
+        if (file.seek(offset)) {
+            length = file.read(block.data.data(), qMin<qint64>(blockSize, fileSize - offset));
+        }
+        locker.relock();
+
+        if (fillEpoch != epoch) {
+            // The reader moved elsewhere while this block was read
+            block.state = BlockState::Empty;
+            continue;
+        }
+        if (length < 0) {
+            qCDebug(lcIo) << "Read-ahead failed at" << offset << file.errorString();
+            failed = true;
+            block.state = BlockState::Empty;
+        } else {
+            block.length = static_cast<int>(length);
+            block.state = BlockState::Ready;
+        }
+        blockReady.wakeAll();
+    }
+}
+
+int ReadAheadReader::findBlock(qint64 position, BlockState state) const
+{
+    for (int i = 0; i < 2; ++i) {
+        const Block &block = blocks[i];
+        if (block.state != state) {
+            continue;
+        }
+        if (position < 0) {
+            return i;
+        }
+        const qint64 end = block.offset + (state == BlockState::Ready ? block.length : blockSize);
+        if (position >= block.offset && position < end) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void ReadAheadReader::restartAt(qint64 position)
+{
+    ++epoch;
+    for (Block &block : blocks) {
+        if (block.state == BlockState::Ready) {
+            block.state = BlockState::Empty;
+        }
+    }
+    fetchPosition = position;
+    blockFree.wakeAll();
+}
+
+int ReadAheadReader::read(uchar *data, int maxSize)
+{
+    QMutexLocker locker(&mutex);
+    while (true) {
+        if (isStopped() || failed) {
+            return -1;
+        }
+        if (readPosition >= fileSize || maxSize <= 0) {
+            return 0;
+        }
+
+        const int ready = findBlock(readPosition, BlockState::Ready);
+        if (ready >= 0) {
+            const Block &block = blocks[ready];
+            const int offset = static_cast<int>(readPosition - block.offset);
+            const int count = qMin(maxSize, block.length - offset);
+            memcpy(data, block.data.constData() + offset, count);
+            readPosition += count;
+
+            // Once the reader is in the newer block the older one can be refilled
+            Block &other = blocks[1 - ready];
+            if (other.state == BlockState::Ready && other.offset < block.offset) {
+                other.state = BlockState::Empty;
+                blockFree.wakeAll();
+            }
+            return count;
+        }
+
+        // Wait if the position is being fetched or is fetched next, otherwise start over there
+        const bool filling = findBlock(readPosition, BlockState::Filling) >= 0;
+        const bool next = readPosition >= fetchPosition && readPosition < fetchPosition + blockSize
+                          && findBlock(-1, BlockState::Empty) >= 0;
+        if (!filling && !next) {
+            restartAt(readPosition);
+        }
+        blockReady.wait(&mutex, 100);
+    }
+}
+
+bool ReadAheadReader::seek(qint64 position)
+{
+    if (position < 0 || position > fileSize) {
+        return false;
+    }
+    readPosition = position;
+    return true;
+}
+
+AVIOContext *ReadAheadReader::createIOContext()
+{
+    unsigned char *buffer = static_cast<unsigned char *>(av_malloc(IoBufferSize));
+    if (!buffer) {
+        return nullptr;
+    }
+    AVIOContext *context = avio_alloc_context(buffer, IoBufferSize, 0, this,
+                                              &ReadAheadReader::readPacket, nullptr,
+                                              &ReadAheadReader::seekPacket);
+    if (!context) {
+        av_free(buffer);
+    }
+    return context;
+}
+
+void ReadAheadReader::freeIOContext(AVIOContext **context)
+{
+    if (context && *context) {
+        av_freep(&(*context)->buffer);
+        avio_context_free(context);
+    }
+}
+
+int ReadAheadReader::readPacket(void *opaque, uint8_t *buffer, int size)
+{
+    ReadAheadReader *self = static_cast<ReadAheadReader *>(opaque);
+    const int count = self->read(buffer, size);
+    if (count > 0) {
+        return count;
+    }
+    if (count == 0) {
+        return AVERROR_EOF;
+    }
+    return self->isStopped() ? AVERROR_EXIT : AVERROR(EIO);
+}
+
+int64_t ReadAheadReader::seekPacket(void *opaque, int64_t offset, int whence)
+{
+    ReadAheadReader *self = static_cast<ReadAheadReader *>(opaque);
+    if (whence & AVSEEK_SIZE) {
+        return self->size();
+    }
+
+    qint64 target;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET: target = offset; break;
+        case SEEK_CUR: target = self->position() + offset; break;
+        case SEEK_END: target = self->size() + offset; break;
+        default: return AVERROR(EINVAL);
+    }
+    return self->seek(target) ? target : AVERROR(EINVAL);
+}
@@ -0,0 +1,119 @@
+#ifndef READAHEADREADER_H
+#define READAHEADREADER_H
+
+#include <QString>
+#include <QFile>
+#include <QByteArray>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <cstdint>
+
+// Forward declarations
+struct AVIOContext;
+class QThread;
+
+/**
+ * @brief The ReadAheadReader class feeds the demuxer from large blocks read on a background thread
+ *
+ * The file is read in blocks of a configurable size (8 MiB by default) into two
+ * buffers. While the demuxer consumes one block, a fetch thread reads the next one
+ * into the other, so disk or network latency overlaps with parsing and the demuxer's
+ * small reads become memcpy calls. Seeks inside the buffered blocks are free; a seek
+ * elsewhere discards them and restarts the read-ahead at the new position.
+ *
+ * The reader is consumed through a custom AVIOContext from createIOContext(); all
+ * read() and seek() calls must come from one thread.
+ */
+class ReadAheadReader
+{
+public:
+    static constexpr int DefaultBlockSize = 8 << 20;   ///< Bytes per read-ahead block
+    static constexpr int MinBlockSize = 64 << 10;       ///< Smallest block size accepted
+    static constexpr int IoBufferSize = 256 << 10;      ///< Size of the AVIOContext buffer
+
+    /**
+     * @brief Create a reader for a file
+     * @param filePath The file to read
+     * @param blockSize Bytes per read-ahead block
+     * @param stopFlag Polled while waiting for data; reads fail once it becomes true
+     */
+    ReadAheadReader(const QString &filePath, int blockSize, const std::atomic<bool> *stopFlag);
+    ~ReadAheadReader();
+
+    ReadAheadReader(const ReadAheadReader &) = delete;
+    ReadAheadReader &operator=(const ReadAheadReader &) = delete;
+
+    /**
+     * @brief Open the file and start the fetch thread
+     * @return bool False if the file cannot be opened
+     */
+    bool open();
+
+    /**
+     * @brief Copy bytes at the current position
+     * @return int The number of bytes copied, 0 at the end of the file, or -1 on error or stop
+     */
+    int read(uchar *data, int maxSize);
+
+    /**
+     * @brief Move the current position; buffered data is kept
+     * @return bool False if the position is outside the file
+     */
+    bool seek(qint64 position);
+
+    qint64 position() const { return readPosition; }
+    qint64 size() const { return fileSize; }
+    bool isStopped() const { return stopFlag && stopFlag->load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Create an AVIOContext that reads through this reader
+     * @return AVIOContext* The context, or nullptr on allocation failure; free it with freeIOContext()
+     */
+    AVIOContext *createIOContext();
+
+    /**
+     * @brief Free a context made by createIOContext() and its buffer
+     */
+    static void freeIOContext(AVIOContext **context);
+
+private:
+    enum class BlockState {
+        Empty,      ///< Free for the fetch thread
+        Filling,    ///< Being read by the fetch thread
+        Ready       ///< Holds data for the reader
+    };
+
+    struct Block {
+        QByteArray data;
+        qint64 offset = 0;
+        int length = 0;
+        BlockState state = BlockState::Empty;
+    };
+
+    QString filePath;
+    int blockSize;
+    const std::atomic<bool> *stopFlag;
+    QFile file;                ///< Only used by the fetch thread once started
+    qint64 fileSize;
+    qint64 readPosition;       ///< Reader's position
+
+    QMutex mutex;
+    QWaitCondition blockReady;
+    QWaitCondition blockFree;
+    Block blocks[2];
+    qint64 fetchPosition;      ///< Offset of the next block to fetch
+    quint64 epoch;             ///< Bumped when the read-ahead restarts, so stale fills are dropped
+    bool failed;
+    bool quit;
+    QThread *fetchThread;
+
+    void fetchLoop();
+    int findBlock(qint64 position, BlockState state) const;
+    void restartAt(qint64 position);
+
+    static int readPacket(void *opaque, uint8_t *buffer, int size);
+    static int64_t seekPacket(void *opaque, int64_t offset, int whence);
+};
+
+#endif // READAHEADREADER_H
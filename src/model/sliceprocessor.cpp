@@ -1,124 +1,82 @@
 #include "sliceprocessor.h"
-#include "mediafilemanager.h"
+#include "common/logging.h"
 #include <QDebug>
-#include <QThread>
+#include <limits>
 
 SliceProcessor::SliceProcessor(QObject *parent)
     : QObject(parent)
-    , running(false)
-    , batchSize(50) // Default batch size
+    , ring(RingCapacity)
 {
-    qDebug() << "SliceProcessor created";
+    qCDebug(lcSlices) << "SliceProcessor created";
 }
 
 SliceProcessor::~SliceProcessor()
 {
     stop();
-    qDebug() << "SliceProcessor destroyed";
+    qCDebug(lcSlices) << "SliceProcessor destroyed";
 }
 
 void SliceProcessor::start()
 {
-    QMutexLocker locker(&mutex);
-    running = true;
-    qDebug() << "SliceProcessor started";
+    ring.reopen();
+    qCDebug(lcSlices) << "SliceProcessor started";
 }
 
 void SliceProcessor::stop()
 {
-    QMutexLocker locker(&mutex);
-    running = false;
-    condition.wakeAll(); // Wake up any waiting threads
-    qDebug() << "SliceProcessor stopped";
+    ring.close(); // Wakes the processor and a parser blocked on a full ring
+    qCDebug(lcSlices) << "SliceProcessor stopped";
 }
 
-void SliceProcessor::queueSlices(const QList<SliceInfo> &slices)
+bool SliceProcessor::publish(const PacketRange &range)
 {
-    if (slices.isEmpty()) {
-        return;
+    if (range.count <= 0) {
+        return true;
     }
-    
-    QMutexLocker locker(&mutex);
-    
-    // Add all slices to the queue
-    for (const SliceInfo &slice : slices) {
-        sliceQueue.enqueue(slice);
-    }
-    
-    qDebug() << "Added" << slices.size() << "slices to processing queue, total:" << sliceQueue.size();
-    
-    // Signal that there are slices to process
-    condition.wakeOne();
+    return ring.push(range);
 }
 
-void SliceProcessor::clearSlices()
+bool SliceProcessor::finish(quint32 generation)
 {
-    QMutexLocker locker(&mutex);
-    sliceQueue.clear();
-    processedSlices.clear();
-    qDebug() << "Cleared all slices from processor";
+    return ring.push({ generation, 0, 0 });
 }
 
 bool SliceProcessor::isRunning() const
 {
-    return running;
-}
-
-void SliceProcessor::setBatchSize(int size)
-{
-    if (size > 0) {
-        QMutexLocker locker(&mutex);
-        batchSize = size;
-        qDebug() << "Slice batch size set to" << batchSize;
-    }
+    return !ring.isClosed();
 }
 
 void SliceProcessor::process()
 {
-    qDebug() << "SliceProcessor process thread started";
+    qCDebug(lcSlices) << "SliceProcessor process thread started";
     
-    while (true) {
-        QList<SliceInfo> batch;
-        
-        {
-            QMutexLocker locker(&mutex);
-            
-            // Wait until there are slices to process or we're told to stop
-            while (sliceQueue.isEmpty() && running) {
-                condition.wait(&mutex);
+    PacketRange ranges[DrainSize];
+    size_t drained;
+    while ((drained = ring.pop(ranges, DrainSize)) > 0) {
+        // Merge adjacent ranges of the same job; the parser appends rows in order. An end
+        // mark flushes the rows before it, so the job's last rows arrive before its end.
+        PacketRange merged;
+        for (size_t i = 0; i < drained; ++i) {
+            const PacketRange &range = ranges[i];
+            if (merged.count > 0 && range.count > 0
+                && range.generation == merged.generation
+                && range.firstIndex == merged.firstIndex + merged.count
+                && range.count <= std::numeric_limits<int>::max() - merged.count) {
+                merged.count += range.count;
+                continue;
             }
-            
-            // Check if we should exit
-            if (!running && sliceQueue.isEmpty()) {
-                break;
+            if (merged.count > 0) {
+                emit slicesBatchProcessed(merged.generation, merged.firstIndex, merged.count);
             }
-            
-            // Process a batch of slices
-            int count = qMin(batchSize, sliceQueue.size());
-            for (int i = 0; i < count; ++i) {
-                if (!sliceQueue.isEmpty()) {
-                    SliceInfo slice = sliceQueue.dequeue();
-                    batch.append(slice);
-                    processedSlices.append(slice);
-                }
+            merged = range;
+            if (range.count == 0) {
+                emit processingFinished(range.generation);
             }
         }
-        
-        if (!batch.isEmpty()) {
-            // Emit signal with the batch of processed slices
-            emit slicesBatchProcessed(batch);
-            
-            qDebug() << "Processed batch of" << batch.size() << "slices, remaining:" << sliceQueue.size();
-            
-            // Small delay to allow UI to update
-            QThread::msleep(10);
-        }
-        
-        // Check if we've processed all slices
-        if (sliceQueue.isEmpty()) {
-            emit processingFinished();
+        if (merged.count > 0) {
+            emit slicesBatchProcessed(merged.generation, merged.firstIndex, merged.count);
         }
     }
     
-    qDebug() << "SliceProcessor process thread finished";
-} 
\ No newline at end of file
+    qCDebug(lcSlices) << "SliceProcessor process thread finished";
+}
@@ -2,19 +2,26 @@
 #define SLICEPROCESSOR_H
 
 #include <QObject>
-#include <QList>
-#include <QMutex>
-#include <QWaitCondition>
-#include <QQueue>
+#include "common/spscring.h"
 
-// Forward declarations
-struct SliceInfo;
+/**
+ * @brief A range of packet table rows published by the parser
+ */
+struct PacketRange {
+    quint32 generation = 0;       ///< Parse job the rows belong to
+    qint64 firstIndex = 0;        ///< First packet table row
+    int count = 0;                ///< Number of rows; 0 marks the end of the job
+};
 
 /**
  * @brief The SliceProcessor class handles slice processing in a background thread
  * 
- * This class processes slices in a separate thread to keep the UI responsive.
- * It batches slices and emits signals when batches are ready for the UI to display.
+ * The parser thread publishes the ranges of rows it appended to the shared PacketTable
+ * into a bounded lock-free single-producer/single-consumer ring; slices themselves are
+ * never copied. The processor drains every range available at once, merges adjacent
+ * ranges of the same job and emits one signal per merged range, so the views see rows
+ * as fast as the demuxer produces them. A full ring blocks the parser until the
+ * processor catches up.
  */
 class SliceProcessor : public QObject
 {
@@ -43,53 +50,54 @@ public:
     void stop();
     
     /**
-     * @brief Queue slices for processing
-     * @param slices The slices to process
+     * @brief Publish a range of packet table rows (called from the parser thread only)
+     * @param range The rows appended to the table
+     * @return bool False if the processor was stopped
      */
-    void queueSlices(const QList<SliceInfo> &slices);
+    bool publish(const PacketRange &range);
     
     /**
-     * @brief Clear all queued and processed slices
+     * @brief Mark the end of a job's ranges (called from the parser thread only)
+     *
+     * processingFinished() is emitted for the job once every range published before
+     * the mark has been delivered.
+     * @param generation The parse job that finished
+     * @return bool False if the processor was stopped
      */
-    void clearSlices();
+    bool finish(quint32 generation);
     
     /**
      * @brief Check if the processor is running
      * @return bool True if running
      */
     bool isRunning() const;
-    
-    /**
-     * @brief Set the batch size for processing
-     * @param size The number of slices to process in each batch
-     */
-    void setBatchSize(int size);
 
 signals:
     /**
-     * @brief Signal emitted when a batch of slices is processed
-     * @param slices The processed slice batch
+     * @brief Signal emitted when a range of slices is processed
+     * @param generation The parse job the rows belong to
+     * @param firstIndex The first packet table row of the range
+     * @param count The number of rows in the range
      */
-    void slicesBatchProcessed(const QList<SliceInfo> &slices);
+    void slicesBatchProcessed(quint32 generation, qint64 firstIndex, int count);
     
     /**
-     * @brief Signal emitted when all queued slices are processed
+     * @brief Signal emitted when every range of a finished job has been delivered
+     * @param generation The parse job that finished
      */
-    void processingFinished();
+    void processingFinished(quint32 generation);
 
 public slots:
     /**
-     * @brief Process slices in the queue
+     * @brief Process published ranges until the processor is stopped
      */
     void process();
 
 private:
-    QMutex mutex;                  ///< Mutex for thread safety
-    QWaitCondition condition;      ///< Wait condition for thread synchronization
-    QQueue<SliceInfo> sliceQueue;  ///< Queue of slices to process
-    QList<SliceInfo> processedSlices; ///< List of already processed slices
-    bool running;                  ///< Running flag
-    int batchSize;                 ///< Number of slices to process in each batch
+    static const int RingCapacity = 1024;     ///< Ranges in flight before the parser blocks
+    static const int DrainSize = 256;         ///< Ranges taken off the ring at once
+    
+    SpscRing<PacketRange> ring;               ///< Ranges published by the parser thread
 };
 
-#endif // SLICEPROCESSOR_H 
\ No newline at end of file
+#endif // SLICEPROCESSOR_H
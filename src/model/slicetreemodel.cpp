@@ -1,87 +1,144 @@
 #include "slicetreemodel.h"
-#include "mediafilemanager.h"
+#include "common/logging.h"
 #include <QStringList>
 #include <QDebug>
 
-// SliceTreeItem implementation
-SliceTreeItem::SliceTreeItem(const QString &name, const QString &value, SliceTreeItem *parent)
-    : m_name(name), m_value(value), m_parentItem(parent)
+namespace {
+
+// Node id layout: | kind (3) | stream slot (16) | slice row (32) | header field (5) | property (8) |
+// The property part holds the NAL unit of NAL and header field nodes
+static_assert(sizeof(quintptr) >= 8, "SliceTreeModel node ids require 64-bit quintptr");
+
+constexpr int kPropertyBits = 8;
+constexpr int kFieldBits = 5;
+constexpr int kRowBits = 32;
+constexpr int kSlotBits = 16;
+constexpr int kFieldShift = kPropertyBits;
+constexpr int kRowShift = kFieldShift + kFieldBits;
+constexpr int kSlotShift = kRowShift + kRowBits;
+constexpr int kKindShift = kSlotShift + kSlotBits;
+constexpr quint64 kPropertyMask = (quint64(1) << kPropertyBits) - 1;
+constexpr quint64 kFieldMask = (quint64(1) << kFieldBits) - 1;
+constexpr quint64 kRowMask = (quint64(1) << kRowBits) - 1;
+constexpr quint64 kSlotMask = (quint64(1) << kSlotBits) - 1;
+
+// Property rows shown for every slice
+enum SliceProperty {
+    StreamIndexProperty = 0,
+    StreamTypeProperty,
+    PtsProperty,
+    DtsProperty,
+    DurationProperty,
+    SizeProperty,
+    KeyFrameProperty,
+    PositionProperty,
+    SlicePropertyCount,
+    NalUnitsProperty = SlicePropertyCount   ///< Shown only for slices split into NAL units
+};
+
+// Units listed under a slice, bounded by the property bits of the node id
+constexpr int kMaxListedNalUnits = int(kPropertyMask) + 1;
+
+// Header fields shown under NAL units with a parsed slice header
+enum HeaderField {
+    SliceTypeField = 0,
+    FirstMbField,
+    SegmentAddressField,
+    DependentField,
+    FrameNumField,
+    PocField,
+    QpField,
+    QpDeltaField,
+    RefIdxL0Field,
+    RefIdxL1Field,
+    PpsIdField,
+    PictureStructureField,
+    ShortTermRpsField,
+    LongTermRefsField,
+    TilesField,
+    EntryPointsField,
+    HeaderFieldCount
+};
+static_assert(HeaderFieldCount <= int(kFieldMask) + 1, "Header fields must fit the field bits of the node id");
+
+// Header field rows of each codec, in display order
+constexpr HeaderField kH264Fields[] = {
+    SliceTypeField, FirstMbField, FrameNumField, PocField, QpField, QpDeltaField,
+    RefIdxL0Field, RefIdxL1Field, PpsIdField, PictureStructureField
+};
+constexpr HeaderField kHevcFields[] = {
+    SliceTypeField, SegmentAddressField, DependentField, PocField, QpField, QpDeltaField,
+    RefIdxL0Field, RefIdxL1Field, PpsIdField, ShortTermRpsField, LongTermRefsField, TilesField, EntryPointsField
+};
+
+int headerFieldCount(NalCodec codec)
 {
-    if (parent) {
-        parent->appendChild(this);
-    }
-}
-
-SliceTreeItem::~SliceTreeItem()
-{
-    qDeleteAll(m_childItems);
+    return codec == NalCodec::Hevc ? int(sizeof(kHevcFields) / sizeof(kHevcFields[0]))
+                                   : int(sizeof(kH264Fields) / sizeof(kH264Fields[0]));
 }
 
-void SliceTreeItem::appendChild(SliceTreeItem *child)
+HeaderField headerField(NalCodec codec, int row)
 {
-    m_childItems.append(child);
+    return codec == NalCodec::Hevc ? kHevcFields[row] : kH264Fields[row];
 }
 
-SliceTreeItem *SliceTreeItem::child(int row)
+QString sliceTypeName(int sliceType)
 {
-    if (row < 0 || row >= m_childItems.size()) {
-        return nullptr;
+    switch (sliceType) {
+        case 0: return QString("P");
+        case 1: return QString("B");
+        case 2: return QString("I");
+        case 3: return QString("SP");
+        case 4: return QString("SI");
+        default: return QString("Unknown");
     }
-    return m_childItems.at(row);
 }
 
-int SliceTreeItem::childCount() const
+} // namespace
+
+SliceTreeModel::SliceTreeModel(QObject *parent)
+    : QAbstractItemModel(parent)
+    , sliceCount(0)
+    , estimated(false)
 {
-    return m_childItems.count();
 }
 
-int SliceTreeItem::columnCount() const
+SliceTreeModel::~SliceTreeModel()
 {
-    return 2; // Property and Value columns
 }
 
-QVariant SliceTreeItem::data(int column) const
+quintptr SliceTreeModel::makeNodeId(NodeKind kind, int slot, qint64 row, int property, int field)
 {
-    switch (column) {
-        case 0: return m_name;
-        case 1: return m_value;
-        default: return QVariant();
-    }
+    return static_cast<quintptr>((quint64(kind) << kKindShift)
+                                 | ((quint64(slot) & kSlotMask) << kSlotShift)
+                                 | ((quint64(row) & kRowMask) << kRowShift)
+                                 | ((quint64(field) & kFieldMask) << kFieldShift)
+                                 | (quint64(property) & kPropertyMask));
 }
 
-int SliceTreeItem::row() const
+SliceTreeModel::NodeKind SliceTreeModel::nodeKind(quintptr id)
 {
-    if (m_parentItem) {
-        return m_parentItem->m_childItems.indexOf(const_cast<SliceTreeItem*>(this));
-    }
-    return 0;
+    return static_cast<NodeKind>(quint64(id) >> kKindShift);
 }
 
-SliceTreeItem *SliceTreeItem::parentItem()
+int SliceTreeModel::nodeSlot(quintptr id)
 {
-    return m_parentItem;
+    return static_cast<int>((quint64(id) >> kSlotShift) & kSlotMask);
 }
 
-void SliceTreeItem::setData(const QString &name, const QVariant &value)
+qint64 SliceTreeModel::nodeRow(quintptr id)
 {
-    m_name = name;
-    m_value = value;
+    return static_cast<qint64>((quint64(id) >> kRowShift) & kRowMask);
 }
 
-// SliceTreeModel implementation
-SliceTreeModel::SliceTreeModel(QObject *parent)
-    : QAbstractItemModel(parent)
-    , videoSliceCount(0)
-    , audioSliceCount(0)
-    , otherSliceCount(0)
+int SliceTreeModel::nodeProperty(quintptr id)
 {
-    rootItem = new SliceTreeItem("Root");
-    setupModelData();
+    return static_cast<int>(quint64(id) & kPropertyMask);
 }
 
-SliceTreeModel::~SliceTreeModel()
+int SliceTreeModel::nodeField(quintptr id)
 {
-    delete rootItem;
+    return static_cast<int>((quint64(id) >> kFieldShift) & kFieldMask);
 }
 
 QVariant SliceTreeModel::data(const QModelIndex &index, int role) const
@@ -90,8 +147,75 @@ QVariant SliceTreeModel::data(const QModelIndex &index, int role) const
         return QVariant();
     }
 
-    SliceTreeItem *item = static_cast<SliceTreeItem*>(index.internalPointer());
-    return item->data(index.column());
+    const quintptr id = index.internalId();
+    const int column = index.column();
+
+    switch (nodeKind(id)) {
+        case PlaceholderNode:
+            return column == 0 ? QVariant(QString("No slices available")) : QVariant(QString());
+
+        case CategoryNode: {
+            const int category = nodeSlot(id);
+            if (column == 0) {
+                return categoryName(category);
+            }
+            const int count = categorySliceCount(category);
+            if (count == 0) {
+                return QString("None");
+            }
+            return estimated ? QString("%1 sampled").arg(count) : QString::number(count);
+        }
+
+        case StreamNode: {
+            const StreamEntry &stream = streams.at(nodeSlot(id));
+            if (column == 0) {
+                return QString("Stream %1").arg(stream.streamIndex);
+            }
+            return streamTypeName(stream.streamType);
+        }
+
+        case SliceNode: {
+            const StreamEntry &stream = streams.at(nodeSlot(id));
+            const SliceInfo slice = packetTable->at(stream.sliceRows.at(static_cast<int>(nodeRow(id))));
+            if (column == 0) {
+                return QString(estimated ? "Sampled slice at PTS %1" : "Slice at PTS %1").arg(formatTimestamp(slice.pts));
+            }
+            return QString(slice.isKeyFrame ? "Key Frame" : "Regular Frame");
+        }
+
+        case PropertyNode: {
+            const StreamEntry &stream = streams.at(nodeSlot(id));
+            const qint64 packet = stream.sliceRows.at(static_cast<int>(nodeRow(id)));
+            if (nodeProperty(id) == NalUnitsProperty) {
+                if (column == 0) {
+                    return QString("NAL Units");
+                }
+                qint64 first;
+                const int units = nalUnitsOf(packet, first);
+                return units > kMaxListedNalUnits ? QString("%1 units, first %2 listed").arg(units).arg(kMaxListedNalUnits)
+                                                  : QString("%1 units").arg(units);
+            }
+            return propertyData(packetTable->at(packet), nodeProperty(id), column);
+        }
+
+        case NalNode: {
+            const StreamEntry &stream = streams.at(nodeSlot(id));
+            qint64 first;
+            nalUnitsOf(stream.sliceRows.at(static_cast<int>(nodeRow(id))), first);
+            return nalData(first + nodeProperty(id), nodeProperty(id), column);
+        }
+
+        case HeaderFieldNode: {
+            const StreamEntry &stream = streams.at(nodeSlot(id));
+            qint64 first;
+            nalUnitsOf(stream.sliceRows.at(static_cast<int>(nodeRow(id))), first);
+            const NalIndex &nals = packetTable->nalUnits();
+            const qint64 nal = first + nodeProperty(id);
+            return headerFieldData(nals.sliceHeader(nal), headerField(nals.codec(nal), nodeField(id)), column);
+        }
+    }
+
+    return QVariant();
 }
 
 Qt::ItemFlags SliceTreeModel::flags(const QModelIndex &index) const
@@ -109,18 +233,31 @@ QModelIndex SliceTreeModel::index(int row, int column, const QModelIndex &parent
         return QModelIndex();
     }
 
-    SliceTreeItem *parentItem;
     if (!parent.isValid()) {
-        parentItem = rootItem;
-    } else {
-        parentItem = static_cast<SliceTreeItem*>(parent.internalPointer());
+        if (sliceCount == 0) {
+            return createIndex(row, column, makeNodeId(PlaceholderNode));
+        }
+        return createIndex(row, column, makeNodeId(CategoryNode, row));
     }
 
-    SliceTreeItem *childItem = parentItem->child(row);
-    if (childItem) {
-        return createIndex(row, column, childItem);
+    const quintptr parentId = parent.internalId();
+    switch (nodeKind(parentId)) {
+        case CategoryNode: {
+            const int slot = categoryStreams[nodeSlot(parentId)].at(row);
+            return createIndex(row, column, makeNodeId(StreamNode, slot));
+        }
+        case StreamNode:
+            return createIndex(row, column, makeNodeId(SliceNode, nodeSlot(parentId), row));
+        case SliceNode:
+            return createIndex(row, column, makeNodeId(PropertyNode, nodeSlot(parentId), nodeRow(parentId), row));
+        case PropertyNode:
+            return createIndex(row, column, makeNodeId(NalNode, nodeSlot(parentId), nodeRow(parentId), row));
+        case NalNode:
+            return createIndex(row, column, makeNodeId(HeaderFieldNode, nodeSlot(parentId), nodeRow(parentId),
+                                                       nodeProperty(parentId), row));
+        default:
+            return QModelIndex();
     }
-    return QModelIndex();
 }
 
 QModelIndex SliceTreeModel::parent(const QModelIndex &index) const
@@ -129,14 +266,27 @@ QModelIndex SliceTreeModel::parent(const QModelIndex &index) const
         return QModelIndex();
     }
 
-    SliceTreeItem *childItem = static_cast<SliceTreeItem*>(index.internalPointer());
-    SliceTreeItem *parentItem = childItem->parentItem();
-
-    if (parentItem == rootItem) {
-        return QModelIndex();
+    const quintptr id = index.internalId();
+    switch (nodeKind(id)) {
+        case StreamNode: {
+            const StreamEntry &stream = streams.at(nodeSlot(id));
+            return createIndex(stream.category, 0, makeNodeId(CategoryNode, stream.category));
+        }
+        case SliceNode: {
+            const int slot = nodeSlot(id);
+            return createIndex(streams.at(slot).rowInCategory, 0, makeNodeId(StreamNode, slot));
+        }
+        case PropertyNode: {
+            const qint64 row = nodeRow(id);
+            return createIndex(static_cast<int>(row), 0, makeNodeId(SliceNode, nodeSlot(id), row));
+        }
+        case NalNode:
+            return createIndex(NalUnitsProperty, 0, makeNodeId(PropertyNode, nodeSlot(id), nodeRow(id), NalUnitsProperty));
+        case HeaderFieldNode:
+            return createIndex(nodeProperty(id), 0, makeNodeId(NalNode, nodeSlot(id), nodeRow(id), nodeProperty(id)));
+        default:
+            return QModelIndex();
     }
-
-    return createIndex(parentItem->row(), 0, parentItem);
 }
 
 int SliceTreeModel::rowCount(const QModelIndex &parent) const
@@ -145,14 +295,40 @@ int SliceTreeModel::rowCount(const QModelIndex &parent) const
         return 0;
     }
 
-    SliceTreeItem *parentItem;
     if (!parent.isValid()) {
-        parentItem = rootItem;
-    } else {
-        parentItem = static_cast<SliceTreeItem*>(parent.internalPointer());
+        return sliceCount == 0 ? 1 : CategoryCount;
     }
 
-    return parentItem->childCount();
+    const quintptr id = parent.internalId();
+    switch (nodeKind(id)) {
+        case CategoryNode:
+            return categoryStreams[nodeSlot(id)].size();
+        case StreamNode:
+            return streams.at(nodeSlot(id)).sliceRows.size();
+        case SliceNode: {
+            qint64 first;
+            const qint64 packet = streams.at(nodeSlot(id)).sliceRows.at(static_cast<int>(nodeRow(id)));
+            return nalUnitsOf(packet, first) > 0 ? SlicePropertyCount + 1 : SlicePropertyCount;
+        }
+        case PropertyNode: {
+            if (nodeProperty(id) != NalUnitsProperty) {
+                return 0;
+            }
+            qint64 first;
+            const qint64 packet = streams.at(nodeSlot(id)).sliceRows.at(static_cast<int>(nodeRow(id)));
+            return qMin(nalUnitsOf(packet, first), kMaxListedNalUnits);
+        }
+        case NalNode: {
+            qint64 first;
+            const qint64 packet = streams.at(nodeSlot(id)).sliceRows.at(static_cast<int>(nodeRow(id)));
+            nalUnitsOf(packet, first);
+            const NalIndex &nals = packetTable->nalUnits();
+            const qint64 nal = first + nodeProperty(id);
+            return nals.sliceHeader(nal).isValid() ? headerFieldCount(nals.codec(nal)) : 0;
+        }
+        default:
+            return 0;
+    }
 }
 
 int SliceTreeModel::columnCount(const QModelIndex &parent) const
@@ -172,157 +348,274 @@ QVariant SliceTreeModel::headerData(int section, Qt::Orientation orientation, in
     return QVariant();
 }
 
-void SliceTreeModel::updateSliceData(const QList<SliceInfo> &slices)
+void SliceTreeModel::setPacketTable(const QSharedPointer<const PacketTable> &table, bool estimated)
 {
-    // Replace all existing slices with the new ones
-    accumulatedSlices.clear();
-    accumulatedSlices = slices;
-    
-    // Rebuild the tree with the new slices
-    rebuildTreeFromSlices();
-    
-    qDebug() << "Updated slice tree model with" << slices.size() << "slices (replacing all)";
+    // Replace all existing slices; rows are added through appendPackets()
+    clearSliceData();
+    packetTable = table;
+    this->estimated = estimated;
 }
 
-void SliceTreeModel::appendSliceData(const QList<SliceInfo> &slices)
+void SliceTreeModel::appendPackets(qint64 firstIndex, int count)
 {
-    if (slices.isEmpty()) {
+    if (!packetTable || count <= 0) {
+        return;
+    }
+
+    // Ignore ranges that do not continue the rows already shown (stale or duplicate batches)
+    if (firstIndex != sliceCount || firstIndex + count > packetTable->size()) {
+        qCDebug(lcSlices) << "Ignoring packet range" << firstIndex << "+" << count << "at slice count" << sliceCount;
+        return;
+    }
+
+    // The first slices replace the placeholder row with the category rows
+    const bool wasEmpty = sliceCount == 0;
+    if (wasEmpty) {
+        beginResetModel();
+    }
+
+    const int firstNewRow = sliceCount;
+    sliceCount += count;
+
+    // Insert stream containers seen for the first time, then group the new rows by stream
+    QHash<int, QVector<quint32>> newRowsBySlot;
+    for (int row = firstNewRow; row < sliceCount; ++row) {
+        const int slot = streamSlotFor(row, !wasEmpty);
+        if (wasEmpty) {
+            streams[slot].sliceRows.append(static_cast<quint32>(row));
+        } else {
+            newRowsBySlot[slot].append(static_cast<quint32>(row));
+        }
+    }
+
+    if (wasEmpty) {
+        endResetModel();
+        LG_TRACE(lcSlices) << "Appended" << count << "slices to slice tree model, total:" << sliceCount;
         return;
     }
-    
-    // Append new slices to the accumulated list
-    accumulatedSlices.append(slices);
-    
-    // Rebuild the tree with all slices
-    rebuildTreeFromSlices();
-    
-    qDebug() << "Appended" << slices.size() << "slices to slice tree model, total:" << accumulatedSlices.size();
+
+    // Insert only the new slice rows under each affected stream
+    bool categoryTouched[CategoryCount] = { false, false, false };
+    for (auto it = newRowsBySlot.constBegin(); it != newRowsBySlot.constEnd(); ++it) {
+        StreamEntry &stream = streams[it.key()];
+        const QModelIndex streamIndex = createIndex(stream.rowInCategory, 0, makeNodeId(StreamNode, it.key()));
+        const int first = stream.sliceRows.size();
+        const int last = first + it.value().size() - 1;
+
+        beginInsertRows(streamIndex, first, last);
+        stream.sliceRows.append(it.value());
+        endInsertRows();
+
+        categoryTouched[stream.category] = true;
+    }
+
+    // Refresh the category slice counts
+    for (int category = 0; category < CategoryCount; ++category) {
+        if (categoryTouched[category]) {
+            const QModelIndex countIndex = createIndex(category, 1, makeNodeId(CategoryNode, category));
+            emit dataChanged(countIndex, countIndex, { Qt::DisplayRole });
+        }
+    }
+
+    LG_TRACE(lcSlices) << "Appended" << count << "slices to slice tree model, total:" << sliceCount;
+}
+
+qint64 SliceTreeModel::packetIndex(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return -1;
+    }
+    const quintptr id = index.internalId();
+    const NodeKind kind = nodeKind(id);
+    if (kind != SliceNode && kind != PropertyNode && kind != NalNode && kind != HeaderFieldNode) {
+        return -1;
+    }
+    return streams.at(nodeSlot(id)).sliceRows.at(static_cast<int>(nodeRow(id)));
 }
 
 void SliceTreeModel::clearSliceData()
 {
     beginResetModel();
-    delete rootItem;
-    rootItem = new SliceTreeItem("Root");
-    setupModelData();
-    streamItems.clear();
-    videoSliceCount = 0;
-    audioSliceCount = 0;
-    otherSliceCount = 0;
-    accumulatedSlices.clear();
+    streams.clear();
+    streamSlots.clear();
+    for (int category = 0; category < CategoryCount; ++category) {
+        categoryStreams[category].clear();
+    }
+    sliceCount = 0;
     endResetModel();
-    
-    qDebug() << "Cleared all slice data";
+
+    qCDebug(lcSlices) << "Cleared all slice data";
 }
 
 int SliceTreeModel::getSliceCount() const
 {
-    return accumulatedSlices.size();
+    return sliceCount;
 }
 
-void SliceTreeModel::rebuildTreeFromSlices()
+int SliceTreeModel::streamSlotFor(qint64 packetIndex, bool notifyView)
 {
-    beginResetModel();
-    
-    // Clear existing tree structure
-    delete rootItem;
-    rootItem = new SliceTreeItem("Root");
-    streamItems.clear();
-    
-    // Reset counters
-    videoSliceCount = 0;
-    audioSliceCount = 0;
-    otherSliceCount = 0;
-    
-    // Create category items
-    SliceTreeItem *videoCategory = new SliceTreeItem("Video Slices", "0", rootItem);
-    SliceTreeItem *audioCategory = new SliceTreeItem("Audio Slices", "0", rootItem);
-    SliceTreeItem *otherCategory = new SliceTreeItem("Other Slices", "0", rootItem);
-    
-    // Process all accumulated slices
-    for (const SliceInfo &slice : accumulatedSlices) {
-        // Get or create stream item
-        SliceTreeItem *streamParent;
-        if (slice.streamType == "video") {
-            streamParent = videoCategory;
-            videoSliceCount++;
-        } else if (slice.streamType == "audio") {
-            streamParent = audioCategory;
-            audioSliceCount++;
-        } else {
-            streamParent = otherCategory;
-            otherSliceCount++;
-        }
-        
-        // Get or create stream-specific container
-        int streamIndex = slice.streamIndex;
-        if (!streamItems.contains(streamIndex)) {
-            QString streamName = QString("Stream %1").arg(streamIndex);
-            streamItems[streamIndex] = new SliceTreeItem(streamName, slice.streamType, streamParent);
-        }
-        
-        // Create slice item
-        QString sliceName = QString("Slice at PTS %1").arg(formatTimestamp(slice.pts));
-        SliceTreeItem *sliceItem = new SliceTreeItem(sliceName, 
-                                                    slice.isKeyFrame ? "Key Frame" : "Regular Frame",
-                                                    streamItems[streamIndex]);
-        
-        // Add slice details
-        createSliceItem(slice, sliceItem);
-    }
-    
-    // Update category counts
-    videoCategory->setData("Video Slices", QString::number(videoSliceCount));
-    audioCategory->setData("Audio Slices", QString::number(audioSliceCount));
-    otherCategory->setData("Other Slices", QString::number(otherSliceCount));
-    
-    // Remove empty categories
-    if (videoSliceCount == 0) {
-        rootItem->child(0)->setData("Video Slices", "None");
-    }
-    if (audioSliceCount == 0) {
-        rootItem->child(1)->setData("Audio Slices", "None");
-    }
-    if (otherSliceCount == 0) {
-        rootItem->child(2)->setData("Other Slices", "None");
-    }
-    
-    endResetModel();
-    
-    qDebug() << "Rebuilt slice tree model with" << accumulatedSlices.size() << "total slices";
-    qDebug() << "  Video slices:" << videoSliceCount;
-    qDebug() << "  Audio slices:" << audioSliceCount;
-    qDebug() << "  Other slices:" << otherSliceCount;
+    const int streamIndex = packetTable->streamIndex(packetIndex);
+    auto it = streamSlots.constFind(streamIndex);
+    if (it != streamSlots.constEnd()) {
+        return it.value();
+    }
+
+    StreamEntry stream;
+    stream.streamIndex = streamIndex;
+    stream.streamType = packetTable->streamType(packetIndex);
+    stream.category = categoryForType(stream.streamType);
+    stream.rowInCategory = categoryStreams[stream.category].size();
+
+    if (notifyView) {
+        const QModelIndex categoryIndex = createIndex(stream.category, 0, makeNodeId(CategoryNode, stream.category));
+        beginInsertRows(categoryIndex, stream.rowInCategory, stream.rowInCategory);
+    }
+    const int slot = streams.size();
+    streams.append(stream);
+    streamSlots.insert(streamIndex, slot);
+    categoryStreams[stream.category].append(slot);
+    if (notifyView) {
+        endInsertRows();
+    }
+    return slot;
+}
+
+int SliceTreeModel::categoryForType(StreamType streamType)
+{
+    switch (streamType) {
+        case StreamType::Video: return VideoCategory;
+        case StreamType::Audio: return AudioCategory;
+        default: return OtherCategory;
+    }
 }
 
-void SliceTreeModel::setupModelData()
+QString SliceTreeModel::categoryName(int category)
 {
-    // Create placeholder data when no file is loaded
-    SliceTreeItem *placeholderItem = new SliceTreeItem("No slices available", "", rootItem);
-    Q_UNUSED(placeholderItem);
+    switch (category) {
+        case VideoCategory: return QString("Video Slices");
+        case AudioCategory: return QString("Audio Slices");
+        default: return QString("Other Slices");
+    }
 }
 
-SliceTreeItem* SliceTreeModel::createSliceItem(const SliceInfo &sliceInfo, SliceTreeItem *parent)
-{
-    addPropertyItem(parent, "Stream Index", QString::number(sliceInfo.streamIndex));
-    addPropertyItem(parent, "Stream Type", sliceInfo.streamType);
-    addPropertyItem(parent, "PTS", formatTimestamp(sliceInfo.pts));
-    addPropertyItem(parent, "DTS", formatTimestamp(sliceInfo.dts));
-    addPropertyItem(parent, "Duration", QString::number(sliceInfo.duration));
-    addPropertyItem(parent, "Size", QString("%1 bytes").arg(sliceInfo.size));
-    addPropertyItem(parent, "Key Frame", sliceInfo.isKeyFrame ? "Yes" : "No");
-    addPropertyItem(parent, "Position", QString("0x%1").arg(sliceInfo.pos, 0, 16));
-    
-    return parent;
+int SliceTreeModel::categorySliceCount(int category) const
+{
+    int count = 0;
+    for (int slot : categoryStreams[category]) {
+        count += streams.at(slot).sliceRows.size();
+    }
+    return count;
 }
 
-void SliceTreeModel::addPropertyItem(SliceTreeItem *parent, const QString &name, const QVariant &value)
+QVariant SliceTreeModel::propertyData(const SliceInfo &sliceInfo, int property, int column) const
 {
-    QString valueStr = value.toString();
+    if (column == 0) {
+        switch (property) {
+            case StreamIndexProperty: return QString("Stream Index");
+            case StreamTypeProperty: return QString("Stream Type");
+            case PtsProperty: return QString("PTS");
+            case DtsProperty: return QString("DTS");
+            case DurationProperty: return QString("Duration");
+            case SizeProperty: return QString("Size");
+            case KeyFrameProperty: return QString("Key Frame");
+            case PositionProperty: return QString("Position");
+            default: return QVariant();
+        }
+    }
+
+    QString valueStr;
+    switch (property) {
+        case StreamIndexProperty: valueStr = QString::number(sliceInfo.streamIndex); break;
+        case StreamTypeProperty: valueStr = streamTypeName(sliceInfo.streamType); break;
+        case PtsProperty: valueStr = formatTimestamp(sliceInfo.pts); break;
+        case DtsProperty: valueStr = formatTimestamp(sliceInfo.dts); break;
+        case DurationProperty: valueStr = QString::number(sliceInfo.duration); break;
+        case SizeProperty: valueStr = QString("%1 bytes").arg(sliceInfo.size); break;
+        case KeyFrameProperty: valueStr = sliceInfo.isKeyFrame ? "Yes" : "No"; break;
+        case PositionProperty: valueStr = QString("0x%1").arg(sliceInfo.pos, 0, 16); break;
+        default: return QVariant();
+    }
+
     if (valueStr.isEmpty()) {
         valueStr = "N/A";
     }
-    new SliceTreeItem(name, valueStr, parent);
+    return valueStr;
+}
+
+int SliceTreeModel::nalUnitsOf(qint64 packetIndex, qint64 &first) const
+{
+    first = 0;
+    if (!packetTable || packetTable->nalUnits().isEmpty()) {
+        return 0;
+    }
+    return packetTable->nalUnits().unitsOf(packetIndex, first);
+}
+
+QVariant SliceTreeModel::nalData(qint64 nalIndex, int unit, int column) const
+{
+    const NalIndex &nals = packetTable->nalUnits();
+    if (column == 0) {
+        return QString("NAL %1: %2").arg(unit).arg(NalScanner::typeName(nals.codec(nalIndex), nals.type(nalIndex)));
+    }
+
+    QString value = QString("%1 bytes at offset %2").arg(nals.unitSize(nalIndex)).arg(nals.offset(nalIndex));
+    if (nals.emulationBytes(nalIndex) > 0) {
+        value += QString(", %1 emulation prevention bytes").arg(nals.emulationBytes(nalIndex));
+    }
+    return value;
+}
+
+QVariant SliceTreeModel::headerFieldData(const NalSliceHeader &header, int field, int column) const
+{
+    if (column == 0) {
+        switch (field) {
+            case SliceTypeField: return QString("Slice Type");
+            case FirstMbField: return QString("First MB");
+            case SegmentAddressField: return QString("Segment Address");
+            case DependentField: return QString("Dependent Segment");
+            case FrameNumField: return QString("Frame Num");
+            case PocField: return QString("POC");
+            case QpField: return QString("QP");
+            case QpDeltaField: return QString("QP Delta");
+            case RefIdxL0Field: return QString("Ref Idx L0 Active");
+            case RefIdxL1Field: return QString("Ref Idx L1 Active");
+            case PpsIdField: return QString("PPS ID");
+            case PictureStructureField: return QString("Picture Structure");
+            case ShortTermRpsField: return QString("Short-Term RPS");
+            case LongTermRefsField: return QString("Long-Term Refs");
+            case TilesField: return QString("Tiles");
+            case EntryPointsField: return QString("Entry Points");
+            default: return QVariant();
+        }
+    }
+
+    switch (field) {
+        case SliceTypeField: return sliceTypeName(header.sliceType);
+        case FirstMbField: return QString::number(header.firstMb);
+        case SegmentAddressField: return QString("CTB %1").arg(header.firstMb);
+        case DependentField: return QString(header.dependent ? "Yes" : "No");
+        case FrameNumField: return QString::number(header.frameNum);
+        case PocField: return QString::number(header.poc);
+        case QpField: return QString::number(header.qp);
+        case QpDeltaField: return QString::number(header.qpDelta);
+        case RefIdxL0Field: return QString::number(header.refIdxL0);
+        case RefIdxL1Field: return QString::number(header.refIdxL1);
+        case PpsIdField: return QString::number(header.ppsId);
+        case PictureStructureField:
+            return QString(header.fieldPic == 0 ? "Frame" : header.fieldPic == 1 ? "Top Field" : "Bottom Field");
+        case ShortTermRpsField:
+            return QString("%1 before, %2 after, %3 used").arg(header.rpsNegative).arg(header.rpsPositive).arg(header.rpsUsed);
+        case LongTermRefsField: return QString::number(header.longTermRefs);
+        case TilesField:
+            return header.tileColumns * header.tileRows > 1 ? QString("%1x%2").arg(header.tileColumns).arg(header.tileRows)
+                                                            : QString("None");
+        case EntryPointsField:
+            if (header.entryPoints == 0) {
+                return QString("None");
+            }
+            return QString("%1%2").arg(header.entryPoints).arg(header.wavefront ? ", wavefront" : "");
+        default: return QVariant();
+    }
 }
 
 QString SliceTreeModel::formatTimestamp(int64_t timestamp) const
@@ -332,4 +625,4 @@ QString SliceTreeModel::formatTimestamp(int64_t timestamp) const
         return "N/A";
     }
     return QString("%1").arg(timestamp);
-} 
\ No newline at end of file
+}
\ No newline at end of file
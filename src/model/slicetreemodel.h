@@ -5,95 +5,24 @@
 #include <QString>
 #include <QVector>
 #include <QVariant>
-#include <QMap>
-#include <QList>
-
-// Forward declarations
-struct SliceInfo;
-
-/**
- * @brief The SliceTreeItem class represents a node in the slice tree view
- * 
- * This class is used to build a hierarchical tree structure for displaying
- * slice information in a QTreeView. Each item can have a parent and multiple
- * children, forming a tree.
- */
-class SliceTreeItem
-{
-public:
-    /**
-     * @brief Construct a new Slice Tree Item
-     * 
-     * @param name The name/label for this item
-     * @param value The value to display (optional)
-     * @param parent The parent item (nullptr for root)
-     */
-    explicit SliceTreeItem(const QString &name, const QString &value = QString(), SliceTreeItem *parent = nullptr);
-    ~SliceTreeItem();
-
-    /**
-     * @brief Add a child item to this item
-     * @param child The child item to add
-     */
-    void appendChild(SliceTreeItem *child);
-    
-    /**
-     * @brief Get a child at the specified row
-     * @param row The row index
-     * @return SliceTreeItem* The child item or nullptr if invalid
-     */
-    SliceTreeItem *child(int row);
-    
-    /**
-     * @brief Get the number of children
-     * @return int Child count
-     */
-    int childCount() const;
-    
-    /**
-     * @brief Get the number of columns
-     * @return int Column count
-     */
-    int columnCount() const;
-    
-    /**
-     * @brief Get the data for a specific column
-     * @param column The column index
-     * @return QVariant The data to display
-     */
-    QVariant data(int column) const;
-    
-    /**
-     * @brief Get the row index of this item in its parent
-     * @return int Row index
-     */
-    int row() const;
-    
-    /**
-     * @brief Get the parent item
-     * @return SliceTreeItem* The parent item
-     */
-    SliceTreeItem *parentItem();
-    
-    /**
-     * @brief Set the name and value data
-     * @param name The name to set
-     * @param value The value to set
-     */
-    void setData(const QString &name, const QVariant &value);
-
-private:
-    QVector<SliceTreeItem*> m_childItems;  ///< Child items
-    QString m_name;                        ///< Item name/label
-    QVariant m_value;                      ///< Item value
-    SliceTreeItem *m_parentItem;           ///< Parent item
-};
+#include <QHash>
+#include <QSharedPointer>
+#include "packettable.h"
 
 /**
  * @brief The SliceTreeModel class provides a model for displaying slice data in a tree view
- * 
+ *
  * This model organizes slice information in a hierarchical structure for display in a QTreeView.
  * It implements the Model component of the Model-View-Controller pattern for slice data.
+ *
+ * The tree is virtual: no node objects are allocated per slice. Every index carries an
+ * encoded node id (kind, stream slot, slice row, property row) and the displayed text is
+ * computed in data() from the shared PacketTable. Appending slices only inserts the new
+ * rows, so the cost of a batch is proportional to the batch size and not to the number
+ * of slices already loaded.
+ *
+ * Slices split into NAL units get a "NAL Units" property row with one child per unit,
+ * read from the table's NAL index. Units with a parsed slice header list its fields.
  */
 class SliceTreeModel : public QAbstractItemModel
 {
@@ -117,22 +46,36 @@ public:
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
 
     /**
-     * @brief Update the model with new slice data (replaces existing data)
-     * @param slices The list of slice information to display
+     * @brief Set the packet table the model reads from (replaces existing data)
+     * @param table The shared packet table
+     * @param estimated Whether the rows are sampled estimates rather than parsed packets
      */
-    void updateSliceData(const QList<SliceInfo> &slices);
-    
+    void setPacketTable(const QSharedPointer<const PacketTable> &table, bool estimated = false);
+
     /**
-     * @brief Append new slices to the existing data
-     * @param slices The list of new slice information to append
+     * @brief Check whether the model shows sampled estimates
      */
-    void appendSliceData(const QList<SliceInfo> &slices);
-    
+    bool isEstimated() const { return estimated; }
+
+    /**
+     * @brief Append a range of packet table rows to the existing data
+     * @param firstIndex The first row of the range
+     * @param count The number of rows
+     */
+    void appendPackets(qint64 firstIndex, int count);
+
+    /**
+     * @brief Get the packet table row an index refers to
+     * @param index A slice, slice property, NAL unit or header field index
+     * @return qint64 The packet table row, or -1 for other nodes
+     */
+    qint64 packetIndex(const QModelIndex &index) const;
+
     /**
      * @brief Clear all slice data from the model
      */
     void clearSliceData();
-    
+
     /**
      * @brief Get the total number of slices in the model
      * @return int The total slice count
@@ -140,46 +83,129 @@ public:
     int getSliceCount() const;
 
 private:
-    SliceTreeItem *rootItem;  ///< Root item of the tree
-    
-    // Stream type counters for organizing slices
-    int videoSliceCount;
-    int audioSliceCount;
-    int otherSliceCount;
-    
-    // Maps to organize slices by stream
-    QMap<int, SliceTreeItem*> streamItems;
-    
-    // Storage for accumulated slices
-    QList<SliceInfo> accumulatedSlices;
-    
+    /**
+     * @brief Kind of node an index refers to
+     */
+    enum NodeKind {
+        PlaceholderNode = 0,  ///< "No slices available" row shown while empty
+        CategoryNode,         ///< Video / Audio / Other category
+        StreamNode,           ///< Per-stream container
+        SliceNode,            ///< A single slice
+        PropertyNode,         ///< A property row of a slice
+        NalNode,              ///< A NAL unit of a slice, under its NAL units property row
+        HeaderFieldNode       ///< A slice header field of a NAL unit
+    };
+
+    /**
+     * @brief Slice categories shown at the top level
+     */
+    enum Category {
+        VideoCategory = 0,
+        AudioCategory,
+        OtherCategory,
+        CategoryCount
+    };
+
+    /**
+     * @brief Per-stream container data
+     */
+    struct StreamEntry {
+        int streamIndex;          ///< Stream index in the media file
+        int category;             ///< Category this stream is listed under
+        int rowInCategory;        ///< Row of the stream node inside its category
+        StreamType streamType;    ///< Stream type
+        QVector<quint32> sliceRows; ///< Packet table rows of this stream, in arrival order
+    };
+
+    // Streams in order of first appearance, addressed by slot
+    QVector<StreamEntry> streams;
+
+    // Maps a media stream index to its slot in streams
+    QHash<int, int> streamSlots;
+
+    // Stream slots listed under each category, in row order
+    QVector<int> categoryStreams[CategoryCount];
+
+    // Shared packet table and the number of its rows shown by the model
+    QSharedPointer<const PacketTable> packetTable;
+    int sliceCount;
+    bool estimated;
+
     // Helper methods
     /**
-     * @brief Set up initial model data
+     * @brief Encode a node id for use as an index internal id
      */
-    void setupModelData();
-    
+    static quintptr makeNodeId(NodeKind kind, int slot = 0, qint64 row = 0, int property = 0, int field = 0);
+
     /**
-     * @brief Rebuild the tree model from accumulated slices
+     * @brief Decode the parts of a node id
      */
-    void rebuildTreeFromSlices();
-    
+    static NodeKind nodeKind(quintptr id);
+    static int nodeSlot(quintptr id);
+    static qint64 nodeRow(quintptr id);
+    static int nodeProperty(quintptr id);
+    static int nodeField(quintptr id);
+
     /**
-     * @brief Create a slice item with all properties
+     * @brief Get the slot of a packet's stream, creating the stream container if needed
+     * @param packetIndex The packet table row
+     * @param notifyView Whether to announce a new stream container as an inserted row
+     * @return int The stream slot
+     */
+    int streamSlotFor(qint64 packetIndex, bool notifyView);
+
+    /**
+     * @brief Get the category a stream type belongs to
+     * @param streamType The stream type
+     * @return int The category
+     */
+    static int categoryForType(StreamType streamType);
+
+    /**
+     * @brief Get the display name of a category
+     */
+    static QString categoryName(int category);
+
+    /**
+     * @brief Count the slices listed under a category
+     */
+    int categorySliceCount(int category) const;
+
+    /**
+     * @brief Get the display data of a slice property row
      * @param sliceInfo The slice information
-     * @param parent The parent item
-     * @return SliceTreeItem* The created slice item
+     * @param property The property row
+     * @param column The column
+     * @return QVariant The data to display
+     */
+    QVariant propertyData(const SliceInfo &sliceInfo, int property, int column) const;
+
+    /**
+     * @brief Find the NAL units of a slice
+     * @param packetIndex The packet table row
+     * @param first Receives the NAL index row of the first unit
+     * @return int The number of units, 0 if the slice was not split
      */
-    SliceTreeItem* createSliceItem(const SliceInfo &sliceInfo, SliceTreeItem *parent);
-    
+    int nalUnitsOf(qint64 packetIndex, qint64 &first) const;
+
     /**
-     * @brief Add a property item to a parent item
-     * @param parent The parent item
-     * @param name The property name
-     * @param value The property value
+     * @brief Get the display data of a NAL unit row
+     * @param nalIndex The NAL index row
+     * @param unit The unit's position among the units of its slice
+     * @param column The column
+     * @return QVariant The data to display
      */
-    void addPropertyItem(SliceTreeItem *parent, const QString &name, const QVariant &value);
-    
+    QVariant nalData(qint64 nalIndex, int unit, int column) const;
+
+    /**
+     * @brief Get the display data of a slice header field row
+     * @param header The parsed slice header
+     * @param field The field, a HeaderField
+     * @param column The column
+     * @return QVariant The data to display
+     */
+    QVariant headerFieldData(const NalSliceHeader &header, int field, int column) const;
+
     /**
      * @brief Get a formatted timestamp string
      * @param timestamp The timestamp value
@@ -188,4 +214,4 @@ private:
     QString formatTimestamp(int64_t timestamp) const;
 };
 
-#endif // SLICETREEMODEL_H 
\ No newline at end of file
+#endif // SLICETREEMODEL_H
\ No newline at end of file
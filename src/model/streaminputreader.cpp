@@ -0,0 +1,187 @@
+#include "streaminputreader.h"
+#include "common/logging.h"
+#include <QFileInfo>
+#include <QDebug>
+#include <cstdio>
+#include <cstring>
+
+#if defined(Q_OS_UNIX)
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// FFmpeg headers
+extern "C" {
+#include <libavformat/avio.h>
+#include <libavutil/mem.h>
+#include <libavutil/error.h>
+}
+
+bool StreamInputReader::isStreamInput(const QString &filePath)
+{
+    if (filePath == "-") {
+        return true;
+    }
+#if defined(Q_OS_UNIX)
+    struct stat info;
+    if (::stat(QFile::encodeName(filePath).constData(), &info) != 0) {
+        return false;
+    }
+    return S_ISFIFO(info.st_mode) || S_ISSOCK(info.st_mode) || S_ISCHR(info.st_mode);
+#else
+    const QFileInfo info(filePath);
+    return info.exists() && !info.isFile() && !info.isDir();
+#endif
+}
+
+StreamInputReader::StreamInputReader(const QString &filePath, const std::atomic<bool> *stopFlag)
+    : filePath(filePath)
+    , stopFlag(stopFlag)
+    , descriptor(-1)
+    , ownsDescriptor(false)
+    , readPosition(0)
+{
+}
+
+StreamInputReader::~StreamInputReader()
+{
+#if defined(Q_OS_UNIX)
+    if (ownsDescriptor && descriptor >= 0) {
+        ::close(descriptor);
+    }
+#endif
+}
+
+bool StreamInputReader::open()
+{
+#if defined(Q_OS_UNIX)
+    if (filePath == "-") {
+        descriptor = STDIN_FILENO;
+        return true;
+    }
+
+    const QByteArray path = QFile::encodeName(filePath);
+    struct stat info;
+    if (::stat(path.constData(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= static_cast<int>(sizeof(address.sun_path))) {
+            qCDebug(lcIo) << "Socket path too long:" << filePath;
+            return false;
+        }
+        memcpy(address.sun_path, path.constData(), path.size());
+        descriptor = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (descriptor >= 0 && ::connect(descriptor, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+            ::close(descriptor);
+            descriptor = -1;
+        }
+    } else {
+        // Non-blocking, so opening a pipe does not wait for its writer
+        descriptor = ::open(path.constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    }
+    if (descriptor < 0) {
+        qCDebug(lcIo) << "Could not open stream input" << filePath << strerror(errno);
+        return false;
+    }
+    ownsDescriptor = true;
+    return true;
+#else
+    bool opened;
+    if (filePath == "-") {
+        opened = file.open(stdin, QIODevice::ReadOnly | QIODevice::Unbuffered);
+    } else {
+        file.setFileName(filePath);
+        opened = file.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    }
+    if (!opened) {
+        qCDebug(lcIo) << "Could not open stream input" << filePath << file.errorString();
+    }
+    return opened;
+#endif
+}
+
+int StreamInputReader::read(uchar *data, int maxSize)
+{
+#if defined(Q_OS_UNIX)
+    if (descriptor >= 0) {
+        for (;;) {
+            if (isStopped()) {
+                return -1;
+            }
+
+            // A pipe without a writer yet polls as idle; one whose writer left reads as the end
+            pollfd request = { descriptor, POLLIN, 0 };
+            const int ready = ::poll(&request, 1, PollIntervalMs);
+            if (ready < 0 && errno != EINTR) {
+                return -1;
+            }
+            if (ready <= 0) {
+                continue;
+            }
+
+            const ssize_t count = ::read(descriptor, data, maxSize);
+            if (count > 0) {
+                readPosition += count;
+                return static_cast<int>(count);
+            }
+            if (count == 0) {
+                return 0;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                return -1;
+            }
+        }
+    }
+#endif
+
+    // Without poll() the read blocks until data arrives; stop requests wait for it
+    if (isStopped()) {
+        return -1;
+    }
+    const qint64 count = file.read(reinterpret_cast<char *>(data), maxSize);
+    if (count > 0) {
+        readPosition += count;
+    }
+    return static_cast<int>(count);
+}
+
+AVIOContext *StreamInputReader::createIOContext()
+{
+    unsigned char *buffer = static_cast<unsigned char *>(av_malloc(IoBufferSize));
+    if (!buffer) {
+        return nullptr;
+    }
+    AVIOContext *context = avio_alloc_context(buffer, IoBufferSize, 0, this,
+                                              &StreamInputReader::readPacket, nullptr, nullptr);
+    if (!context) {
+        av_free(buffer);
+    }
+    return context;
+}
+
+void StreamInputReader::freeIOContext(AVIOContext **context)
+{
+    if (context && *context) {
+        av_freep(&(*context)->buffer);
+        avio_context_free(context);
+    }
+}
+
+int StreamInputReader::readPacket(void *opaque, uint8_t *buffer, int size)
+{
+    StreamInputReader *self = static_cast<StreamInputReader *>(opaque);
+    const int count = self->read(buffer, size);
+    if (count > 0) {
+        return count;
+    }
+    if (count == 0) {
+        return AVERROR_EOF;
+    }
+    return self->isStopped() ? AVERROR_EXIT : AVERROR(EIO);
+}
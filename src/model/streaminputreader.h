@@ -0,0 +1,84 @@
+#ifndef STREAMINPUTREADER_H
+#define STREAMINPUTREADER_H
+
+#include <QString>
+#include <QFile>
+#include <atomic>
+#include <cstdint>
+
+// Forward declarations
+struct AVIOContext;
+
+/**
+ * @brief The StreamInputReader class feeds the demuxer from an input that can only be read once
+ *
+ * Standard input (the path "-"), named pipes, local sockets and character devices have
+ * no size and cannot seek. The reader hands the demuxer whatever bytes are available,
+ * without waiting to fill its buffer, and waits for data in short slices so a stop
+ * request is noticed even while the writer is silent. Opening never blocks on a pipe
+ * that has no writer yet.
+ *
+ * The reader is consumed through a custom AVIOContext from createIOContext(), which
+ * has no seek callback; all read() calls must come from one thread.
+ */
+class StreamInputReader
+{
+public:
+    static constexpr int IoBufferSize = 64 << 10;   ///< Size of the AVIOContext buffer
+    static constexpr int PollIntervalMs = 250;      ///< Stop flag check interval while waiting for data
+
+    /**
+     * @brief Check whether a path names an input that must be read as a stream
+     * @return bool True for "-" and for pipes, sockets and devices
+     */
+    static bool isStreamInput(const QString &filePath);
+
+    /**
+     * @brief Create a reader for a stream input
+     * @param filePath The input to read, or "-" for standard input
+     * @param stopFlag Polled while waiting for data; reads fail once it becomes true
+     */
+    StreamInputReader(const QString &filePath, const std::atomic<bool> *stopFlag);
+    ~StreamInputReader();
+
+    StreamInputReader(const StreamInputReader &) = delete;
+    StreamInputReader &operator=(const StreamInputReader &) = delete;
+
+    /**
+     * @brief Open the input, connecting to it if it is a local socket
+     * @return bool False if the input cannot be opened
+     */
+    bool open();
+
+    /**
+     * @brief Copy the bytes available now, waiting until there are some
+     * @return int The number of bytes copied, 0 at the end of the stream, or -1 on error or stop
+     */
+    int read(uchar *data, int maxSize);
+
+    qint64 position() const { return readPosition; }
+    bool isStopped() const { return stopFlag && stopFlag->load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Create a non-seekable AVIOContext that reads through this reader
+     * @return AVIOContext* The context, or nullptr on allocation failure; free it with freeIOContext()
+     */
+    AVIOContext *createIOContext();
+
+    /**
+     * @brief Free a context made by createIOContext() and its buffer
+     */
+    static void freeIOContext(AVIOContext **context);
+
+private:
+    QString filePath;
+    const std::atomic<bool> *stopFlag;
+    QFile file;                // Used where descriptors cannot be polled
+    int descriptor;            ///< Polled descriptor, or -1 when reading through file
+    bool ownsDescriptor;       ///< False for standard input, which is left open
+    qint64 readPosition;
+
+    static int readPacket(void *opaque, uint8_t *buffer, int size);
+};
+
+#endif // STREAMINPUTREADER_H
@@ -0,0 +1,601 @@
+#include "tsshardparser.h"
+#include "parseschedule.h"
+#include "nalsyntaxparser.h"
+#include "common/logging.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QMutexLocker>
+#include <QDebug>
+#include <vector>
+#include <algorithm>
+
+// FFmpeg headers
+extern "C" {
+#include <libavutil/avutil.h>
+}
+
+namespace {
+
+constexpr int kTsPacketSize = 188;                    // TS packet without prefix or parity
+constexpr qint64 kMinShardBytes = 16LL << 20;
+constexpr qint64 kMaxShardBytes = 256LL << 20;
+constexpr qint64 kMaxLookaheadBytes = 64LL << 20;     // Bound on reading past a shard to finish its PES packets
+constexpr int kPacketsPerRead = 4096;
+constexpr int kSyncCheckPackets = 8;
+
+// Bytes of a unit kept to parse it again: all the syntax parsers read, emulation prevention included
+constexpr int kReplayBytes = 2 * NalSyntaxParser::MaxParameterSetBytes;
+
+qint64 readTimestamp(const uchar *p)
+{
+    return (static_cast<qint64>((p[0] >> 1) & 0x07) << 30)
+           | (static_cast<qint64>(p[1]) << 22)
+           | (static_cast<qint64>(p[2] >> 1) << 15)
+           | (static_cast<qint64>(p[3]) << 7)
+           | static_cast<qint64>(p[4] >> 1);
+}
+
+bool hasOptionalPesHeader(uchar streamId)
+{
+    // program_stream_map, padding, private_stream_2, ECM, EMM, DSMCC, H.222.1 type E and directory
+    return streamId != 0xBC && streamId != 0xBE && streamId != 0xBF
+           && streamId != 0xF0 && streamId != 0xF1 && streamId != 0xF2
+           && streamId != 0xF8 && streamId != 0xFF;
+}
+
+/**
+ * Parse the PES header at the start of a payload. expectedBytes is the full PES size
+ * including its header, or -1 for an unbounded video PES.
+ */
+void parsePesHeader(const uchar *payload, int length, qint64 &pts, qint64 &dts,
+                    int &headerSize, qint64 &expectedBytes)
+{
+    pts = AV_NOPTS_VALUE;
+    dts = AV_NOPTS_VALUE;
+    headerSize = 0;
+    expectedBytes = -1;
+
+    if (length < 6 || payload[0] != 0x00 || payload[1] != 0x00 || payload[2] != 0x01) {
+        return;
+    }
+
+    const int pesLength = (payload[4] << 8) | payload[5];
+    if (pesLength > 0) {
+        expectedBytes = pesLength + 6;
+    }
+
+    if (!hasOptionalPesHeader(payload[3]) || length < 9) {
+        headerSize = 6;
+        return;
+    }
+
+    const int ptsDtsFlags = payload[7] >> 6;
+    headerSize = 9 + payload[8];
+    if ((ptsDtsFlags & 0x2) && length >= 14) {
+        pts = readTimestamp(payload + 9);
+        dts = pts;
+    }
+    if (ptsDtsFlags == 0x3 && length >= 19) {
+        dts = readTimestamp(payload + 14);
+    }
+}
+
+// Slices of a random access point: H.264 IDR, HEVC BLA, IDR and CRA
+bool isRandomAccessSlice(NalCodec codec, int nalType)
+{
+    return codec == NalCodec::H264 ? nalType == 5 : nalType >= 16 && nalType <= 21;
+}
+
+// Slices whose order count does not depend on the pictures before them: H.264 IDR, HEVC BLA
+// and IDR. A CRA continues the count unless it starts the stream.
+bool resetsOrderCount(NalCodec codec, int nalType)
+{
+    return codec == NalCodec::H264 ? nalType == 5 : nalType >= 16 && nalType <= 20;
+}
+
+} // namespace
+
+// One PES packet found by a shard, in packet table column form
+struct TsShardParser::ShardPacket {
+    qint64 pts;
+    qint64 dts;
+    qint64 pos;
+    qint32 size;
+    quint16 streamIndex;
+    quint8 flags;
+};
+
+// One NAL unit of a video PES packet found by a shard
+struct TsShardParser::ShardNal {
+    int packet;              ///< Index in ShardResult::packets
+    NalCodec codec;
+    NalUnit unit;
+    NalSliceHeader header;   ///< Parsed header of slice units
+};
+
+// A unit parsed before its PID's first IDR or BLA picture in a shard, kept to be parsed
+// again from the end state of the previous shard
+struct TsShardParser::ShardReplay {
+    int pid;
+    int nal;                 ///< Index in ShardResult::nals
+    QByteArray bytes;        ///< The start of the unit, up to kReplayBytes
+};
+
+// A PID's syntax parser as a shard left it
+struct TsShardParser::ShardSyntax {
+    std::shared_ptr<NalSyntaxParser> parser;
+    bool settled = false;    ///< An IDR or BLA picture was parsed; the state no longer depends on earlier shards
+};
+
+struct TsShardParser::ShardResult {
+    QVector<ShardPacket> packets;
+    QVector<ShardNal> nals;            ///< In packet order within each PID
+    QVector<ShardReplay> replay;       ///< In decoding order within each PID
+    QHash<int, ShardSyntax> syntax;    ///< By PID
+    qint64 start = 0;
+    qint64 end = 0;
+    bool claimed = false;
+    bool partial = false;      ///< Overlaps bytes covered before the run
+    bool done = false;
+    bool complete = false;
+};
+
+TsShardParser::TsShardParser(const QString &filePath, const QHash<int, StreamMapping> &pidStreams,
+                             const std::atomic<bool> *stopFlag)
+    : filePath(filePath)
+    , pidStreams(pidStreams)
+    , stopFlag(stopFlag)
+    , packetSize(kTsPacketSize)
+    , syncOffset(0)
+    , fixedShardBytes(0)
+    , aborted(false)
+{
+}
+
+TsShardParser::~TsShardParser()
+{
+}
+
+void TsShardParser::setShardBytes(qint64 bytes)
+{
+    fixedShardBytes = qMax<qint64>(0, bytes);
+}
+
+bool TsShardParser::detectPacketSize(const QString &filePath, int &packetSize, qint64 &syncOffset)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QByteArray head = file.read(204 * (kSyncCheckPackets + 1) * 4);
+    const uchar *data = reinterpret_cast<const uchar*>(head.constData());
+
+    for (int size : {188, 192, 204}) {
+        const int prefix = (size == 192) ? 4 : 0;
+        for (int offset = 0; offset < size; ++offset) {
+            if (offset + prefix + size * kSyncCheckPackets > head.size()) {
+                break;
+            }
+            bool synced = true;
+            for (int i = 0; i < kSyncCheckPackets && synced; ++i) {
+                synced = data[offset + prefix + i * size] == 0x47;
+            }
+            if (synced) {
+                packetSize = size;
+                syncOffset = offset;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool TsShardParser::canShard(const QString &filePath)
+{
+    if (QThread::idealThreadCount() < 2 || QFileInfo(filePath).size() < 2 * kMinShardBytes) {
+        return false;
+    }
+
+    int size;
+    qint64 offset;
+    return detectPacketSize(filePath, size, offset);
+}
+
+bool TsShardParser::run(PacketTable &table, const ShardCallback &onShardStitched, ParseSchedule *schedule)
+{
+    if (!detectPacketSize(filePath, packetSize, syncOffset)) {
+        qCDebug(lcIndex) << "Transport stream sync not found:" << filePath;
+        return false;
+    }
+
+    const qint64 fileSize = QFileInfo(filePath).size();
+    const int threads = qMax(1, QThread::idealThreadCount());
+
+    // Several shards per thread keep all cores busy when shard costs differ
+    qint64 shardBytes = fixedShardBytes > 0 ? fixedShardBytes
+                                            : qBound(kMinShardBytes, (fileSize - syncOffset) / (threads * 4), kMaxShardBytes);
+    shardBytes = qMax<qint64>(packetSize, shardBytes - shardBytes % packetSize);
+    const int shardCount = static_cast<int>((fileSize - syncOffset + shardBytes - 1) / shardBytes);
+
+    qCDebug(lcIndex) << QString("Sharding transport stream: %1 shards of %2 bytes, %3 threads, packet size %4")
+                .arg(shardCount).arg(shardBytes).arg(threads).arg(packetSize);
+
+    // Shards a resumed parse has covered already are skipped; rows of partly covered ones
+    // are filtered when stitched
+    std::vector<ShardResult> results(shardCount);
+    int pendingCount = shardCount;
+    if (schedule) {
+        schedule->markCovered(0, syncOffset);
+    }
+    for (int i = 0; i < shardCount; ++i) {
+        ShardResult &result = results[i];
+        result.start = syncOffset + i * shardBytes;
+        result.end = qMin(fileSize, result.start + shardBytes);
+        if (schedule && schedule->coveredEnd(result.start) >= result.end) {
+            result.claimed = true;
+            --pendingCount;
+        } else if (schedule) {
+            result.partial = schedule->isCovered(result.start) || schedule->nextCoveredStart(result.start) < result.end;
+        }
+    }
+    aborted.store(false, std::memory_order_relaxed);
+
+    // Each pool task claims the next shard when it starts; a priority request moves the
+    // cursor, so the shard holding the requested position is parsed and stitched next
+    std::vector<int> claimOrder;
+    claimOrder.reserve(shardCount);
+    int cursor = 0;
+    auto claimShard = [&]() -> int {
+        qint64 position;
+        if (schedule && schedule->hasRequest() && schedule->takeRequest(position)) {
+            cursor = static_cast<int>(qBound<qint64>(0, (position - syncOffset) / shardBytes, shardCount - 1));
+            qCDebug(lcIndex) << "Priority request moves the shard cursor to shard" << cursor;
+        }
+        for (int k = 0; k < shardCount; ++k) {
+            const int i = (cursor + k) % shardCount;
+            if (!results[i].claimed) {
+                results[i].claimed = true;
+                cursor = i + 1;
+                claimOrder.push_back(i);
+                return i;
+            }
+        }
+        return -1;
+    };
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    for (int i = 0; i < pendingCount; ++i) {
+        pool.start([this, fileSize, &results, &claimShard]() {
+            int index;
+            {
+                QMutexLocker locker(&mutex);
+                index = claimShard();
+            }
+            if (index < 0) {
+                return;
+            }
+            ShardResult &result = results[index];
+            parseShard(result.start, result.end, fileSize, result);
+            QMutexLocker locker(&mutex);
+            result.done = true;
+            shardDone.wakeAll();
+        });
+    }
+
+    // Stitch in claim order as shards complete. The syntax parser of each video PID as the
+    // last stitched shard left it, valid for the shard that follows it in the file.
+    QHash<int, std::shared_ptr<NalSyntaxParser>> carried;
+    qint64 carriedEnd = -1;
+    bool complete = true;
+    qint64 bytesDone = syncOffset;
+    for (int k = 0; k < pendingCount && complete; ++k) {
+        ShardResult *claimed;
+        {
+            QMutexLocker locker(&mutex);
+            while (static_cast<int>(claimOrder.size()) <= k || !results[claimOrder[k]].done) {
+                shardDone.wait(&mutex);
+            }
+            claimed = &results[claimOrder[k]];
+        }
+        ShardResult &result = *claimed;
+
+        if (!result.complete || isStopped()) {
+            complete = false;
+            break;
+        }
+
+        // Units before a PID's first IDR or BLA picture were parsed without the pictures before
+        // the shard; following on from the last stitched shard they are parsed again from its state
+        if (result.start != carriedEnd) {
+            carried.clear();
+        }
+        for (const ShardReplay &replay : result.replay) {
+            auto parser = carried.constFind(replay.pid);
+            if (parser != carried.constEnd()) {
+                ShardNal &unit = result.nals[replay.nal];
+                if (!(*parser)->parseUnit(reinterpret_cast<const uchar *>(replay.bytes.constData()),
+                                          replay.bytes.size(), unit.header)) {
+                    unit.header = NalSliceHeader();
+                }
+            }
+        }
+        for (auto it = result.syntax.cbegin(); it != result.syntax.cend(); ++it) {
+            if (it->settled || !carried.contains(it.key())) {
+                carried.insert(it.key(), it->parser);
+            }
+        }
+        carriedEnd = result.end;
+
+        // Units of several video PIDs interleave; each packet's units follow its row
+        auto byPacket = [](const ShardNal &a, const ShardNal &b) { return a.packet < b.packet; };
+        if (!std::is_sorted(result.nals.cbegin(), result.nals.cend(), byPacket)) {
+            std::stable_sort(result.nals.begin(), result.nals.end(), byPacket);
+        }
+
+        const qint64 firstIndex = table.size();
+        int nal = 0;
+        for (int i = 0; i < result.packets.size(); ++i) {
+            const ShardPacket &packet = result.packets.at(i);
+            if (result.partial && schedule->isCovered(packet.pos)) {
+                continue;
+            }
+            const qint64 row = table.appendRow(packet.pts, packet.dts, packet.pos, 0, packet.size,
+                                               packet.streamIndex, packet.flags);
+            if (row < 0) {
+                qCDebug(lcIndex) << "Packet table is full";
+                complete = false;
+                break;
+            }
+            while (nal < result.nals.size() && result.nals.at(nal).packet < i) {
+                ++nal;
+            }
+            for (; nal < result.nals.size() && result.nals.at(nal).packet == i; ++nal) {
+                const ShardNal &unit = result.nals.at(nal);
+                table.nalUnits().append(row, unit.codec, unit.unit, unit.header.isValid() ? &unit.header : nullptr);
+            }
+        }
+        const int count = static_cast<int>(table.size() - firstIndex);
+        result.packets = QVector<ShardPacket>();
+        result.nals = QVector<ShardNal>();
+        result.replay = QVector<ShardReplay>();
+        result.syntax.clear();
+        bytesDone += result.end - result.start;
+        if (schedule) {
+            schedule->markCovered(result.start, result.end);
+            bytesDone = schedule->coveredBytes();
+        }
+
+        if (onShardStitched) {
+            onShardStitched(firstIndex, count, bytesDone);
+        }
+    }
+
+    if (!complete) {
+        aborted.store(true, std::memory_order_relaxed);
+        pool.clear();
+    }
+    pool.waitForDone();
+    return complete;
+}
+
+void TsShardParser::parseShard(qint64 start, qint64 end, qint64 fileSize, ShardResult &result) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        qCDebug(lcIndex) << "Could not open shard of" << filePath;
+        return;
+    }
+
+    struct PidState {
+        int pid = -1;
+        int row = -1;              // Open packet in result.packets
+        qint64 bytes = 0;          // PES bytes seen so far, header included
+        qint64 expected = -1;      // Full PES size, or -1 if unbounded
+        int headerSize = 0;
+        int lastCc = -1;
+        NalCodec codec = NalCodec::Unknown;
+        QByteArray payload;        // Elementary stream bytes of an open video PES packet
+        std::shared_ptr<NalSyntaxParser> syntax;   // Parameter sets and order count state of the PID
+        bool settled = false;      // An IDR or BLA picture was parsed
+    };
+    QHash<int, PidState> states;
+    int openRows = 0;
+    NalScanner scanner;
+    QVector<NalUnit> units;
+
+    // Keep the PES bytes of a TS payload that lie past the PES header and within its length
+    auto collectPayload = [](PidState &state, const uchar *payload, int length) {
+        const qint64 before = state.bytes - length;
+        const qint64 from = qMax<qint64>(before, state.headerSize);
+        const qint64 to = state.expected > 0 ? qMin(state.bytes, state.expected) : state.bytes;
+        if (to > from) {
+            state.payload.append(reinterpret_cast<const char *>(payload + (from - before)), static_cast<int>(to - from));
+        }
+    };
+
+    // Split a complete video PES packet into NAL units and parse their headers. Units before
+    // the first IDR or BLA picture are kept to be parsed again at stitching.
+    auto scanPayload = [&result, &scanner, &units](PidState &state) {
+        const uchar *data = reinterpret_cast<const uchar *>(state.payload.constData());
+        units.clear();
+        scanner.setCodec(state.codec);
+        scanner.begin();
+        scanner.feed(data, state.payload.size(), units);
+        scanner.finish(units);
+        for (const NalUnit &unit : units) {
+            ShardNal nal = { state.row, state.codec, unit, NalSliceHeader() };
+            const bool parsed = state.syntax && state.syntax->parseUnit(data + unit.offset, unit.size, nal.header);
+            if (!parsed) {
+                nal.header = NalSliceHeader();
+            }
+            if (state.syntax && !state.settled) {
+                if (parsed && resetsOrderCount(state.codec, unit.type)) {
+                    state.settled = true;
+                } else {
+                    const QByteArray bytes(reinterpret_cast<const char *>(data + unit.offset), qMin(unit.size, kReplayBytes));
+                    result.replay.append({ state.pid, static_cast<int>(result.nals.size()), bytes });
+                }
+            }
+            if (isRandomAccessSlice(state.codec, unit.type)) {
+                result.packets[state.row].flags |= PacketTable::KeyFrameFlag;
+            }
+            result.nals.append(nal);
+        }
+        state.payload.resize(0);
+    };
+
+    auto finish = [&result, &openRows, &scanPayload](PidState &state) {
+        const qint64 bytes = state.expected > 0 ? qMin(state.bytes, state.expected) : state.bytes;
+        result.packets[state.row].size = static_cast<qint32>(qMax<qint64>(0, bytes - state.headerSize));
+        if (state.codec != NalCodec::Unknown) {
+            scanPayload(state);
+        }
+        state.row = -1;
+        --openRows;
+    };
+
+    const int prefix = (packetSize == 192) ? 4 : 0;
+    QByteArray buffer(packetSize * kPacketsPerRead, Qt::Uninitialized);
+    const uchar *data = reinterpret_cast<const uchar*>(buffer.constData());
+    qint64 offset = start;
+
+    while (offset < fileSize) {
+        if (isStopped() || aborted.load(std::memory_order_relaxed)) {
+            return;
+        }
+        // Past the end only the PES packets begun in the shard are followed
+        if (offset >= end && openRows == 0) {
+            break;
+        }
+        if (offset >= end + kMaxLookaheadBytes) {
+            qCDebug(lcIndex) << "Shard lookahead limit reached at" << offset << "with" << openRows << "open PES packets";
+            break;
+        }
+
+        if (!file.seek(offset)) {
+            break;
+        }
+        const qint64 bytesRead = file.read(buffer.data(), qMin<qint64>(buffer.size(), fileSize - offset));
+        if (bytesRead < packetSize) {
+            break;
+        }
+
+        qint64 consumed = 0;
+        while (consumed + packetSize <= bytesRead) {
+            const uchar *ts = data + consumed + prefix;
+            const qint64 packetPos = offset + consumed;
+
+            // Lost sync: move to the next byte that looks like a packet start
+            if (ts[0] != 0x47) {
+                ++consumed;
+                continue;
+            }
+            consumed += packetSize;
+
+            const int pid = ((ts[1] & 0x1F) << 8) | ts[2];
+            auto mapping = pidStreams.constFind(pid);
+            if (mapping == pidStreams.constEnd()) {
+                continue;
+            }
+
+            const bool transportError = ts[1] & 0x80;
+            const bool unitStart = ts[1] & 0x40;
+            const int adaptation = (ts[3] >> 4) & 0x3;
+            const int cc = ts[3] & 0x0F;
+
+            int payloadOffset = 4;
+            bool randomAccess = false;
+            bool discontinuity = false;
+            if (adaptation & 0x2) {
+                const int adaptationLength = ts[4];
+                if (adaptationLength > 0) {
+                    discontinuity = ts[5] & 0x80;
+                    randomAccess = ts[5] & 0x40;
+                }
+                payloadOffset = 5 + adaptationLength;
+            }
+            const bool hasPayload = (adaptation & 0x1) && payloadOffset < kTsPacketSize;
+            const int payloadLength = hasPayload ? kTsPacketSize - payloadOffset : 0;
+
+            PidState &state = states[pid];
+            bool continuityError = false;
+            if (adaptation & 0x1) {
+                if (state.lastCc >= 0 && !discontinuity && cc != state.lastCc && cc != ((state.lastCc + 1) & 0x0F)) {
+                    continuityError = true;
+                }
+                state.lastCc = cc;
+            }
+
+            if (unitStart) {
+                if (state.row >= 0) {
+                    finish(state);
+                }
+                // PES packets starting past the end belong to the next shard
+                if (packetPos >= end || !hasPayload) {
+                    continue;
+                }
+
+                ShardPacket packet;
+                parsePesHeader(ts + payloadOffset, payloadLength, packet.pts, packet.dts,
+                               state.headerSize, state.expected);
+                packet.pos = packetPos;
+                packet.size = 0;
+                packet.streamIndex = static_cast<quint16>(mapping->streamIndex);
+                packet.flags = static_cast<quint8>((static_cast<quint8>(mapping->streamType) << PacketTable::StreamTypeShift)
+                                                   & PacketTable::StreamTypeMask);
+                if (randomAccess || mapping->streamType == StreamType::Audio) {
+                    packet.flags |= PacketTable::KeyFrameFlag;
+                }
+                if (transportError) {
+                    packet.flags |= PacketTable::CorruptFlag;
+                }
+
+                state.pid = pid;
+                state.row = result.packets.size();
+                state.bytes = payloadLength;
+                result.packets.append(packet);
+                ++openRows;
+                state.codec = mapping->nalCodec;
+                if (state.codec != NalCodec::Unknown) {
+                    if (!state.syntax) {
+                        state.syntax = NalSyntaxParser::create(mapping->nalCodec);
+                        if (state.syntax) {
+                            state.syntax->parseConfig(reinterpret_cast<const uchar *>(mapping->codecConfig.constData()),
+                                                      mapping->codecConfig.size());
+                        }
+                    }
+                    collectPayload(state, ts + payloadOffset, payloadLength);
+                }
+            } else if (state.row >= 0) {
+                state.bytes += payloadLength;
+                if (transportError || continuityError) {
+                    result.packets[state.row].flags |= PacketTable::CorruptFlag;
+                }
+                if (state.codec != NalCodec::Unknown) {
+                    collectPayload(state, ts + payloadOffset, payloadLength);
+                }
+            }
+
+            if (state.row >= 0 && state.expected > 0 && state.bytes >= state.expected) {
+                finish(state);
+            }
+        }
+
+        offset += consumed;
+    }
+
+    // Packets still open at the end of the file or the lookahead end here
+    for (PidState &state : states) {
+        if (state.row >= 0) {
+            finish(state);
+        }
+        if (state.syntax) {
+            result.syntax.insert(state.pid, { state.syntax, state.settled });
+        }
+    }
+    result.complete = true;
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#ifndef TSSHARDPARSER_H
+#define TSSHARDPARSER_H
+
+#include <QString>
+#include <QHash>
+#include <QVector>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <functional>
+#include "packettable.h"
+
+class ParseSchedule;
+
+/**
+ * @brief The TsShardParser class indexes an MPEG transport stream on all cores
+ *
+ * The file is split into byte ranges aligned to the transport packet size and each
+ * range is scanned on a pool thread. Shards do not run a demuxer: they read the TS
+ * and PES headers directly and use the PID to stream mapping found while probing.
+ * A shard owns every PES packet whose first TS packet lies inside its range; it skips
+ * the tails of PES packets begun in the previous range and reads past its own end to
+ * complete the ones it started. Shards are stitched into the packet table in the order
+ * pool threads claim them, which is file order unless a priority request moves the next
+ * claim to the shard holding the requested position; without requests the table is
+ * ordered by position and identical to a single-threaded scan.
+ *
+ * The payloads of H.264 and HEVC streams are split into NAL units as they are read,
+ * and the units are stitched into the table's NAL index with their packets. A video
+ * packet is a key frame if its TS packet has the random access indicator or it holds an
+ * IDR or IRAP slice. Each shard parses slice headers from its own start, so the units
+ * before a PID's first IDR or BLA picture in the shard are parsed again at stitching,
+ * against the state the previous shard in the file left. A shard stitched after a
+ * priority claim or a covered range has no such state, and the headers of those
+ * pictures are parsed as in any parse that starts mid-stream.
+ */
+class TsShardParser
+{
+public:
+    /**
+     * @brief Callback run on the calling thread after each stitched shard
+     * @param firstIndex The first packet table row added for the shard
+     * @param count The number of rows added
+     * @param bytesDone Bytes of the file covered by the stitched shards so far
+     */
+    using ShardCallback = std::function<void(qint64 firstIndex, int count, qint64 bytesDone)>;
+
+    /**
+     * @brief Create a parser for a transport stream file
+     * @param filePath The file to parse
+     * @param pidStreams The PID of each elementary stream and the stream it maps to
+     * @param stopFlag Polled by the shards; parsing ends early when it becomes true
+     */
+    TsShardParser(const QString &filePath, const QHash<int, StreamMapping> &pidStreams,
+                  const std::atomic<bool> *stopFlag);
+    ~TsShardParser();
+
+    /**
+     * @brief Check whether a file is large enough and synchronized well enough to shard
+     * @param filePath The file to check
+     * @return bool True if run() can parse the file
+     */
+    static bool canShard(const QString &filePath);
+
+    /**
+     * @brief Use a fixed shard size instead of one derived from the file size and thread count
+     * @param bytes Bytes per shard, rounded down to whole transport packets; 0 derives the size
+     */
+    void setShardBytes(qint64 bytes);
+
+    /**
+     * @brief Parse the whole file, appending the packets to the table shard by shard
+     * @param table The table to append to (the caller must be its only writer)
+     * @param onShardStitched Called after each shard has been appended
+     * @param schedule Source of priority requests and of byte ranges covered by an earlier run,
+     *                 which are skipped; stitched shards are marked covered. Nullptr parses
+     *                 the whole file in file order
+     * @return bool True if the whole file was parsed, false if stopped or failed
+     */
+    bool run(PacketTable &table, const ShardCallback &onShardStitched, ParseSchedule *schedule = nullptr);
+
+private:
+    struct ShardPacket;
+    struct ShardNal;
+    struct ShardReplay;
+    struct ShardSyntax;
+    struct ShardResult;
+
+    QString filePath;
+    QHash<int, StreamMapping> pidStreams;
+    const std::atomic<bool> *stopFlag;
+
+    int packetSize;           ///< 188, or 192 for M2TS with a timestamp prefix, or 204 with Reed-Solomon parity
+    qint64 syncOffset;        ///< Offset of the first sync byte
+    qint64 fixedShardBytes;   ///< Shard size set by setShardBytes(), or 0
+
+    QMutex mutex;
+    QWaitCondition shardDone;
+    std::atomic<bool> aborted;   ///< Set when stitching gives up, so queued shards end early
+
+    bool isStopped() const { return stopFlag && stopFlag->load(std::memory_order_relaxed); }
+    void parseShard(qint64 start, qint64 end, qint64 fileSize, ShardResult &result) const;
+    static bool detectPacketSize(const QString &filePath, int &packetSize, qint64 &syncOffset);
+};
+
+#endif // TSSHARDPARSER_H
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QInputDialog>
 #include <QDockWidget>
 #include <QLabel>
 #include <QFrame>
@@ -47,6 +48,13 @@ void MainWindow::setupConnections()
     connect(controller, &Controller::updateWindowTitle, this, &MainWindow::updateWindowTitle);
     connect(controller, &Controller::error, this, &MainWindow::showError);
     connect(controller, &Controller::clearAllWidgets, this, &MainWindow::clearAllWidgets);
+    connect(controller, &Controller::probingProgress, this, &MainWindow::onProbingProgress);
+    connect(controller, &Controller::parsingMetrics, this, &MainWindow::onParsingMetrics);
+    connect(controller, &Controller::quickScanFinished, this, &MainWindow::onQuickScanFinished);
+    connect(controller, &Controller::parsingFinished, this, &MainWindow::onParsingFinished);
+    connect(controller, &Controller::streamInfoUpdated, this, [this]() {
+        statusBar()->clearMessage();
+    });
     
     // Connect widget managers to controller
     if (streamsManager) {
@@ -56,6 +64,15 @@ void MainWindow::setupConnections()
     if (sliceManager) {
         sliceManager->connectToController(controller);
     }
+    
+    if (hexManager) {
+        hexManager->connectToController(controller);
+    }
+    
+    // The hex view shows the bytes of the slice selected in the slice view
+    if (sliceManager && hexManager) {
+        connect(sliceManager, &SliceWidgetManager::packetSelected, hexManager, &HexWidgetManager::showPacket);
+    }
 }
 
 void MainWindow::setupDockAreaPriorities()
@@ -85,12 +102,41 @@ void MainWindow::createFileMenu()
         fileMenu->addAction(openFileAction);
     }
 
+    QAction *openStreamAction = new QAction(tr("Open &Stream..."), this);
+    if (openStreamAction) {
+        connect(openStreamAction, &QAction::triggered, this, &MainWindow::onOpenStream);
+        fileMenu->addAction(openStreamAction);
+    }
+
     QAction *closeFileAction = new QAction(tr("&Close"), this);
     if (closeFileAction) {
         connect(closeFileAction, &QAction::triggered, this, &MainWindow::onCloseFile);
         fileMenu->addAction(closeFileAction);
     }
 
+    QAction *parseFromAction = new QAction(tr("&Parse From Time..."), this);
+    if (parseFromAction) {
+        connect(parseFromAction, &QAction::triggered, this, &MainWindow::onParseFromTime);
+        fileMenu->addAction(parseFromAction);
+    }
+
+    // Applies to the next file opened, which is then parsed as it grows
+    QAction *followAction = new QAction(tr("&Follow Growing File"), this);
+    if (followAction) {
+        followAction->setCheckable(true);
+        followAction->setChecked(controller->isFollowModeEnabled());
+        connect(followAction, &QAction::toggled, this, &MainWindow::onFollowGrowingFile);
+        fileMenu->addAction(followAction);
+    }
+
+    QAction *quickScanAction = new QAction(tr("&Quick Scan Large Files"), this);
+    if (quickScanAction) {
+        quickScanAction->setCheckable(true);
+        quickScanAction->setChecked(controller->isQuickScanEnabled());
+        connect(quickScanAction, &QAction::toggled, this, &MainWindow::onQuickScan);
+        fileMenu->addAction(quickScanAction);
+    }
+
     QAction *exitAction = new QAction(tr("E&xit"), this);
     if (exitAction) {
         connect(exitAction, &QAction::triggered, this, &QWidget::close);
@@ -252,11 +298,61 @@ void MainWindow::onOpenFile()
     controller->openFile();
 }
 
+void MainWindow::onOpenStream()
+{
+    // Pipes and sockets are often hidden by the file dialog, so the path is typed
+    bool accepted = false;
+    const QString path = QInputDialog::getText(this, tr("Open Stream"),
+                                               tr("Named pipe or local socket to read:"),
+                                               QLineEdit::Normal, QString(), &accepted).trimmed();
+    if (accepted && !path.isEmpty()) {
+        controller->openFile(path);
+    }
+}
+
 void MainWindow::onCloseFile()
 {
     controller->closeFile();
 }
 
+void MainWindow::onParseFromTime()
+{
+    if (!controller->isParsing()) {
+        return;
+    }
+
+    bool accepted = false;
+    const QString text = QInputDialog::getText(this, tr("Parse From Time"),
+                                               tr("Time to index first ([hh:]mm:ss or seconds):"),
+                                               QLineEdit::Normal, QString(), &accepted).trimmed();
+    if (!accepted || text.isEmpty()) {
+        return;
+    }
+
+    // Accept seconds, mm:ss or hh:mm:ss
+    double seconds = 0;
+    for (const QString &part : text.split(':')) {
+        bool valid = false;
+        const double value = part.toDouble(&valid);
+        if (!valid || value < 0) {
+            showError(tr("Invalid time: %1").arg(text));
+            return;
+        }
+        seconds = seconds * 60 + value;
+    }
+    controller->prioritizeTime(seconds);
+}
+
+void MainWindow::onFollowGrowingFile(bool enabled)
+{
+    controller->setFollowModeEnabled(enabled);
+}
+
+void MainWindow::onQuickScan(bool enabled)
+{
+    controller->setQuickScanEnabled(enabled);
+}
+
 void MainWindow::onAboutUs()
 {
     QMessageBox::information(this, tr("About us"), tr("Legilimens"));
@@ -353,6 +449,60 @@ void MainWindow::showError(const QString &message)
     QMessageBox::critical(this, tr("Error"), message);
 }
 
+void MainWindow::onProbingProgress(qint64 bytesProbed)
+{
+    statusBar()->showMessage(tr("Probing streams... %1 MB read").arg(bytesProbed / (1024 * 1024)));
+}
+
+void MainWindow::onParsingMetrics(const ParseMetrics &metrics)
+{
+    const double megabytes = metrics.bytesDone / (1024.0 * 1024.0);
+    const double megabytesPerSecond = metrics.bytesPerSecond / (1024.0 * 1024.0);
+    QString message = metrics.totalBytes > 0
+        ? tr("Parsing %1%").arg(metrics.bytesDone * 100 / metrics.totalBytes)
+        : tr("Parsing %1 MB").arg(megabytes, 0, 'f', 1);
+    message += tr(" - %1 packets, %2 MB/s, %3 packets/s")
+                   .arg(metrics.packets)
+                   .arg(megabytesPerSecond, 0, 'f', 1)
+                   .arg(metrics.packetsPerSecond, 0, 'f', 0);
+    if (metrics.etaMs >= 0) {
+        const qint64 seconds = (metrics.etaMs + 999) / 1000;
+        message += tr(", %1:%2 left").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+    }
+    statusBar()->showMessage(message);
+}
+
+void MainWindow::onParsingFinished()
+{
+    // Arrives after the last rows reached the views, so the count is final
+    const QSharedPointer<const PacketTable> table = controller->getMediaFileManager()->getPacketTable();
+    statusBar()->showMessage(tr("Parsing finished - %1 packets").arg(table ? table->size() : 0));
+}
+
+void MainWindow::onQuickScanFinished(const QuickScanResult &result)
+{
+    if (!quickScanLabel) {
+        quickScanLabel = new QLabel(this);
+        statusBar()->addPermanentWidget(quickScanLabel);
+    }
+
+    // The status message is taken by parse progress, so the estimates get their own label
+    QString text = tr("Estimated from %1 samples: %2 Mb/s")
+                       .arg(result.samples)
+                       .arg(result.averageBitRate / 1e6, 0, 'f', 1);
+    for (const QuickScanStreamEstimate &stream : result.streams) {
+        if (stream.keyFrameSeconds > 0 && stream.keyFrameInterval > 1) {
+            text += tr(", stream %1 key frame every %2 s (%3 packets)")
+                        .arg(stream.streamIndex)
+                        .arg(stream.keyFrameSeconds, 0, 'f', 2)
+                        .arg(stream.keyFrameInterval, 0, 'f', 0);
+            break;
+        }
+    }
+    quickScanLabel->setText(text);
+    quickScanLabel->show();
+}
+
 void MainWindow::clearAllWidgets()
 {
     qDebug() << "Clearing all widget content";
@@ -374,6 +524,10 @@ void MainWindow::clearAllWidgets()
         macroblockManager->clearContent();
     }
     
+    if (quickScanLabel) {
+        quickScanLabel->hide();
+    }
+    
     qDebug() << "All widgets cleared successfully";
 }
 
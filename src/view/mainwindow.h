@@ -5,6 +5,7 @@
 #include <QMap>
 #include <QAction>
 #include <QDockWidget>
+#include <QLabel>
 #include "controller/controller.h"
 #include "view/widgets/sequencewidgetmanager.h"
 #include "view/widgets/streamswidgetmanager.h"
@@ -43,6 +44,9 @@ private:
     HexWidgetManager* hexManager = nullptr;
     MacroblockWidgetManager* macroblockManager = nullptr;
 
+    // Quick scan estimates, shown until the file is closed
+    QLabel *quickScanLabel = nullptr;
+
     // Helper methods
     void setupDockAreaPriorities();
     void createMenus();
@@ -56,7 +60,11 @@ private:
 
 private slots:
     void onOpenFile();
+    void onOpenStream();
     void onCloseFile();
+    void onParseFromTime();
+    void onFollowGrowingFile(bool enabled);
+    void onQuickScan(bool enabled);
     void onAboutUs();
     void onStreams();
     void onSlice();
@@ -71,6 +79,10 @@ private slots:
 
     void updateWindowTitle(const QString &title);
     void showError(const QString &message);
+    void onProbingProgress(qint64 bytesProbed);
+    void onParsingMetrics(const ParseMetrics &metrics);
+    void onParsingFinished();
+    void onQuickScanFinished(const QuickScanResult &result);
     void clearAllWidgets();
 };
 #endif // MAINWINDOW_H
@@ -1,10 +1,14 @@
 #include "view/widgets/hexwidgetmanager.h"
+#include "controller/controller.h"
 #include <QVBoxLayout>
-#include <QLabel>
+#include <QPlainTextEdit>
+#include <QFontDatabase>
 #include <QDebug>
 
 HexWidgetManager::HexWidgetManager(QWidget *parent)
     : BaseWidgetManager(parent)
+    , hexView(nullptr)
+    , connectedController(nullptr)
 {
 }
 
@@ -14,23 +18,104 @@ void HexWidgetManager::setupContentWidget()
     QVBoxLayout *layout = new QVBoxLayout(contentWidget);
     layout->setContentsMargins(0, 0, 0, 0);
 
-    // Add a placeholder label
-    QLabel *label = new QLabel("Hex View", contentWidget);
-    layout->addWidget(label);
+    // Read-only monospace text view for the dump
+    hexView = new QPlainTextEdit(contentWidget);
+    hexView->setReadOnly(true);
+    hexView->setLineWrapMode(QPlainTextEdit::NoWrap);
+    hexView->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    hexView->setPlaceholderText("Select a slice to show its bytes");
+    layout->addWidget(hexView);
 }
 
 void HexWidgetManager::setupConnections()
 {
-    // Setup any necessary connections here
+    // Packets are shown through showPacket(), connected by the main window
 }
 
 void HexWidgetManager::updateContent()
 {
-    // Update hex content here
+    // Content is updated through the showPacket slot
 }
 
 void HexWidgetManager::clearContent()
 {
-    // Clear hex widget content
+    if (hexView) {
+        hexView->clear();
+    }
     qDebug() << "Cleared hex widget content";
-} 
\ No newline at end of file
+}
+
+void HexWidgetManager::connectToController(Controller *controller)
+{
+    if (connectedController) {
+        disconnect(connectedController, &Controller::mappedFileChanged,
+                   this, &HexWidgetManager::setMappedFile);
+    }
+    
+    connectedController = controller;
+    
+    if (controller) {
+        connect(controller, &Controller::mappedFileChanged,
+                this, &HexWidgetManager::setMappedFile, Qt::QueuedConnection);
+        setMappedFile(controller->getMediaFileManager()->getMappedFile());
+    }
+}
+
+void HexWidgetManager::setMappedFile(QSharedPointer<const MappedFile> mapping)
+{
+    mappedFile = mapping;
+    clearContent();
+}
+
+void HexWidgetManager::showPacket(qint64 position, int size)
+{
+    if (!hexView) {
+        return;
+    }
+    if (!mappedFile) {
+        hexView->setPlainText("The file is not memory-mapped; no bytes to show");
+        return;
+    }
+    if (position < 0) {
+        hexView->setPlainText("The packet position is unknown");
+        return;
+    }
+    
+    // The bytes are not copied out of the mapping until they are formatted
+    const QByteArray bytes = mappedFile->bytes(position, qMin(size, MaxDumpBytes));
+    QString text = QString("Packet at offset %1, %2 bytes").arg(position).arg(size);
+    if (size > MaxDumpBytes) {
+        text += QString(" (first %1 shown)").arg(MaxDumpBytes);
+    }
+    text += "\n\n" + formatHexDump(bytes, position);
+    hexView->setPlainText(text);
+}
+
+QString HexWidgetManager::formatHexDump(const QByteArray &bytes, qint64 baseOffset)
+{
+    static const char digits[] = "0123456789abcdef";
+    QString dump;
+    dump.reserve((bytes.size() / 16 + 1) * 80);
+    
+    for (qsizetype line = 0; line < bytes.size(); line += 16) {
+        dump += QString("%1  ").arg(baseOffset + line, 10, 16, QChar('0'));
+        
+        QString ascii;
+        for (int i = 0; i < 16; ++i) {
+            if (line + i < bytes.size()) {
+                const uchar byte = static_cast<uchar>(bytes.at(line + i));
+                dump += QChar(digits[byte >> 4]);
+                dump += QChar(digits[byte & 0x0f]);
+                dump += ' ';
+                ascii += (byte >= 0x20 && byte < 0x7f) ? QChar(byte) : QChar('.');
+            } else {
+                dump += "   ";
+            }
+            if (i == 7) {
+                dump += ' ';
+            }
+        }
+        dump += " |" + ascii + "|\n";
+    }
+    return dump;
+}
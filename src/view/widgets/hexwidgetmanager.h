@@ -2,19 +2,62 @@
 #define HEXWIDGETMANAGER_H
 
 #include "common/basewidgetmanager.h"
+#include "model/mappedfile.h"
+#include <QSharedPointer>
 
+class QPlainTextEdit;
+class Controller;
+
+/**
+ * @brief The HexWidgetManager class shows the bytes of the selected packet
+ *
+ * Bytes are read from the memory mapping the demuxer reads from, so showing a packet
+ * needs no file access. Large packets are shown up to MaxDumpBytes.
+ */
 class HexWidgetManager : public BaseWidgetManager
 {
     Q_OBJECT
 
 public:
+    static constexpr int MaxDumpBytes = 64 << 10;   ///< Bytes shown per packet
+
     explicit HexWidgetManager(QWidget *parent = nullptr);
     void updateContent() override;
     void clearContent() override;
+    
+    /**
+     * @brief Connect to the controller for file mapping updates
+     * @param controller The controller to connect to
+     */
+    void connectToController(Controller *controller);
+
+public slots:
+    /**
+     * @brief Use a new mapping of the open file
+     * @param mapping The mapping, or null when the file is closed or not mapped
+     */
+    void setMappedFile(QSharedPointer<const MappedFile> mapping);
+    
+    /**
+     * @brief Show the bytes of a packet
+     * @param position Byte position of the packet in the file
+     * @param size Size of the packet in bytes
+     */
+    void showPacket(qint64 position, int size);
 
 protected:
     void setupContentWidget() override;
     void setupConnections() override;
+
+private:
+    QPlainTextEdit *hexView;                ///< Hex dump display
+    QSharedPointer<const MappedFile> mappedFile;
+    Controller *connectedController;        ///< Connected controller
+    
+    /**
+     * @brief Format bytes as offset, hex and ASCII columns, 16 bytes per line
+     */
+    static QString formatHexDump(const QByteArray &bytes, qint64 baseOffset);
 };
 
-#endif // HEXWIDGETMANAGER_H 
\ No newline at end of file
+#endif // HEXWIDGETMANAGER_H
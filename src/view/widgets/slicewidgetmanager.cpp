@@ -1,9 +1,11 @@
 #include "view/widgets/slicewidgetmanager.h"
 #include "model/slicetreemodel.h"
-#include "model/sliceprocessor.h"
+#include "model/packettable.h"
 #include "controller/controller.h"
+#include "common/logging.h"
 #include <QVBoxLayout>
 #include <QLabel>
+#include <QElapsedTimer>
 #include <QDebug>
 
 SliceWidgetManager::SliceWidgetManager(QWidget *parent)
@@ -11,38 +13,15 @@ SliceWidgetManager::SliceWidgetManager(QWidget *parent)
     , treeView(nullptr)
     , sliceModel(nullptr)
     , connectedController(nullptr)
-    , sliceProcessor(nullptr)
+    , pendingFirst(0)
+    , pendingEnd(0)
 {
-    // Create the slice processor and move it to a separate thread
-    sliceProcessor = new SliceProcessor();
-    sliceProcessor->moveToThread(&processorThread);
-    
-    // Connect thread start signal to processor's process slot
-    connect(&processorThread, &QThread::started, sliceProcessor, &SliceProcessor::process);
-    
-    // Connect processor signals to our slots
-    connect(sliceProcessor, &SliceProcessor::slicesBatchProcessed, 
-            this, &SliceWidgetManager::onSlicesBatchProcessed, Qt::QueuedConnection);
-    connect(sliceProcessor, &SliceProcessor::processingFinished,
-            this, &SliceWidgetManager::onSliceProcessingFinished, Qt::QueuedConnection);
-    
-    // Start the processor thread
-    processorThread.start();
-    sliceProcessor->start();
+    flushTimer.setInterval(FlushIntervalMs);
+    connect(&flushTimer, &QTimer::timeout, this, &SliceWidgetManager::flushPendingPackets);
 }
 
 SliceWidgetManager::~SliceWidgetManager()
 {
-    // Stop the processor and wait for the thread to finish
-    if (sliceProcessor) {
-        sliceProcessor->stop();
-    }
-    
-    processorThread.quit();
-    processorThread.wait();
-    
-    // Delete the processor (it's safe now that the thread has stopped)
-    delete sliceProcessor;
 }
 
 void SliceWidgetManager::setupContentWidget()
@@ -57,6 +36,8 @@ void SliceWidgetManager::setupContentWidget()
     treeView->setAlternatingRowColors(true);
     treeView->setAnimated(true);
     treeView->setIndentation(20);
+    // All rows share one height, which lets the view skip per-row size queries on large models
+    treeView->setUniformRowHeights(true);
     
     // Create and set the model
     sliceModel = new SliceTreeModel(this);
@@ -65,6 +46,21 @@ void SliceWidgetManager::setupContentWidget()
     // Expand the root item by default
     treeView->expandToDepth(0);
     
+    // Expand category and stream containers when they first appear, instead of
+    // re-walking the whole tree after every batch
+    connect(sliceModel, &QAbstractItemModel::modelReset, this, [this]() {
+        treeView->expandToDepth(1);
+    });
+    connect(sliceModel, &QAbstractItemModel::rowsInserted,
+            this, [this](const QModelIndex &parent, int first, int last) {
+        if (parent.isValid() && !parent.parent().isValid()) {
+            treeView->expand(parent);
+            for (int row = first; row <= last; ++row) {
+                treeView->expand(sliceModel->index(row, 0, parent));
+            }
+        }
+    });
+    
     // Add the tree view to the layout
     layout->addWidget(treeView);
 }
@@ -78,7 +74,13 @@ void SliceWidgetManager::setupConnections()
             Q_UNUSED(deselected);
             if (!selected.indexes().isEmpty()) {
                 QModelIndex index = selected.indexes().first();
-                qDebug() << "Selected slice item:" << index.data().toString();
+                qCDebug(lcSlices) << "Selected slice item:" << index.data().toString();
+                
+                const qint64 row = sliceModel->packetIndex(index);
+                const QSharedPointer<const PacketTable> &shown = estimateTable ? estimateTable : packetTable;
+                if (row >= 0 && shown && row < shown->size()) {
+                    emit packetSelected(shown->pos(row), shown->packetSize(row));
+                }
             }
         });
     }
@@ -91,62 +93,151 @@ void SliceWidgetManager::updateContent()
 
 void SliceWidgetManager::clearContent()
 {
+    clearPendingPackets();
+    packetTable.reset();
+    estimateTable.reset();
+    
     if (sliceModel) {
         sliceModel->clearSliceData();
     }
     
-    if (sliceProcessor) {
-        sliceProcessor->clearSlices();
-    }
-    
-    qDebug() << "Cleared slice widget content";
+    qCDebug(lcSlices) << "Cleared slice widget content";
 }
 
 void SliceWidgetManager::connectToController(Controller *controller)
 {
     // Disconnect from previous controller if any
     if (connectedController) {
-        disconnect(connectedController, &Controller::slicesParsed, 
-                   this, &SliceWidgetManager::onSlicesParsed);
+        disconnect(connectedController, &Controller::packetTableReset,
+                   this, &SliceWidgetManager::onPacketTableReset);
+        disconnect(connectedController, &Controller::packetsParsed, 
+                   this, &SliceWidgetManager::onPacketsParsed);
+        disconnect(connectedController, &Controller::quickScanFinished,
+                   this, &SliceWidgetManager::onQuickScanFinished);
+        disconnect(connectedController, &Controller::parsingFinished,
+                   this, &SliceWidgetManager::onParsingFinished);
     }
     
     connectedController = controller;
     
     if (controller) {
-        connect(controller, &Controller::slicesParsed, 
-                this, &SliceWidgetManager::onSlicesParsed, Qt::QueuedConnection);
-        qDebug() << "Slice widget connected to controller";
+        connect(controller, &Controller::packetTableReset,
+                this, &SliceWidgetManager::onPacketTableReset, Qt::QueuedConnection);
+        connect(controller, &Controller::packetsParsed, 
+                this, &SliceWidgetManager::onPacketsParsed, Qt::QueuedConnection);
+        connect(controller, &Controller::quickScanFinished,
+                this, &SliceWidgetManager::onQuickScanFinished, Qt::QueuedConnection);
+        connect(controller, &Controller::parsingFinished,
+                this, &SliceWidgetManager::onParsingFinished, Qt::QueuedConnection);
+        qCDebug(lcSlices) << "Slice widget connected to controller";
     }
 }
 
-void SliceWidgetManager::onSlicesParsed(const QList<SliceInfo> &slices)
+void SliceWidgetManager::onPacketTableReset(QSharedPointer<const PacketTable> table)
 {
-    if (slices.isEmpty()) {
+    clearPendingPackets();
+    packetTable = table;
+    estimateTable.reset();
+    
+    if (sliceModel) {
+        sliceModel->setPacketTable(table);
+    }
+}
+
+void SliceWidgetManager::onPacketsParsed(const PacketBatch &batch)
+{
+    if (batch.isNull() || batch.table() != packetTable) {
         return;
     }
     
-    // Queue the slices for background processing
-    if (sliceProcessor) {
-        sliceProcessor->queueSlices(slices);
+    // Ranges arrive in table order, so the pending rows stay one contiguous range; while
+    // estimates are shown it starts at the first row of the table
+    if (pendingFirst == pendingEnd && !estimateTable) {
+        pendingFirst = batch.firstIndex();
+        pendingEnd = batch.firstIndex();
     }
+    if (batch.firstIndex() != pendingEnd) {
+        qCDebug(lcSlices) << "Ignoring packet range" << batch.firstIndex() << "+" << batch.count() << "pending up to" << pendingEnd;
+        return;
+    }
+    pendingEnd = batch.endIndex();
     
-    qDebug() << "Queued" << slices.size() << "slices for background processing";
+    // Parsed packets replace the sampled ones once there are more of them
+    if (estimateTable && pendingEnd < estimateTable->size()) {
+        return;
+    }
+    showParsedPackets();
+    
+    if (!flushTimer.isActive()) {
+        flushTimer.start();
+    }
 }
 
-void SliceWidgetManager::onSlicesBatchProcessed(const QList<SliceInfo> &slices)
+void SliceWidgetManager::onQuickScanFinished(const QuickScanResult &result)
 {
-    if (sliceModel && !slices.isEmpty()) {
-        // Append the processed batch to the model
-        sliceModel->appendSliceData(slices);
-        
-        // Expand to show the first level of items
-        treeView->expandToDepth(1);
-        
-        qDebug() << "Added batch of" << slices.size() << "slices to tree model, total:" << sliceModel->getSliceCount();
+    // The scan runs alongside the parse; its sample is only shown while it is the larger one
+    if (!sliceModel || !packetTable || !result.packets || result.packets->size() <= pendingEnd) {
+        return;
+    }
+    
+    // Parsed rows already in the view are shown again once the parse overtakes the sample
+    flushTimer.stop();
+    pendingFirst = 0;
+    estimateTable = result.packets;
+    sliceModel->setPacketTable(estimateTable, true);
+    sliceModel->appendPackets(0, static_cast<int>(estimateTable->size()));
+    qCDebug(lcSlices) << "Showing" << estimateTable->size() << "sampled packets until the parse has more";
+}
+
+void SliceWidgetManager::onParsingFinished()
+{
+    // A parse that ends with fewer packets than the sample still replaces it
+    if (estimateTable) {
+        showParsedPackets();
+        if (pendingFirst != pendingEnd) {
+            flushTimer.start();
+        }
+    }
+}
+
+void SliceWidgetManager::showParsedPackets()
+{
+    if (!estimateTable) {
+        return;
+    }
+    estimateTable.reset();
+    if (sliceModel) {
+        sliceModel->setPacketTable(packetTable);
+    }
+}
+
+void SliceWidgetManager::flushPendingPackets()
+{
+    if (!sliceModel || pendingFirst == pendingEnd) {
+        flushTimer.stop();
+        return;
+    }
+    
+    QElapsedTimer budget;
+    budget.start();
+    const qint64 flushStart = pendingFirst;
+    while (pendingFirst < pendingEnd && budget.elapsed() < FlushBudgetMs) {
+        const int step = static_cast<int>(qMin<qint64>(FlushStepRows, pendingEnd - pendingFirst));
+        sliceModel->appendPackets(pendingFirst, step);
+        pendingFirst += step;
+    }
+    
+    LG_TRACE(lcSlices) << "Added" << (pendingFirst - flushStart) << "slices to tree model in" << budget.elapsed()
+             << "ms, total:" << sliceModel->getSliceCount() << "pending:" << (pendingEnd - pendingFirst);
+    
+    if (pendingFirst == pendingEnd) {
+        flushTimer.stop();
     }
 }
 
-void SliceWidgetManager::onSliceProcessingFinished()
+void SliceWidgetManager::clearPendingPackets()
 {
-    qDebug() << "Slice processing finished, total slices in model:" << sliceModel->getSliceCount();
-} 
\ No newline at end of file
+    flushTimer.stop();
+    pendingFirst = 0;
+    pendingEnd = 0;
+}
\ No newline at end of file
@@ -2,19 +2,29 @@
 #define SLICEWIDGETMANAGER_H
 
 #include "common/basewidgetmanager.h"
+#include "model/packettable.h"
+#include "model/mediafilemanager.h"
 #include <QTreeView>
-#include <QThread>
+#include <QTimer>
+#include <QSharedPointer>
 
 class SliceTreeModel;
 class Controller;
-class SliceProcessor;
-struct SliceInfo;
 
 /**
  * @brief The SliceWidgetManager class manages the slice view widget
  * 
  * This class represents the View component of the Model-View-Controller pattern
  * for slice data. It displays slice information in a tree view.
+ *
+ * Parsed packet ranges are not handed to the model as they arrive. They are gathered
+ * into one pending range and flushed at most once per display frame, and each flush
+ * stops once its time budget is spent, leaving the rest for the next frame. A fast
+ * parser therefore cannot starve the event loop of paint and input events.
+ *
+ * Packets sampled by a quick scan are shown, marked as estimates, while the parse has
+ * fewer packets than the sample; parsed packets replace them once they outnumber the
+ * sample or the parse finishes.
  */
 class SliceWidgetManager : public BaseWidgetManager
 {
@@ -49,22 +59,42 @@ public:
     void connectToController(Controller *controller);
 
 public slots:
+    /**
+     * @brief Handle a new packet table from the controller
+     * @param table The packet table the following packet ranges refer to
+     */
+    void onPacketTableReset(QSharedPointer<const PacketTable> table);
+    
     /**
      * @brief Handle slice data updates from the controller
-     * @param slices The list of slices to process
+     * @param batch The rows parsed; ignored unless it refers to the current table
      */
-    void onSlicesParsed(const QList<SliceInfo> &slices);
+    void onPacketsParsed(const PacketBatch &batch);
     
     /**
-     * @brief Handle processed slice batches from the SliceProcessor
-     * @param slices The batch of processed slices
+     * @brief Show the packets sampled by a quick scan until the parse overtakes them
+     * @param result The quick scan estimates
      */
-    void onSlicesBatchProcessed(const QList<SliceInfo> &slices);
+    void onQuickScanFinished(const QuickScanResult &result);
     
     /**
-     * @brief Handle completion of slice processing
+     * @brief Replace estimates still shown when the parse finishes
+     */
+    void onParsingFinished();
+
+signals:
+    /**
+     * @brief Signal emitted when a slice is selected in the tree
+     * @param position Byte position of the packet in the file, or -1 if unknown
+     * @param size Size of the packet in bytes
      */
-    void onSliceProcessingFinished();
+    void packetSelected(qint64 position, int size);
+
+private slots:
+    /**
+     * @brief Append pending rows to the model until the frame budget is spent
+     */
+    void flushPendingPackets();
 
 protected:
     /**
@@ -82,9 +112,25 @@ private:
     SliceTreeModel *sliceModel;       ///< Model for slice data
     Controller *connectedController;  ///< Connected controller
     
-    // Background processing
-    QThread processorThread;          ///< Thread for slice processing
-    SliceProcessor *sliceProcessor;   ///< Slice processor for background processing
+    // Frame-paced model updates
+    static const int FlushIntervalMs = 16;  ///< At most one flush per 60 Hz frame
+    static const int FlushBudgetMs = 8;     ///< UI thread time one flush may take
+    static const int FlushStepRows = 4096;  ///< Rows appended between budget checks
+    QSharedPointer<const PacketTable> packetTable; ///< Table parsed packets are appended to
+    QSharedPointer<const PacketTable> estimateTable; ///< Sampled packets the model shows meanwhile, or null
+    QTimer flushTimer;                ///< Drives flushes while rows are pending
+    qint64 pendingFirst;              ///< First packet table row not yet in the model
+    qint64 pendingEnd;                ///< One past the last parsed row
+    
+    /**
+     * @brief Drop rows that were parsed but not yet shown
+     */
+    void clearPendingPackets();
+    
+    /**
+     * @brief Switch the model from the sampled packets to the parsed ones, if estimates are shown
+     */
+    void showParsedPackets();
 };
 
 #endif // SLICEWIDGETMANAGER_H 
\ No newline at end of file
@@ -0,0 +1,116 @@
+#ifndef BITWRITER_H
+#define BITWRITER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QtGlobal>
+
+/**
+ * @brief The BitWriter class builds the RBSPs and NAL units the tests feed to the parsers
+ *
+ * Fields are appended MSB first, as the syntax tables of H.264 and HEVC list them;
+ * nalUnit() closes the RBSP with its trailing bits, inserts the emulation prevention
+ * bytes and puts the unit header in front.
+ */
+class BitWriter
+{
+public:
+    void writeBits(quint64 value, int bits)
+    {
+        for (int i = bits - 1; i >= 0; --i) {
+            if (bitCount % 8 == 0) {
+                data.append('\0');
+            }
+            if ((value >> i) & 1) {
+                data[data.size() - 1] = static_cast<char>(data.at(data.size() - 1) | (0x80 >> (bitCount % 8)));
+            }
+            ++bitCount;
+        }
+    }
+
+    void writeFlag(bool flag) { writeBits(flag ? 1 : 0, 1); }
+
+    void writeUe(quint32 value)
+    {
+        const quint64 code = quint64(value) + 1;
+        int length = 0;
+        while ((code >> (length + 1)) != 0) {
+            ++length;
+        }
+        writeBits(0, length);
+        writeBits(code, length + 1);
+    }
+
+    void writeSe(qint32 value)
+    {
+        writeUe(value <= 0 ? static_cast<quint32>(-2 * qint64(value)) : static_cast<quint32>(2 * qint64(value) - 1));
+    }
+
+    /**
+     * @brief Get the bits written so far, the last byte padded with zero bits
+     */
+    QByteArray bytes() const { return data; }
+
+    /**
+     * @brief Close the RBSP and turn it into a NAL unit
+     * @param header The NAL unit header: one byte for H.264, two for HEVC
+     */
+    QByteArray nalUnit(const QByteArray &header)
+    {
+        writeBits(1, 1);          // rbsp_stop_one_bit
+        writeBits(0, (8 - bitCount % 8) % 8);
+        return header + escape(data);
+    }
+
+    /**
+     * @brief Insert emulation prevention bytes where an RBSP would imitate a start code
+     */
+    static QByteArray escape(const QByteArray &rbsp)
+    {
+        QByteArray escaped;
+        int zeros = 0;
+        for (const char byte : rbsp) {
+            if (zeros >= 2 && static_cast<uchar>(byte) <= 3) {
+                escaped.append('\3');
+                zeros = 0;
+            }
+            escaped.append(byte);
+            zeros = byte == 0 ? zeros + 1 : 0;
+        }
+        return escaped;
+    }
+
+    /**
+     * @brief Join units into an Annex B payload, each behind a four-byte start code
+     */
+    static QByteArray annexB(const QList<QByteArray> &units)
+    {
+        QByteArray payload;
+        for (const QByteArray &unit : units) {
+            payload.append(QByteArray::fromHex("00000001"));
+            payload.append(unit);
+        }
+        return payload;
+    }
+
+    /**
+     * @brief Join units into an MP4 style sample, each behind a big-endian length field
+     */
+    static QByteArray lengthPrefixed(const QList<QByteArray> &units, int lengthSize)
+    {
+        QByteArray sample;
+        for (const QByteArray &unit : units) {
+            for (int i = lengthSize - 1; i >= 0; --i) {
+                sample.append(static_cast<char>((unit.size() >> (8 * i)) & 0xFF));
+            }
+            sample.append(unit);
+        }
+        return sample;
+    }
+
+private:
+    QByteArray data;
+    int bitCount = 0;
+};
+
+#endif // BITWRITER_H
@@ -0,0 +1,343 @@
+#ifndef NALUNITS_H
+#define NALUNITS_H
+
+#include "bitwriter.h"
+
+/**
+ * @brief Builders for the parameter sets and slices of small H.264 and HEVC test streams
+ *
+ * Each builder writes the syntax elements of one unit with the fields a test varies as
+ * parameters and fixed values elsewhere, and returns the escaped unit with its header.
+ */
+namespace NalUnits {
+
+enum H264SliceType {
+    H264P = 0,
+    H264B = 1,
+    H264I = 2
+};
+
+// Baseline profile SPS of a 1920x1088 progressive stream: 4-bit frame_num, 6-bit POC LSB for type 0
+inline QByteArray h264Sps(int id, int pocType)
+{
+    BitWriter writer;
+    writer.writeBits(66, 8);      // profile_idc
+    writer.writeBits(0, 8);       // constraint flags
+    writer.writeBits(40, 8);      // level_idc
+    writer.writeUe(id);
+    writer.writeUe(0);            // log2_max_frame_num_minus4
+    writer.writeUe(pocType);
+    if (pocType == 0) {
+        writer.writeUe(2);        // log2_max_pic_order_cnt_lsb_minus4
+    }
+    writer.writeUe(2);            // max_num_ref_frames
+    writer.writeFlag(false);      // gaps_in_frame_num_value_allowed_flag
+    writer.writeUe(119);          // pic_width_in_mbs_minus1
+    writer.writeUe(67);           // pic_height_in_map_units_minus1
+    writer.writeFlag(true);       // frame_mbs_only_flag
+    writer.writeFlag(true);       // direct_8x8_inference_flag
+    writer.writeFlag(false);      // frame_cropping_flag
+    writer.writeFlag(false);      // vui_parameters_present_flag
+    return writer.nalUnit(QByteArray::fromHex("67"));
+}
+
+// CAVLC PPS with one reference per list by default and pic_init_qp 26
+inline QByteArray h264Pps(int id, int spsId)
+{
+    BitWriter writer;
+    writer.writeUe(id);
+    writer.writeUe(spsId);
+    writer.writeFlag(false);      // entropy_coding_mode_flag
+    writer.writeFlag(false);      // bottom_field_pic_order_in_frame_present_flag
+    writer.writeUe(0);            // num_slice_groups_minus1
+    writer.writeUe(0);            // num_ref_idx_l0_default_active_minus1
+    writer.writeUe(0);            // num_ref_idx_l1_default_active_minus1
+    writer.writeFlag(false);      // weighted_pred_flag
+    writer.writeBits(0, 2);       // weighted_bipred_idc
+    writer.writeSe(0);            // pic_init_qp_minus26
+    writer.writeSe(0);            // pic_init_qs_minus26
+    writer.writeSe(0);            // chroma_qp_index_offset
+    writer.writeFlag(true);       // deblocking_filter_control_present_flag
+    writer.writeFlag(false);      // constrained_intra_pred_flag
+    writer.writeFlag(false);      // redundant_pic_cnt_present_flag
+    return writer.nalUnit(QByteArray::fromHex("68"));
+}
+
+struct H264Slice {
+    int type = H264I;
+    bool idr = false;
+    bool reference = true;
+    int frameNum = 0;
+    int pocLsb = 0;               ///< Only coded for POC type 0
+    int qpDelta = 0;
+    int firstMb = 0;
+    int ppsId = 0;
+};
+
+// A slice of a picture of h264Sps() and h264Pps()
+inline QByteArray h264Slice(const H264Slice &slice, int pocType = 0)
+{
+    BitWriter writer;
+    writer.writeUe(slice.firstMb);
+    writer.writeUe(slice.type + 5);
+    writer.writeUe(slice.ppsId);
+    writer.writeBits(slice.frameNum, 4);
+    if (slice.idr) {
+        writer.writeUe(0);        // idr_pic_id
+    }
+    if (pocType == 0) {
+        writer.writeBits(slice.pocLsb, 6);
+    }
+    if (slice.type == H264B) {
+        writer.writeFlag(true);   // direct_spatial_mv_pred_flag
+    }
+    if (slice.type != H264I) {
+        writer.writeFlag(false);  // num_ref_idx_active_override_flag
+        writer.writeFlag(false);  // ref_pic_list_modification_flag_l0
+        if (slice.type == H264B) {
+            writer.writeFlag(false);
+        }
+    }
+    if (slice.reference) {
+        writer.writeBits(0, slice.idr ? 2 : 1);   // dec_ref_pic_marking()
+    }
+    writer.writeSe(slice.qpDelta);
+    writer.writeUe(1);            // disable_deblocking_filter_idc
+
+    const int nalRefIdc = slice.reference ? 3 : 0;
+    return writer.nalUnit(QByteArray(1, static_cast<char>((nalRefIdc << 5) | (slice.idr ? 5 : 1))));
+}
+
+enum HevcSliceType {
+    HevcB = 0,
+    HevcP = 1,
+    HevcI = 2
+};
+
+enum HevcUnitType {
+    HevcTrailN = 0,
+    HevcTrailR = 1,
+    HevcIdrWRadl = 19,
+    HevcCra = 21,
+    HevcVps = 32,
+    HevcSps = 33,
+    HevcPps = 34,
+    HevcEos = 36
+};
+
+inline QByteArray hevcHeader(int type, int temporalId = 0)
+{
+    QByteArray header(2, '\0');
+    header[0] = static_cast<char>(type << 1);
+    header[1] = static_cast<char>(temporalId + 1);
+    return header;
+}
+
+// General profile, tier and level of a profile_tier_level(); the defaults are Main
+// profile, Main tier, level 4.1
+struct HevcProfileTierLevel {
+    int profileIdc = 1;
+    quint32 compatibility = 0x60000000;   ///< general_profile_compatibility_flag[0] in the top bit
+    bool highTier = false;
+    int levelIdc = 123;
+    int maxSubLayersMinus1 = 0;           ///< Sub-layers get a profile and a level of their own
+};
+
+inline void writeHevcProfileTierLevel(BitWriter &writer, const HevcProfileTierLevel &ptl = HevcProfileTierLevel())
+{
+    writer.writeBits(0, 2);           // general_profile_space
+    writer.writeFlag(ptl.highTier);
+    writer.writeBits(static_cast<quint64>(ptl.profileIdc), 5);
+    writer.writeBits(ptl.compatibility, 32);
+    writer.writeBits(0xB, 4);         // progressive, interlaced, non-packed, frame-only constraint flags
+    writer.writeBits(0, 43);          // general_reserved_zero_43bits
+    writer.writeFlag(false);          // general_inbld_flag
+    writer.writeBits(static_cast<quint64>(ptl.levelIdc), 8);
+    for (int i = 0; i < ptl.maxSubLayersMinus1; ++i) {
+        writer.writeFlag(true);       // sub_layer_profile_present_flag
+        writer.writeFlag(true);       // sub_layer_level_present_flag
+    }
+    if (ptl.maxSubLayersMinus1 > 0) {
+        writer.writeBits(0, 2 * (8 - ptl.maxSubLayersMinus1));
+    }
+    for (int i = 0; i < ptl.maxSubLayersMinus1; ++i) {
+        writer.writeBits(0x7F, 56);   // sub-layer profile space, tier, idc and most flags, with ones to skip
+        writer.writeBits(0xFFFFFFFF, 32);
+        writer.writeBits(0x55, 8);    // sub_layer_level_idc
+    }
+}
+
+// VPS of a single-layer stream
+inline QByteArray hevcVps(int id, const HevcProfileTierLevel &ptl = HevcProfileTierLevel())
+{
+    BitWriter writer;
+    writer.writeBits(static_cast<quint64>(id), 4);
+    writer.writeFlag(true);       // vps_base_layer_internal_flag
+    writer.writeFlag(true);       // vps_base_layer_available_flag
+    writer.writeBits(0, 6);       // vps_max_layers_minus1
+    writer.writeBits(static_cast<quint64>(ptl.maxSubLayersMinus1), 3);
+    writer.writeFlag(true);       // vps_temporal_id_nesting_flag
+    writer.writeBits(0xFFFF, 16); // vps_reserved_0xffff_16bits
+    writeHevcProfileTierLevel(writer, ptl);
+    writer.writeFlag(false);      // vps_sub_layer_ordering_info_present_flag
+    writer.writeUe(4);            // vps_max_dec_pic_buffering_minus1
+    writer.writeUe(2);            // vps_max_num_reorder_pics
+    writer.writeUe(0);            // vps_max_latency_increase_plus1
+    writer.writeBits(0, 6);       // vps_max_layer_id
+    writer.writeUe(0);            // vps_num_layer_sets_minus1
+    writer.writeFlag(false);      // vps_timing_info_present_flag
+    writer.writeFlag(false);      // vps_extension_flag
+    return writer.nalUnit(hevcHeader(HevcVps));
+}
+
+// SPS of a 1920x1080 4:2:0 stream with 64x64 CTBs (510 per picture), an 8-bit POC LSB
+// and one short-term reference picture set that refers to the picture before
+inline QByteArray hevcSps()
+{
+    BitWriter writer;
+    writer.writeBits(0, 4);       // sps_video_parameter_set_id
+    writer.writeBits(0, 3);       // sps_max_sub_layers_minus1
+    writer.writeFlag(true);       // sps_temporal_id_nesting_flag
+    writeHevcProfileTierLevel(writer);
+    writer.writeUe(0);            // sps_seq_parameter_set_id
+    writer.writeUe(1);            // chroma_format_idc
+    writer.writeUe(1920);
+    writer.writeUe(1080);
+    writer.writeFlag(false);      // conformance_window_flag
+    writer.writeUe(0);            // bit_depth_luma_minus8
+    writer.writeUe(0);            // bit_depth_chroma_minus8
+    writer.writeUe(4);            // log2_max_pic_order_cnt_lsb_minus4
+    writer.writeFlag(true);       // sps_sub_layer_ordering_info_present_flag
+    writer.writeUe(4);
+    writer.writeUe(2);
+    writer.writeUe(0);
+    writer.writeUe(0);            // log2_min_luma_coding_block_size_minus3
+    writer.writeUe(3);            // log2_diff_max_min_luma_coding_block_size
+    writer.writeUe(0);
+    writer.writeUe(3);
+    writer.writeUe(1);
+    writer.writeUe(1);
+    writer.writeFlag(false);      // scaling_list_enabled_flag
+    writer.writeFlag(true);       // amp_enabled_flag
+    writer.writeFlag(false);      // sample_adaptive_offset_enabled_flag
+    writer.writeFlag(false);      // pcm_enabled_flag
+    writer.writeUe(1);            // num_short_term_ref_pic_sets
+    writer.writeUe(1);            // num_negative_pics
+    writer.writeUe(0);            // num_positive_pics
+    writer.writeUe(0);            // delta_poc_s0_minus1
+    writer.writeFlag(true);       // used_by_curr_pic_s0_flag
+    writer.writeFlag(false);      // long_term_ref_pics_present_flag
+    writer.writeFlag(false);      // sps_temporal_mvp_enabled_flag
+    writer.writeFlag(true);       // strong_intra_smoothing_enabled_flag
+    writer.writeFlag(false);      // vui_parameters_present_flag
+    writer.writeFlag(false);      // sps_extension_present_flag
+    return writer.nalUnit(hevcHeader(HevcSps));
+}
+
+struct HevcPpsFields {
+    bool dependentSlices = false;
+    int tileColumns = 1;          ///< Tiles are enabled when above 1
+    int tileRows = 1;
+    bool wavefront = false;
+};
+
+// PPS 0 with one reference per list by default and init_qp 26
+inline QByteArray hevcPps(const HevcPpsFields &fields = HevcPpsFields())
+{
+    const bool tiles = fields.tileColumns > 1 || fields.tileRows > 1;
+    BitWriter writer;
+    writer.writeUe(0);            // pps_pic_parameter_set_id
+    writer.writeUe(0);            // pps_seq_parameter_set_id
+    writer.writeFlag(fields.dependentSlices);
+    writer.writeFlag(false);      // output_flag_present_flag
+    writer.writeBits(0, 3);       // num_extra_slice_header_bits
+    writer.writeFlag(false);      // sign_data_hiding_enabled_flag
+    writer.writeFlag(false);      // cabac_init_present_flag
+    writer.writeUe(0);            // num_ref_idx_l0_default_active_minus1
+    writer.writeUe(0);            // num_ref_idx_l1_default_active_minus1
+    writer.writeSe(0);            // init_qp_minus26
+    writer.writeFlag(false);      // constrained_intra_pred_flag
+    writer.writeFlag(false);      // transform_skip_enabled_flag
+    writer.writeFlag(false);      // cu_qp_delta_enabled_flag
+    writer.writeSe(0);            // pps_cb_qp_offset
+    writer.writeSe(0);            // pps_cr_qp_offset
+    writer.writeFlag(false);      // pps_slice_chroma_qp_offsets_present_flag
+    writer.writeFlag(false);      // weighted_pred_flag
+    writer.writeFlag(false);      // weighted_bipred_flag
+    writer.writeFlag(false);      // transquant_bypass_enabled_flag
+    writer.writeFlag(tiles);
+    writer.writeFlag(fields.wavefront);
+    if (tiles) {
+        writer.writeUe(fields.tileColumns - 1);
+        writer.writeUe(fields.tileRows - 1);
+        writer.writeFlag(true);   // uniform_spacing_flag
+        writer.writeFlag(true);   // loop_filter_across_tiles_enabled_flag
+    }
+    writer.writeFlag(false);      // pps_loop_filter_across_slices_enabled_flag
+    writer.writeFlag(false);      // deblocking_filter_control_present_flag
+    writer.writeFlag(false);      // pps_scaling_list_data_present_flag
+    writer.writeFlag(false);      // lists_modification_present_flag
+    writer.writeUe(0);            // log2_parallel_merge_level_minus2
+    writer.writeFlag(false);      // slice_segment_header_extension_present_flag
+    writer.writeFlag(false);      // pps_extension_present_flag
+    return writer.nalUnit(hevcHeader(HevcPps));
+}
+
+struct HevcSlice {
+    int unitType = HevcIdrWRadl;
+    int temporalId = 0;
+    int type = HevcI;
+    int pocLsb = 0;               ///< Not coded for IDR pictures
+    int qpDelta = 0;
+    int address = 0;              ///< slice_segment_address; 0 for the first segment of a picture
+    bool dependent = false;       ///< Only coded if the PPS allows dependent segments
+    int entryPoints = 0;          ///< Only coded if the PPS enables tiles or wavefronts
+};
+
+// A slice segment of a picture of hevcSps() and the PPS built from ppsFields
+inline QByteArray hevcSlice(const HevcSlice &slice, const HevcPpsFields &ppsFields = HevcPpsFields())
+{
+    const bool irap = slice.unitType >= 16 && slice.unitType <= 23;
+    const bool idr = slice.unitType == HevcIdrWRadl || slice.unitType == 20;
+    BitWriter writer;
+    writer.writeFlag(slice.address == 0);   // first_slice_segment_in_pic_flag
+    if (irap) {
+        writer.writeFlag(false);  // no_output_of_prior_pics_flag
+    }
+    writer.writeUe(0);            // slice_pic_parameter_set_id
+    if (slice.address != 0) {
+        if (ppsFields.dependentSlices) {
+            writer.writeFlag(slice.dependent);
+        }
+        writer.writeBits(slice.address, 9);
+    }
+    if (!slice.dependent) {
+        writer.writeUe(slice.type);
+        if (!idr) {
+            writer.writeBits(slice.pocLsb, 8);
+            writer.writeFlag(true);   // short_term_ref_pic_set_sps_flag, the only set takes no index bits
+        }
+        if (slice.type != HevcI) {
+            writer.writeFlag(false);  // num_ref_idx_active_override_flag
+            if (slice.type == HevcB) {
+                writer.writeFlag(false);  // mvd_l1_zero_flag
+            }
+            writer.writeUe(0);        // five_minus_max_num_merge_cand
+        }
+        writer.writeSe(slice.qpDelta);
+    }
+    if (ppsFields.tileColumns > 1 || ppsFields.tileRows > 1 || ppsFields.wavefront) {
+        writer.writeUe(slice.entryPoints);
+        if (slice.entryPoints > 0) {
+            writer.writeUe(7);        // offset_len_minus1
+            for (int i = 0; i < slice.entryPoints; ++i) {
+                writer.writeBits(0x55, 8);    // entry_point_offset_minus1
+            }
+        }
+    }
+    return writer.nalUnit(hevcHeader(slice.unitType, slice.temporalId));
+}
+
+} // namespace NalUnits
+
+#endif // NALUNITS_H
@@ -0,0 +1,99 @@
+#include "bitreader.h"
+#include "bitwriter.h"
+#include <QtTest>
+
+class TestBitReader : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void readsFixedWidthFields();
+    void readsExpGolombCodes();
+    void skipsAcrossTheCache();
+    void flagsReadsPastTheEnd();
+    void flagsOverlongCodes();
+};
+
+void TestBitReader::readsFixedWidthFields()
+{
+    // Every width from 1 to 32, so fields straddle bytes and cache refills
+    BitWriter writer;
+    for (int bits = 1; bits <= 32; ++bits) {
+        writer.writeBits((quint64(0x9E3779B9) * bits) & ((quint64(1) << bits) - 1), bits);
+    }
+    const QByteArray data = writer.bytes();
+
+    BitReader reader(reinterpret_cast<const uchar *>(data.constData()), data.size());
+    for (int bits = 1; bits <= 32; ++bits) {
+        QCOMPARE(quint64(reader.readBits(bits)), (quint64(0x9E3779B9) * bits) & ((quint64(1) << bits) - 1));
+    }
+    QVERIFY(!reader.isOverrun());
+    QVERIFY(reader.bitsLeft() < 8);
+}
+
+void TestBitReader::readsExpGolombCodes()
+{
+    const QVector<quint32> unsignedValues = { 0, 1, 2, 3, 6, 7, 254, 255, 65535, 1u << 20, 0xFFFFFFFEu };
+    const QVector<qint32> signedValues = { 0, 1, -1, 2, -2, 26, -26, 1000, -1000, 32767, -32768 };
+
+    // A leading bit puts the codes off byte boundaries
+    BitWriter writer;
+    writer.writeFlag(true);
+    for (int i = 0; i < unsignedValues.size(); ++i) {
+        writer.writeUe(unsignedValues.at(i));
+        writer.writeSe(signedValues.at(i));
+    }
+    const QByteArray data = writer.bytes();
+
+    BitReader reader(reinterpret_cast<const uchar *>(data.constData()), data.size());
+    QVERIFY(reader.readFlag());
+    for (int i = 0; i < unsignedValues.size(); ++i) {
+        QCOMPARE(reader.readUe(), unsignedValues.at(i));
+        QCOMPARE(reader.readSe(), signedValues.at(i));
+    }
+    QVERIFY(!reader.isOverrun());
+}
+
+void TestBitReader::skipsAcrossTheCache()
+{
+    BitWriter writer;
+    writer.writeBits(0x5, 3);
+    writer.writeBits(0, 32);
+    writer.writeBits(0xFFFFFFFF, 32);
+    writer.writeBits(0x1234, 16);
+    writer.writeBits(0x2A, 6);
+    writer.writeUe(300);
+    const QByteArray data = writer.bytes();
+
+    BitReader reader(reinterpret_cast<const uchar *>(data.constData()), data.size());
+    QCOMPARE(reader.readBits(3), 0x5u);
+    reader.skipBits(80);
+    QCOMPARE(reader.readBits(6), 0x2Au);
+    QCOMPARE(reader.readUe(), 300u);
+    QVERIFY(!reader.isOverrun());
+}
+
+void TestBitReader::flagsReadsPastTheEnd()
+{
+    const uchar data[] = { 0xA5, 0x0F };
+    BitReader reader(data, sizeof(data));
+    QCOMPARE(reader.readBits(16), 0xA50Fu);
+    QVERIFY(!reader.isOverrun());
+    QCOMPARE(reader.bitsLeft(), qint64(0));
+
+    // Reads past the end return zero bits
+    QCOMPARE(reader.readBits(4), 0u);
+    QVERIFY(reader.isOverrun());
+}
+
+void TestBitReader::flagsOverlongCodes()
+{
+    // 40 zero bits cannot start a ue(v) code of 32 bits or less
+    const uchar data[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    BitReader reader(data, sizeof(data));
+    reader.readUe();
+    QVERIFY(reader.isOverrun());
+}
+
+QTEST_GUILESS_MAIN(TestBitReader)
+#include "tst_bitreader.moc"
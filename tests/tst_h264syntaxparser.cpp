@@ -0,0 +1,202 @@
+#include "h264syntaxparser.h"
+#include "nalunits.h"
+#include <QtTest>
+#include <climits>
+
+using namespace NalUnits;
+
+namespace {
+
+bool parse(H264SyntaxParser &parser, const QByteArray &unit, NalSliceHeader &header)
+{
+    return parser.parseUnit(reinterpret_cast<const uchar *>(unit.constData()), unit.size(), header);
+}
+
+// The POC of a slice, or a value no test expects if it is not parsed
+qint32 pocOf(H264SyntaxParser &parser, const H264Slice &fields, int pocType = 0)
+{
+    NalSliceHeader header;
+    return parse(parser, h264Slice(fields, pocType), header) ? header.poc : INT_MIN;
+}
+
+} // namespace
+
+class TestH264SyntaxParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void skipsSlicesWithoutParameterSets();
+    void readsSliceFields();
+    void readsParameterSetsFromAvcC();
+    void derivesPocTypeZero();
+    void keepsThePocOfLaterSlices();
+    void derivesPocTypeTwo();
+};
+
+void TestH264SyntaxParser::skipsSlicesWithoutParameterSets()
+{
+    H264SyntaxParser parser;
+    NalSliceHeader header;
+    H264Slice idr;
+    idr.idr = true;
+    QVERIFY(!parse(parser, h264Slice(idr), header));
+    QVERIFY(!parse(parser, h264Sps(0, 0), header));
+    QVERIFY(!parse(parser, h264Slice(idr), header));
+    QVERIFY(!parse(parser, h264Pps(0, 0), header));
+    QVERIFY(parse(parser, h264Slice(idr), header));
+}
+
+void TestH264SyntaxParser::readsSliceFields()
+{
+    H264SyntaxParser parser;
+    NalSliceHeader header;
+    parse(parser, h264Sps(0, 0), header);
+    parse(parser, h264Pps(0, 0), header);
+
+    H264Slice idr;
+    idr.idr = true;
+    idr.qpDelta = 3;
+    QVERIFY(parse(parser, h264Slice(idr), header));
+    QCOMPARE(int(header.sliceType), int(H264I));
+    QCOMPARE(int(header.qpDelta), 3);
+    QCOMPARE(int(header.qp), 29);
+    QCOMPARE(header.frameNum, 0);
+    QCOMPARE(header.poc, 0);
+    QCOMPARE(int(header.refIdxL0), 0);
+    QCOMPARE(int(header.refIdxL1), 0);
+    QCOMPARE(int(header.fieldPic), 0);
+
+    H264Slice b;
+    b.type = H264B;
+    b.reference = false;
+    b.frameNum = 1;
+    b.pocLsb = 2;
+    b.qpDelta = -4;
+    b.firstMb = 0;
+    QVERIFY(parse(parser, h264Slice(b), header));
+    QCOMPARE(int(header.sliceType), int(H264B));
+    QCOMPARE(int(header.qp), 22);
+    QCOMPARE(header.frameNum, 1);
+    QCOMPARE(header.poc, 2);
+    QCOMPARE(int(header.refIdxL0), 1);
+    QCOMPARE(int(header.refIdxL1), 1);
+}
+
+void TestH264SyntaxParser::readsParameterSetsFromAvcC()
+{
+    const QByteArray spsUnit = h264Sps(0, 0);
+    const QByteArray ppsUnit = h264Pps(0, 0);
+    QByteArray avcC = QByteArray::fromHex("0142c028ffe1");
+    avcC.append(static_cast<char>(spsUnit.size() >> 8)).append(static_cast<char>(spsUnit.size() & 0xFF)).append(spsUnit);
+    avcC.append('\1');
+    avcC.append(static_cast<char>(ppsUnit.size() >> 8)).append(static_cast<char>(ppsUnit.size() & 0xFF)).append(ppsUnit);
+
+    H264SyntaxParser parser;
+    parser.parseConfig(reinterpret_cast<const uchar *>(avcC.constData()), avcC.size());
+    NalSliceHeader header;
+    H264Slice idr;
+    idr.idr = true;
+    QVERIFY(parse(parser, h264Slice(idr), header));
+}
+
+void TestH264SyntaxParser::derivesPocTypeZero()
+{
+    H264SyntaxParser parser;
+    NalSliceHeader header;
+    parse(parser, h264Sps(0, 0), header);
+    parse(parser, h264Pps(0, 0), header);
+
+    H264Slice picture;
+    picture.idr = true;
+    QCOMPARE(pocOf(parser, picture), 0);
+
+    // Reference pictures climb through the 64-value LSB range and wrap
+    picture.idr = false;
+    picture.type = H264P;
+    const int lsbs[] = { 20, 40, 60, 16, 36 };
+    const qint32 pocs[] = { 20, 40, 60, 80, 100 };
+    for (int i = 0; i < 5; ++i) {
+        picture.frameNum = i + 1;
+        picture.pocLsb = lsbs[i];
+        QCOMPARE(pocOf(parser, picture), pocs[i]);
+    }
+
+    // A non-reference picture does not move the base: 50 after 36 (POC 100) is 114,
+    // and 30 after it still counts from 36
+    picture.type = H264B;
+    picture.reference = false;
+    picture.pocLsb = 50;
+    QCOMPARE(pocOf(parser, picture), 114);
+    picture.pocLsb = 30;
+    QCOMPARE(pocOf(parser, picture), 94);
+
+    // An IDR picture starts over
+    picture.idr = true;
+    picture.type = H264I;
+    picture.reference = true;
+    picture.frameNum = 0;
+    picture.pocLsb = 0;
+    QCOMPARE(pocOf(parser, picture), 0);
+
+    // An LSB more than half the range above the last one goes down a period
+    picture.idr = false;
+    picture.type = H264P;
+    picture.frameNum = 1;
+    picture.pocLsb = 60;
+    QCOMPARE(pocOf(parser, picture), -4);
+}
+
+void TestH264SyntaxParser::keepsThePocOfLaterSlices()
+{
+    H264SyntaxParser parser;
+    NalSliceHeader header;
+    parse(parser, h264Sps(0, 0), header);
+    parse(parser, h264Pps(0, 0), header);
+
+    H264Slice picture;
+    picture.idr = true;
+    QCOMPARE(pocOf(parser, picture), 0);
+    picture.idr = false;
+    picture.type = H264P;
+    picture.frameNum = 1;
+    picture.pocLsb = 8;
+    QCOMPARE(pocOf(parser, picture), 8);
+
+    // A later slice of the same picture repeats frame_num; its POC is the picture's
+    picture.firstMb = 4080;
+    QVERIFY(parse(parser, h264Slice(picture), header));
+    QCOMPARE(header.firstMb, 4080);
+    QCOMPARE(header.poc, 8);
+}
+
+void TestH264SyntaxParser::derivesPocTypeTwo()
+{
+    H264SyntaxParser parser;
+    NalSliceHeader header;
+    parse(parser, h264Sps(1, 2), header);
+    parse(parser, h264Pps(1, 1), header);
+
+    // Output order is decoding order: twice the frame count, one less for non-reference pictures
+    H264Slice picture;
+    picture.ppsId = 1;
+    picture.idr = true;
+    QCOMPARE(pocOf(parser, picture, 2), 0);
+    picture.idr = false;
+    picture.type = H264P;
+    picture.frameNum = 1;
+    QCOMPARE(pocOf(parser, picture, 2), 2);
+    picture.reference = false;
+    picture.frameNum = 2;
+    QCOMPARE(pocOf(parser, picture, 2), 3);
+
+    // frame_num wraps after 15 and the offset carries the count on
+    picture.reference = true;
+    picture.frameNum = 15;
+    QCOMPARE(pocOf(parser, picture, 2), 30);
+    picture.frameNum = 0;
+    QCOMPARE(pocOf(parser, picture, 2), 32);
+}
+
+QTEST_GUILESS_MAIN(TestH264SyntaxParser)
+#include "tst_h264syntaxparser.moc"
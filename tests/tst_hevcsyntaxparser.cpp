@@ -0,0 +1,258 @@
+#include "hevcsyntaxparser.h"
+#include "nalunits.h"
+#include <QtTest>
+#include <climits>
+
+using namespace NalUnits;
+
+namespace {
+
+bool parse(HevcSyntaxParser &parser, const QByteArray &unit, NalSliceHeader &header)
+{
+    return parser.parseUnit(reinterpret_cast<const uchar *>(unit.constData()), unit.size(), header);
+}
+
+// The POC of the picture a segment starts, or a value no test expects if it is not parsed
+qint32 pocOf(HevcSyntaxParser &parser, int unitType, int pocLsb, int temporalId = 0)
+{
+    HevcSlice slice;
+    slice.unitType = unitType;
+    slice.temporalId = temporalId;
+    slice.type = unitType >= 16 ? HevcI : HevcP;
+    slice.pocLsb = pocLsb;
+    NalSliceHeader header;
+    return parse(parser, hevcSlice(slice), header) ? header.poc : INT_MIN;
+}
+
+void parseParameterSets(HevcSyntaxParser &parser, const HevcPpsFields &ppsFields = HevcPpsFields())
+{
+    NalSliceHeader header;
+    parse(parser, hevcSps(), header);
+    parse(parser, hevcPps(ppsFields), header);
+}
+
+} // namespace
+
+class TestHevcSyntaxParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void skipsSlicesWithoutParameterSets();
+    void readsSliceSegmentFields();
+    void readsTilesAndEntryPoints();
+    void sharesFieldsWithDependentSegments();
+    void readsParameterSetsFromHvcC();
+    void derivesPoc();
+    void restartsPocAtSequenceStarts();
+    void readsProfileTierLevel();
+    void derivesProfileFromCompatibilityFlags();
+};
+
+void TestHevcSyntaxParser::skipsSlicesWithoutParameterSets()
+{
+    HevcSyntaxParser parser;
+    NalSliceHeader header;
+    QVERIFY(!parse(parser, hevcSlice(HevcSlice()), header));
+    QVERIFY(!parse(parser, hevcSps(), header));
+    QVERIFY(!parse(parser, hevcPps(), header));
+    QVERIFY(parse(parser, hevcSlice(HevcSlice()), header));
+}
+
+void TestHevcSyntaxParser::readsSliceSegmentFields()
+{
+    HevcSyntaxParser parser;
+    parseParameterSets(parser);
+    NalSliceHeader header;
+
+    HevcSlice idr;
+    idr.qpDelta = -2;
+    QVERIFY(parse(parser, hevcSlice(idr), header));
+    QCOMPARE(int(header.sliceType), 2);
+    QCOMPARE(int(header.qpDelta), -2);
+    QCOMPARE(int(header.qp), 24);
+    QCOMPARE(header.poc, 0);
+    QCOMPARE(int(header.rpsNegative), 0);
+    QCOMPARE(int(header.dependent), 0);
+    QCOMPARE(int(header.tileColumns), 1);
+    QCOMPARE(int(header.wavefront), 0);
+
+    // P slices refer to the SPS reference picture set, with the picture before in it;
+    // slice types are reported in the H.264 numbering
+    HevcSlice trail;
+    trail.unitType = HevcTrailR;
+    trail.type = HevcP;
+    trail.pocLsb = 1;
+    trail.qpDelta = 1;
+    QVERIFY(parse(parser, hevcSlice(trail), header));
+    QCOMPARE(int(header.sliceType), 0);
+    QCOMPARE(int(header.qp), 27);
+    QCOMPARE(header.poc, 1);
+    QCOMPARE(int(header.refIdxL0), 1);
+    QCOMPARE(int(header.refIdxL1), 0);
+    QCOMPARE(int(header.rpsNegative), 1);
+    QCOMPARE(int(header.rpsPositive), 0);
+    QCOMPARE(int(header.rpsUsed), 1);
+    QCOMPARE(int(header.longTermRefs), 0);
+
+    trail.type = HevcB;
+    trail.pocLsb = 2;
+    QVERIFY(parse(parser, hevcSlice(trail), header));
+    QCOMPARE(int(header.sliceType), 1);
+    QCOMPARE(int(header.refIdxL1), 1);
+}
+
+void TestHevcSyntaxParser::readsTilesAndEntryPoints()
+{
+    HevcPpsFields tiles;
+    tiles.tileColumns = 4;
+    tiles.tileRows = 2;
+    HevcSyntaxParser parser;
+    parseParameterSets(parser, tiles);
+    NalSliceHeader header;
+
+    HevcSlice idr;
+    idr.entryPoints = 7;
+    QVERIFY(parse(parser, hevcSlice(idr, tiles), header));
+    QCOMPARE(int(header.tileColumns), 4);
+    QCOMPARE(int(header.tileRows), 2);
+    QCOMPARE(int(header.entryPoints), 7);
+    QCOMPARE(int(header.wavefront), 0);
+
+    HevcPpsFields wavefront;
+    wavefront.wavefront = true;
+    parseParameterSets(parser, wavefront);
+    idr.entryPoints = 16;
+    QVERIFY(parse(parser, hevcSlice(idr, wavefront), header));
+    QCOMPARE(int(header.tileColumns), 1);
+    QCOMPARE(int(header.wavefront), 1);
+    QCOMPARE(int(header.entryPoints), 16);
+}
+
+void TestHevcSyntaxParser::sharesFieldsWithDependentSegments()
+{
+    HevcPpsFields fields;
+    fields.dependentSlices = true;
+    HevcSyntaxParser parser;
+    parseParameterSets(parser, fields);
+    NalSliceHeader header;
+
+    HevcSlice independent;
+    independent.qpDelta = 5;
+    QVERIFY(parse(parser, hevcSlice(independent, fields), header));
+
+    HevcSlice dependent;
+    dependent.address = 255;
+    dependent.dependent = true;
+    QVERIFY(parse(parser, hevcSlice(dependent, fields), header));
+    QCOMPARE(int(header.dependent), 1);
+    QCOMPARE(header.firstMb, 255);
+    QCOMPARE(int(header.sliceType), 2);
+    QCOMPARE(int(header.qp), 31);
+
+    // Addresses lie within the 510 CTBs of a picture
+    dependent.address = 510;
+    QVERIFY(!parse(parser, hevcSlice(dependent, fields), header));
+}
+
+void TestHevcSyntaxParser::readsParameterSetsFromHvcC()
+{
+    // HEVCDecoderConfigurationRecord with four-byte lengths and one array per set
+    QByteArray hvcC(22, '\0');
+    hvcC[0] = 1;
+    hvcC[21] = 0x03;
+    hvcC.append('\3');
+    for (const QByteArray &unit : { hevcVps(0), hevcSps(), hevcPps() }) {
+        hvcC.append(static_cast<char>(unit.at(0) >> 1)).append('\0').append('\1');
+        hvcC.append(static_cast<char>(unit.size() >> 8)).append(static_cast<char>(unit.size() & 0xFF)).append(unit);
+    }
+
+    HevcSyntaxParser parser;
+    parser.parseConfig(reinterpret_cast<const uchar *>(hvcC.constData()), hvcC.size());
+    NalSliceHeader header;
+    QVERIFY(parse(parser, hevcSlice(HevcSlice()), header));
+    QCOMPARE(parser.profileTierLevel().profileIdc, 1);
+    QCOMPARE(parser.profileTierLevel().levelIdc, 123);
+}
+
+void TestHevcSyntaxParser::derivesPoc()
+{
+    HevcSyntaxParser parser;
+    parseParameterSets(parser);
+
+    QCOMPARE(pocOf(parser, HevcIdrWRadl, 0), 0);
+
+    // Climbing through the 256-value LSB range and wrapping
+    QCOMPARE(pocOf(parser, HevcTrailR, 100), 100);
+    QCOMPARE(pocOf(parser, HevcTrailR, 200), 200);
+    QCOMPARE(pocOf(parser, HevcTrailR, 40), 296);
+
+    // Sub-layer non-reference pictures and pictures above temporal layer 0 do not move
+    // the base: both jump more than half the range from 40, but 50 still counts from it
+    QCOMPARE(pocOf(parser, HevcTrailN, 180), 180);
+    QCOMPARE(pocOf(parser, HevcTrailR, 190, 1), 190);
+    QCOMPARE(pocOf(parser, HevcTrailR, 50), 306);
+
+    // An IDR picture starts over; an LSB more than half the range above goes down a period
+    QCOMPARE(pocOf(parser, HevcIdrWRadl, 0), 0);
+    QCOMPARE(pocOf(parser, HevcTrailR, 240), -16);
+}
+
+void TestHevcSyntaxParser::restartsPocAtSequenceStarts()
+{
+    HevcSyntaxParser parser;
+    parseParameterSets(parser);
+
+    // A CRA picture that starts the stream takes its LSB as its POC
+    QCOMPARE(pocOf(parser, HevcCra, 100), 100);
+    QCOMPARE(pocOf(parser, HevcTrailR, 240), -16);
+
+    // Within a sequence a CRA picture counts on from the pictures before it
+    QCOMPARE(pocOf(parser, HevcCra, 250), -6);
+
+    // After an end of sequence it starts a new one
+    NalSliceHeader header;
+    QVERIFY(!parse(parser, hevcHeader(HevcEos) + QByteArray(1, '\0'), header));
+    QCOMPARE(pocOf(parser, HevcCra, 250), 250);
+}
+
+void TestHevcSyntaxParser::readsProfileTierLevel()
+{
+    HevcSyntaxParser parser;
+    QVERIFY(!parser.profileTierLevel().isValid());
+
+    // Main 10, High tier, level 5.1, with a sub-layer whose profile and level are skipped
+    HevcProfileTierLevel main10;
+    main10.profileIdc = 2;
+    main10.compatibility = 0x20000000;
+    main10.highTier = true;
+    main10.levelIdc = 153;
+    main10.maxSubLayersMinus1 = 1;
+    NalSliceHeader header;
+    QVERIFY(!parse(parser, hevcVps(3, main10), header));
+    QVERIFY(parser.profileTierLevel().isValid());
+    QCOMPARE(parser.profileTierLevel().profileIdc, 2);
+    QCOMPARE(parser.profileTierLevel().highTier, true);
+    QCOMPARE(parser.profileTierLevel().levelIdc, 153);
+
+    // The SPS, once read, is what the stream's slices refer to
+    parseParameterSets(parser);
+    QVERIFY(parse(parser, hevcSlice(HevcSlice()), header));
+    QCOMPARE(parser.profileTierLevel().profileIdc, 1);
+    QCOMPARE(parser.profileTierLevel().highTier, false);
+    QCOMPARE(parser.profileTierLevel().levelIdc, 123);
+}
+
+void TestHevcSyntaxParser::derivesProfileFromCompatibilityFlags()
+{
+    HevcProfileTierLevel unset;
+    unset.profileIdc = 0;
+    unset.compatibility = 0x20000000;
+    HevcSyntaxParser parser;
+    NalSliceHeader header;
+    parse(parser, hevcVps(0, unset), header);
+    QCOMPARE(parser.profileTierLevel().profileIdc, 2);
+}
+
+QTEST_GUILESS_MAIN(TestHevcSyntaxParser)
+#include "tst_hevcsyntaxparser.moc"
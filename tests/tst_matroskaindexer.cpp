@@ -0,0 +1,221 @@
+#include "matroskaindexer.h"
+#include "nalunits.h"
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+// FFmpeg headers
+extern "C" {
+#include <libavutil/avutil.h>
+}
+
+using namespace NalUnits;
+
+namespace {
+
+// An element with its ID as written in the file and an eight-byte size
+QByteArray element(quint32 id, const QByteArray &payload)
+{
+    QByteArray bytes;
+    for (int shift = id > 0xFFFFFF ? 24 : (id > 0xFFFF ? 16 : (id > 0xFF ? 8 : 0)); shift >= 0; shift -= 8) {
+        bytes.append(static_cast<char>(id >> shift));
+    }
+    bytes.append('\x01');
+    for (int shift = 48; shift >= 0; shift -= 8) {
+        bytes.append(static_cast<char>(quint64(payload.size()) >> shift));
+    }
+    return bytes + payload;
+}
+
+QByteArray unknownSizeElement(quint32 id, const QByteArray &payload)
+{
+    QByteArray bytes = element(id, QByteArray());
+    bytes.chop(7);
+    return bytes + QByteArray(7, '\xFF') + payload;
+}
+
+QByteArray uintElement(quint32 id, quint32 value)
+{
+    QByteArray bytes(4, '\0');
+    for (int i = 0; i < 4; ++i) {
+        bytes[i] = static_cast<char>(value >> (24 - 8 * i));
+    }
+    return element(id, bytes);
+}
+
+// Track number, relative timecode and flags, then the lace header and frames
+QByteArray block(int track, qint16 timecode, quint8 flags, const QByteArray &frames)
+{
+    QByteArray bytes;
+    bytes.append(static_cast<char>(0x80 | track));
+    bytes.append(static_cast<char>(timecode >> 8)).append(static_cast<char>(timecode & 0xFF));
+    bytes.append(static_cast<char>(flags));
+    return bytes + frames;
+}
+
+// The EBML header, then the Segment
+QByteArray matroskaFile(const QByteArray &segment)
+{
+    return element(0x1A45DFA3, QByteArray()) + segment;
+}
+
+QByteArray trackEntry(int number, quint32 defaultDuration)
+{
+    return element(0xAE, uintElement(0xD7, static_cast<quint32>(number)) + uintElement(0x23E383, defaultDuration));
+}
+
+} // namespace
+
+class TestMatroskaIndexer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void readsBlocksAndLaces();
+    void splitsH264FramesIntoNalUnits();
+    void resynchronizesAfterDamagedData();
+    void rejectsFilesWithoutClusters();
+
+private:
+    QTemporaryDir directory;
+    QHash<int, StreamMapping> trackStreams;
+    QByteArray header;
+    QByteArray firstCluster;
+    QByteArray secondCluster;
+
+    QString writeFile(const QString &name, const QByteArray &data);
+};
+
+void TestMatroskaIndexer::initTestCase()
+{
+    QVERIFY(directory.isValid());
+
+    StreamMapping video;
+    video.streamIndex = 0;
+    video.streamType = StreamType::Video;
+    video.nalCodec = NalCodec::H264;
+    trackStreams.insert(1, video);
+    StreamMapping audio;
+    audio.streamIndex = 1;
+    audio.streamType = StreamType::Audio;
+    trackStreams.insert(2, audio);
+
+    // Millisecond timecodes; 40 ms video frames and 20 ms audio frames. Track 3 has no stream.
+    header = element(0x1549A966, uintElement(0x2AD7B1, 1000000));
+    header += element(0x1654AE6B, trackEntry(1, 40000000) + trackEntry(2, 20000000) + trackEntry(3, 0));
+
+    // An IDR picture with its parameter sets in Annex B form, Xiph-laced audio, a block of
+    // the unmapped track, and a P picture in a BlockGroup that references another block
+    H264Slice slice;
+    slice.idr = true;
+    const QByteArray idr = BitWriter::annexB({ h264Sps(0, 0), h264Pps(0, 0), h264Slice(slice) });
+    slice.idr = false;
+    slice.type = H264P;
+    slice.frameNum = 1;
+    slice.pocLsb = 4;
+    const QByteArray p = BitWriter::annexB({ h264Slice(slice) });
+    firstCluster = uintElement(0xE7, 1000);
+    firstCluster += element(0xA3, block(1, 0, 0x80, idr));
+    firstCluster += element(0xA3, block(2, 0, 0x82, QByteArray::fromHex("02ff2d05") + QByteArray(312, '\x11')));
+    firstCluster += element(0xA3, block(3, 0, 0x80, QByteArray(9, '\x22')));
+    firstCluster += element(0xA0, element(0xA1, block(1, 40, 0x00, p)) + uintElement(0x9B, 40)
+                                  + element(0xFB, QByteArray(1, '\xD8')));
+    firstCluster = element(0x1F43B675, firstCluster);
+
+    // EBML-laced frames of 10, 12 and 8 bytes, then fixed-size lacing on a discardable block
+    secondCluster = uintElement(0xE7, 2000);
+    secondCluster += element(0xA3, block(2, 0, 0x86, QByteArray::fromHex("028ac1") + QByteArray(30, '\x33')));
+    secondCluster += element(0xA3, block(2, 60, 0x85, QByteArray::fromHex("01") + QByteArray(12, '\x44')));
+}
+
+QString TestMatroskaIndexer::writeFile(const QString &name, const QByteArray &data)
+{
+    const QString path = directory.filePath(name);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return QString();
+    }
+    file.write(data);
+    return path;
+}
+
+void TestMatroskaIndexer::readsBlocksAndLaces()
+{
+    const QByteArray file = matroskaFile(unknownSizeElement(0x18538067, header + firstCluster
+                                                            + unknownSizeElement(0x1F43B675, secondCluster)));
+    MatroskaIndexer indexer(writeFile("laces.mkv", file), trackStreams, nullptr);
+    QVERIFY(indexer.load());
+    PacketTable packets;
+    qint64 batched = 0;
+    QVERIFY(indexer.appendTo(packets, [&](qint64, int count, qint64) { batched += count; }));
+    QCOMPARE(packets.size(), qint64(10));
+    QCOMPARE(batched, qint64(10));
+
+    // Laced frames after the first take their timestamps from the default duration
+    const int streams[] = { 0, 1, 1, 1, 0, 1, 1, 1, 1, 1 };
+    const qint64 pts[] = { 1000, 1000, 1020, 1040, 1040, 2000, 2020, 2040, 2060, 2080 };
+    const qint32 sizes[] = { 0, 300, 5, 7, 0, 10, 12, 8, 6, 6 };
+    const bool keys[] = { true, true, true, true, false, true, true, true, true, true };
+    for (int row = 0; row < 10; ++row) {
+        QCOMPARE(packets.streamIndex(row), streams[row]);
+        QCOMPARE(packets.pts(row), pts[row]);
+        QCOMPARE(packets.dts(row), qint64(AV_NOPTS_VALUE));
+        QCOMPARE(packets.duration(row), streams[row] == 0 ? 40 : 20);
+        QCOMPARE(packets.isKeyFrame(row), keys[row]);
+        if (sizes[row] > 0) {
+            QCOMPARE(packets.packetSize(row), sizes[row]);
+        }
+    }
+
+    // Every frame points at the block it came from
+    for (int row = 0; row < 10; ++row) {
+        QCOMPARE(int(uchar(file.at(packets.pos(row)))), 0x80 | (streams[row] + 1));
+    }
+    QCOMPARE(packets.pos(2), packets.pos(1));
+    QVERIFY(!(packets.flags(7) & PacketTable::DiscardFlag));
+    QVERIFY(packets.flags(8) & PacketTable::DiscardFlag);
+}
+
+void TestMatroskaIndexer::splitsH264FramesIntoNalUnits()
+{
+    const QByteArray data = header + firstCluster;
+    MatroskaIndexer indexer(writeFile("units.mkv", matroskaFile(element(0x18538067, data))), trackStreams, nullptr);
+    QVERIFY(indexer.load());
+    PacketTable packets;
+    QVERIFY(indexer.appendTo(packets, MatroskaIndexer::BatchCallback()));
+    QCOMPARE(packets.size(), qint64(5));
+
+    const NalIndex &units = packets.nalUnits();
+    qint64 first = 0;
+    QCOMPARE(units.unitsOf(1, first), 0);
+    QCOMPARE(units.unitsOf(0, first), 3);
+    QCOMPARE(int(units.type(first)), 7);
+    QCOMPARE(int(units.type(first + 1)), 8);
+    QCOMPARE(int(units.type(first + 2)), 5);
+    QCOMPARE(int(units.sliceHeader(first + 2).sliceType), int(H264I));
+    QCOMPARE(units.unitsOf(4, first), 1);
+    QCOMPARE(units.sliceHeader(first).frameNum, 1);
+    QCOMPARE(units.sliceHeader(first).poc, 4);
+}
+
+void TestMatroskaIndexer::resynchronizesAfterDamagedData()
+{
+    // Zero bytes are no element ID; the scan for the next Cluster ID finds the second cluster
+    const QByteArray data = header + firstCluster + QByteArray(5, '\0') + element(0x1F43B675, secondCluster);
+    MatroskaIndexer indexer(writeFile("damaged.mkv", matroskaFile(element(0x18538067, data))), trackStreams, nullptr);
+    QVERIFY(indexer.load());
+    PacketTable packets;
+    QVERIFY(indexer.appendTo(packets, MatroskaIndexer::BatchCallback()));
+    QCOMPARE(packets.size(), qint64(10));
+    QCOMPARE(packets.pts(5), qint64(2000));
+}
+
+void TestMatroskaIndexer::rejectsFilesWithoutClusters()
+{
+    MatroskaIndexer indexer(writeFile("empty.mkv", matroskaFile(element(0x18538067, header))), trackStreams, nullptr);
+    QVERIFY(!indexer.load());
+}
+
+QTEST_GUILESS_MAIN(TestMatroskaIndexer)
+#include "tst_matroskaindexer.moc"
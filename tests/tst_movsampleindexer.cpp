@@ -0,0 +1,232 @@
+#include "movsampleindexer.h"
+#include "nalunits.h"
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+using namespace NalUnits;
+
+namespace {
+
+QByteArray be32(quint32 value)
+{
+    QByteArray bytes(4, '\0');
+    for (int i = 0; i < 4; ++i) {
+        bytes[i] = static_cast<char>(value >> (24 - 8 * i));
+    }
+    return bytes;
+}
+
+QByteArray box(const char *type, const QByteArray &payload)
+{
+    return be32(static_cast<quint32>(8 + payload.size())) + QByteArray(type, 4) + payload;
+}
+
+// Version and flags, then the payload
+QByteArray fullBox(const char *type, const QByteArray &payload)
+{
+    return box(type, be32(0) + payload);
+}
+
+QByteArray table(const QList<quint32> &values)
+{
+    QByteArray bytes;
+    for (quint32 value : values) {
+        bytes += be32(value);
+    }
+    return bytes;
+}
+
+QByteArray avcC(const QByteArray &sps, const QByteArray &pps)
+{
+    QByteArray config = QByteArray::fromHex("0142c028ffe1");
+    config.append(static_cast<char>(sps.size() >> 8)).append(static_cast<char>(sps.size() & 0xFF)).append(sps);
+    config.append('\1');
+    config.append(static_cast<char>(pps.size() >> 8)).append(static_cast<char>(pps.size() & 0xFF)).append(pps);
+    return config;
+}
+
+QByteArray trak(quint32 trackId, const QByteArray &stbl)
+{
+    // tkhd version 0: times, then the track ID
+    const QByteArray tkhd = fullBox("tkhd", table({ 0, 0, trackId }) + QByteArray(68, '\0'));
+    return box("trak", tkhd + box("mdia", box("minf", box("stbl", stbl))));
+}
+
+} // namespace
+
+class TestMovSampleIndexer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void mergesTracksByFilePosition();
+    void splitsH264SamplesIntoNalUnits();
+    void rejectsFragmentedFiles();
+    void rejectsChunksThatMissSamples();
+
+private:
+    QTemporaryDir directory;
+    QHash<int, StreamMapping> trackStreams;
+    QList<QByteArray> videoSamples;
+    qint64 videoChunks[2] = {};
+    qint64 audioChunk = 0;
+
+    QString writeFile(const QString &name, const QByteArray &moov, const QByteArray &mdat);
+    QByteArray videoStbl(const QList<quint32> &stsc) const;
+    QByteArray audioStbl() const;
+};
+
+void TestMovSampleIndexer::initTestCase()
+{
+    QVERIFY(directory.isValid());
+
+    // An IDR picture and two P pictures in length-prefixed samples; the parameter sets are in avcC
+    H264Slice slice;
+    slice.idr = true;
+    videoSamples.append(BitWriter::lengthPrefixed({ h264Slice(slice) }, 4));
+    slice.idr = false;
+    slice.type = H264P;
+    slice.frameNum = 1;
+    slice.pocLsb = 4;
+    videoSamples.append(BitWriter::lengthPrefixed({ h264Slice(slice) }, 4));
+    slice.frameNum = 2;
+    slice.pocLsb = 8;
+    videoSamples.append(BitWriter::lengthPrefixed({ h264Slice(slice), h264Slice(slice) }, 4));
+
+    StreamMapping video;
+    video.streamIndex = 0;
+    video.streamType = StreamType::Video;
+    video.nalCodec = NalCodec::H264;
+    video.codecConfig = avcC(h264Sps(0, 0), h264Pps(0, 0));
+    trackStreams.insert(1, video);
+    StreamMapping audio;
+    audio.streamIndex = 1;
+    audio.streamType = StreamType::Audio;
+    trackStreams.insert(2, audio);
+
+    // mdat: the first two video samples, three audio samples, then the last video sample
+    const qint64 mdatStart = 20 + 8;
+    videoChunks[0] = mdatStart;
+    audioChunk = videoChunks[0] + videoSamples[0].size() + videoSamples[1].size();
+    videoChunks[1] = audioChunk + 30;
+}
+
+QString TestMovSampleIndexer::writeFile(const QString &name, const QByteArray &moov, const QByteArray &mdat)
+{
+    const QString path = directory.filePath(name);
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return QString();
+    }
+    file.write(box("ftyp", QByteArray("isom") + be32(0x200) + QByteArray("isom")));
+    file.write(box("mdat", mdat));
+    file.write(box("moov", moov));
+    return path;
+}
+
+QByteArray TestMovSampleIndexer::videoStbl(const QList<quint32> &stsc) const
+{
+    QByteArray stbl;
+    stbl += fullBox("stts", table({ 1, 3, 512 }));
+    stbl += fullBox("ctts", table({ 3, 1, 1024, 1, 0, 1, 512 }));
+    stbl += fullBox("stss", table({ 1, 1 }));
+    stbl += fullBox("stsc", be32(static_cast<quint32>(stsc.size() / 3)) + table(stsc));
+    stbl += fullBox("stsz", table({ 0, 3 }) + table({ quint32(videoSamples[0].size()), quint32(videoSamples[1].size()),
+                                                      quint32(videoSamples[2].size()) }));
+    stbl += fullBox("stco", table({ 2, quint32(videoChunks[0]), quint32(videoChunks[1]) }));
+    return stbl;
+}
+
+QByteArray TestMovSampleIndexer::audioStbl() const
+{
+    // Uniform 10-byte samples in one chunk, no stss: every sample is a sync sample
+    QByteArray stbl;
+    stbl += fullBox("stts", table({ 1, 3, 1024 }));
+    stbl += fullBox("stsc", table({ 1, 1, 3, 1 }));
+    stbl += fullBox("stsz", table({ 10, 3 }));
+    stbl += fullBox("stco", table({ 1, quint32(audioChunk) }));
+    return stbl;
+}
+
+void TestMovSampleIndexer::mergesTracksByFilePosition()
+{
+    const QByteArray mdat = videoSamples[0] + videoSamples[1] + QByteArray(30, '\x55') + videoSamples[2];
+    const QByteArray moov = trak(1, videoStbl({ 1, 2, 1, 2, 1, 1 })) + trak(2, audioStbl());
+    const QString path = writeFile("merged.mp4", moov, mdat);
+
+    MovSampleIndexer indexer(path, trackStreams, nullptr);
+    QVERIFY(indexer.load());
+    QCOMPARE(indexer.sampleCount(), qint64(6));
+    PacketTable packets;
+    qint64 batched = 0;
+    QVERIFY(indexer.appendTo(packets, [&](qint64, int count) { batched += count; }));
+    QCOMPARE(packets.size(), qint64(6));
+    QCOMPARE(batched, qint64(6));
+
+    // Rows are in file order; timestamps are the raw table values with the composition offsets
+    const int streams[] = { 0, 0, 1, 1, 1, 0 };
+    const qint64 pts[] = { 1024, 512, 0, 1024, 2048, 1536 };
+    const qint64 dts[] = { 0, 512, 0, 1024, 2048, 1024 };
+    const qint64 pos[] = { videoChunks[0], videoChunks[0] + videoSamples[0].size(), audioChunk, audioChunk + 10,
+                           audioChunk + 20, videoChunks[1] };
+    const bool keys[] = { true, false, true, true, true, false };
+    for (int row = 0; row < 6; ++row) {
+        QCOMPARE(packets.streamIndex(row), streams[row]);
+        QCOMPARE(packets.streamType(row), streams[row] == 0 ? StreamType::Video : StreamType::Audio);
+        QCOMPARE(packets.pts(row), pts[row]);
+        QCOMPARE(packets.dts(row), dts[row]);
+        QCOMPARE(packets.pos(row), pos[row]);
+        QCOMPARE(packets.duration(row), streams[row] == 0 ? 512 : 1024);
+        QCOMPARE(packets.isKeyFrame(row), keys[row]);
+    }
+    QCOMPARE(packets.packetSize(0), qint32(videoSamples[0].size()));
+    QCOMPARE(packets.packetSize(2), qint32(10));
+}
+
+void TestMovSampleIndexer::splitsH264SamplesIntoNalUnits()
+{
+    const QByteArray mdat = videoSamples[0] + videoSamples[1] + QByteArray(30, '\x55') + videoSamples[2];
+    const QByteArray moov = trak(1, videoStbl({ 1, 2, 1, 2, 1, 1 })) + trak(2, audioStbl());
+    const QString path = writeFile("units.mp4", moov, mdat);
+
+    MovSampleIndexer indexer(path, trackStreams, nullptr);
+    QVERIFY(indexer.load());
+    PacketTable packets;
+    QVERIFY(indexer.appendTo(packets, MovSampleIndexer::BatchCallback()));
+
+    // Audio packets are not split; the slices of video packets have their headers parsed
+    const NalIndex &units = packets.nalUnits();
+    qint64 first = 0;
+    QCOMPARE(units.unitsOf(2, first), 0);
+    QCOMPARE(units.unitsOf(0, first), 1);
+    QCOMPARE(units.offset(first), 4);
+    QCOMPARE(int(units.type(first)), 5);
+    QCOMPARE(int(units.sliceHeader(first).sliceType), int(H264I));
+    QCOMPARE(units.sliceHeader(first).poc, 0);
+    QCOMPARE(units.unitsOf(1, first), 1);
+    QCOMPARE(units.sliceHeader(first).poc, 4);
+    QCOMPARE(units.unitsOf(5, first), 2);
+    QCOMPARE(units.packetRow(first + 1), qint64(5));
+    QCOMPARE(units.sliceHeader(first + 1).frameNum, 2);
+    QCOMPARE(units.sliceHeader(first + 1).poc, 8);
+}
+
+void TestMovSampleIndexer::rejectsFragmentedFiles()
+{
+    const QByteArray moov = trak(1, videoStbl({ 1, 2, 1, 2, 1, 1 })) + box("mvex", QByteArray());
+    MovSampleIndexer indexer(writeFile("fragmented.mp4", moov, QByteArray(64, '\0')), trackStreams, nullptr);
+    QVERIFY(!indexer.load());
+}
+
+void TestMovSampleIndexer::rejectsChunksThatMissSamples()
+{
+    // One sample per chunk leaves the third sample outside the two chunks
+    const QByteArray moov = trak(1, videoStbl({ 1, 1, 1 }));
+    MovSampleIndexer indexer(writeFile("short.mp4", moov, QByteArray(64, '\0')), trackStreams, nullptr);
+    QVERIFY(!indexer.load());
+}
+
+QTEST_GUILESS_MAIN(TestMovSampleIndexer)
+#include "tst_movsampleindexer.moc"
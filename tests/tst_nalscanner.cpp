@@ -0,0 +1,190 @@
+#include "nalscanner.h"
+#include "bitwriter.h"
+#include <QRandomGenerator>
+#include <QtTest>
+
+namespace {
+
+// An SPS, a PPS and an IDR slice of H.264; the SPS and the slice need emulation prevention
+const QByteArray kSps = QByteArray::fromHex("67") + BitWriter::escape(QByteArray::fromHex("4200000100000010"));
+const QByteArray kPps = QByteArray::fromHex("68ce3c80");
+const QByteArray kIdr = QByteArray::fromHex("65") + BitWriter::escape(QByteArray::fromHex("88000003000002ff"));
+
+const uchar *bytes(const QByteArray &data)
+{
+    return reinterpret_cast<const uchar *>(data.constData());
+}
+
+// Start codes written out by hand, one of them three bytes long, and trailing zero bytes
+QByteArray annexBPayload()
+{
+    return QByteArray::fromHex("00000001") + kSps + QByteArray::fromHex("000001") + kPps
+           + QByteArray::fromHex("00000001") + kIdr + QByteArray::fromHex("0000");
+}
+
+int naiveFindCandidate(const uchar *data, int size, int from)
+{
+    for (int i = from; i + 2 < size; ++i) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] <= 3) {
+            return i;
+        }
+    }
+    return size;
+}
+
+} // namespace
+
+class TestNalScanner : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void escapesTheTestUnits();
+    void splitsAtStartCodes();
+    void splitsPayloadsFedInPieces();
+    void splitsLengthPrefixedSamples();
+    void stopsAtTruncatedLengths();
+    void findsCandidatesLikeTheNaiveSearch();
+    void readsHevcUnitTypes();
+    void benchmarkFindCandidate();
+};
+
+void TestNalScanner::escapesTheTestUnits()
+{
+    QCOMPARE(kSps, QByteArray::fromHex("6742000003010000030010"));
+    QCOMPARE(kIdr, QByteArray::fromHex("65880000030300000302ff"));
+    QCOMPARE(NalScanner::countEmulationBytes(bytes(kSps), kSps.size()), 2);
+    QCOMPARE(NalScanner::countEmulationBytes(bytes(kPps), kPps.size()), 0);
+}
+
+void TestNalScanner::splitsAtStartCodes()
+{
+    const QByteArray payload = annexBPayload();
+    NalScanner scanner(NalCodec::H264);
+    QVector<NalUnit> units;
+    scanner.begin();
+    scanner.feed(bytes(payload), payload.size(), units);
+    scanner.finish(units);
+
+    QCOMPARE(int(units.size()), 3);
+    QCOMPARE(units.at(0).offset, 4);
+    QCOMPARE(units.at(0).size, int(kSps.size()));
+    QCOMPARE(int(units.at(0).type), 7);
+    QCOMPARE(int(units.at(0).emulationBytes), 2);
+
+    // The zero byte before a four-byte start code is not part of the unit before it
+    QCOMPARE(units.at(1).offset, 4 + int(kSps.size()) + 3);
+    QCOMPARE(units.at(1).size, int(kPps.size()));
+    QCOMPARE(int(units.at(1).type), 8);
+    QCOMPARE(int(units.at(1).emulationBytes), 0);
+
+    QCOMPARE(units.at(2).offset, units.at(1).offset + int(kPps.size()) + 4);
+    QCOMPARE(units.at(2).size, int(kIdr.size()));
+    QCOMPARE(int(units.at(2).type), 5);
+    QCOMPARE(int(units.at(2).emulationBytes), 2);
+}
+
+void TestNalScanner::splitsPayloadsFedInPieces()
+{
+    const QByteArray payload = annexBPayload();
+    NalScanner scanner(NalCodec::H264);
+    QVector<NalUnit> whole;
+    scanner.begin();
+    scanner.feed(bytes(payload), payload.size(), whole);
+    scanner.finish(whole);
+
+    // Small pieces split start codes and emulation prevention triples between feeds
+    for (int piece = 1; piece <= 7; ++piece) {
+        QVector<NalUnit> units;
+        scanner.begin();
+        for (int pos = 0; pos < payload.size(); pos += piece) {
+            scanner.feed(bytes(payload) + pos, qMin(piece, int(payload.size()) - pos), units);
+        }
+        scanner.finish(units);
+
+        QCOMPARE(int(units.size()), int(whole.size()));
+        for (int i = 0; i < units.size(); ++i) {
+            QCOMPARE(units.at(i).offset, whole.at(i).offset);
+            QCOMPARE(units.at(i).size, whole.at(i).size);
+            QCOMPARE(units.at(i).type, whole.at(i).type);
+            QCOMPARE(units.at(i).emulationBytes, whole.at(i).emulationBytes);
+        }
+    }
+}
+
+void TestNalScanner::splitsLengthPrefixedSamples()
+{
+    const QByteArray sample = BitWriter::lengthPrefixed({ kSps, kPps, kIdr }, 4);
+    NalScanner scanner(NalCodec::H264);
+    QVector<NalUnit> units;
+    QVERIFY(scanner.scanLengthPrefixed(bytes(sample), sample.size(), 4, units));
+
+    QCOMPARE(int(units.size()), 3);
+    QCOMPARE(units.at(0).offset, 4);
+    QCOMPARE(units.at(1).offset, 4 + int(kSps.size()) + 4);
+    QCOMPARE(units.at(2).offset, units.at(1).offset + int(kPps.size()) + 4);
+    QCOMPARE(units.at(2).size, int(kIdr.size()));
+    QCOMPARE(int(units.at(2).type), 5);
+    QCOMPARE(int(units.at(2).emulationBytes), 2);
+}
+
+void TestNalScanner::stopsAtTruncatedLengths()
+{
+    QByteArray sample = BitWriter::lengthPrefixed({ kSps, kIdr }, 2);
+    sample.chop(3);
+
+    NalScanner scanner(NalCodec::H264);
+    QVector<NalUnit> units;
+    QVERIFY(!scanner.scanLengthPrefixed(bytes(sample), sample.size(), 2, units));
+    QCOMPARE(int(units.size()), 1);
+    QCOMPARE(units.at(0).size, int(kSps.size()));
+}
+
+void TestNalScanner::findsCandidatesLikeTheNaiveSearch()
+{
+    // Mostly zero bytes, so triples start at every alignment the vector kernels handle
+    QRandomGenerator random(7);
+    for (int round = 0; round < 2000; ++round) {
+        QByteArray data(static_cast<int>(random.bounded(300)), '\0');
+        for (char &byte : data) {
+            const quint32 roll = random.bounded(8);
+            byte = static_cast<char>(roll < 4 ? 0 : (roll == 4 ? random.bounded(4) : random.bounded(256)));
+        }
+        const int from = static_cast<int>(random.bounded(data.size() + 1));
+        QCOMPARE(NalScanner::findCandidate(bytes(data), data.size(), from),
+                 naiveFindCandidate(bytes(data), data.size(), from));
+    }
+}
+
+void TestNalScanner::readsHevcUnitTypes()
+{
+    QCOMPARE(int(NalScanner::unitType(NalCodec::Hevc, 0x40)), 32);
+    QCOMPARE(int(NalScanner::unitType(NalCodec::Hevc, 0x26)), 19);
+    QCOMPARE(int(NalScanner::unitType(NalCodec::H264, 0x65)), 5);
+}
+
+void TestNalScanner::benchmarkFindCandidate()
+{
+    // Random video-like data with a start code every 20000 bytes
+    QByteArray data(4 << 20, '\0');
+    QRandomGenerator random(1);
+    random.fillRange(reinterpret_cast<quint32 *>(data.data()), data.size() / 4);
+    for (int i = 0; i + 3 <= data.size(); i += 20000) {
+        data[i] = 0;
+        data[i + 1] = 0;
+        data[i + 2] = 1;
+    }
+
+    int candidates = 0;
+    QBENCHMARK {
+        candidates = 0;
+        for (int i = NalScanner::findCandidate(bytes(data), data.size(), 0); i < data.size();
+             i = NalScanner::findCandidate(bytes(data), data.size(), i + 1)) {
+            ++candidates;
+        }
+    }
+    QVERIFY(candidates >= data.size() / 20000);
+}
+
+QTEST_GUILESS_MAIN(TestNalScanner)
+#include "tst_nalscanner.moc"
@@ -0,0 +1,317 @@
+#include "packetindexcache.h"
+#include "nalpayloadindexer.h"
+#include "nalunits.h"
+#include <QFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace {
+
+// Two and a half packet chunks, with two NAL units on every third packet
+constexpr qint64 kPacketCount = 2 * PacketTable::ChunkSize + PacketTable::ChunkSize / 2;
+
+void fill(PacketTable &table, qint64 from, qint64 to)
+{
+    for (qint64 row = from; row < to; ++row) {
+        table.appendRow(row * 3, row * 3 - 1, row * 100, 40, static_cast<qint32>(row % 1000),
+                        static_cast<quint16>(row % 3), static_cast<quint8>(row % 7));
+        if (row % 3 != 0) {
+            continue;
+        }
+        NalSliceHeader header;
+        header.sliceType = static_cast<qint8>(row % 5);
+        header.frameNum = static_cast<qint32>(row & 0xFF);
+        header.poc = static_cast<qint32>(row * 2);
+        header.qp = 26;
+        header.entryPoints = static_cast<quint16>(row % 9);
+        const NalUnit parameterSet = { 0, 10, 7, 0 };
+        const NalUnit slice = { 14, static_cast<qint32>(row % 500 + 1), 1, static_cast<quint16>(row % 4) };
+        table.nalUnits().append(row, NalCodec::H264, parameterSet);
+        table.nalUnits().append(row, NalCodec::H264, slice, &header);
+    }
+}
+
+// Append a packet and split its Annex B payload into units, parsing the slice headers
+void appendPayload(PacketTable &table, NalPayloadIndexer &payloads, int streamIndex, const QByteArray &payload)
+{
+    const qint64 row = table.appendRow(table.size(), table.size(), table.size() * 1000, 1,
+                                       static_cast<qint32>(payload.size()), static_cast<quint16>(streamIndex),
+                                       static_cast<quint8>(static_cast<quint8>(StreamType::Video) << PacketTable::StreamTypeShift));
+    payloads.indexPayload(table.nalUnits(), row, streamIndex, reinterpret_cast<const uchar *>(payload.constData()),
+                          payload.size());
+}
+
+} // namespace
+
+using namespace NalUnits;
+
+class TestPacketIndexCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+    void readsBackACompleteIndex();
+    void resumesAPartialIndex();
+    void ignoresAnIndexOfAnotherVersionOfTheFile();
+    void ignoresATruncatedIndex();
+    void keepsParsedSliceHeaders();
+
+private:
+    QTemporaryDir directory;
+    QString mediaPath;
+    QList<VideoStreamInfo> videoStreams;
+    QList<AudioStreamInfo> audioStreams;
+
+    void compareTables(const PacketTable &expected, const PacketTable &actual);
+};
+
+void TestPacketIndexCache::initTestCase()
+{
+    // Indexes go to a test cache directory, not the user's
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(directory.isValid());
+
+    mediaPath = directory.filePath("media.ts");
+    QFile media(mediaPath);
+    QVERIFY(media.open(QIODevice::WriteOnly));
+    media.write(QByteArray(188, '\x47'));
+    media.close();
+
+    VideoStreamInfo video;
+    video.streamIndex = 0;
+    video.codecId = "h264";
+    video.width = 1920;
+    video.height = 1080;
+    videoStreams.append(video);
+    AudioStreamInfo audio;
+    audio.streamIndex = 1;
+    audio.codecId = "aac";
+    audioStreams.append(audio);
+}
+
+void TestPacketIndexCache::cleanup()
+{
+    QFile::remove(PacketIndexCache(mediaPath).indexFilePath());
+}
+
+void TestPacketIndexCache::compareTables(const PacketTable &expected, const PacketTable &actual)
+{
+    QCOMPARE(actual.size(), expected.size());
+    for (qint64 row = 0; row < expected.size(); ++row) {
+        QCOMPARE(actual.pts(row), expected.pts(row));
+        QCOMPARE(actual.dts(row), expected.dts(row));
+        QCOMPARE(actual.pos(row), expected.pos(row));
+        QCOMPARE(actual.duration(row), expected.duration(row));
+        QCOMPARE(actual.packetSize(row), expected.packetSize(row));
+        QCOMPARE(actual.streamIndex(row), expected.streamIndex(row));
+        QCOMPARE(actual.flags(row), expected.flags(row));
+    }
+
+    const NalIndex &expectedUnits = expected.nalUnits();
+    const NalIndex &actualUnits = actual.nalUnits();
+    QCOMPARE(actualUnits.size(), expectedUnits.size());
+    for (qint64 row = 0; row < expectedUnits.size(); ++row) {
+        QCOMPARE(actualUnits.packetRow(row), expectedUnits.packetRow(row));
+        QCOMPARE(actualUnits.offset(row), expectedUnits.offset(row));
+        QCOMPARE(actualUnits.unitSize(row), expectedUnits.unitSize(row));
+        QCOMPARE(actualUnits.type(row), expectedUnits.type(row));
+        QCOMPARE(int(actualUnits.codec(row)), int(expectedUnits.codec(row)));
+        QCOMPARE(actualUnits.emulationBytes(row), expectedUnits.emulationBytes(row));
+        const NalSliceHeader &expectedHeader = expectedUnits.sliceHeader(row);
+        const NalSliceHeader &actualHeader = actualUnits.sliceHeader(row);
+        QCOMPARE(actualHeader.firstMb, expectedHeader.firstMb);
+        QCOMPARE(actualHeader.frameNum, expectedHeader.frameNum);
+        QCOMPARE(actualHeader.poc, expectedHeader.poc);
+        QCOMPARE(actualHeader.sliceType, expectedHeader.sliceType);
+        QCOMPARE(actualHeader.qpDelta, expectedHeader.qpDelta);
+        QCOMPARE(actualHeader.qp, expectedHeader.qp);
+        QCOMPARE(actualHeader.refIdxL0, expectedHeader.refIdxL0);
+        QCOMPARE(actualHeader.refIdxL1, expectedHeader.refIdxL1);
+        QCOMPARE(actualHeader.ppsId, expectedHeader.ppsId);
+        QCOMPARE(actualHeader.fieldPic, expectedHeader.fieldPic);
+        QCOMPARE(actualHeader.entryPoints, expectedHeader.entryPoints);
+        QCOMPARE(actualHeader.tileColumns, expectedHeader.tileColumns);
+        QCOMPARE(actualHeader.tileRows, expectedHeader.tileRows);
+        QCOMPARE(actualHeader.wavefront, expectedHeader.wavefront);
+        QCOMPARE(actualHeader.dependent, expectedHeader.dependent);
+        QCOMPARE(actualHeader.rpsNegative, expectedHeader.rpsNegative);
+        QCOMPARE(actualHeader.rpsPositive, expectedHeader.rpsPositive);
+        QCOMPARE(actualHeader.rpsUsed, expectedHeader.rpsUsed);
+        QCOMPARE(actualHeader.longTermRefs, expectedHeader.longTermRefs);
+    }
+}
+
+void TestPacketIndexCache::readsBackACompleteIndex()
+{
+    PacketTable table;
+    fill(table, 0, kPacketCount);
+    QVERIFY(PacketIndexCache::save(mediaPath, videoStreams, audioStreams, 2, table));
+
+    PacketIndexCache cache(mediaPath);
+    QVERIFY(cache.load());
+    QVERIFY(cache.isComplete());
+    QCOMPARE(cache.packetCount(), kPacketCount);
+    QCOMPARE(cache.storedChunkCount(), qint64(2));
+    QCOMPARE(cache.storedNalChunkCount(), table.nalUnits().size() / NalIndex::ChunkSize);
+
+    QList<VideoStreamInfo> videos;
+    QList<AudioStreamInfo> audios;
+    int totalStreams = 0;
+    cache.streamInfo(videos, audios, totalStreams);
+    QCOMPARE(totalStreams, 2);
+    QCOMPARE(int(videos.size()), 1);
+    QCOMPARE(videos.first().codecId, QString("h264"));
+    QCOMPARE(videos.first().width, 1920);
+    QCOMPARE(int(audios.size()), 1);
+    QCOMPARE(audios.first().codecId, QString("aac"));
+
+    PacketTable restored;
+    QVERIFY(cache.attachPackets(restored));
+    compareTables(table, restored);
+}
+
+void TestPacketIndexCache::resumesAPartialIndex()
+{
+    // A parse that stops after a checkpoint leaves a partial index
+    PacketTable partial;
+    fill(partial, 0, PacketTable::ChunkSize + 1000);
+    {
+        PacketIndexWriter writer(mediaPath);
+        QVERIFY(writer.open(videoStreams, audioStreams, 2, 0, 0));
+        ParseCheckpoint checkpoint;
+        checkpoint.coveredSpans.append(qMakePair(qint64(0), qint64(4096)));
+        checkpoint.openStart = 4096;
+        checkpoint.openEnd = 8192;
+        QVERIFY(writer.write(partial, &checkpoint));
+    }
+
+    PacketTable resumed;
+    qint64 storedChunks = 0;
+    qint64 storedNalChunks = 0;
+    {
+        PacketIndexCache cache(mediaPath);
+        QVERIFY(!cache.load());
+        QVERIFY(cache.load(true));
+        QVERIFY(!cache.isComplete());
+        QCOMPARE(int(cache.checkpoint().coveredSpans.size()), 1);
+        QCOMPARE(cache.checkpoint().coveredSpans.first().second, qint64(4096));
+        QCOMPARE(cache.checkpoint().openStart, qint64(4096));
+        QCOMPARE(cache.checkpoint().openEnd, qint64(8192));
+        QVERIFY(cache.attachPackets(resumed));
+        compareTables(partial, resumed);
+        storedChunks = cache.storedChunkCount();
+        storedNalChunks = cache.storedNalChunkCount();
+    }
+
+    // The next run appends to the rows it restored and completes the index
+    fill(resumed, resumed.size(), kPacketCount);
+    {
+        PacketIndexWriter writer(mediaPath);
+        QVERIFY(writer.open(videoStreams, audioStreams, 2, storedChunks, storedNalChunks));
+        ParseCheckpoint checkpoint;
+        QVERIFY(writer.write(resumed, &checkpoint));
+        QVERIFY(writer.write(resumed, nullptr));
+    }
+
+    PacketTable expected;
+    fill(expected, 0, kPacketCount);
+    PacketIndexCache cache(mediaPath);
+    QVERIFY(cache.load());
+    PacketTable restored;
+    QVERIFY(cache.attachPackets(restored));
+    compareTables(expected, restored);
+}
+
+void TestPacketIndexCache::ignoresAnIndexOfAnotherVersionOfTheFile()
+{
+    PacketTable table;
+    fill(table, 0, 1000);
+    QVERIFY(PacketIndexCache::save(mediaPath, videoStreams, audioStreams, 2, table));
+    const QString indexPath = PacketIndexCache(mediaPath).indexFilePath();
+
+    QFile media(mediaPath);
+    QVERIFY(media.open(QIODevice::Append));
+    media.write(QByteArray(188, '\x47'));
+    media.close();
+
+    PacketIndexCache cache(mediaPath);
+    QVERIFY(!cache.load());
+    QFile::remove(indexPath);
+}
+
+void TestPacketIndexCache::ignoresATruncatedIndex()
+{
+    PacketTable table;
+    fill(table, 0, kPacketCount);
+    QVERIFY(PacketIndexCache::save(mediaPath, videoStreams, audioStreams, 2, table));
+
+    PacketIndexCache cache(mediaPath);
+    QFile index(cache.indexFilePath());
+    QVERIFY(index.resize(index.size() / 2));
+    QVERIFY(!cache.load(true));
+}
+
+void TestPacketIndexCache::keepsParsedSliceHeaders()
+{
+    // H.264 and HEVC pictures split and parsed as in a parse pass, until the units fill
+    // a chunk and leave a partial one
+    NalPayloadIndexer payloads;
+    payloads.addStream(0, NalCodec::H264, QByteArray());
+    payloads.addStream(1, NalCodec::Hevc, QByteArray());
+    HevcPpsFields tiles;
+    tiles.tileColumns = 2;
+    PacketTable table;
+    for (int gop = 0; table.nalUnits().size() < NalIndex::ChunkSize + 1000; ++gop) {
+        H264Slice h264;
+        h264.idr = true;
+        h264.qpDelta = gop % 7 - 3;
+        appendPayload(table, payloads, 0, BitWriter::annexB({ h264Sps(0, 0), h264Pps(0, 0), h264Slice(h264) }));
+        h264.idr = false;
+        h264.type = H264P;
+        h264.frameNum = 1;
+        h264.pocLsb = 4;
+        appendPayload(table, payloads, 0, BitWriter::annexB({ h264Slice(h264) }));
+        h264.type = H264B;
+        h264.reference = false;
+        h264.frameNum = 2;
+        h264.pocLsb = 2;
+        appendPayload(table, payloads, 0, BitWriter::annexB({ h264Slice(h264) }));
+
+        HevcSlice hevc;
+        hevc.qpDelta = gop % 5;
+        hevc.entryPoints = 1;
+        appendPayload(table, payloads, 1, BitWriter::annexB({ hevcSps(), hevcPps(tiles), hevcSlice(hevc, tiles) }));
+        hevc.unitType = HevcTrailR;
+        hevc.type = HevcP;
+        hevc.pocLsb = 1;
+        appendPayload(table, payloads, 1, BitWriter::annexB({ hevcSlice(hevc, tiles) }));
+    }
+
+    QVERIFY(PacketIndexCache::save(mediaPath, videoStreams, audioStreams, 2, table));
+    PacketIndexCache cache(mediaPath);
+    QVERIFY(cache.load());
+    PacketTable restored;
+    QVERIFY(cache.attachPackets(restored));
+    compareTables(table, restored);
+
+    // Spot checks that the headers compared were parsed ones, in the stored chunk and the tail
+    const NalIndex &units = restored.nalUnits();
+    for (qint64 gopStart : { qint64(0), table.size() - 5 }) {
+        qint64 first = 0;
+        QCOMPARE(units.unitsOf(gopStart + 1, first), 1);
+        QCOMPARE(int(units.sliceHeader(first).sliceType), int(H264P));
+        QCOMPARE(units.sliceHeader(first).poc, 4);
+        QCOMPARE(int(units.sliceHeader(first).refIdxL0), 1);
+        QCOMPARE(units.unitsOf(gopStart + 4, first), 1);
+        QCOMPARE(units.sliceHeader(first).poc, 1);
+        QCOMPARE(int(units.sliceHeader(first).tileColumns), 2);
+        QCOMPARE(int(units.sliceHeader(first).entryPoints), 1);
+        QCOMPARE(int(units.sliceHeader(first).rpsNegative), 1);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestPacketIndexCache)
+#include "tst_packetindexcache.moc"
@@ -0,0 +1,209 @@
+#include "parseschedule.h"
+#include <QtTest>
+
+namespace {
+
+using Spans = QVector<QPair<qint64, qint64>>;
+
+Spans spans(std::initializer_list<QPair<qint64, qint64>> list)
+{
+    return Spans(list);
+}
+
+} // namespace
+
+class TestParseSchedule : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void mergesAdjacentSpans();
+    void mergesOverlappingSpans();
+    void swallowsContainedSpans();
+    void clipsSpansToTheInput();
+    void answersPositionQueries();
+    void findsGapsWrappingAround();
+    void placesPositionRequests();
+    void placesTimeRequests();
+};
+
+void TestParseSchedule::mergesAdjacentSpans()
+{
+    ParseSchedule schedule;
+    schedule.setInput(1000, 0, 0);
+    schedule.markCovered(100, 200);
+    schedule.markCovered(200, 300);
+    schedule.markCovered(50, 100);
+    QCOMPARE(schedule.coveredSpans(), spans({ { 50, 300 } }));
+    QCOMPARE(schedule.coveredBytes(), qint64(250));
+
+    // A span that fills the gap between two joins them
+    schedule.markCovered(400, 500);
+    schedule.markCovered(300, 400);
+    QCOMPARE(schedule.coveredSpans(), spans({ { 50, 500 } }));
+    QCOMPARE(schedule.coveredBytes(), qint64(450));
+}
+
+void TestParseSchedule::mergesOverlappingSpans()
+{
+    ParseSchedule schedule;
+    schedule.setInput(1000, 0, 0);
+    schedule.markCovered(100, 200);
+    schedule.markCovered(150, 250);
+    QCOMPARE(schedule.coveredSpans(), spans({ { 100, 250 } }));
+    schedule.markCovered(50, 120);
+    QCOMPARE(schedule.coveredSpans(), spans({ { 50, 250 } }));
+    QCOMPARE(schedule.coveredBytes(), qint64(200));
+
+    // Overlapping two spans at once
+    schedule.markCovered(400, 500);
+    schedule.markCovered(240, 410);
+    QCOMPARE(schedule.coveredSpans(), spans({ { 50, 500 } }));
+    QCOMPARE(schedule.coveredBytes(), qint64(450));
+}
+
+void TestParseSchedule::swallowsContainedSpans()
+{
+    ParseSchedule schedule;
+    schedule.setInput(1000, 0, 0);
+    schedule.markCovered(100, 200);
+    schedule.markCovered(300, 400);
+    schedule.markCovered(500, 600);
+    QCOMPARE(schedule.coveredBytes(), qint64(300));
+
+    // A span inside a covered one changes nothing
+    schedule.markCovered(120, 180);
+    QCOMPARE(schedule.coveredSpans(), spans({ { 100, 200 }, { 300, 400 }, { 500, 600 } }));
+    QCOMPARE(schedule.coveredBytes(), qint64(300));
+
+    // A span around several swallows them
+    schedule.markCovered(250, 650);
+    QCOMPARE(schedule.coveredSpans(), spans({ { 100, 200 }, { 250, 650 } }));
+    QCOMPARE(schedule.coveredBytes(), qint64(500));
+    schedule.markCovered(0, 1000);
+    QCOMPARE(schedule.coveredSpans(), spans({ { 0, 1000 } }));
+    QCOMPARE(schedule.coveredBytes(), qint64(1000));
+}
+
+void TestParseSchedule::clipsSpansToTheInput()
+{
+    ParseSchedule schedule;
+    schedule.setInput(1000, 0, 0);
+    schedule.markCovered(-50, 100);
+    schedule.markCovered(900, 2000);
+    schedule.markCovered(500, 500);
+    schedule.markCovered(700, 600);
+    schedule.markCovered(1200, 1300);
+    QCOMPARE(schedule.coveredSpans(), spans({ { 0, 100 }, { 900, 1000 } }));
+    QCOMPARE(schedule.coveredBytes(), qint64(200));
+}
+
+void TestParseSchedule::answersPositionQueries()
+{
+    ParseSchedule schedule;
+    schedule.setInput(1000, 0, 0);
+    schedule.markCovered(100, 200);
+    schedule.markCovered(300, 400);
+
+    QVERIFY(!schedule.isCovered(99));
+    QVERIFY(schedule.isCovered(100));
+    QVERIFY(schedule.isCovered(199));
+    QVERIFY(!schedule.isCovered(200));
+
+    QCOMPARE(schedule.coveredEnd(50), qint64(50));
+    QCOMPARE(schedule.coveredEnd(100), qint64(200));
+    QCOMPARE(schedule.coveredEnd(150), qint64(200));
+    QCOMPARE(schedule.coveredEnd(200), qint64(200));
+
+    QCOMPARE(schedule.nextCoveredStart(0), qint64(100));
+    QCOMPARE(schedule.nextCoveredStart(150), qint64(300));
+    QCOMPARE(schedule.nextCoveredStart(250), qint64(300));
+    QCOMPARE(schedule.nextCoveredStart(300), qint64(1000));
+    QCOMPARE(schedule.nextCoveredStart(500), qint64(1000));
+}
+
+void TestParseSchedule::findsGapsWrappingAround()
+{
+    ParseSchedule schedule;
+    schedule.setInput(1000, 0, 0);
+    QCOMPARE(schedule.firstGap(0), qint64(0));
+    QCOMPARE(schedule.firstGap(400), qint64(400));
+
+    schedule.markCovered(0, 100);
+    schedule.markCovered(200, 1000);
+    QCOMPARE(schedule.firstGap(0), qint64(100));
+    QCOMPARE(schedule.firstGap(50), qint64(100));
+    QCOMPARE(schedule.firstGap(150), qint64(150));
+
+    // Past the last gap the search starts over from the beginning
+    QCOMPARE(schedule.firstGap(300), qint64(100));
+    QCOMPARE(schedule.firstGap(1000), qint64(100));
+
+    schedule.markCovered(100, 200);
+    QCOMPARE(schedule.firstGap(0), qint64(-1));
+    QCOMPARE(schedule.firstGap(500), qint64(-1));
+}
+
+void TestParseSchedule::placesPositionRequests()
+{
+    ParseSchedule schedule;
+    qint64 position = -1;
+    QVERIFY(!schedule.hasRequest());
+    QVERIFY(!schedule.takeRequest(position));
+
+    // Without an input size a request cannot be placed, and is dropped
+    schedule.requestPosition(400);
+    QVERIFY(schedule.hasRequest());
+    QVERIFY(!schedule.takeRequest(position));
+    QVERIFY(!schedule.hasRequest());
+
+    schedule.setInput(1000, 0, 0);
+    schedule.requestPosition(400);
+    QVERIFY(schedule.takeRequest(position));
+    QCOMPARE(position, qint64(400));
+    QVERIFY(!schedule.hasRequest());
+    QVERIFY(!schedule.takeRequest(position));
+
+    // Positions are clamped to the input; a later request replaces an earlier one
+    schedule.requestPosition(-5);
+    QVERIFY(schedule.takeRequest(position));
+    QCOMPARE(position, qint64(0));
+    schedule.requestPosition(10);
+    schedule.requestPosition(5000);
+    QVERIFY(schedule.takeRequest(position));
+    QCOMPARE(position, qint64(999));
+}
+
+void TestParseSchedule::placesTimeRequests()
+{
+    ParseSchedule schedule;
+    qint64 position = -1;
+
+    // With a duration, times map linearly onto the input
+    schedule.setInput(1000, 100, 8000);
+    schedule.requestTime(25);
+    QVERIFY(schedule.takeRequest(position));
+    QCOMPARE(position, qint64(250));
+    schedule.requestTime(500);
+    QVERIFY(schedule.takeRequest(position));
+    QCOMPARE(position, qint64(999));
+    schedule.requestPosition(10);
+    schedule.requestTime(50);
+    QVERIFY(schedule.takeRequest(position));
+    QCOMPARE(position, qint64(500));
+
+    // Without one, through the bit rate
+    schedule.setInput(1000, 0, 8000);
+    schedule.requestTime(0.5);
+    QVERIFY(schedule.takeRequest(position));
+    QCOMPARE(position, qint64(500));
+
+    // Without either a time cannot be placed
+    schedule.setInput(1000, 0, 0);
+    schedule.requestTime(1);
+    QVERIFY(!schedule.takeRequest(position));
+    QVERIFY(!schedule.hasRequest());
+}
+
+QTEST_GUILESS_MAIN(TestParseSchedule)
+#include "tst_parseschedule.moc"
@@ -0,0 +1,164 @@
+#include "sliceprocessor.h"
+#include <QThread>
+#include <QtTest>
+#include <memory>
+
+namespace {
+
+// A delivered range of rows, or with no rows the end of a job
+struct Delivery {
+    quint32 generation;
+    qint64 firstIndex;
+    int count;
+};
+
+// The rows a job published, as one contiguous span
+struct Span {
+    quint32 generation;
+    qint64 first;
+    qint64 end;
+};
+
+constexpr unsigned long kTimeoutMs = 60000;
+
+} // namespace
+
+class TestSliceProcessor : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void deliversEveryRowBeforeTheEndMark();
+    void mergesRangesDrainedTogether();
+    void refusesRangesOnceStopped();
+
+private:
+    QVector<Delivery> deliveries;
+
+    void record(SliceProcessor &processor);
+};
+
+void TestSliceProcessor::init()
+{
+    deliveries.clear();
+}
+
+// Direct connections run in the processor's thread, the only one appending
+void TestSliceProcessor::record(SliceProcessor &processor)
+{
+    connect(&processor, &SliceProcessor::slicesBatchProcessed, this,
+            [this](quint32 generation, qint64 firstIndex, int count) {
+                deliveries.append({ generation, firstIndex, count });
+            },
+            Qt::DirectConnection);
+    connect(&processor, &SliceProcessor::processingFinished, this,
+            [this](quint32 generation) { deliveries.append({ generation, 0, 0 }); }, Qt::DirectConnection);
+}
+
+void TestSliceProcessor::deliversEveryRowBeforeTheEndMark()
+{
+    SliceProcessor processor;
+    record(processor);
+    processor.start();
+    std::unique_ptr<QThread> thread(QThread::create([&processor] { processor.process(); }));
+    thread->start();
+
+    // Far more ranges than the ring holds, in sizes of one to seven rows; the second job
+    // skips rows, and the empty ranges in between are dropped
+    const Span spans[] = { { 1, 0, 300000 }, { 2, 0, 5000 }, { 2, 10000, 12000 } };
+    bool published = true;
+    for (quint32 generation = 1; generation <= 2; ++generation) {
+        for (const Span &span : spans) {
+            if (span.generation != generation) {
+                continue;
+            }
+            for (qint64 row = span.first; row < span.end && published;) {
+                const int count = static_cast<int>(qMin<qint64>(1 + row % 7, span.end - row));
+                published = processor.publish({ generation, row, 0 }) && processor.publish({ generation, row, count });
+                row += count;
+            }
+        }
+        published = published && processor.finish(generation);
+    }
+    processor.stop();
+    QVERIFY(thread->wait(kTimeoutMs));
+    QVERIFY(published);
+
+    // Each job's rows arrive in order and in full, then its end mark
+    int delivery = 0;
+    for (quint32 generation = 1; generation <= 2; ++generation) {
+        for (const Span &span : spans) {
+            if (span.generation != generation) {
+                continue;
+            }
+            qint64 row = span.first;
+            while (row < span.end && delivery < deliveries.size()) {
+                const Delivery &range = deliveries.at(delivery++);
+                QCOMPARE(range.generation, generation);
+                QCOMPARE(range.firstIndex, row);
+                QVERIFY(range.count > 0);
+                row += range.count;
+            }
+            QCOMPARE(row, span.end);
+        }
+        QVERIFY(delivery < deliveries.size());
+        QCOMPARE(deliveries.at(delivery).generation, generation);
+        QCOMPARE(deliveries.at(delivery).count, 0);
+        ++delivery;
+    }
+    QCOMPARE(delivery, int(deliveries.size()));
+}
+
+void TestSliceProcessor::mergesRangesDrainedTogether()
+{
+    // Everything is on the ring before the processor drains it, so one pass sees it all
+    SliceProcessor processor;
+    record(processor);
+    processor.start();
+    QVERIFY(processor.publish({ 1, 0, 10 }));
+    QVERIFY(processor.publish({ 1, 10, 5 }));
+    QVERIFY(processor.publish({ 1, 15, 1 }));
+    QVERIFY(processor.publish({ 1, 20, 4 }));
+    QVERIFY(processor.finish(1));
+    QVERIFY(processor.publish({ 2, 24, 6 }));
+    QVERIFY(processor.publish({ 3, 30, 2 }));
+    QVERIFY(processor.publish({ 3, 32, 2 }));
+    QVERIFY(processor.finish(3));
+
+    // A stopped processor delivers what is left and returns
+    processor.stop();
+    processor.process();
+
+    // Adjacent rows of one job merge; gaps, job changes and end marks split
+    const Delivery expected[] = { { 1, 0, 16 }, { 1, 20, 4 }, { 1, 0, 0 }, { 2, 24, 6 }, { 3, 30, 4 }, { 3, 0, 0 } };
+    QCOMPARE(int(deliveries.size()), 6);
+    for (int i = 0; i < 6; ++i) {
+        QCOMPARE(deliveries.at(i).generation, expected[i].generation);
+        QCOMPARE(deliveries.at(i).firstIndex, expected[i].firstIndex);
+        QCOMPARE(deliveries.at(i).count, expected[i].count);
+    }
+}
+
+void TestSliceProcessor::refusesRangesOnceStopped()
+{
+    SliceProcessor processor;
+    record(processor);
+    processor.start();
+    QVERIFY(processor.isRunning());
+    processor.stop();
+    QVERIFY(!processor.isRunning());
+    QVERIFY(!processor.publish({ 1, 0, 5 }));
+    QVERIFY(!processor.finish(1));
+
+    // Restarting reopens the ring for the next job
+    processor.start();
+    QVERIFY(processor.publish({ 2, 0, 5 }));
+    processor.stop();
+    processor.process();
+    QCOMPARE(int(deliveries.size()), 1);
+    QCOMPARE(deliveries.at(0).generation, quint32(2));
+}
+
+QTEST_GUILESS_MAIN(TestSliceProcessor)
+#include "tst_sliceprocessor.moc"
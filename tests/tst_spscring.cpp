@@ -0,0 +1,179 @@
+#include "spscring.h"
+#include <QThread>
+#include <QtTest>
+#include <memory>
+
+namespace {
+
+// Enough records to wrap a small ring thousands of times
+constexpr quint64 kRecordCount = 4000000;
+
+// Long enough for a waiting side to spend its yields and park on the wait condition
+constexpr unsigned long kParkMs = 100;
+
+constexpr unsigned long kTimeoutMs = 60000;
+
+// Wait for the threads. On a timeout close the ring so a stuck side returns, then report failure.
+template <typename T>
+bool finishes(SpscRing<T> &ring, std::initializer_list<QThread *> threads)
+{
+    bool finished = true;
+    for (QThread *thread : threads) {
+        if (!thread->wait(kTimeoutMs)) {
+            finished = false;
+            ring.close();
+            thread->wait();
+        }
+    }
+    return finished;
+}
+
+} // namespace
+
+class TestSpscRing : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundsCapacityUpToAPowerOfTwo();
+    void deliversRecordsInOrderAcrossWraps();
+    void wakesAParkedConsumer();
+    void wakesAParkedProducer();
+    void closeReleasesBothSides();
+};
+
+void TestSpscRing::roundsCapacityUpToAPowerOfTwo()
+{
+    QCOMPARE(SpscRing<int>(0).capacity(), size_t(2));
+    QCOMPARE(SpscRing<int>(64).capacity(), size_t(64));
+    QCOMPARE(SpscRing<int>(1000).capacity(), size_t(1024));
+}
+
+void TestSpscRing::deliversRecordsInOrderAcrossWraps()
+{
+    SpscRing<quint64> ring(256);
+    std::unique_ptr<QThread> producer(QThread::create([&ring] {
+        for (quint64 value = 0; value < kRecordCount; ++value) {
+            if (!ring.push(value)) {
+                return;
+            }
+        }
+        ring.close();
+    }));
+
+    // The consumer drains in batches of varying size so pops straddle the wrap
+    quint64 received = 0;
+    quint64 misplaced = 0;
+    std::unique_ptr<QThread> consumer(QThread::create([&ring, &received, &misplaced] {
+        quint64 batch[97];
+        size_t count;
+        while ((count = ring.pop(batch, 1 + received % 97)) > 0) {
+            for (size_t i = 0; i < count; ++i) {
+                if (batch[i] != received) {
+                    ++misplaced;
+                }
+                ++received;
+            }
+        }
+    }));
+    consumer->start();
+    producer->start();
+    QVERIFY(finishes(ring, { producer.get(), consumer.get() }));
+
+    QCOMPARE(received, kRecordCount);
+    QCOMPARE(misplaced, quint64(0));
+    QVERIFY(ring.isEmpty());
+}
+
+void TestSpscRing::wakesAParkedConsumer()
+{
+    SpscRing<int> ring(4);
+    int values[3] = {};
+    size_t counts[3] = {};
+    std::unique_ptr<QThread> consumer(QThread::create([&ring, &values, &counts] {
+        for (int round = 0; round < 3; ++round) {
+            counts[round] = ring.pop(&values[round], 1);
+        }
+    }));
+    consumer->start();
+
+    // Each round the consumer finds the ring empty, parks, and is woken by the push
+    bool parked = true;
+    for (int round = 0; round < 3; ++round) {
+        QThread::msleep(kParkMs);
+        parked = parked && !consumer->isFinished();
+        ring.push(10 + round);
+    }
+    QVERIFY(finishes(ring, { consumer.get() }));
+    QVERIFY(parked);
+    for (int round = 0; round < 3; ++round) {
+        QCOMPARE(counts[round], size_t(1));
+        QCOMPARE(values[round], 10 + round);
+    }
+}
+
+void TestSpscRing::wakesAParkedProducer()
+{
+    SpscRing<int> ring(2);
+    bool pushed = false;
+    std::unique_ptr<QThread> producer(QThread::create([&ring, &pushed] {
+        pushed = ring.push(0) && ring.push(1) && ring.push(2);
+    }));
+    producer->start();
+
+    // The third push finds the ring full and parks until a pop frees a slot
+    QThread::msleep(kParkMs);
+    const bool parked = !producer->isFinished();
+    int values[3] = {};
+    size_t count = ring.pop(values, 1);
+    QVERIFY(finishes(ring, { producer.get() }));
+    QVERIFY(parked);
+    QVERIFY(pushed);
+    while (count < 3) {
+        const size_t popped = ring.pop(values + count, 3 - count);
+        QVERIFY(popped > 0);
+        count += popped;
+    }
+    QCOMPARE(values[0], 0);
+    QCOMPARE(values[1], 1);
+    QCOMPARE(values[2], 2);
+}
+
+void TestSpscRing::closeReleasesBothSides()
+{
+    // A parked consumer returns empty-handed, a parked producer fails
+    SpscRing<int> ring(2);
+    size_t count = 1;
+    int value = 0;
+    std::unique_ptr<QThread> consumer(QThread::create([&ring, &count, &value] { count = ring.pop(&value, 1); }));
+    consumer->start();
+    QThread::msleep(kParkMs);
+    ring.close();
+    QVERIFY(finishes(ring, { consumer.get() }));
+    QCOMPARE(count, size_t(0));
+
+    ring.reopen();
+    QVERIFY(ring.push(1));
+    QVERIFY(ring.push(2));
+    bool pushed = true;
+    std::unique_ptr<QThread> producer(QThread::create([&ring, &pushed] { pushed = ring.push(3); }));
+    producer->start();
+    QThread::msleep(kParkMs);
+    ring.close();
+    QVERIFY(finishes(ring, { producer.get() }));
+    QVERIFY(!pushed);
+
+    // Pushes fail once closed, while pops drain what is left
+    QVERIFY(!ring.push(4));
+    int values[4] = {};
+    size_t drained = 0;
+    while (const size_t popped = ring.pop(values + drained, 4 - drained)) {
+        drained += popped;
+    }
+    QCOMPARE(drained, size_t(2));
+    QCOMPARE(values[0], 1);
+    QCOMPARE(values[1], 2);
+}
+
+QTEST_GUILESS_MAIN(TestSpscRing)
+#include "tst_spscring.moc"
@@ -0,0 +1,364 @@
+#include "tsshardparser.h"
+#include "parseschedule.h"
+#include "nalunits.h"
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <algorithm>
+#include <tuple>
+
+using namespace NalUnits;
+
+namespace {
+
+constexpr int kVideoPid = 0x100;
+constexpr int kAudioPid = 0x101;
+constexpr int kFrameCount = 240;
+constexpr int kGopLength = 40;          // Long enough for the 6-bit POC LSB to wrap inside a GOP
+constexpr int kBigFrame = 100;          // A picture spanning several shards
+constexpr int kRandomAccessFrame = 130; // A P picture flagged by the random access indicator
+constexpr qint64 kShardBytes = 100 * 188;
+
+// A 33-bit timestamp in the PES header layout, behind a four-bit prefix
+QByteArray timestamp(int prefix, qint64 value)
+{
+    QByteArray bytes(5, '\0');
+    bytes[0] = static_cast<char>((prefix << 4) | ((value >> 29) & 0x0E) | 1);
+    bytes[1] = static_cast<char>(value >> 22);
+    bytes[2] = static_cast<char>(((value >> 14) & 0xFE) | 1);
+    bytes[3] = static_cast<char>(value >> 7);
+    bytes[4] = static_cast<char>(((value << 1) & 0xFE) | 1);
+    return bytes;
+}
+
+// A PES packet with a PTS and DTS; video packets leave the length open
+QByteArray pesPacket(uchar streamId, qint64 pts, qint64 dts, const QByteArray &payload, bool bounded)
+{
+    const QByteArray fields = timestamp(3, pts) + timestamp(1, dts);
+    const int length = bounded ? 3 + fields.size() + payload.size() : 0;
+    QByteArray bytes = QByteArray::fromHex("000001");
+    bytes.append(static_cast<char>(streamId));
+    bytes.append(static_cast<char>(length >> 8)).append(static_cast<char>(length & 0xFF));
+    bytes.append('\x80').append('\xC0').append(static_cast<char>(fields.size()));
+    return bytes + fields + payload;
+}
+
+// The transport packets of a PES packet; the last one is filled with adaptation field stuffing
+QList<QByteArray> transportPackets(int pid, const QByteArray &pes, bool randomAccess, QHash<int, int> &counters)
+{
+    QList<QByteArray> packets;
+    for (int offset = 0; offset < pes.size();) {
+        const bool first = offset == 0;
+        const int chunk = qMin(first && randomAccess ? 182 : 184, pes.size() - offset);
+        const int adaptation = 184 - chunk;
+        int &counter = counters[pid];
+
+        QByteArray packet;
+        packet.append('\x47');
+        packet.append(static_cast<char>((first ? 0x40 : 0) | (pid >> 8)));
+        packet.append(static_cast<char>(pid & 0xFF));
+        packet.append(static_cast<char>((adaptation > 0 ? 0x30 : 0x10) | counter));
+        if (adaptation > 0) {
+            packet.append(static_cast<char>(adaptation - 1));
+            if (adaptation > 1) {
+                packet.append(first && randomAccess ? '\x40' : '\0');
+                packet.append(QByteArray(adaptation - 2, '\xFF'));
+            }
+        }
+        packet.append(pes.mid(offset, chunk));
+        packets.append(packet);
+        counter = (counter + 1) & 0x0F;
+        offset += chunk;
+    }
+    return packets;
+}
+
+// An H.264 picture of two slices; IDR pictures carry the parameter sets
+QByteArray picture(int frame)
+{
+    const int inGop = frame % kGopLength;
+    H264Slice slice;
+    slice.idr = inGop == 0;
+    slice.type = slice.idr ? H264I : H264P;
+    slice.frameNum = inGop % 16;
+    slice.pocLsb = (2 * inGop) % 64;
+    QList<QByteArray> units;
+    if (slice.idr) {
+        units = { h264Sps(0, 0), h264Pps(0, 0) };
+    }
+
+    // Slice data of a few kilobytes, without start codes
+    const int dataBytes = frame == kBigFrame ? 50000 : 1500 + (frame * 7919) % 9000;
+    units.append(h264Slice(slice) + QByteArray(dataBytes / 2, '\xA5'));
+    slice.firstMb = 4080;
+    units.append(h264Slice(slice) + QByteArray(dataBytes / 2, '\x5A'));
+    return BitWriter::annexB(units);
+}
+
+// A row with its units, with the fields the parser fills in
+struct Unit {
+    int type;
+    qint32 offset;
+    qint32 size;
+    int sliceType;
+    qint32 firstMb;
+    qint32 frameNum;
+    qint32 poc;
+
+    bool operator==(const Unit &other) const
+    {
+        return std::tie(type, offset, size, sliceType, firstMb, frameNum, poc)
+               == std::tie(other.type, other.offset, other.size, other.sliceType, other.firstMb, other.frameNum, other.poc);
+    }
+};
+
+struct Row {
+    qint64 pts;
+    qint64 dts;
+    qint64 pos;
+    qint32 size;
+    int streamIndex;
+    quint8 flags;
+    QVector<Unit> units;
+
+    bool operator==(const Row &other) const
+    {
+        return std::tie(pts, dts, pos, size, streamIndex, flags, units)
+               == std::tie(other.pts, other.dts, other.pos, other.size, other.streamIndex, other.flags, other.units);
+    }
+};
+
+// The rows of a table in file order
+QVector<Row> rowsOf(const PacketTable &table)
+{
+    QVector<Row> rows;
+    const NalIndex &index = table.nalUnits();
+    for (qint64 i = 0; i < table.size(); ++i) {
+        Row row = { table.pts(i), table.dts(i), table.pos(i), table.packetSize(i), table.streamIndex(i),
+                    table.flags(i), QVector<Unit>() };
+        qint64 first = 0;
+        const int count = index.unitsOf(i, first);
+        for (qint64 unit = first; unit < first + count; ++unit) {
+            const NalSliceHeader &header = index.sliceHeader(unit);
+            row.units.append({ index.type(unit), index.offset(unit), index.unitSize(unit), header.sliceType,
+                               header.firstMb, header.frameNum, header.poc });
+        }
+        rows.append(row);
+    }
+    std::sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) { return a.pos < b.pos; });
+    return rows;
+}
+
+} // namespace
+
+class TestTsShardParser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void matchesASingleShardScan();
+    void flagsRandomAccessPictures();
+    void skipsCoveredBytes();
+    void stitchesAPriorityClaimFirst();
+
+private:
+    QTemporaryDir directory;
+    QString path;
+    qint64 fileSize = 0;
+    QHash<int, StreamMapping> pidStreams;
+    QVector<Row> reference;
+
+    bool parse(PacketTable &table, qint64 shardBytes, ParseSchedule *schedule, QVector<QPair<qint64, int>> *stitched);
+};
+
+void TestTsShardParser::initTestCase()
+{
+    QVERIFY(directory.isValid());
+
+    StreamMapping video;
+    video.streamIndex = 0;
+    video.streamType = StreamType::Video;
+    video.nalCodec = NalCodec::H264;
+    pidStreams.insert(kVideoPid, video);
+    StreamMapping audio;
+    audio.streamIndex = 1;
+    audio.streamType = StreamType::Audio;
+    pidStreams.insert(kAudioPid, audio);
+
+    // Each picture is followed by two audio packets, whose transport packets interleave with
+    // the next picture's; a PAT-like packet of an unmapped PID opens each GOP
+    QHash<int, int> counters;
+    QList<QByteArray> audioPackets;
+    QByteArray file;
+    for (int frame = 0; frame < kFrameCount; ++frame) {
+        if (frame % kGopLength == 0) {
+            file += transportPackets(0, QByteArray(184, '\xFF'), false, counters).first();
+        }
+        const qint64 pts = 7200 + frame * 3600;
+        // Only every other IDR picture has the random access indicator
+        const bool randomAccess = frame % (2 * kGopLength) == 0 || frame == kRandomAccessFrame;
+        const QList<QByteArray> videoPackets = transportPackets(kVideoPid, pesPacket(0xE0, pts, pts - 3600, picture(frame), false),
+                                                                randomAccess, counters);
+        for (int i = 0; i < videoPackets.size(); ++i) {
+            file += videoPackets.at(i);
+            if (i % 8 == 7 && !audioPackets.isEmpty()) {
+                file += audioPackets.takeFirst();
+            }
+        }
+        for (int i = 0; i < 2; ++i) {
+            const qint64 audioPts = frame * 3600 + i * 1800;
+            audioPackets += transportPackets(kAudioPid, pesPacket(0xC0, audioPts, audioPts, QByteArray(300 + 40 * i, '\x33'), true),
+                                             false, counters);
+        }
+    }
+    for (const QByteArray &packet : audioPackets) {
+        file += packet;
+    }
+
+    path = directory.filePath("stream.ts");
+    QFile out(path);
+    QVERIFY(out.open(QIODevice::WriteOnly));
+    QCOMPARE(out.write(file), qint64(file.size()));
+    out.close();
+    fileSize = file.size();
+
+    // The reference is one shard over the whole file: a plain scan in file order
+    PacketTable table;
+    QVector<QPair<qint64, int>> stitched;
+    QVERIFY(parse(table, fileSize, nullptr, &stitched));
+    QCOMPARE(int(stitched.size()), 1);
+    QCOMPARE(table.size(), qint64(3 * kFrameCount));
+    reference = rowsOf(table);
+}
+
+bool TestTsShardParser::parse(PacketTable &table, qint64 shardBytes, ParseSchedule *schedule,
+                              QVector<QPair<qint64, int>> *stitched)
+{
+    TsShardParser parser(path, pidStreams, nullptr);
+    parser.setShardBytes(shardBytes);
+    return parser.run(table, [stitched](qint64 firstIndex, int count, qint64) {
+        stitched->append(qMakePair(firstIndex, count));
+    }, schedule);
+}
+
+void TestTsShardParser::matchesASingleShardScan()
+{
+    // Small shards put PES packets across every boundary, and the big picture makes its
+    // shard read through the next one to complete it
+    PacketTable table;
+    QVector<QPair<qint64, int>> stitched;
+    QVERIFY(parse(table, kShardBytes, nullptr, &stitched));
+    QCOMPARE(int(stitched.size()), int((fileSize + kShardBytes - 1) / kShardBytes));
+    QVERIFY(int(stitched.size()) > kFrameCount / 4);
+
+    // Without requests shards are stitched in file order, so the rows are already sorted
+    for (qint64 i = 1; i < table.size(); ++i) {
+        QVERIFY(table.pos(i) > table.pos(i - 1));
+    }
+    const QVector<Row> rows = rowsOf(table);
+    QCOMPARE(int(rows.size()), int(reference.size()));
+    for (int i = 0; i < rows.size(); ++i) {
+        QVERIFY2(rows.at(i) == reference.at(i), qPrintable(QString("row %1").arg(i)));
+    }
+}
+
+void TestTsShardParser::flagsRandomAccessPictures()
+{
+    // IDR pictures are key frames whether or not the random access indicator is set, as is
+    // the P picture that has it; audio packets always are
+    int frame = 0;
+    for (const Row &row : reference) {
+        if (row.streamIndex == 1) {
+            QVERIFY(row.flags & PacketTable::KeyFrameFlag);
+            continue;
+        }
+        const bool key = frame % kGopLength == 0 || frame == kRandomAccessFrame;
+        QCOMPARE(bool(row.flags & PacketTable::KeyFrameFlag), key);
+        QCOMPARE(int(row.units.size()), frame % kGopLength == 0 ? 4 : 2);
+        QCOMPARE(row.units.last().poc, 2 * (frame % kGopLength));
+        ++frame;
+    }
+    QCOMPARE(frame, kFrameCount);
+}
+
+void TestTsShardParser::skipsCoveredBytes()
+{
+    // Part of the second shard and all of the last one were covered by an earlier run
+    const qint64 lastShard = (fileSize - 1) / kShardBytes * kShardBytes;
+    ParseSchedule schedule;
+    schedule.setInput(fileSize, 0, 0);
+    schedule.markCovered(kShardBytes + 2000, kShardBytes + 9000);
+    schedule.markCovered(lastShard, fileSize);
+
+    PacketTable table;
+    QVector<QPair<qint64, int>> stitched;
+    QVERIFY(parse(table, kShardBytes, &schedule, &stitched));
+    QCOMPARE(int(stitched.size()), int((fileSize + kShardBytes - 1) / kShardBytes) - 1);
+    QCOMPARE(schedule.coveredBytes(), fileSize);
+
+    // Rows that start in the covered bytes are left out; the others are as in the reference
+    QVector<Row> expected;
+    for (const Row &row : reference) {
+        if (!(row.pos >= kShardBytes + 2000 && row.pos < kShardBytes + 9000) && row.pos < lastShard) {
+            expected.append(row);
+        }
+    }
+    QVERIFY(expected.size() < reference.size());
+    const QVector<Row> rows = rowsOf(table);
+    QCOMPARE(int(rows.size()), int(expected.size()));
+    for (int i = 0; i < rows.size(); ++i) {
+        QVERIFY2(rows.at(i) == expected.at(i), qPrintable(QString("row %1").arg(i)));
+    }
+}
+
+void TestTsShardParser::stitchesAPriorityClaimFirst()
+{
+    // A request in the middle of the file moves the first claim there
+    const int requestedShard = 30;
+    const qint64 shardStart = requestedShard * kShardBytes;
+    ParseSchedule schedule;
+    schedule.setInput(fileSize, 0, 0);
+    schedule.requestPosition(shardStart + 100);
+
+    PacketTable table;
+    QVector<QPair<qint64, int>> stitched;
+    QVERIFY(parse(table, kShardBytes, &schedule, &stitched));
+    QVERIFY(!stitched.isEmpty());
+    QVERIFY(stitched.first().second > 0);
+    for (qint64 i = stitched.first().first; i < stitched.first().first + stitched.first().second; ++i) {
+        QVERIFY(table.pos(i) >= shardStart && table.pos(i) < shardStart + kShardBytes);
+    }
+
+    // The claimed shard follows no stitched shard, so the pictures from its start to the next
+    // IDR have their headers parsed as in a parse that starts mid-stream; their units still
+    // match the reference, and everything else matches it in full
+    QVector<Row> rows = rowsOf(table);
+    QCOMPARE(int(rows.size()), int(reference.size()));
+    int midStream = 0;
+    for (int i = 0; i < rows.size(); ++i) {
+        if (rows.at(i).pos < shardStart || rows.at(i).streamIndex != 0) {
+            continue;
+        }
+        if (rows.at(i).units.first().type == 7) {
+            break;
+        }
+        QCOMPARE(int(rows.at(i).units.size()), int(reference.at(i).units.size()));
+        for (int unit = 0; unit < rows.at(i).units.size(); ++unit) {
+            Unit &parsed = rows[i].units[unit];
+            const Unit &scanned = reference.at(i).units.at(unit);
+            parsed.sliceType = scanned.sliceType;
+            parsed.firstMb = scanned.firstMb;
+            parsed.frameNum = scanned.frameNum;
+            parsed.poc = scanned.poc;
+        }
+        ++midStream;
+    }
+    QVERIFY(midStream > 0);
+    for (int i = 0; i < rows.size(); ++i) {
+        QVERIFY2(rows.at(i) == reference.at(i), qPrintable(QString("row %1").arg(i)));
+    }
+}
+
+QTEST_GUILESS_MAIN(TestTsShardParser)
+#include "tst_tsshardparser.moc"